@@ -40,8 +40,10 @@
 #define GET_ENV_FLAGS(flags, t_hi, t_lo, wt_enable, cache_inhibit,             \
 coherency, size, mode)                                                         \
 {                                                                              \
-    /* Get time, we prefer to use TSC to lower overhead */                     \
-    asm volatile("rdtsc" : "=a" (t_hi), "=d" (t_lo) : : "%rbx", "%rcx");       \
+    /* Get time, see QEM_TRACE_TIME_SOURCE */                                  \
+    uint64_t timestamp = qem_trace_get_time(ENV_GET_CPU(env));                 \
+    t_hi = (uint32_t)timestamp;                                                \
+    t_lo = (uint32_t)(timestamp >> 32);                                        \
                                                                                \
     /* To check the current ring we read MSR register */                       \
     flags |= (mode ? QEM_TRACE_PL_KERNEL : QEM_TRACE_PL_USER);                 \
@@ -78,7 +80,14 @@ coherency, size, mode)                                                         \
 void helper_qem_instld_trace(CPUARMState *env, target_ulong current_eip,
                              int size, int mmu_idx)
 {
-    if((qem_tracing_state & QEM_TRACE_ITRACE) != 0)
+    if(qem_tracing_state != 0 &&
+       qem_trace_filter_asid(ENV_GET_CPU(env)->cpu_index))
+    {
+        qem_trace_sample_tick(ENV_GET_CPU(env)->cpu_index);
+    }
+    if((qem_tracing_state & QEM_TRACE_ITRACE) != 0 &&
+       qem_trace_filter_asid(ENV_GET_CPU(env)->cpu_index) &&
+       qem_trace_sample_record(ENV_GET_CPU(env)->cpu_index))
     {
         target_ulong hwaddr;
         int32_t coherency_enabled;
@@ -90,6 +99,10 @@ void helper_qem_instld_trace(CPUARMState *env, target_ulong current_eip,
                                     &hwaddr,
                                     &wt_enable,
                                     &cache_inhibit, &coherency_enabled, &access_mode);
+        if(qem_trace_filter_phys(hwaddr) == 0)
+        {
+            return;
+        }
 
         /* Set flags */
         uint32_t flags = QEM_TRACE_EVENT_ACCESS | QEM_TRACE_ACCESS_TYPE_READ |
@@ -111,7 +124,10 @@ void helper_qem_instld_trace(CPUARMState *env, target_ulong current_eip,
 void helper_qem_datald_trace(CPUARMState *env, target_ulong addr,
                              int size, int mmu_idx, int exclusive)
 {
-    if((qem_tracing_state & QEM_TRACE_DTRACE) != 0)
+    if((qem_tracing_state & QEM_TRACE_DTRACE) != 0 &&
+       qem_trace_filter_asid(ENV_GET_CPU(env)->cpu_index) &&
+       qem_trace_filter_virt(addr) &&
+       qem_trace_sample_record(ENV_GET_CPU(env)->cpu_index))
     {
         target_ulong hwaddr;
         int32_t coherency_enabled;
@@ -123,6 +139,10 @@ void helper_qem_datald_trace(CPUARMState *env, target_ulong addr,
                                     &hwaddr,
                                     &wt_enable,
                                     &cache_inhibit, &coherency_enabled, &access_mode);
+        if(qem_trace_filter_phys(hwaddr) == 0)
+        {
+            return;
+        }
 
         /* Set flags */
         uint32_t flags = QEM_TRACE_EVENT_ACCESS | QEM_TRACE_ACCESS_TYPE_READ |
@@ -148,7 +168,10 @@ void helper_qem_datald_trace(CPUARMState *env, target_ulong addr,
 void helper_qem_datast_trace(CPUARMState *env, target_ulong addr,
                              int size, int mmu_idx, int exclusive)
 {
-    if((qem_tracing_state & QEM_TRACE_DTRACE) != 0)
+    if((qem_tracing_state & QEM_TRACE_DTRACE) != 0 &&
+       qem_trace_filter_asid(ENV_GET_CPU(env)->cpu_index) &&
+       qem_trace_filter_virt(addr) &&
+       qem_trace_sample_record(ENV_GET_CPU(env)->cpu_index))
     {
         target_ulong hwaddr;
         int32_t coherency_enabled;
@@ -160,6 +183,10 @@ void helper_qem_datast_trace(CPUARMState *env, target_ulong addr,
                                     &hwaddr,
                                     &wt_enable,
                                     &cache_inhibit, &coherency_enabled, &access_mode);
+        if(qem_trace_filter_phys(hwaddr) == 0)
+        {
+            return;
+        }
 
         /* Set flags */
         uint32_t flags = QEM_TRACE_EVENT_ACCESS | QEM_TRACE_ACCESS_TYPE_WRITE |
@@ -181,11 +208,123 @@ void helper_qem_datast_trace(CPUARMState *env, target_ulong addr,
     }
 }
 
+/* Traces the words of a load or store multiple, the address is translated once
+ * per page.
+ */
+static void qem_data_multi_trace(CPUARMState *env, target_ulong addr,
+                                 int count, int mmu_idx,
+                                 MMUAccessType access_type, uint32_t flags)
+{
+    uint32_t core = ENV_GET_CPU(env)->cpu_index;
+    uint32_t page_count;
+    uint32_t page_flags;
+
+    if((qem_tracing_state & QEM_TRACE_DTRACE) == 0 ||
+       qem_trace_filter_asid(core) == 0)
+    {
+        return;
+    }
+
+    while(count > 0)
+    {
+        target_ulong hwaddr;
+        int32_t coherency_enabled;
+        int32_t cache_inhibit;
+        int32_t wt_enable;
+        int32_t access_mode;
+        qem_arm_get_info_addr_mem_trace(env, addr, access_type,
+                                    (ARMMMUIdx)mmu_idx,
+                                    &hwaddr,
+                                    &wt_enable,
+                                    &cache_inhibit, &coherency_enabled, &access_mode);
+
+        page_count = qem_trace_multi_page_count(addr, count, 4);
+        page_flags = flags;
+
+        unsigned a, d;
+
+        GET_ENV_FLAGS(page_flags, a, d, wt_enable, cache_inhibit,
+                      coherency_enabled, 2, access_mode);
+
+        qem_trace_multi_output(core, addr, hwaddr,
+                               ((uint64_t) a) | ((uint64_t) d) << 32,
+                               page_flags, page_count, 4);
+
+        addr  += page_count * 4;
+        count -= page_count;
+    }
+}
+
+void helper_qem_datald_multi_trace(CPUARMState *env, target_ulong addr,
+                                   int count, int mmu_idx)
+{
+    qem_data_multi_trace(env, addr, count, mmu_idx, MMU_DATA_LOAD,
+                         QEM_TRACE_EVENT_ACCESS | QEM_TRACE_ACCESS_TYPE_READ |
+                         QEM_TRACE_DATA_TYPE_DATA);
+}
+
+void helper_qem_datast_multi_trace(CPUARMState *env, target_ulong addr,
+                                   int count, int mmu_idx)
+{
+    qem_data_multi_trace(env, addr, count, mmu_idx, MMU_DATA_STORE,
+                         QEM_TRACE_EVENT_ACCESS | QEM_TRACE_ACCESS_TYPE_WRITE |
+                         QEM_TRACE_DATA_TYPE_DATA);
+}
+
 /*********************************** MISC *************************************/
 
+#if QEM_TRACE_ASID_FILTER_ENABLED || QEM_TRACE_PC_TRIGGER_ENABLED
+/* Returns the identifier of the address space the CPU runs in. */
+static uint64_t qem_trace_get_asid(CPUARMState *env)
+{
+    uint64_t asid;
+    uint64_t ttbcr;
+    bool     secure;
+
+    secure = arm_is_secure(env) && !arm_el_is_aa64(env, 3);
+    ttbcr  = env->cp15.tcr_el[secure ? 3 : 1].raw_tcr;
+
+    /* LPAE keeps the ASID in the TTBR selected by TTBCR.A1, the short
+     * descriptors format in CONTEXTIDR
+     */
+    if((ttbcr & TTBCR_EAE) != 0)
+    {
+        asid = (ttbcr & TTBCR_A1) ? A32_BANKED_CURRENT_REG_GET(env, ttbr1) :
+                                    A32_BANKED_CURRENT_REG_GET(env, ttbr0);
+        asid = (asid >> 48) & 0xFF;
+    }
+    else
+    {
+        asid = A32_BANKED_CURRENT_REG_GET(env, contextidr) & 0xFF;
+    }
+
+    return asid;
+}
+#endif
+
+#if QEM_TRACE_ASID_FILTER_ENABLED
+void helper_qem_tb_enter_trace(CPUARMState *env)
+{
+    qem_trace_filter_asid_enter(ENV_GET_CPU(env)->cpu_index,
+                                qem_trace_get_asid(env));
+}
+#endif
+
+#if QEM_TRACE_PC_TRIGGER_ENABLED
+void helper_qem_pc_trigger(CPUARMState *env, target_ulong addr)
+{
+    qem_trace_trigger_fire(ENV_GET_CPU(env), addr, qem_trace_get_asid(env));
+}
+#endif
+
 void helper_qem_start_trace(CPUARMState *env, int type)
 {
     CPUState *cs = ENV_GET_CPU(env);
+
+    if(qem_trace_replay_traced() == 0)
+    {
+        return;
+    }
     qem_trace_enable(cs, (QEM_TRACE_TTYPE_E)type);
 }
 
@@ -193,4 +332,9 @@ void helper_qem_stop_trace(int type)
 {
     qem_trace_disable((QEM_TRACE_TTYPE_E)type);
 }
+
+void helper_qem_ring_trigger(CPUARMState *env, target_ulong addr)
+{
+    qem_trace_ring_trigger(ENV_GET_CPU(env)->cpu_index, addr);
+}
 #endif /* QEM_TRACE_ENABLED */
\ No newline at end of file
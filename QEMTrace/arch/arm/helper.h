@@ -32,8 +32,20 @@ DEF_HELPER_4(qem_instld_trace, void, env, tl, int, int)
 
 DEF_HELPER_5(qem_datald_trace, void, env, tl, int, int, int)
 DEF_HELPER_5(qem_datast_trace, void, env, tl, int, int, int)
+DEF_HELPER_4(qem_datald_multi_trace, void, env, tl, int, int)
+DEF_HELPER_4(qem_datast_multi_trace, void, env, tl, int, int)
+
+#if QEM_TRACE_ASID_FILTER_ENABLED
+DEF_HELPER_1(qem_tb_enter_trace, void, env)
+#endif
+
+#if QEM_TRACE_PC_TRIGGER_ENABLED
+DEF_HELPER_2(qem_pc_trigger, void, env, tl)
+#endif
 
 DEF_HELPER_2(qem_start_trace, void, env, int)
 DEF_HELPER_1(qem_stop_trace, void, int)
 
+DEF_HELPER_2(qem_ring_trigger, void, env, tl)
+
 #endif /* QEM_TRACE_ENABLED */
\ No newline at end of file
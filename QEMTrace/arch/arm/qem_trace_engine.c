@@ -63,6 +63,26 @@ extern bool get_phys_addr(CPUARMState *env, target_ulong address,
 extern bool regime_translation_disabled(CPUARMState *env,
                                                ARMMMUIdx mmu_idx);
 
+/* Last table walks of a core, direct mapped on the virtual page. Only the
+ * walk results are kept, the SCTLR cache enable bits and the CPU mode are read
+ * on each access. A core memo is emptied when Qemu flushes the core TLB, which
+ * it does each time the translation regime is modified.
+ */
+#define QEM_ARM_MEMO_CORES 64
+#define QEM_ARM_MEMO_SIZE  256
+
+typedef struct
+{
+    target_ulong page;    /* Virtual page                    */
+    uint32_t     mmu_idx; /* Translation regime of the walk  */
+    uint32_t     valid;
+    hwaddr       phys;    /* Physical page                   */
+    int32_t      cache_inhibit;
+    int32_t      write_through_enabled;
+} qem_arm_memo_t;
+
+static qem_arm_memo_t translation_memo[QEM_ARM_MEMO_CORES][QEM_ARM_MEMO_SIZE];
+
 void qem_arm_get_info_addr_mem_trace(CPUARMState *env, vaddr addr,
                                    int real_access_type, ARMMMUIdx mmu_idx,
                                    target_ulong* phys_addr,
@@ -72,19 +92,19 @@ void qem_arm_get_info_addr_mem_trace(CPUARMState *env, vaddr addr,
                                    int32_t* access_mode)
 {
     int prot;
+    int core;
     uint64_t reg;
+    hwaddr phys;
+    target_ulong page;
     target_ulong page_size;
     MemTxAttrs attrs;
     ARMMMUFaultInfo fi;
     ARMCacheAttrs cacheattrs;
+    qem_arm_memo_t* memo;
     *cache_inhibit = 0;
     *coherency_enabled = 0;
     *phys_addr = 0;
     *write_through_enabled = 0;
-    
-    memset(&attrs, 0, sizeof(attrs));
-    memset(&fi, 0, sizeof(fi));
-    memset(&cacheattrs, 0, sizeof(cacheattrs));
 
     /* Get the current CPSR */
     if((env->uncached_cpsr & 0x1F) != 0x10)
@@ -96,24 +116,65 @@ void qem_arm_get_info_addr_mem_trace(CPUARMState *env, vaddr addr,
         reg = env->cp15.sctlr_ns;
     }
 
-    get_phys_addr(env, addr,
-                        real_access_type, mmu_idx,
-                        (hwaddr*)phys_addr, &attrs, &prot,
-                        &page_size,
-                        &fi, &cacheattrs);
-    if(!regime_translation_disabled(env, mmu_idx))
+    memo = NULL;
+    page = addr & TARGET_PAGE_MASK;
+    core = ENV_GET_CPU(env)->cpu_index;
+    if(core < QEM_ARM_MEMO_CORES)
     {
-        *cache_inhibit = (cacheattrs.attrs & 0xF) == 0x4; 
-        *write_through_enabled = (cacheattrs.attrs & 0x7) < 4 ? 1 : 0; 
+        memo = &translation_memo[core][(page >> TARGET_PAGE_BITS) &
+                                       (QEM_ARM_MEMO_SIZE - 1)];
+    }
 
+    if(memo != NULL && memo->valid != 0 && memo->page == page &&
+       memo->mmu_idx == (uint32_t)mmu_idx)
+    {
+        phys = memo->phys | (addr & ~TARGET_PAGE_MASK);
+        *cache_inhibit = memo->cache_inhibit;
+        *write_through_enabled = memo->write_through_enabled;
     }
-    else 
+    else
     {
-        *cache_inhibit = 0;
-
-        /* Check cache mode TODO*/
-        *write_through_enabled = 1; 
+        phys = 0;
+        memset(&attrs, 0, sizeof(attrs));
+        memset(&fi, 0, sizeof(fi));
+        memset(&cacheattrs, 0, sizeof(cacheattrs));
+
+        page_size = 0;
+        if(get_phys_addr(env, addr,
+                         real_access_type, mmu_idx,
+                         &phys, &attrs, &prot,
+                         &page_size,
+                         &fi, &cacheattrs))
+        {
+            /* Faulting walks are not kept */
+            memo = NULL;
+        }
+        if(!regime_translation_disabled(env, mmu_idx))
+        {
+            *cache_inhibit = (cacheattrs.attrs & 0xF) == 0x4; 
+            *write_through_enabled = (cacheattrs.attrs & 0x7) < 4 ? 1 : 0; 
+
+        }
+        else 
+        {
+            *cache_inhibit = 0;
+
+            /* Check cache mode TODO*/
+            *write_through_enabled = 1; 
+        }
+
+        /* Tiny pages are smaller than a Qemu page */
+        if(memo != NULL && page_size >= TARGET_PAGE_SIZE)
+        {
+            memo->page = page;
+            memo->mmu_idx = mmu_idx;
+            memo->phys = phys & TARGET_PAGE_MASK;
+            memo->cache_inhibit = *cache_inhibit;
+            memo->write_through_enabled = *write_through_enabled;
+            memo->valid = 1;
+        }
     }
+    *phys_addr = phys;
 
     /* Check current CPU mode */
     *access_mode = (env->uncached_cpsr & 0x1F) != 0x10;
@@ -136,11 +197,20 @@ void qem_arm_get_info_addr_mem_trace(CPUARMState *env, vaddr addr,
 #if QEM_TRACE_PHYSICAL_ADDRESS == 0
     *phys_addr = addr;
 #endif 
-#else 
+#else
     *phys_addr = addr;
 #endif
     
     
 }
 
+void qem_trace_tlb_flush(CPUState* cs)
+{
+    if(cs->cpu_index < QEM_ARM_MEMO_CORES)
+    {
+        memset(translation_memo[cs->cpu_index], 0,
+               sizeof(translation_memo[cs->cpu_index]));
+    }
+}
+
 #endif /* QEM_TRACE_ENABLED */
\ No newline at end of file
@@ -40,78 +40,38 @@
 
 /**************************** ACCESS TRACE ************************************/
 
-static void flatview_read(FlatView *fv, hwaddr addr,
-                                 MemTxAttrs attrs, uint8_t *buf, int len)
-{
-    hwaddr l;
-    hwaddr addr1;
-    MemoryRegion *mr;
-
-    l = len;
-    mr = flatview_translate(fv, addr, &addr1, &l, false, attrs);
-    flatview_read_continue(fv, addr, attrs, buf, len,
-                                  addr1, l, mr);
-}
-
 void helper_qem_instld_trace(CPUX86State *env, target_ulong current_eip, int size)
 {
-     if((qem_tracing_state & QEM_TRACE_ITRACE) != 0)
+     if(qem_tracing_state != 0 &&
+        qem_trace_filter_asid(ENV_GET_CPU(env)->cpu_index))
+     {
+         /* The iterations of a string instruction are merged in its blocks */
+         if(qem_trace_string_fetch(ENV_GET_CPU(env)->cpu_index, current_eip))
+         {
+             return;
+         }
+         qem_trace_sample_tick(ENV_GET_CPU(env)->cpu_index);
+     }
+     if((qem_tracing_state & QEM_TRACE_ITRACE) != 0 &&
+        qem_trace_filter_asid(ENV_GET_CPU(env)->cpu_index) &&
+        qem_trace_sample_record(ENV_GET_CPU(env)->cpu_index))
      {
-        uint32_t l1, l2;
-        uint32_t pgd, pde, pte;
-        target_ulong phys_addr = 0;
         uint32_t cache_inhibit = 0;
+        /* Get the physical address corresponding to the virtual address */
+#if QEM_TRACE_PHYSICAL_ADDRESS
+        target_ulong phys_addr = qem_get_phys_addr_mem_tracing(env, &cache_inhibit,
+                                                           current_eip);
+#else 
+        target_ulong phys_addr = current_eip;
+#endif
 
-        /* Check if paging is enabled */
-        if((env->cr[0] & CR0_PG_MASK) == 0)
-        {
-            phys_addr = current_eip;
-        }
-        else
+        if(qem_trace_filter_phys(phys_addr) == 0)
         {
-            /* Get the level 1 entry */
-            l1 = current_eip >> 22;
-            /* Get the level 2 entry */
-            l2 = (current_eip & 0x3FFFFF) >> 12;
-
-            pgd = env->cr[3] & ~0xfff;
-
-            /* Get the PDE */
-            FlatView *fv;
-
-            fv = address_space_to_flatview(&address_space_memory);
-
-            flatview_read(fv, pgd + l1 * 4, MEMTXATTRS_UNSPECIFIED, (void*)&pde, 4);
-            pde = le32_to_cpu(pde);
-
-            /* If mapped */
-            if (pde & PG_PRESENT_MASK)
-            {
-                /* If 4M Pages */
-                if ((pde & PG_PSE_MASK) && (env->cr[4] & CR4_PSE_MASK))
-                {
-                    cache_inhibit = (pde & 0x00000010);
-                    phys_addr = (pde & 0xFFC00000) | (current_eip & 0x003FFFFF);
-                }
-                /* If 4K Pages */
-                else
-                {
-                    flatview_read(fv, (pde & ~0xfff) + l2 * 4, MEMTXATTRS_UNSPECIFIED, (void*)&pte, 4);
-                    pte = le32_to_cpu(pte);
-
-                    /* If mapped */
-                    if (pte & PG_PRESENT_MASK)
-                    {
-                        cache_inhibit = (pte & 0x00000040) | (pde & 0x00000010);
-                        phys_addr = (pte & 0xFFFFF000) | (current_eip & 0x00000FFF);
-                    }
-                }
-            }
+            return;
         }
 
-        /* Get time, we prefer to use TSC to lowe overhead */
-        unsigned a, d;
-        asm volatile("rdtsc" : "=a" (a), "=d" (d) : : "%rbx", "%rcx");
+        /* Get time, see QEM_TRACE_TIME_SOURCE */
+        uint64_t timestamp = qem_trace_get_time(ENV_GET_CPU(env));
 
         /* Get flags */
         uint32_t flags = QEM_TRACE_EVENT_ACCESS | QEM_TRACE_ACCESS_TYPE_READ |
@@ -147,9 +107,13 @@ void helper_qem_instld_trace(CPUX86State *env, target_ulong current_eip, int siz
                 break;
         }
 
+        /* The next iterations of a string instruction are counted from it */
+        qem_trace_string_fetch_traced(ENV_GET_CPU(env)->cpu_index, current_eip,
+                                      phys_addr, flags);
+
         qem_trace_output(current_eip, phys_addr,
                                 ENV_GET_CPU(env)->cpu_index,
-                                ((uint64_t) a) | (((uint64_t) d) << 32),
+                                timestamp,
                                 flags);
      }
 
@@ -158,9 +122,13 @@ void helper_qem_instld_trace(CPUX86State *env, target_ulong current_eip, int siz
 void helper_qem_datald_trace(CPUArchState *env, target_ulong addr,
                          int32_t data_size)
 {
-    if((qem_tracing_state & QEM_TRACE_DTRACE) != 0)
+    if((qem_tracing_state & QEM_TRACE_DTRACE) != 0 &&
+       qem_trace_filter_asid(ENV_GET_CPU(env)->cpu_index) &&
+       qem_trace_filter_virt(addr) &&
+       qem_trace_sample_record(ENV_GET_CPU(env)->cpu_index))
     {
         uint32_t cache_inhibit;
+        qem_trace_string_end(ENV_GET_CPU(env)->cpu_index);
         /* Get the physical address corresponding to the virtual address */
 #if QEM_TRACE_PHYSICAL_ADDRESS
         target_ulong phys_addr = qem_get_phys_addr_mem_tracing(env, &cache_inhibit,
@@ -168,9 +136,13 @@ void helper_qem_datald_trace(CPUArchState *env, target_ulong addr,
 #else 
         target_ulong phys_addr = addr;
 #endif
+        if(qem_trace_filter_phys(phys_addr) == 0)
+        {
+            return;
+        }
+
         /* Get time */
-        unsigned a, d;
-        asm volatile("rdtsc" : "=a" (a), "=d" (d) : : "%rbx", "%rcx");
+        uint64_t timestamp = qem_trace_get_time(ENV_GET_CPU(env));
 
         /* Get flags */
         uint32_t flags = qem_get_flags_mem_tracing(env,
@@ -187,7 +159,7 @@ void helper_qem_datald_trace(CPUArchState *env, target_ulong addr,
         /* Output trace */
         qem_trace_output(addr, phys_addr,
                                ENV_GET_CPU(env)->cpu_index,
-                               ((uint64_t) a) | (((uint64_t) d) << 32),
+                               timestamp,
                                flags);
     }
 }
@@ -195,18 +167,26 @@ void helper_qem_datald_trace(CPUArchState *env, target_ulong addr,
 void helper_qem_datast_trace(CPUArchState *env, target_ulong addr,
                          int32_t data_size)
 {
-    if((qem_tracing_state & QEM_TRACE_DTRACE) != 0)
+    if((qem_tracing_state & QEM_TRACE_DTRACE) != 0 &&
+       qem_trace_filter_asid(ENV_GET_CPU(env)->cpu_index) &&
+       qem_trace_filter_virt(addr) &&
+       qem_trace_sample_record(ENV_GET_CPU(env)->cpu_index))
     {
         uint32_t cache_inhibit;
+        qem_trace_string_end(ENV_GET_CPU(env)->cpu_index);
 #if QEM_TRACE_PHYSICAL_ADDRESS
         target_ulong phys_addr = qem_get_phys_addr_mem_tracing(env, &cache_inhibit,
                                                            addr);
 #else 
         target_ulong phys_addr = addr;
 #endif
+        if(qem_trace_filter_phys(phys_addr) == 0)
+        {
+            return;
+        }
+
         /* Get time */
-        unsigned a, d;
-        asm volatile("rdtsc" : "=a" (a), "=d" (d) : : "%rbx", "%rcx");
+        uint64_t timestamp = qem_trace_get_time(ENV_GET_CPU(env));
 
         /* Get flags */
         uint32_t flags = qem_get_flags_mem_tracing(env,
@@ -224,16 +204,103 @@ void helper_qem_datast_trace(CPUArchState *env, target_ulong addr,
         /* Output trace */
         qem_trace_output(addr, phys_addr,
                                ENV_GET_CPU(env)->cpu_index,
-                               ((uint64_t) a) | (((uint64_t) d) << 32),
+                               timestamp,
                                flags);
     }
 }
 
+#if QEM_TRACE_STRING_ENABLED
+void helper_qem_string_trace(CPUArchState *env, target_ulong addr,
+                             int32_t data_size, int32_t operand)
+{
+    if((qem_tracing_state & QEM_TRACE_DTRACE) != 0 &&
+       qem_trace_filter_asid(ENV_GET_CPU(env)->cpu_index) &&
+       qem_trace_filter_virt(addr) &&
+       qem_trace_sample_record(ENV_GET_CPU(env)->cpu_index))
+    {
+        /* The operand is the slot of the access and its type (bit 0) */
+        uint32_t kind = ((uint32_t)operand << 2) | data_size;
+        uint32_t cache_inhibit = 0;
+
+        /* Elements following the block on its page are not translated */
+        if(qem_trace_string_extend(ENV_GET_CPU(env)->cpu_index, addr,
+                                   operand >> 1, kind))
+        {
+            return;
+        }
+
+#if QEM_TRACE_PHYSICAL_ADDRESS
+        target_ulong phys_addr = qem_get_phys_addr_mem_tracing(env, &cache_inhibit,
+                                                           addr);
+#else 
+        target_ulong phys_addr = addr;
+#endif
+        if(qem_trace_filter_phys(phys_addr) == 0)
+        {
+            return;
+        }
+
+        /* Get time */
+        uint64_t timestamp = qem_trace_get_time(ENV_GET_CPU(env));
+
+        /* Get flags */
+        uint32_t flags = qem_get_flags_mem_tracing(env,
+                                               QEM_TRACE_EVENT_ACCESS,
+                                               (operand & 1) ?
+                                               QEM_TRACE_ACCESS_TYPE_WRITE :
+                                               QEM_TRACE_ACCESS_TYPE_READ,
+                                               QEM_TRACE_DATA_TYPE_DATA,
+                                               QEM_TRACE_GRANULARITY_NONE,
+                                               data_size,
+                                               phys_addr);
+
+        /* Get inhibition state BIT 30 or cr0 */
+        flags |= ((env->cr[0] & (1 << 30)) | cache_inhibit) ?
+                 QEM_TRACE_CACHE_INHIBIT_ON : QEM_TRACE_CACHE_INHIBIT_OFF;
+
+        /* The direction flag gives the element order */
+        qem_trace_string_start(ENV_GET_CPU(env)->cpu_index, addr, phys_addr,
+                               timestamp,
+                               flags, operand >> 1, kind,
+                               (int64_t)env->df * (1 << data_size));
+    }
+}
+#endif
+
 /*********************************** MISC *************************************/
 
+#if QEM_TRACE_ASID_FILTER_ENABLED || QEM_TRACE_PC_TRIGGER_ENABLED
+/* Returns the identifier of the address space the CPU runs in. */
+static uint64_t qem_trace_get_asid(CPUX86State *env)
+{
+    /* The address space is identified by its page directory */
+    return env->cr[3] & ~0xFFF;
+}
+#endif
+
+#if QEM_TRACE_ASID_FILTER_ENABLED
+void helper_qem_tb_enter_trace(CPUX86State *env)
+{
+    qem_trace_filter_asid_enter(ENV_GET_CPU(env)->cpu_index,
+                                qem_trace_get_asid(env));
+}
+#endif
+
+#if QEM_TRACE_PC_TRIGGER_ENABLED
+void helper_qem_pc_trigger(CPUX86State *env, target_ulong addr)
+{
+    qem_trace_trigger_fire(ENV_GET_CPU(env), addr, qem_trace_get_asid(env));
+}
+#endif
+
 void helper_qem_start_trace(CPUX86State *env, int type)
 {
     CPUState *cs = ENV_GET_CPU(env);
+
+    if(qem_trace_replay_traced() == 0)
+    {
+        return;
+    }
     qem_trace_enable(cs, (QEM_TRACE_TTYPE_E)type);
 }
 
@@ -242,6 +309,11 @@ void helper_qem_stop_trace(int type)
      qem_trace_disable((QEM_TRACE_TTYPE_E)type);
 }
 
+void helper_qem_ring_trigger(CPUX86State *env, target_ulong addr)
+{
+    qem_trace_ring_trigger(ENV_GET_CPU(env)->cpu_index, addr);
+}
+
 void helper_qem_trace_start_timer(void)
 {
     qem_trace_start_timer();
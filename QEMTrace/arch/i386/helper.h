@@ -33,9 +33,23 @@ DEF_HELPER_3(qem_instld_trace, void, env, tl, int)
 DEF_HELPER_3(qem_datald_trace, void, env, tl, int)
 DEF_HELPER_3(qem_datast_trace, void, env, tl, int)
 
+#if QEM_TRACE_STRING_ENABLED
+DEF_HELPER_4(qem_string_trace, void, env, tl, int, int)
+#endif
+
+#if QEM_TRACE_ASID_FILTER_ENABLED
+DEF_HELPER_1(qem_tb_enter_trace, void, env)
+#endif
+
+#if QEM_TRACE_PC_TRIGGER_ENABLED
+DEF_HELPER_2(qem_pc_trigger, void, env, tl)
+#endif
+
 DEF_HELPER_2(qem_start_trace, void, env, int)
 DEF_HELPER_1(qem_stop_trace, void, int)
 
+DEF_HELPER_2(qem_ring_trigger, void, env, tl)
+
 DEF_HELPER_0(qem_trace_start_timer, void)
 DEF_HELPER_0(qem_trace_get_timer, void)
 
@@ -51,62 +51,162 @@
 #include "../../qem_trace_engine.h"
 
 
+/* Paging-structure cache of a core. Each non leaf level of the walk keeps the
+ * last entries read, direct mapped on the virtual address bits translated by
+ * the entries, so a walk only reads the levels below the deepest hit. The
+ * caches are emptied when Qemu flushes the core TLB, which it does each time
+ * CR3 is loaded, paging is reconfigured or a page is invalidated.
+ */
+#define QEM_X86_PSC_CORES  64
+#define QEM_X86_PSC_LEVELS 4
+#define QEM_X86_PSC_SIZE   64
+
+typedef struct
+{
+    uint64_t tag;   /* Virtual address bits above the level shift */
+    uint64_t entry; /* Present entry read at this level           */
+    uint32_t valid;
+} qem_x86_psc_entry_t;
+
+static qem_x86_psc_entry_t
+    psc[QEM_X86_PSC_CORES][QEM_X86_PSC_LEVELS][QEM_X86_PSC_SIZE];
+
 target_ulong qem_get_phys_addr_mem_tracing(CPUArchState* env,
                                        uint32_t* cache_inhibit,
                                        const target_ulong addr)
 {
-    uint32_t l1, l2;
-    uint32_t pgd, pde, pte;
+    qem_x86_psc_entry_t* cached[QEM_X86_PSC_LEVELS];
+    uint32_t shifts[QEM_X86_PSC_LEVELS + 1];
+    uint32_t levels;
+    uint32_t level;
+    uint32_t entry_size;
+    uint32_t pte32;
+    uint64_t pte;
+    uint64_t table;
+    uint64_t tag;
+    int      core;
+    int      i;
+
+    *cache_inhibit = 0;
 
     /* Check if paging is enabled */
     if((env->cr[0] & CR0_PG_MASK) == 0)
     {
-        *cache_inhibit = 0;
         return addr;
     }
 
-    target_ulong haddr = 0;
-
-    /* Get the level 1 entry */
-    l1 = addr >> 22;
-    /* Get the level 2 entry */
-    l2 = (addr & 0x3FFFFF) >> 12;
-
-    pgd = env->cr[3] & ~0xfff;
-
-    /* Get the PDE */
-    cpu_physical_memory_read(pgd + l1 * 4, &pde, 4);
-    pde = le32_to_cpu(pde);
+    /* Get the walk geometry of the paging mode */
+#ifdef TARGET_X86_64
+    if((env->hflags & HF_LMA_MASK) != 0)
+    {
+        levels = ((env->cr[4] & CR4_LA57_MASK) != 0) ? 5 : 4;
+        table  = env->cr[3] & PG_ADDRESS_MASK;
+    }
+    else
+#endif
+    if((env->cr[4] & CR4_PAE_MASK) != 0)
+    {
+        levels = 3;
+        table  = env->cr[3] & ~0x1F;
+    }
+    else
+    {
+        levels = 2;
+        table  = env->cr[3] & ~0xFFF;
+    }
+    entry_size = (levels == 2) ? 4 : 8;
+    for(i = levels - 1; i >= 0; --i)
+    {
+        shifts[i] = 12 + (levels == 2 ? 10 : 9) * (levels - 1 - i);
+    }
 
-    /* If mapped */
-    if (pde & PG_PRESENT_MASK)
+    /* Resume the walk below the deepest cached level */
+    level = 0;
+    pte   = 0;
+    core  = ENV_GET_CPU(env)->cpu_index;
+    if(core < QEM_X86_PSC_CORES)
     {
-        /* If 4M Pages */
-        if ((pde & PG_PSE_MASK) && (env->cr[4] & CR4_PSE_MASK))
+        for(i = 0; i < (int)levels - 1; ++i)
         {
-            *cache_inhibit = (pde & 0x00000010);
-            haddr = (pde & 0xFFC00000) | (addr & 0x003FFFFF);
+            tag = (uint64_t)addr >> shifts[i];
+            cached[i] = &psc[core][QEM_X86_PSC_LEVELS - levels + 1 + i]
+                            [tag & (QEM_X86_PSC_SIZE - 1)];
         }
-        /* If 4K Pages */
-        else
+        for(i = levels - 2; i >= 0; --i)
         {
-            cpu_physical_memory_read((pde & ~0xfff) + l2 * 4, &pte, 4);
-            pte = le32_to_cpu(pte);
-
-            /* If mapped */
-            if (pte & PG_PRESENT_MASK)
+            if(cached[i]->valid != 0 &&
+               cached[i]->tag == (uint64_t)addr >> shifts[i])
             {
-                *cache_inhibit = (pte & 0x00000040) | (pde & 0x00000010);
-                haddr = (pte & 0xFFFFF000) | (addr & 0x00000FFF);
+                pte   = cached[i]->entry;
+                level = i + 1;
+                break;
             }
         }
     }
-    else {
-        *cache_inhibit = 0;
-        haddr = addr;
+
+    for(; level <= levels; ++level)
+    {
+        if(level > 0)
+        {
+            /* Large page mapped by the previous entry */
+            if((pte & PG_PSE_MASK) != 0 && level < levels &&
+               ((shifts[level - 1] == 22 && (env->cr[4] & CR4_PSE_MASK)) ||
+                shifts[level - 1] == 21 ||
+                (shifts[level - 1] == 30 && levels >= 4)))
+            {
+                *cache_inhibit = (pte & PG_PCD_MASK) != 0;
+                if(levels == 2)
+                {
+                    /* PSE-36 keeps the address bits 32 to 39 in 13 to 20 */
+                    return (target_ulong)((pte & 0xFFC00000) |
+                                          (((pte >> 13) & 0xFF) << 32) |
+                                          (addr & 0x003FFFFF));
+                }
+                return (target_ulong)((pte & PG_ADDRESS_MASK &
+                                       ~((1ULL << shifts[level - 1]) - 1)) |
+                                      (addr &
+                                       ((1ULL << shifts[level - 1]) - 1)));
+            }
+            if(level == levels)
+            {
+                break;
+            }
+            table = pte & ((levels == 2) ? 0xFFFFF000 : PG_ADDRESS_MASK);
+        }
+
+        /* Read the entry of the level */
+        table += (((uint64_t)addr >> shifts[level]) &
+                  ((level == 0 && levels == 3) ? 0x3 :
+                   (levels == 2 ? 0x3FF : 0x1FF))) * entry_size;
+        if(entry_size == 4)
+        {
+            cpu_physical_memory_read(table, &pte32, 4);
+            pte = le32_to_cpu(pte32);
+        }
+        else
+        {
+            cpu_physical_memory_read(table, &pte, 8);
+            pte = le64_to_cpu(pte);
+        }
+
+        /* Not mapped */
+        if((pte & PG_PRESENT_MASK) == 0)
+        {
+            return addr;
+        }
+
+        if(level < levels - 1 && core < QEM_X86_PSC_CORES)
+        {
+            cached[level]->tag   = (uint64_t)addr >> shifts[level];
+            cached[level]->entry = pte;
+            cached[level]->valid = 1;
+        }
     }
 
-    return haddr;
+    *cache_inhibit = (pte & PG_PCD_MASK) != 0;
+    return (target_ulong)((pte & ((levels == 2) ? 0xFFFFF000 :
+                                                  PG_ADDRESS_MASK)) |
+                          (addr & 0xFFF));
 }
 
 uint32_t qem_get_flags_mem_tracing(const CPUArchState* env,
@@ -148,5 +248,12 @@ uint32_t qem_get_flags_mem_tracing(const CPUArchState* env,
     return flags;
 }
 
+void qem_trace_tlb_flush(CPUState* cs)
+{
+    if(cs->cpu_index < QEM_X86_PSC_CORES)
+    {
+        memset(psc[cs->cpu_index], 0, sizeof(psc[cs->cpu_index]));
+    }
+}
 
 #endif /* QEM_TRACE_ENABLED */
\ No newline at end of file
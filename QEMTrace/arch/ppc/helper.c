@@ -40,8 +40,10 @@
 #define GET_ENV_FLAGS(flags, t_hi, t_lo, wt_enable, cache_inhibit,             \
 coherency, size)                                                               \
 {                                                                              \
-    /* Get time, we prefer to use TSC to lower overhead */                     \
-    asm volatile("rdtsc" : "=a" (t_hi), "=d" (t_lo) : : "%rbx", "%rcx");       \
+    /* Get time, see QEM_TRACE_TIME_SOURCE */                                  \
+    uint64_t timestamp = qem_trace_get_time(ENV_GET_CPU(env));                 \
+    t_hi = (uint32_t)timestamp;                                                \
+    t_lo = (uint32_t)(timestamp >> 32);                                        \
                                                                                \
     /* To check the current ring we read MSR register */                       \
     flags |= ((env->msr & (1 << 17)) ?                                         \
@@ -78,7 +80,14 @@ coherency, size)                                                               \
 void helper_qem_instld_trace(CPUPPCState *env, target_ulong current_eip,
                          int size)
 {
-    if((qem_tracing_state & QEM_TRACE_ITRACE) != 0)
+    if(qem_tracing_state != 0 &&
+       qem_trace_filter_asid(ENV_GET_CPU(env)->cpu_index))
+    {
+        qem_trace_sample_tick(ENV_GET_CPU(env)->cpu_index);
+    }
+    if((qem_tracing_state & QEM_TRACE_ITRACE) != 0 &&
+       qem_trace_filter_asid(ENV_GET_CPU(env)->cpu_index) &&
+       qem_trace_sample_record(ENV_GET_CPU(env)->cpu_index))
     {
         /* Get information about the adreess */
         target_ulong haddr;
@@ -105,6 +114,10 @@ void helper_qem_instld_trace(CPUPPCState *env, target_ulong current_eip,
 #else 
     haddr = current_eip;
 #endif
+        if(qem_trace_filter_phys(haddr) == 0)
+        {
+            return;
+        }
         
         qem_trace_output(current_eip,
                               haddr,
@@ -117,7 +130,10 @@ void helper_qem_instld_trace(CPUPPCState *env, target_ulong current_eip,
 void helper_qem_datast_trace_direct(CPUPPCState *env, target_ulong virt_addr,
                                 int size)
 {
-    if((qem_tracing_state & QEM_TRACE_DTRACE) != 0)
+    if((qem_tracing_state & QEM_TRACE_DTRACE) != 0 &&
+       qem_trace_filter_asid(ENV_GET_CPU(env)->cpu_index) &&
+       qem_trace_filter_virt(virt_addr) &&
+       qem_trace_sample_record(ENV_GET_CPU(env)->cpu_index))
     {
         /* Get information about the adreess */
         target_ulong haddr;
@@ -145,6 +161,10 @@ void helper_qem_datast_trace_direct(CPUPPCState *env, target_ulong virt_addr,
 #else 
     haddr = virt_addr;
 #endif
+        if(qem_trace_filter_phys(haddr) == 0)
+        {
+            return;
+        }
         qem_trace_output(virt_addr,
                                 haddr,
                                 ENV_GET_CPU(env)->cpu_index,
@@ -156,7 +176,10 @@ void helper_qem_datast_trace_direct(CPUPPCState *env, target_ulong virt_addr,
 void helper_qem_datast_ex_trace_direct(CPUPPCState *env, target_ulong virt_addr,
                                 int size)
 {
-    if((qem_tracing_state & QEM_TRACE_DTRACE) != 0)
+    if((qem_tracing_state & QEM_TRACE_DTRACE) != 0 &&
+       qem_trace_filter_asid(ENV_GET_CPU(env)->cpu_index) &&
+       qem_trace_filter_virt(virt_addr) &&
+       qem_trace_sample_record(ENV_GET_CPU(env)->cpu_index))
     {
         /* Get information about the adreess */
         target_ulong haddr;
@@ -182,6 +205,10 @@ void helper_qem_datast_ex_trace_direct(CPUPPCState *env, target_ulong virt_addr,
 #else 
     haddr = virt_addr;
 #endif
+        if(qem_trace_filter_phys(haddr) == 0)
+        {
+            return;
+        }
 
         qem_trace_output(virt_addr,
                                 haddr,
@@ -194,7 +221,10 @@ void helper_qem_datast_ex_trace_direct(CPUPPCState *env, target_ulong virt_addr,
 void helper_qem_datald_trace_direct(CPUPPCState *env, target_ulong virt_addr,
                                 int size)
 {
-    if((qem_tracing_state & QEM_TRACE_DTRACE) != 0)
+    if((qem_tracing_state & QEM_TRACE_DTRACE) != 0 &&
+       qem_trace_filter_asid(ENV_GET_CPU(env)->cpu_index) &&
+       qem_trace_filter_virt(virt_addr) &&
+       qem_trace_sample_record(ENV_GET_CPU(env)->cpu_index))
     {
         /* Get information about the adreess */
         target_ulong haddr;
@@ -220,6 +250,10 @@ void helper_qem_datald_trace_direct(CPUPPCState *env, target_ulong virt_addr,
 #else 
     haddr = virt_addr;
 #endif
+        if(qem_trace_filter_phys(haddr) == 0)
+        {
+            return;
+        }
 
         qem_trace_output(virt_addr,
                                 haddr,
@@ -232,7 +266,10 @@ void helper_qem_datald_trace_direct(CPUPPCState *env, target_ulong virt_addr,
 void helper_qem_datald_ex_trace_direct(CPUPPCState *env, target_ulong virt_addr,
                                 int size)
 {
-    if((qem_tracing_state & QEM_TRACE_DTRACE) != 0)
+    if((qem_tracing_state & QEM_TRACE_DTRACE) != 0 &&
+       qem_trace_filter_asid(ENV_GET_CPU(env)->cpu_index) &&
+       qem_trace_filter_virt(virt_addr) &&
+       qem_trace_sample_record(ENV_GET_CPU(env)->cpu_index))
     {
         /* Get information about the adreess */
         target_ulong haddr;
@@ -258,6 +295,10 @@ void helper_qem_datald_ex_trace_direct(CPUPPCState *env, target_ulong virt_addr,
 #else 
     haddr = virt_addr;
 #endif
+        if(qem_trace_filter_phys(haddr) == 0)
+        {
+            return;
+        }
 
         qem_trace_output(virt_addr,
                                 haddr,
@@ -267,6 +308,73 @@ void helper_qem_datald_ex_trace_direct(CPUPPCState *env, target_ulong virt_addr,
     }
 }
 
+/* Traces the words of a multiple word transfer, the address is translated once
+ * per page.
+ */
+static void qem_data_multi_trace(CPUPPCState *env, target_ulong virt_addr,
+                                 int count, int size, uint32_t flags)
+{
+    uint32_t core = ENV_GET_CPU(env)->cpu_index;
+    uint32_t page_count;
+    uint32_t page_flags;
+
+    if((qem_tracing_state & QEM_TRACE_DTRACE) == 0 ||
+       qem_trace_filter_asid(core) == 0)
+    {
+        return;
+    }
+
+    while(count > 0)
+    {
+        /* Get information about the page of the address */
+        target_ulong haddr;
+        unsigned a, d;
+        a = 0;
+        d = 0;
+
+        page_count = qem_trace_multi_page_count(virt_addr, count, size);
+        page_flags = flags;
+
+#if QEM_TRACE_GATHER_META
+        int32_t coherency_enabled;
+        int32_t cache_inhibit;
+        int32_t wt_enable;
+        qem_ppc_get_info_addr_mem_trace(env, virt_addr, ACCESS_INT, &haddr,
+                                    &wt_enable,
+                                    &cache_inhibit, &coherency_enabled);
+
+        GET_ENV_FLAGS(page_flags, a, d, wt_enable, cache_inhibit,
+                      coherency_enabled, size)
+#else
+        haddr = virt_addr;
+#endif
+        qem_trace_multi_output(core, virt_addr, haddr,
+                               ((uint64_t) a) | (((uint64_t) d) << 32),
+                               page_flags, page_count, size);
+
+        virt_addr += page_count * size;
+        count     -= page_count;
+    }
+}
+
+void helper_qem_datald_multi_trace_direct(CPUPPCState *env,
+                                          target_ulong virt_addr,
+                                          int count, int size)
+{
+    qem_data_multi_trace(env, virt_addr, count, size,
+                         QEM_TRACE_EVENT_ACCESS | QEM_TRACE_ACCESS_TYPE_READ |
+                         QEM_TRACE_DATA_TYPE_DATA);
+}
+
+void helper_qem_datast_multi_trace_direct(CPUPPCState *env,
+                                          target_ulong virt_addr,
+                                          int count, int size)
+{
+    qem_data_multi_trace(env, virt_addr, count, size,
+                         QEM_TRACE_EVENT_ACCESS | QEM_TRACE_ACCESS_TYPE_WRITE |
+                         QEM_TRACE_DATA_TYPE_DATA);
+}
+
 
 void helper_qem_datast_trace(CPUPPCState *env, target_ulong simm,
                          int reg, int size)
@@ -351,9 +459,59 @@ void helper_qem_datald_ex_trace_trad(CPUPPCState *env, int reg0,
 
 /*********************************** MISC *************************************/
 
+#if QEM_TRACE_ASID_FILTER_ENABLED || QEM_TRACE_PC_TRIGGER_ENABLED
+/* Returns the identifier of the address space the CPU runs in. */
+static uint64_t qem_trace_get_asid(CPUPPCState *env)
+{
+    uint64_t asid;
+
+    switch(env->mmu_model)
+    {
+        case POWERPC_MMU_BOOKE:
+        case POWERPC_MMU_BOOKE206:
+            asid = env->spr[SPR_BOOKE_PID];
+            break;
+        case POWERPC_MMU_SOFT_4xx:
+        case POWERPC_MMU_SOFT_4xx_Z:
+            asid = env->spr[SPR_40x_PID];
+            break;
+        case POWERPC_MMU_SOFT_6xx:
+        case POWERPC_MMU_SOFT_74xx:
+            /* Each process gets its own VSIDs */
+            asid = env->sr[0] & 0x00FFFFFF;
+            break;
+        default:
+            asid = 0;
+            break;
+    }
+
+    return asid;
+}
+#endif
+
+#if QEM_TRACE_ASID_FILTER_ENABLED
+void helper_qem_tb_enter_trace(CPUPPCState *env)
+{
+    qem_trace_filter_asid_enter(ENV_GET_CPU(env)->cpu_index,
+                                qem_trace_get_asid(env));
+}
+#endif
+
+#if QEM_TRACE_PC_TRIGGER_ENABLED
+void helper_qem_pc_trigger(CPUPPCState *env, target_ulong addr)
+{
+    qem_trace_trigger_fire(ENV_GET_CPU(env), addr, qem_trace_get_asid(env));
+}
+#endif
+
 void helper_qem_start_trace(CPUPPCState *env, int type)
 {
     CPUState *cs = ENV_GET_CPU(env);
+
+    if(qem_trace_replay_traced() == 0)
+    {
+        return;
+    }
     qem_trace_enable(cs, (QEM_TRACE_TTYPE_E)type);
 }
 
@@ -362,6 +520,11 @@ void helper_qem_stop_trace(int type)
     qem_trace_disable((QEM_TRACE_TTYPE_E)type);
 }
 
+void helper_qem_ring_trigger(CPUPPCState *env, target_ulong addr)
+{
+    qem_trace_ring_trigger(ENV_GET_CPU(env)->cpu_index, addr);
+}
+
 void helper_qem_trace_start_timer(void)
 {
     qem_trace_start_timer();
@@ -40,14 +40,27 @@ DEF_HELPER_3(qem_datast_trace_direct, void, env, tl, int)
 DEF_HELPER_3(qem_datald_ex_trace_direct, void, env, tl, int)
 DEF_HELPER_3(qem_datast_ex_trace_direct, void, env, tl, int)
 
+DEF_HELPER_4(qem_datald_multi_trace_direct, void, env, tl, int, int)
+DEF_HELPER_4(qem_datast_multi_trace_direct, void, env, tl, int, int)
+
 DEF_HELPER_4(qem_datald_trace_trad, void, env, int, int, int)
 DEF_HELPER_4(qem_datast_trace_trad, void, env, int, int, int)
 DEF_HELPER_4(qem_datald_ex_trace_trad, void, env, int, int, int)
 DEF_HELPER_4(qem_datast_ex_trace_trad, void, env, int, int, int)
 
+#if QEM_TRACE_ASID_FILTER_ENABLED
+DEF_HELPER_1(qem_tb_enter_trace, void, env)
+#endif
+
+#if QEM_TRACE_PC_TRIGGER_ENABLED
+DEF_HELPER_2(qem_pc_trigger, void, env, tl)
+#endif
+
 DEF_HELPER_2(qem_start_trace, void, env, int)
 DEF_HELPER_1(qem_stop_trace, void, int)
 
+DEF_HELPER_2(qem_ring_trigger, void, env, tl)
+
 DEF_HELPER_0(qem_trace_start_timer, void)
 DEF_HELPER_0(qem_trace_get_timer, void)
 
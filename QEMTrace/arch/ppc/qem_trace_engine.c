@@ -74,6 +74,84 @@ int mmu40x_get_physical_address(CPUPPCState *env, mmu_ctx_t *ctx,
                                        target_ulong address, int rw,
                                        int access_type);
                                        
+/* BookE 2.06 TLB index, maps the effective pages to the TLB entry they hit.
+ * Each core has its own direct mapped index, cleared when the generation
+ * changes after a TLB modification.
+ */
+#define QEM_PPC_TLB_INDEX_CORES 64
+#define QEM_PPC_TLB_INDEX_SIZE  256
+
+typedef struct {
+    ppcmas_tlb_t *tlb;       /* TLB entry hit by the page       */
+    target_ulong epn;        /* Effective page number           */
+    hwaddr rpn;              /* Real page address               */
+    uint32_t pid[3];         /* PID registers of the lookup     */
+    uint32_t context;        /* MSR bits and access of the lookup */
+    int prot;                /* Protection bits                 */
+    int valid;
+} qem_ppc_tlb_index_entry_t;
+
+typedef struct {
+    qem_ppc_tlb_index_entry_t entries[QEM_PPC_TLB_INDEX_SIZE];
+    uint32_t generation;
+} qem_ppc_tlb_index_t;
+
+static qem_ppc_tlb_index_t tlb_index[QEM_PPC_TLB_INDEX_CORES];
+static uint32_t tlb_index_generation;
+
+void qem_ppc_tlb_index_invalidate(void)
+{
+    __atomic_add_fetch(&tlb_index_generation, 1, __ATOMIC_RELEASE);
+}
+
+/* Returns the index entry of the page, emptied if it describes another
+ * lookup, NULL if the core has no index.
+ */
+static qem_ppc_tlb_index_entry_t *mmubooke206_index_entry(CPUPPCState *env,
+                                                          target_ulong address,
+                                                          int rw,
+                                                          int access_type)
+{
+    qem_ppc_tlb_index_t *index;
+    qem_ppc_tlb_index_entry_t *entry;
+    target_ulong epn;
+    uint32_t generation;
+    uint32_t context;
+    int core;
+
+    core = ENV_GET_CPU(env)->cpu_index;
+    if (core >= QEM_PPC_TLB_INDEX_CORES) {
+        return NULL;
+    }
+    index = &tlb_index[core];
+
+    /* The TLB changed since the index was built */
+    generation = __atomic_load_n(&tlb_index_generation, __ATOMIC_ACQUIRE);
+    if (index->generation != generation) {
+        memset(index->entries, 0, sizeof(index->entries));
+        index->generation = generation;
+    }
+
+    epn = address >> 12;
+    context = msr_ir | (msr_ds << 1) | (msr_pr << 2) |
+              ((access_type == ACCESS_CODE) << 3) | ((rw != 0) << 4);
+    entry = &index->entries[epn & (QEM_PPC_TLB_INDEX_SIZE - 1)];
+
+    if (entry->epn != epn || entry->context != context ||
+        entry->pid[0] != env->spr[SPR_BOOKE_PID] ||
+        entry->pid[1] != env->spr[SPR_BOOKE_PID1] ||
+        entry->pid[2] != env->spr[SPR_BOOKE_PID2]) {
+        entry->valid = 0;
+        entry->epn = epn;
+        entry->context = context;
+        entry->pid[0] = env->spr[SPR_BOOKE_PID];
+        entry->pid[1] = env->spr[SPR_BOOKE_PID1];
+        entry->pid[2] = env->spr[SPR_BOOKE_PID2];
+    }
+
+    return entry;
+}
+
 static int mmubooke206_get_info(CPUPPCState *env, mmu_ctx_t *ctx,
                                    target_ulong address, int rw,
                                    int access_type,
@@ -82,6 +160,7 @@ static int mmubooke206_get_info(CPUPPCState *env, mmu_ctx_t *ctx,
                                    int32_t* cache_inhibit,
                                    int32_t* coherency_enabled)
 {
+    qem_ppc_tlb_index_entry_t *entry;
     ppcmas_tlb_t *tlb;
     hwaddr raddr;
     int i, j, ret;
@@ -89,6 +168,15 @@ static int mmubooke206_get_info(CPUPPCState *env, mmu_ctx_t *ctx,
     ret = -1;
     raddr = (hwaddr)-1ULL;
 
+    entry = mmubooke206_index_entry(env, address, rw, access_type);
+    if (entry != NULL && entry->valid) {
+        tlb = entry->tlb;
+        raddr = entry->rpn | (address & 0xFFF);
+        ctx->prot = entry->prot;
+        ret = 0;
+        goto found_tlb;
+    }
+
     for (i = 0; i < BOOKE206_MAX_TLBN; i++) {
         int ways = booke206_tlb_ways(env, i);
 
@@ -110,6 +198,14 @@ found_tlb:
     if (ret >= 0) {
         ctx->raddr = raddr;
 
+        /* Only the successful lookups are indexed */
+        if (entry != NULL && !entry->valid) {
+            entry->tlb = tlb;
+            entry->rpn = raddr & ~(hwaddr)0xFFF;
+            entry->prot = ctx->prot;
+            entry->valid = 1;
+        }
+
         *write_through_enabled = (tlb->mas2 >> MAS2_W_SHIFT) & 0x1;
         *coherency_enabled = (tlb->mas2 >> MAS2_M_SHIFT) & 0x1;
 
@@ -139,6 +235,110 @@ found_tlb:
     return ret;
 }
 
+/* 6xx/74xx software TLB translation cache. Each core has its own direct
+ * mapped cache, keyed by effective page and segment register (VSID and
+ * protection keys), so storing a segment register needs no invalidation.
+ * The BATs are checked before the cache. The cache index only uses page
+ * index bits, so a tlbie only concerns one entry.
+ */
+#define QEM_PPC_6XX_CACHE_CORES 64
+#define QEM_PPC_6XX_CACHE_SIZE  1024
+
+typedef struct {
+    target_ulong page;       /* Effective page number           */
+    target_ulong sr;         /* Segment register of the page    */
+    hwaddr rpn;              /* Real page address               */
+    int context;             /* MSR PR bit and access type      */
+    int prot;                /* Protection bits                 */
+    int valid;
+} qem_ppc_6xx_cache_entry_t;
+
+static qem_ppc_6xx_cache_entry_t
+    mmu6xx_cache[QEM_PPC_6XX_CACHE_CORES][QEM_PPC_6XX_CACHE_SIZE];
+
+void qem_ppc_6xx_cache_invalidate_page(CPUPPCState *env, target_ulong eaddr)
+{
+    int core;
+
+    core = ENV_GET_CPU(env)->cpu_index;
+    if (core < QEM_PPC_6XX_CACHE_CORES) {
+        mmu6xx_cache[core][(eaddr >> TARGET_PAGE_BITS) &
+                           (QEM_PPC_6XX_CACHE_SIZE - 1)].valid = 0;
+    }
+}
+
+void qem_ppc_6xx_cache_invalidate_all(CPUPPCState *env)
+{
+    int core;
+
+    core = ENV_GET_CPU(env)->cpu_index;
+    if (core < QEM_PPC_6XX_CACHE_CORES) {
+        memset(mmu6xx_cache[core], 0, sizeof(mmu6xx_cache[core]));
+    }
+}
+
+/* Returns the cache entry of the page, emptied if it describes another
+ * lookup, NULL if the core has no cache.
+ */
+static qem_ppc_6xx_cache_entry_t *mmu6xx_cache_entry(CPUPPCState *env,
+                                                     target_ulong eaddr,
+                                                     int access_type)
+{
+    qem_ppc_6xx_cache_entry_t *entry;
+    target_ulong page;
+    target_ulong sr;
+    int context;
+    int core;
+
+    core = ENV_GET_CPU(env)->cpu_index;
+    if (core >= QEM_PPC_6XX_CACHE_CORES) {
+        return NULL;
+    }
+
+    page = eaddr >> TARGET_PAGE_BITS;
+    sr = env->sr[eaddr >> 28];
+    context = msr_pr | ((access_type == ACCESS_CODE) << 1);
+    entry = &mmu6xx_cache[core][page & (QEM_PPC_6XX_CACHE_SIZE - 1)];
+
+    if (entry->page != page || entry->sr != sr || entry->context != context) {
+        entry->valid = 0;
+        entry->page = page;
+        entry->sr = sr;
+        entry->context = context;
+    }
+
+    return entry;
+}
+
+/* Translates through the 6xx/74xx segments, the cache avoids the software
+ * TLB search.
+ */
+static int mmu6xx_get_segment_info(CPUPPCState *env, mmu_ctx_t *ctx,
+                                   target_ulong eaddr, int rw,
+                                   int access_type)
+{
+    qem_ppc_6xx_cache_entry_t *entry;
+    int ret;
+
+    entry = mmu6xx_cache_entry(env, eaddr, access_type);
+    if (entry != NULL && entry->valid) {
+        ctx->raddr = entry->rpn | (eaddr & ~TARGET_PAGE_MASK);
+        ctx->prot = entry->prot;
+        return 0;
+    }
+
+    ret = get_segment_6xx_tlb(env, ctx, eaddr, rw, access_type);
+
+    /* Only the successful lookups are cached */
+    if (ret == 0 && entry != NULL) {
+        entry->rpn = ctx->raddr & TARGET_PAGE_MASK;
+        entry->prot = ctx->prot;
+        entry->valid = 1;
+    }
+
+    return ret;
+}
+
 static int qem_ppc_get_info_addr_mem_trace_internal(CPUPPCState *env, mmu_ctx_t *ctx,
                                    target_ulong eaddr, int rw,
                                    int access_type,
@@ -165,7 +365,8 @@ static int qem_ppc_get_info_addr_mem_trace_internal(CPUPPCState *env, mmu_ctx_t
             }
             if (ret < 0) {
                 /* We didn't match any BAT entry or don't have BATs */
-                ret = get_segment_6xx_tlb(env, ctx, eaddr, rw, access_type);
+                ret = mmu6xx_get_segment_info(env, ctx, eaddr, rw,
+                                              access_type);
             }
         }
         break;
@@ -212,6 +413,35 @@ static int qem_ppc_get_info_addr_mem_trace_internal(CPUPPCState *env, mmu_ctx_t
     return ret;
 }
 
+/* Last translations of a core, one per access class. The memo is emptied when
+ * Qemu flushes the core TLB, which it does each time the MMU state the
+ * translation depends on is modified, except for the MSR bits and cache
+ * enable bits which are part of the key.
+ */
+#define QEM_PPC_MEMO_CORES 64
+#define QEM_PPC_MEMO_DATA  0
+#define QEM_PPC_MEMO_CODE  1
+
+typedef struct {
+    target_ulong page;             /* Effective page                  */
+    uint64_t context;              /* MSR and cache enable bits       */
+    hwaddr raddr;                  /* Real page address               */
+    int32_t write_through_enabled;
+    int32_t cache_inhibit;
+    int32_t coherency_enabled;
+    int valid;
+} qem_ppc_memo_t;
+
+static qem_ppc_memo_t translation_memo[QEM_PPC_MEMO_CORES][2];
+
+void qem_trace_tlb_flush(CPUState *cs)
+{
+    if (cs->cpu_index < QEM_PPC_MEMO_CORES) {
+        translation_memo[cs->cpu_index][QEM_PPC_MEMO_DATA].valid = 0;
+        translation_memo[cs->cpu_index][QEM_PPC_MEMO_CODE].valid = 0;
+    }
+}
+
 void qem_ppc_get_info_addr_mem_trace(CPUPPCState *env, vaddr addr,
                                    int real_access_type,
                                    target_ulong* phys_addr,
@@ -220,25 +450,73 @@ void qem_ppc_get_info_addr_mem_trace(CPUPPCState *env, vaddr addr,
                                    int32_t* coherency_enabled)
 {
     mmu_ctx_t ctx;
+    qem_ppc_memo_t *memo;
+    target_ulong page;
+    uint64_t context;
+    int access_type;
+    int core;
+
+    *write_through_enabled = -1;
     *cache_inhibit = -1;
     *coherency_enabled = -1;
     *phys_addr = -1;
 
+    memo = NULL;
+    page = addr & TARGET_PAGE_MASK;
+    context = env->msr & ((1ULL << MSR_IR) | (1ULL << MSR_DR) |
+                          (1ULL << MSR_PR) | (1ULL << MSR_GS) | MSR_HVB);
+    if (env->mmu_model == POWERPC_MMU_BOOKE206) {
+        context |= (uint64_t)(env->spr[SPR_Exxx_L1CSR0] & L1CSR0_DCE) << 32;
+        context |= (uint64_t)(env->spr[SPR_Exxx_L1CSR1] & L1CSR1_ICE) << 40;
+    }
+
+    /* One compare when the page is the last one of the access class */
+    core = ENV_GET_CPU(env)->cpu_index;
+    if (core < QEM_PPC_MEMO_CORES) {
+        memo = &translation_memo[core][real_access_type == ACCESS_CODE ?
+                                       QEM_PPC_MEMO_CODE : QEM_PPC_MEMO_DATA];
+        if (memo->valid && memo->page == page && memo->context == context) {
+            *write_through_enabled = memo->write_through_enabled;
+            *cache_inhibit = memo->cache_inhibit;
+            *coherency_enabled = memo->coherency_enabled;
+#if QEM_TRACE_PHYSICAL_ADDRESS
+            *phys_addr = memo->raddr | (addr & ~TARGET_PAGE_MASK);
+#else
+            *phys_addr = addr;
+#endif
+            return;
+        }
+    }
+
+    /* The access class of the helper is tried first */
+    access_type = (real_access_type == ACCESS_CODE) ? ACCESS_CODE : ACCESS_INT;
     if (unlikely(qem_ppc_get_info_addr_mem_trace_internal(env, &ctx, addr, 0,
-        ACCESS_INT, real_access_type, write_through_enabled,
+        access_type, real_access_type, write_through_enabled,
         cache_inhibit, coherency_enabled) != 0)) {
 
-        /* Some MMUs have separate TLBs for code and data. If we only try an
-         * ACCESS_INT, we may not be able to read instructions mapped by code
-         * TLBs, so we also try a ACCESS_CODE.
+        /* Some MMUs have separate TLBs for code and data, cache operations
+         * on instructions may only be mapped by the data TLBs and the other
+         * way round, so we also try the other access class.
          */
+        access_type = (access_type == ACCESS_CODE) ? ACCESS_INT : ACCESS_CODE;
         if (unlikely(qem_ppc_get_info_addr_mem_trace_internal(env, &ctx, addr, 0,
-                                  ACCESS_CODE, real_access_type,
+                                  access_type, real_access_type,
                                   write_through_enabled,
                                   cache_inhibit, coherency_enabled) != 0)) {
             return;
         }
     }
+
+    if (memo != NULL) {
+        memo->page = page;
+        memo->context = context;
+        memo->raddr = ctx.raddr & TARGET_PAGE_MASK;
+        memo->write_through_enabled = *write_through_enabled;
+        memo->cache_inhibit = *cache_inhibit;
+        memo->coherency_enabled = *coherency_enabled;
+        memo->valid = 1;
+    }
+
 #if QEM_TRACE_PHYSICAL_ADDRESS
     *phys_addr = ctx.raddr;
 #else 
@@ -246,5 +524,4 @@ void qem_ppc_get_info_addr_mem_trace(CPUPPCState *env, vaddr addr,
 #endif
 }
 
-
 #endif /* QEM_TRACE_ENABLED */
\ No newline at end of file
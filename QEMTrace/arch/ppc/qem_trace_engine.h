@@ -57,6 +57,7 @@
 
 #if QEM_TRACE_ENABLED
 #include "../../qem_trace_engine.h"
+#include "qem_trace_mmu.h" /* Translation caches invalidation */
 
 /* Context used internally during MMU translations */
 typedef struct mmu_ctx_t mmu_ctx_t;
@@ -0,0 +1,58 @@
+/*
+ * Guest memory access tracing engine for PowerPC architecture.
+ *
+ * Provides the invalidation of the trace translation caches, called by the
+ * MMU emulation when the guest modifies its translations. Does not depend on
+ * the TCG headers.
+ *
+ * Header included in
+ *     qem_trace_engine.h
+ *     target/ppc/mmu_helper.c
+ *
+ *  Copyright (c) 2019 Alexy Torres Aurora Dugo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __QEM_TRACE_PPC_MMU_H_
+#define __QEM_TRACE_PPC_MMU_H_
+
+#include "../../qem_trace_config.h" /* QEMTrace configuration */
+
+#if QEM_TRACE_ENABLED
+
+#include "cpu.h" /* CPUPPCState, target_ulong */
+
+/*******************************************************************************
+ * FUNCTIONS
+ ******************************************************************************/
+
+/* Empties the BookE 2.06 TLB index of every core, called when a TLB entry is
+ * modified.
+ */
+void qem_ppc_tlb_index_invalidate(void);
+
+/* Empties the 6xx/74xx translation cache entry of the page on the core,
+ * called when the software TLB entries of the page are modified.
+ */
+void qem_ppc_6xx_cache_invalidate_page(CPUPPCState *env, target_ulong eaddr);
+
+/* Empties the 6xx/74xx translation cache of the core, called when the whole
+ * software TLB or SDR1 is modified.
+ */
+void qem_ppc_6xx_cache_invalidate_all(CPUPPCState *env);
+
+#endif /* QEM_TRACE_ENABLED */
+
+#endif /* __QEM_TRACE_PPC_MMU_H_ */
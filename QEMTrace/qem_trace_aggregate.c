@@ -0,0 +1,742 @@
+/*
+ * Guest memory access tracing engine.
+ *
+ * Provides tools to save per block access counters instead of traces.
+ *
+ *  Copyright (c) 2019 Alexy Torres Aurora Dugo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "qemu/osdep.h"
+#include "qemu/host-utils.h"
+#include "cpu.h"
+#include "qemu/timer.h"
+#include "sysemu/sysemu.h"
+
+#include "qem_trace_config.h" /* QEM Trace configuration */
+
+#if QEM_TRACE_ENABLED
+
+#if QEM_TRACE_TYPE == QEM_TRACE_AGGREGATE
+
+#include "qem_trace_engine.h" /* Engine header */
+#include "qem_trace_logger.h" /* QEM logger */
+
+/*******************************************************************************
+ * CONSTANTS
+ ******************************************************************************/
+
+/* Counters of a block */
+#define COUNTER_READ  0
+#define COUNTER_WRITE 1
+#define COUNTER_FETCH 2
+
+#if QEM_TRACE_AGGREGATE_MODE == QEM_TRACE_AGGREGATE_HISTOGRAM
+#if QEM_TRACE_AGGREGATE_TABLE_SIZE < 2 || \
+    (QEM_TRACE_AGGREGATE_TABLE_SIZE & (QEM_TRACE_AGGREGATE_TABLE_SIZE - 1)) != 0
+#error "QEM_TRACE_AGGREGATE_TABLE_SIZE must be a power of 2"
+#endif
+#else
+#if QEM_TRACE_AGGREGATE_TOP_K_SIZE < 1 || \
+    (QEM_TRACE_AGGREGATE_TOP_K_SIZE & (QEM_TRACE_AGGREGATE_TOP_K_SIZE - 1)) != 0
+#error "QEM_TRACE_AGGREGATE_TOP_K_SIZE must be a power of 2"
+#endif
+
+/* Top K index size, kept at most a quarter full */
+#define TOP_K_INDEX_SIZE (4 * QEM_TRACE_AGGREGATE_TOP_K_SIZE)
+#define TOP_K_INDEX_BITS __builtin_ctz(TOP_K_INDEX_SIZE)
+
+/* Top K summaries of a core */
+#define SUMMARY_LINE 0
+#define SUMMARY_PAGE 1
+#endif
+
+/*******************************************************************************
+ * STRUCTURES
+ ******************************************************************************/
+
+#if QEM_TRACE_AGGREGATE_MODE == QEM_TRACE_AGGREGATE_HISTOGRAM
+/* Hash table entry, key is the block number + 1, 0 for a free entry. */
+typedef struct
+{
+    uint64_t key;
+    uint64_t counters[3];
+} qem_aggregate_entry_t;
+#else
+/* Top K entry, ordered on count in the summary heap. */
+typedef struct
+{
+    uint64_t key;
+    uint64_t counters[3];
+    /* Count inherited from the evicted entry. */
+    uint64_t error;
+    /* Estimated count, error + counters. */
+    uint64_t count;
+    /* Position in the summary index. */
+    uint32_t slot;
+} qem_aggregate_top_t;
+
+/* Space-Saving summary, a min heap on count of the monitored blocks and an
+ * open addressing index of their heap positions.
+ */
+typedef struct
+{
+    qem_aggregate_top_t heap[QEM_TRACE_AGGREGATE_TOP_K_SIZE];
+    /* Heap position + 1 of the entries, 0 for a free slot. */
+    uint32_t index[TOP_K_INDEX_SIZE];
+    uint32_t size;
+} qem_aggregate_summary_t;
+#endif
+
+/* Counters of a core, only accessed by the thread running the core and, once
+ * the other cores are stopped, by the thread stopping tracing.
+ */
+typedef struct
+{
+#if QEM_TRACE_AGGREGATE_MODE == QEM_TRACE_AGGREGATE_HISTOGRAM
+    /* Open addressing hash table of the blocks. */
+    qem_aggregate_entry_t* entries;
+    /* Number of entries, power of 2. */
+    uint64_t size;
+    /* Number of used entries. */
+    uint64_t count;
+    /* Number of bits of the hash, log2(size). */
+    uint32_t bits;
+#else
+    /* Hottest lines and pages. */
+    qem_aggregate_summary_t summaries[2];
+#endif
+    /* Number of accesses since the last snapshot. */
+    uint64_t accesses;
+    /* Number of the next snapshot. */
+    uint32_t snapshot;
+    /* Set when the core accessed memory since tracing started. */
+    uint8_t  used;
+} qem_aggregate_table_t;
+
+/*******************************************************************************
+ * GLOBAL VARS
+ ******************************************************************************/
+/* Keeps track on the tracing state */
+volatile uint8_t qem_tracing_state = 0;
+
+/* Keeps track execution time */
+volatile uint64_t qem_time_start = 0;
+
+/* Counters of each possible vCPU, allocated when tracing is first enabled */
+static qem_aggregate_table_t* qem_aggregate_tables = NULL;
+static uint32_t               qem_aggregate_core_count = 0;
+
+/* Aggregate file, shared by the cores saving their snapshots */
+static FILE*           qem_aggregate_file_fd;
+static uint64_t        qem_file_size = 0;
+static pthread_mutex_t qem_aggregate_file_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* This is the file index ID. Each time the tracing is started, the index is
+ * incremented and the new file name will be of the form qem_aggregate_xx.out
+ * where xx is the file_index.
+ */
+static uint32_t qem_file_index = 0;
+
+/*******************************************************************************
+ * FUNCTIONS
+ ******************************************************************************/
+static inline uint64_t qem_aggregate_hash(const uint64_t key,
+                                          const uint32_t bits)
+{
+    /* Fibonacci hashing, the high bits are the best mixed */
+    return (key * 0x9E3779B97F4A7C15ULL) >> (64 - bits);
+}
+
+/* Writes an entry to the aggregate file, the file lock must be held. */
+static void qem_aggregate_write(const uint64_t block, const uint32_t shift,
+                                const uint64_t* counters, const uint64_t error,
+                                const uint32_t snapshot, const uint32_t core)
+{
+    qem_trace_aggregate_t entry;
+    int                   error_code;
+
+    entry.address  = block << shift;
+    entry.reads    = counters[COUNTER_READ];
+    entry.writes   = counters[COUNTER_WRITE];
+    entry.fetches  = counters[COUNTER_FETCH];
+    entry.error    = error;
+    entry.snapshot = snapshot;
+    entry.core     = core;
+    entry.shift    = shift;
+
+    error_code = fwrite(&entry, sizeof(qem_trace_aggregate_t), 1,
+                        qem_aggregate_file_fd);
+    if(error_code != 1)
+    {
+        QEM_TRACE_ERROR("Could not write the aggregate entry", error_code, 1);
+    }
+    qem_file_size += sizeof(qem_trace_aggregate_t);
+}
+
+#if QEM_TRACE_AGGREGATE_MODE == QEM_TRACE_AGGREGATE_HISTOGRAM
+
+static void qem_aggregate_alloc(qem_aggregate_table_t* table,
+                                const uint64_t size)
+{
+    table->entries = calloc(size, sizeof(qem_aggregate_entry_t));
+    if(table->entries == NULL)
+    {
+        QEM_TRACE_ERROR("Could not allocate the aggregate table", errno, 1);
+    }
+
+    table->size  = size;
+    table->count = 0;
+    table->bits  = 0;
+    while((1ULL << table->bits) < size)
+    {
+        ++table->bits;
+    }
+}
+
+static qem_aggregate_entry_t* qem_aggregate_find(qem_aggregate_table_t* table,
+                                                 const uint64_t key)
+{
+    qem_aggregate_entry_t* entry;
+    uint64_t               index;
+
+    /* Linear probing, the table is never more than half full */
+    index = qem_aggregate_hash(key, table->bits);
+    while(1)
+    {
+        entry = &table->entries[index];
+        if(entry->key == key || entry->key == 0)
+        {
+            return entry;
+        }
+        index = (index + 1) & (table->size - 1);
+    }
+}
+
+static void qem_aggregate_grow(qem_aggregate_table_t* table)
+{
+    qem_aggregate_entry_t* old_entries;
+    qem_aggregate_entry_t* entry;
+    uint64_t               old_size;
+    uint64_t               i;
+
+    old_entries = table->entries;
+    old_size    = table->size;
+
+    qem_aggregate_alloc(table, old_size * 2);
+    for(i = 0; i < old_size; ++i)
+    {
+        if(old_entries[i].key != 0)
+        {
+            entry  = qem_aggregate_find(table, old_entries[i].key);
+            *entry = old_entries[i];
+            ++table->count;
+        }
+    }
+
+    free(old_entries);
+}
+
+/* Counts an access to the block. */
+static inline void qem_aggregate_count(qem_aggregate_table_t* table,
+                                       const uint64_t block,
+                                       const uint32_t counter)
+{
+    qem_aggregate_entry_t* entry;
+    uint64_t               key;
+
+    if(table->entries == NULL)
+    {
+        qem_aggregate_alloc(table, QEM_TRACE_AGGREGATE_TABLE_SIZE);
+    }
+
+    key   = block + 1;
+    entry = qem_aggregate_find(table, key);
+    if(entry->key == 0)
+    {
+        /* Keep the table at most half full */
+        if(2 * (table->count + 1) > table->size)
+        {
+            qem_aggregate_grow(table);
+            entry = qem_aggregate_find(table, key);
+        }
+        entry->key = key;
+        ++table->count;
+    }
+
+    ++entry->counters[counter];
+}
+
+/* Appends the counters of a core to the aggregate file. */
+static void qem_aggregate_save(qem_aggregate_table_t* table,
+                               const uint32_t core)
+{
+    uint64_t i;
+
+    pthread_mutex_lock(&qem_aggregate_file_lock);
+
+    for(i = 0; i < table->size; ++i)
+    {
+        if(table->entries[i].key != 0)
+        {
+            qem_aggregate_write(table->entries[i].key - 1,
+                                QEM_TRACE_AGGREGATE_SHIFT,
+                                table->entries[i].counters, 0,
+                                table->snapshot, core);
+        }
+    }
+
+    pthread_mutex_unlock(&qem_aggregate_file_lock);
+
+    ++table->snapshot;
+}
+
+/* Releases the counters of a core. */
+static void qem_aggregate_release(qem_aggregate_table_t* table)
+{
+    free(table->entries);
+    table->entries = NULL;
+}
+
+#else
+
+/* Returns the index slot of the block, a free slot if not monitored. */
+static inline uint32_t qem_aggregate_top_find(
+                                        const qem_aggregate_summary_t* summary,
+                                        const uint64_t block)
+{
+    uint32_t slot;
+
+    slot = qem_aggregate_hash(block, TOP_K_INDEX_BITS);
+    while(summary->index[slot] != 0 &&
+          summary->heap[summary->index[slot] - 1].key != block)
+    {
+        slot = (slot + 1) & (TOP_K_INDEX_SIZE - 1);
+    }
+    return slot;
+}
+
+/* Removes a slot from the index, moving back the entries probed after it. */
+static void qem_aggregate_top_unindex(qem_aggregate_summary_t* summary,
+                                      uint32_t slot)
+{
+    uint64_t key;
+    uint32_t next;
+    uint32_t home;
+
+    next = slot;
+    while(1)
+    {
+        summary->index[slot] = 0;
+        while(1)
+        {
+            next = (next + 1) & (TOP_K_INDEX_SIZE - 1);
+            if(summary->index[next] == 0)
+            {
+                return;
+            }
+
+            /* Entries whose home is cyclically in ]slot, next] stay */
+            key  = summary->heap[summary->index[next] - 1].key;
+            home = qem_aggregate_hash(key, TOP_K_INDEX_BITS);
+            if((slot <= next) ? (slot < home && home <= next) :
+                                (slot < home || home <= next))
+            {
+                continue;
+            }
+            break;
+        }
+
+        summary->index[slot] = summary->index[next];
+        summary->heap[summary->index[slot] - 1].slot = slot;
+        slot = next;
+    }
+}
+
+/* Swaps two heap entries, keeping the index up to date. */
+static inline void qem_aggregate_top_swap(qem_aggregate_summary_t* summary,
+                                          const uint32_t first,
+                                          const uint32_t second)
+{
+    qem_aggregate_top_t entry;
+
+    entry                 = summary->heap[first];
+    summary->heap[first]  = summary->heap[second];
+    summary->heap[second] = entry;
+
+    summary->index[summary->heap[first].slot]  = first + 1;
+    summary->index[summary->heap[second].slot] = second + 1;
+}
+
+/* Moves up a new entry. */
+static inline void qem_aggregate_top_up(qem_aggregate_summary_t* summary,
+                                        uint32_t pos)
+{
+    uint32_t parent;
+
+    while(pos != 0)
+    {
+        parent = (pos - 1) / 2;
+        if(summary->heap[parent].count <= summary->heap[pos].count)
+        {
+            return;
+        }
+        qem_aggregate_top_swap(summary, pos, parent);
+        pos = parent;
+    }
+}
+
+/* Moves down an entry which count increased. */
+static inline void qem_aggregate_top_down(qem_aggregate_summary_t* summary,
+                                          uint32_t pos)
+{
+    uint32_t child;
+
+    while((child = 2 * pos + 1) < summary->size)
+    {
+        if(child + 1 < summary->size &&
+           summary->heap[child + 1].count < summary->heap[child].count)
+        {
+            ++child;
+        }
+        if(summary->heap[child].count >= summary->heap[pos].count)
+        {
+            return;
+        }
+        qem_aggregate_top_swap(summary, pos, child);
+        pos = child;
+    }
+}
+
+/* Counts an access to the block, the least counted block is replaced when
+ * the summary is full.
+ */
+static inline void qem_aggregate_top_count(qem_aggregate_summary_t* summary,
+                                           const uint64_t block,
+                                           const uint32_t counter)
+{
+    qem_aggregate_top_t* entry;
+    uint32_t             slot;
+    uint32_t             pos;
+
+    slot = qem_aggregate_top_find(summary, block);
+    if(summary->index[slot] != 0)
+    {
+        pos = summary->index[slot] - 1;
+        ++summary->heap[pos].counters[counter];
+        ++summary->heap[pos].count;
+        qem_aggregate_top_down(summary, pos);
+        return;
+    }
+
+    if(summary->size < QEM_TRACE_AGGREGATE_TOP_K_SIZE)
+    {
+        pos          = summary->size++;
+        entry        = &summary->heap[pos];
+        entry->error = 0;
+        entry->count = 0;
+    }
+    else
+    {
+        /* Replace the least counted block, which count becomes the error */
+        pos   = 0;
+        entry = &summary->heap[0];
+        qem_aggregate_top_unindex(summary, entry->slot);
+        slot         = qem_aggregate_top_find(summary, block);
+        entry->error = entry->count;
+    }
+
+    entry->key                      = block;
+    entry->counters[COUNTER_READ]   = 0;
+    entry->counters[COUNTER_WRITE]  = 0;
+    entry->counters[COUNTER_FETCH]  = 0;
+    entry->counters[counter]        = 1;
+    entry->slot                     = slot;
+    ++entry->count;
+    summary->index[slot] = pos + 1;
+
+    qem_aggregate_top_up(summary, pos);
+    qem_aggregate_top_down(summary, pos);
+}
+
+/* Appends the hottest blocks of a core to the aggregate file and starts a
+ * new epoch.
+ */
+static void qem_aggregate_save(qem_aggregate_table_t* table,
+                               const uint32_t core)
+{
+    static const uint32_t shifts[2] = {
+        [SUMMARY_LINE] = QEM_TRACE_AGGREGATE_LINE_SHIFT,
+        [SUMMARY_PAGE] = QEM_TRACE_AGGREGATE_PAGE_SHIFT
+    };
+
+    qem_aggregate_summary_t* summary;
+    uint32_t                 i;
+    uint32_t                 j;
+
+    pthread_mutex_lock(&qem_aggregate_file_lock);
+
+    for(i = 0; i < 2; ++i)
+    {
+        summary = &table->summaries[i];
+        for(j = 0; j < summary->size; ++j)
+        {
+            qem_aggregate_write(summary->heap[j].key, shifts[i],
+                                summary->heap[j].counters,
+                                summary->heap[j].error,
+                                table->snapshot, core);
+        }
+    }
+
+    pthread_mutex_unlock(&qem_aggregate_file_lock);
+
+    memset(table->summaries, 0, sizeof(table->summaries));
+    ++table->snapshot;
+}
+
+/* Releases the counters of a core. */
+static void qem_aggregate_release(qem_aggregate_table_t* table)
+{
+    (void)table;
+}
+
+#endif /* QEM_TRACE_AGGREGATE_MODE == QEM_TRACE_AGGREGATE_HISTOGRAM */
+
+static void qem_write_header(const uint64_t size, const uint32_t trace_size,
+                             const uint32_t trace_version)
+{
+    int error;
+
+    qem_trace_header_t header =
+    {
+            .size = size,
+            .struct_size = trace_size,
+            .version = trace_version
+    };
+
+    /* Go to the begining of the file */
+    error = fseek(qem_aggregate_file_fd, 0, SEEK_SET);
+    if(error != 0)
+    {
+        QEM_TRACE_ERROR("Could not set the header marker", error, 1);
+    }
+
+    /* Write the header */
+    error = fwrite(&header, sizeof(qem_trace_header_t),
+                   1, qem_aggregate_file_fd);
+    if(error != 1)
+    {
+        QEM_TRACE_ERROR("Could not write the header", error, 1);
+    }
+}
+
+static void qem_init_tracing(void)
+{
+    char filename[27];
+    sprintf(filename, "qem_aggregate_%08d.out", qem_file_index++);
+    filename[26] = 0;
+    remove(filename);
+
+    qem_aggregate_file_fd = fopen(filename, "wb+");
+
+    /* In case of error */
+    if(qem_aggregate_file_fd == NULL)
+    {
+        QEM_TRACE_ERROR("Could not create or open the aggregate file", errno,
+                        1);
+    }
+
+    /* Init the header space */
+    qem_write_header(0, sizeof(qem_trace_aggregate_t), 1);
+    qem_file_size = sizeof(qem_trace_header_t);
+
+    /* Start from empty counters */
+    if(qem_aggregate_tables == NULL)
+    {
+        qem_aggregate_core_count = max_cpus;
+        qem_aggregate_tables = calloc(qem_aggregate_core_count,
+                                      sizeof(qem_aggregate_table_t));
+        if(qem_aggregate_tables == NULL)
+        {
+            QEM_TRACE_ERROR("Could not allocate the aggregate tables", errno,
+                            1);
+        }
+    }
+    memset(qem_aggregate_tables, 0,
+           qem_aggregate_core_count * sizeof(qem_aggregate_table_t));
+
+    QEM_TRACE_INFO("==== Aggregate file name", 0);
+    QEM_TRACE_INFO(filename, 0);
+}
+
+static void qem_close_tracing(void)
+{
+    uint32_t i;
+
+    /* Save the last snapshot of each core */
+    for(i = 0; i < qem_aggregate_core_count; ++i)
+    {
+        if(qem_aggregate_tables[i].used != 0)
+        {
+            qem_aggregate_save(&qem_aggregate_tables[i], i);
+            qem_aggregate_release(&qem_aggregate_tables[i]);
+        }
+    }
+
+    qem_write_header(qem_file_size, sizeof(qem_trace_aggregate_t), 1);
+
+    /* Close file */
+    if(fclose(qem_aggregate_file_fd) < 0)
+    {
+        QEM_TRACE_ERROR("Error while closing the aggregate file", errno, 0);
+    }
+    else
+    {
+        QEM_TRACE_INFO("Aggregate file saved", 0);
+    }
+}
+
+void qem_trace_enable(CPUState* cs, const QEM_TRACE_TTYPE_E type)
+{
+    if(qem_tracing_state == type)
+    {
+        return;
+    }
+
+    if(qem_tracing_state == 0)
+    {
+        /* Open output file */
+        qem_init_tracing();
+        qem_trace_sample_reset();
+        qem_trace_cache_reset();
+    }
+
+    /* Enable tracing state */
+    qem_tracing_state = type;
+}
+
+void qem_trace_disable(const QEM_TRACE_TTYPE_E type)
+{
+    CPUState* cpu;
+
+    if(qem_tracing_state == 0)
+    {
+        return;
+    }
+
+    /* The other cores count in their tables until they are stopped, the
+     * tables are saved and released while they wait.
+     */
+    cpu = qem_trace_exclusive_start();
+
+    /* Enable tracing state */
+    qem_tracing_state &= ~type;
+
+    if(qem_tracing_state == 0)
+    {
+        /* Save the counters and close the output file */
+        qem_close_tracing();
+    }
+
+    qem_trace_exclusive_end(cpu);
+}
+
+void qem_trace_start_timer(void)
+{
+    /* Save the current time */
+    qem_time_start = qemu_clock_get_ns(QEMU_CLOCK_REALTIME);
+}
+
+void qem_trace_get_timer(void)
+{
+    /* Get the current time and compares it to the previously defined start
+     * time.
+     */
+    uint64_t time_end;
+    time_end = qemu_clock_get_ns(QEMU_CLOCK_REALTIME);
+    printf("[QEMU] Elapsed time = %" PRIu64 "\n", (time_end - qem_time_start));
+}
+
+#if QEM_TRACE_TARGET_64
+void QEM_TRACE_BACKEND_OUTPUT(uint64_t virt_addr, uint64_t phys_addr,
+                              uint32_t core, uint64_t time, uint32_t flags)
+#else
+void QEM_TRACE_BACKEND_OUTPUT(uint32_t virt_addr, uint32_t phys_addr,
+                              uint32_t core, uint64_t time, uint32_t flags)
+#endif
+{
+    qem_aggregate_table_t* table;
+    uint32_t               counter;
+
+    (void)virt_addr;
+    (void)time;
+
+    /* Only accesses are counted, cache maintenance and markers are dropped */
+    if((flags & QEM_TRACE_EVENT_MASK) != QEM_TRACE_EVENT_ACCESS ||
+       (flags & QEM_TRACE_SAMPLE_MARKER_MASK) != 0)
+    {
+        return;
+    }
+
+    if((flags & QEM_TRACE_DATA_TYPE_MASK) == QEM_TRACE_DATA_TYPE_INST)
+    {
+        counter = COUNTER_FETCH;
+    }
+    else if((flags & QEM_TRACE_ACCESS_TYPE_MASK) ==
+            QEM_TRACE_ACCESS_TYPE_WRITE)
+    {
+        counter = COUNTER_WRITE;
+    }
+    else
+    {
+        counter = COUNTER_READ;
+    }
+
+    if(core >= qem_aggregate_core_count)
+    {
+        return;
+    }
+    table = &qem_aggregate_tables[core];
+
+#if QEM_TRACE_AGGREGATE_MODE == QEM_TRACE_AGGREGATE_HISTOGRAM
+    qem_aggregate_count(table, (uint64_t)phys_addr >> QEM_TRACE_AGGREGATE_SHIFT,
+                        counter);
+#else
+    qem_aggregate_top_count(&table->summaries[SUMMARY_LINE],
+                            (uint64_t)phys_addr >>
+                            QEM_TRACE_AGGREGATE_LINE_SHIFT,
+                            counter);
+    qem_aggregate_top_count(&table->summaries[SUMMARY_PAGE],
+                            (uint64_t)phys_addr >>
+                            QEM_TRACE_AGGREGATE_PAGE_SHIFT,
+                            counter);
+#endif
+    table->used = 1;
+
+#if QEM_TRACE_AGGREGATE_PERIOD != 0
+    if(++table->accesses == QEM_TRACE_AGGREGATE_PERIOD)
+    {
+        qem_aggregate_save(table, core);
+        table->accesses = 0;
+    }
+#endif
+}
+
+#endif /* QEM_TRACE_TYPE == QEM_TRACE_AGGREGATE */
+
+#endif /* QEM_TRACE_ENABLED */
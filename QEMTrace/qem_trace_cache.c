@@ -0,0 +1,378 @@
+/*
+ * Guest memory access tracing cache filter.
+ *
+ * Provides the per core L1 cache models placed in front of the trace type
+ * output.
+ *
+ *  Copyright (c) 2019 Alexy Torres Aurora Dugo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "qem_trace_config.h" /* QEM Trace configuration */
+
+#if QEM_TRACE_ENABLED
+
+#if QEM_TRACE_CACHE_FILTER_ENABLED
+
+#include <string.h>
+
+#include "qemu/osdep.h"
+#include "cpu.h"
+
+#include "qem_trace_engine.h" /* Engine header */
+#include "qem_trace_def.h"    /* Trace format */
+#include "qem_trace_cache.h"  /* Cache filter header */
+
+/*******************************************************************************
+ * CONSTANTS
+ ******************************************************************************/
+
+/* Line states */
+#define LINE_VALID 0x01
+#define LINE_DIRTY 0x02
+
+/* Caches of a core */
+#define CACHE_DATA 0
+#define CACHE_INST 1
+
+/*******************************************************************************
+ * STRUCTURES
+ ******************************************************************************/
+
+/* Set associative cache, only accessed by the thread running the core. */
+typedef struct
+{
+    /* Line address (address / line size) of each line. */
+    uint64_t tags[QEM_TRACE_CACHE_SETS][QEM_TRACE_CACHE_WAYS];
+#if QEM_TRACE_CACHE_POLICY == QEM_TRACE_CACHE_LRU
+    /* Last use of each line. */
+    uint64_t stamps[QEM_TRACE_CACHE_SETS][QEM_TRACE_CACHE_WAYS];
+    /* Use counter. */
+    uint64_t clock;
+#else
+    /* Tree pseudo LRU bits of each set, node n children are 2n+1 and 2n+2. */
+    uint64_t plru[QEM_TRACE_CACHE_SETS];
+#endif
+    /* State of each line. */
+    uint8_t  states[QEM_TRACE_CACHE_SETS][QEM_TRACE_CACHE_WAYS];
+} qem_trace_cache_t;
+
+/*******************************************************************************
+ * GLOBAL VARS
+ ******************************************************************************/
+
+/* Data and instruction caches of the cores */
+static qem_trace_cache_t caches[QEM_TRACE_CACHE_MAX_CORES][2];
+
+/*******************************************************************************
+ * FUNCTIONS
+ ******************************************************************************/
+
+/* Marks the way of the set as the most recently used. */
+static inline void cache_touch(qem_trace_cache_t* cache, const uint32_t set,
+                               const uint32_t way)
+{
+#if QEM_TRACE_CACHE_POLICY == QEM_TRACE_CACHE_LRU
+    cache->stamps[set][way] = ++cache->clock;
+#else
+    uint32_t node;
+    uint32_t width;
+
+    /* Make each node on the path point away from the way */
+    node  = 0;
+    width = QEM_TRACE_CACHE_WAYS / 2;
+    while(width != 0)
+    {
+        if((way & width) != 0)
+        {
+            cache->plru[set] &= ~(1ULL << node);
+            node = 2 * node + 2;
+        }
+        else
+        {
+            cache->plru[set] |= (1ULL << node);
+            node = 2 * node + 1;
+        }
+        width /= 2;
+    }
+#endif
+}
+
+/* Returns the way to replace in the set. */
+static inline uint32_t cache_victim(const qem_trace_cache_t* cache,
+                                    const uint32_t set)
+{
+    uint32_t way;
+
+    /* Free ways first */
+    for(way = 0; way < QEM_TRACE_CACHE_WAYS; ++way)
+    {
+        if((cache->states[set][way] & LINE_VALID) == 0)
+        {
+            return way;
+        }
+    }
+
+#if QEM_TRACE_CACHE_POLICY == QEM_TRACE_CACHE_LRU
+    uint32_t victim;
+
+    victim = 0;
+    for(way = 1; way < QEM_TRACE_CACHE_WAYS; ++way)
+    {
+        if(cache->stamps[set][way] < cache->stamps[set][victim])
+        {
+            victim = way;
+        }
+    }
+    return victim;
+#else
+    uint32_t node;
+    uint32_t width;
+
+    /* Follow the nodes */
+    node  = 0;
+    way   = 0;
+    width = QEM_TRACE_CACHE_WAYS / 2;
+    while(width != 0)
+    {
+        if((cache->plru[set] & (1ULL << node)) != 0)
+        {
+            way |= width;
+            node = 2 * node + 2;
+        }
+        else
+        {
+            node = 2 * node + 1;
+        }
+        width /= 2;
+    }
+    return way;
+#endif
+}
+
+/* Returns the way holding the line in the set, -1 if not cached. */
+static inline int32_t cache_find(const qem_trace_cache_t* cache,
+                                 const uint32_t set, const uint64_t line)
+{
+    uint32_t way;
+
+    for(way = 0; way < QEM_TRACE_CACHE_WAYS; ++way)
+    {
+        if((cache->states[set][way] & LINE_VALID) != 0 &&
+           cache->tags[set][way] == line)
+        {
+            return way;
+        }
+    }
+    return -1;
+}
+
+/* Outputs the writeback of a dirty line. */
+static void cache_writeback(const uint64_t line, const uint32_t core,
+                            const uint64_t time, const uint32_t flags)
+{
+    uint64_t addr;
+
+    addr = line * QEM_TRACE_CACHE_LINE_SIZE;
+    QEM_TRACE_CACHE_NEXT(addr, addr, core, time,
+                         QEM_TRACE_EVENT_ACCESS |
+                         QEM_TRACE_ACCESS_TYPE_WRITE |
+                         QEM_TRACE_DATA_TYPE_DATA |
+                         QEM_TRACE_CACHE_WRITEBACK_ON |
+                         (flags & QEM_TRACE_PL_E_MASK));
+}
+
+/* Fills the line in the cache, the dirty victim is written back. */
+static void cache_fill(qem_trace_cache_t* cache, const uint32_t set,
+                       const uint64_t line, const uint8_t state,
+                       const uint32_t core, const uint64_t time,
+                       const uint32_t flags)
+{
+    uint32_t way;
+
+    way = cache_victim(cache, set);
+    if((cache->states[set][way] & LINE_DIRTY) != 0)
+    {
+        cache_writeback(cache->tags[set][way], core, time, flags);
+    }
+
+    cache->tags[set][way]   = line;
+    cache->states[set][way] = state;
+    cache_touch(cache, set, way);
+}
+
+/* Applies a maintenance event to the whole cache or to a line. */
+static void cache_maintain(qem_trace_cache_t* cache, const uint64_t line,
+                           const uint32_t core, const uint64_t time,
+                           const uint32_t flags)
+{
+    uint32_t set;
+    uint32_t way;
+    uint32_t first;
+    uint32_t last;
+    uint32_t event;
+    uint8_t  whole;
+    int32_t  found;
+
+    event = flags & QEM_TRACE_EVENT_MASK;
+
+    /* Zeroing a line allocates it without reading it */
+    if(event == QEM_TRACE_EVENT_DCBZ)
+    {
+        set   = line & (QEM_TRACE_CACHE_SETS - 1);
+        found = cache_find(cache, set, line);
+        if(found < 0)
+        {
+            cache_fill(cache, set, line, LINE_VALID | LINE_DIRTY, core, time,
+                       flags);
+        }
+        else
+        {
+            cache->states[set][found] |= LINE_DIRTY;
+            cache_touch(cache, set, found);
+        }
+        return;
+    }
+
+    if(event != QEM_TRACE_EVENT_FLUSH && event != QEM_TRACE_EVENT_INVALIDATE &&
+       event != (QEM_TRACE_EVENT_FLUSH | QEM_TRACE_EVENT_INVALIDATE))
+    {
+        /* Locks and prefetches do not change the cache content */
+        return;
+    }
+
+    /* Line requests only concern the line set, the others all the lines */
+    whole = ((flags & QEM_TRACE_GRANULARITY_MASK) !=
+             QEM_TRACE_GRANULARITY_LINE);
+    if(whole == 0)
+    {
+        first = line & (QEM_TRACE_CACHE_SETS - 1);
+        last  = first;
+    }
+    else
+    {
+        first = 0;
+        last  = QEM_TRACE_CACHE_SETS - 1;
+    }
+
+    for(set = first; set <= last; ++set)
+    {
+        for(way = 0; way < QEM_TRACE_CACHE_WAYS; ++way)
+        {
+            if(whole == 0 && cache->tags[set][way] != line)
+            {
+                continue;
+            }
+
+            /* The event is output, the line is not written back twice */
+            if((event & QEM_TRACE_EVENT_INVALIDATE) != 0)
+            {
+                cache->states[set][way] = 0;
+            }
+            else
+            {
+                cache->states[set][way] &= ~LINE_DIRTY;
+            }
+        }
+    }
+}
+
+void qem_trace_cache_reset(void)
+{
+    memset(caches, 0, sizeof(caches));
+}
+
+#if QEM_TRACE_TARGET_64
+void qem_trace_output(uint64_t virt_addr, uint64_t phys_addr,
+                      uint32_t core, uint64_t time, uint32_t flags)
+#else
+void qem_trace_output(uint32_t virt_addr, uint32_t phys_addr,
+                      uint32_t core, uint64_t time, uint32_t flags)
+#endif
+{
+    qem_trace_cache_t* cache;
+    uint64_t           line;
+    uint32_t           set;
+    uint8_t            write;
+    int32_t            way;
+
+    /* Sampling markers, non cached accesses and untracked cores go through */
+    if((flags & QEM_TRACE_SAMPLE_MARKER_MASK) != 0 ||
+       (flags & QEM_TRACE_CACHE_INHIBIT_MASK) != 0 ||
+       core >= QEM_TRACE_CACHE_MAX_CORES)
+    {
+        QEM_TRACE_CACHE_NEXT(virt_addr, phys_addr, core, time, flags);
+        return;
+    }
+
+    cache = caches[core];
+    if((flags & QEM_TRACE_DATA_TYPE_MASK) == QEM_TRACE_DATA_TYPE_INST)
+    {
+        cache += CACHE_INST;
+    }
+    else
+    {
+        cache += CACHE_DATA;
+    }
+
+    line = phys_addr / QEM_TRACE_CACHE_LINE_SIZE;
+
+    /* Maintenance events are always output, after updating the L1 model */
+    if((flags & QEM_TRACE_EVENT_MASK) != QEM_TRACE_EVENT_ACCESS)
+    {
+        if((flags & QEM_TRACE_CACHE_LEVEL_MASK) == QEM_TRACE_CACHE_LEVEL_1 ||
+           (flags & QEM_TRACE_CACHE_LEVEL_MASK) == QEM_TRACE_CACHE_LEVEL_ALL)
+        {
+            cache_maintain(cache, line, core, time, flags);
+        }
+        QEM_TRACE_CACHE_NEXT(virt_addr, phys_addr, core, time, flags);
+        return;
+    }
+
+    set   = line & (QEM_TRACE_CACHE_SETS - 1);
+    way   = cache_find(cache, set, line);
+    write = ((flags & QEM_TRACE_ACCESS_TYPE_MASK) ==
+             QEM_TRACE_ACCESS_TYPE_WRITE);
+
+    /* Write through stores update the cached line and are always output */
+    if(write && (flags & QEM_TRACE_CACHE_WT_MASK) != 0)
+    {
+        if(way >= 0)
+        {
+            cache_touch(cache, set, way);
+        }
+        QEM_TRACE_CACHE_NEXT(virt_addr, phys_addr, core, time, flags);
+        return;
+    }
+
+    /* Hits are absorbed */
+    if(way >= 0)
+    {
+        if(write)
+        {
+            cache->states[set][way] |= LINE_DIRTY;
+        }
+        cache_touch(cache, set, way);
+        return;
+    }
+
+    cache_fill(cache, set, line, LINE_VALID | (write ? LINE_DIRTY : 0),
+               core, time, flags);
+    QEM_TRACE_CACHE_NEXT(virt_addr, phys_addr, core, time, flags);
+}
+
+#endif /* QEM_TRACE_CACHE_FILTER_ENABLED */
+
+#endif /* QEM_TRACE_ENABLED */
@@ -0,0 +1,80 @@
+/*
+ * Guest memory access tracing cache filter.
+ *
+ * Provides the L1 cache models the memory events go through before being
+ * output, only the events the caches do not absorb are output.
+ *
+ * Header included in
+ *     qem_trace_engine.h
+ *
+ *  Copyright (c) 2019 Alexy Torres Aurora Dugo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __QEM_TRACE_CACHE_H_
+#define __QEM_TRACE_CACHE_H_
+
+#include "qem_trace_config.h" /* QEM Trace configuration */
+
+#if QEM_TRACE_ENABLED
+
+/*******************************************************************************
+ * CONSTANTS
+ ******************************************************************************/
+
+/* Number of cores with their own caches, the accesses of the cores above are
+ * not filtered.
+ */
+#define QEM_TRACE_CACHE_MAX_CORES 64
+
+#if QEM_TRACE_CACHE_FILTER_ENABLED
+#if QEM_TRACE_GATHER_META == 0
+#error "QEM_TRACE_CACHE_FILTER_ENABLED requires QEM_TRACE_GATHER_META"
+#endif
+#if QEM_TRACE_CACHE_SETS < 1 || \
+    (QEM_TRACE_CACHE_SETS & (QEM_TRACE_CACHE_SETS - 1)) != 0
+#error "QEM_TRACE_CACHE_SETS must be a power of 2"
+#endif
+#if QEM_TRACE_CACHE_LINE_SIZE < 1 || \
+    (QEM_TRACE_CACHE_LINE_SIZE & (QEM_TRACE_CACHE_LINE_SIZE - 1)) != 0
+#error "QEM_TRACE_CACHE_LINE_SIZE must be a power of 2"
+#endif
+#if QEM_TRACE_CACHE_WAYS < 1 || QEM_TRACE_CACHE_WAYS > 64
+#error "QEM_TRACE_CACHE_WAYS must be between 1 and 64"
+#endif
+#if QEM_TRACE_CACHE_POLICY == QEM_TRACE_CACHE_PLRU && \
+    (QEM_TRACE_CACHE_WAYS & (QEM_TRACE_CACHE_WAYS - 1)) != 0
+#error "QEM_TRACE_CACHE_WAYS must be a power of 2 with the PLRU policy"
+#endif
+#endif
+
+/*******************************************************************************
+ * FUNCTIONS
+ ******************************************************************************/
+
+#if QEM_TRACE_CACHE_FILTER_ENABLED
+
+/* Empties the caches of all the cores, called when tracing starts. */
+void qem_trace_cache_reset(void);
+
+#else
+
+#define qem_trace_cache_reset()
+
+#endif /* QEM_TRACE_CACHE_FILTER_ENABLED */
+
+#endif /* QEM_TRACE_ENABLED */
+
+#endif /* __QEM_TRACE_CACHE_H_ */
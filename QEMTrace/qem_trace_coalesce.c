@@ -0,0 +1,166 @@
+/*
+ * Guest memory access tracing fetch coalescing.
+ *
+ * Provides the per core ranges merging the instruction fetches placed in front
+ * of the trace type output.
+ *
+ *  Copyright (c) 2019 Alexy Torres Aurora Dugo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "qem_trace_config.h" /* QEM Trace configuration */
+
+#if QEM_TRACE_ENABLED
+
+#if QEM_TRACE_COALESCE_ENABLED
+
+#include "qemu/osdep.h"
+#include "cpu.h"
+
+#include "qem_trace_engine.h"   /* Engine header */
+#include "qem_trace_def.h"      /* Trace format */
+#include "qem_trace_coalesce.h" /* Fetch coalescing header */
+
+/*******************************************************************************
+ * STRUCTURES
+ ******************************************************************************/
+
+/* Fetches merged and not yet output, only accessed by the thread running the
+ * core and by the flush when tracing stops.
+ */
+typedef struct
+{
+    /* First fetch of the range. */
+    uint64_t virt;
+    uint64_t phys;
+    uint64_t time;
+    /* Bit n is set when a fetch was done n bytes after the first one. */
+    uint64_t offsets;
+    /* Flags shared by the fetches. */
+    uint32_t flags;
+    /* Number of fetches, 0 when the range is empty. */
+    uint32_t count;
+    /* Offset of the last fetch. */
+    uint32_t last;
+} qem_trace_range_t;
+
+/*******************************************************************************
+ * GLOBAL VARS
+ ******************************************************************************/
+
+/* Current range of the cores */
+static qem_trace_range_t ranges[QEM_TRACE_COALESCE_MAX_CORES];
+
+/*******************************************************************************
+ * FUNCTIONS
+ ******************************************************************************/
+
+/* Outputs the range and empties it, a single fetch is output unchanged. */
+static void range_output(qem_trace_range_t* range, const uint32_t core)
+{
+    if(range->count == 0)
+    {
+        return;
+    }
+
+    if(range->count == 1)
+    {
+        QEM_TRACE_BACKEND_OUTPUT(range->virt, range->phys, core, range->time,
+                                 range->flags);
+    }
+    else
+    {
+        QEM_TRACE_BACKEND_OUTPUT(range->virt, range->phys, core, range->time,
+                                 range->flags | QEM_TRACE_FETCH_RANGE_START);
+        QEM_TRACE_BACKEND_OUTPUT(range->count, range->count, core,
+                                 range->offsets,
+                                 range->flags | QEM_TRACE_FETCH_RANGE_OFFSETS);
+    }
+    range->count = 0;
+}
+
+void qem_trace_coalesce_flush(void)
+{
+    CPUState* cpu;
+    uint32_t  core;
+
+    /* The other cores merge fetches in their ranges until they are stopped */
+    cpu = qem_trace_exclusive_start();
+
+    for(core = 0; core < QEM_TRACE_COALESCE_MAX_CORES; ++core)
+    {
+        range_output(&ranges[core], core);
+    }
+
+    qem_trace_exclusive_end(cpu);
+}
+
+#if QEM_TRACE_TARGET_64
+void QEM_TRACE_COALESCE_OUTPUT(uint64_t virt_addr, uint64_t phys_addr,
+                               uint32_t core, uint64_t time, uint32_t flags)
+#else
+void QEM_TRACE_COALESCE_OUTPUT(uint32_t virt_addr, uint32_t phys_addr,
+                               uint32_t core, uint64_t time, uint32_t flags)
+#endif
+{
+    qem_trace_range_t* range;
+    uint64_t           offset;
+
+    if(core >= QEM_TRACE_COALESCE_MAX_CORES)
+    {
+        QEM_TRACE_BACKEND_OUTPUT(virt_addr, phys_addr, core, time, flags);
+        return;
+    }
+    range = &ranges[core];
+
+    /* Other records end the range, they are output after it */
+    if((flags & QEM_TRACE_DATA_TYPE_MASK) != QEM_TRACE_DATA_TYPE_INST ||
+       (flags & QEM_TRACE_EVENT_MASK) != QEM_TRACE_EVENT_ACCESS ||
+       (flags & QEM_TRACE_SAMPLE_MARKER_MASK) != 0 ||
+       (flags & QEM_TRACE_CACHE_WRITEBACK_MASK) != 0 ||
+       (flags & QEM_TRACE_STRING_RANGE_MASK) != 0)
+    {
+        range_output(range, core);
+        QEM_TRACE_BACKEND_OUTPUT(virt_addr, phys_addr, core, time, flags);
+        return;
+    }
+
+    /* Merge the fetch if it follows the last one in the span */
+    offset = (uint64_t)phys_addr - range->phys;
+    if(range->count != 0 && range->flags == flags &&
+       (uint64_t)phys_addr > range->phys + range->last &&
+       offset < QEM_TRACE_COALESCE_SPAN &&
+       (uint64_t)virt_addr - range->virt == offset)
+    {
+        range->offsets |= (1ULL << offset);
+        range->last     = offset;
+        ++range->count;
+        return;
+    }
+
+    /* Start a new range */
+    range_output(range, core);
+    range->virt    = virt_addr;
+    range->phys    = phys_addr;
+    range->time    = time;
+    range->offsets = 1;
+    range->flags   = flags;
+    range->count   = 1;
+    range->last    = 0;
+}
+
+#endif /* QEM_TRACE_COALESCE_ENABLED */
+
+#endif /* QEM_TRACE_ENABLED */
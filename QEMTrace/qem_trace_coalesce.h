@@ -0,0 +1,75 @@
+/*
+ * Guest memory access tracing fetch coalescing.
+ *
+ * Provides the merging of the consecutive instruction fetches of a core into
+ * range records and the expansion of the range records.
+ *
+ * Header included in
+ *     qem_trace_engine.h
+ *
+ *  Copyright (c) 2019 Alexy Torres Aurora Dugo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __QEM_TRACE_COALESCE_H_
+#define __QEM_TRACE_COALESCE_H_
+
+#include "qem_trace_config.h" /* QEM Trace configuration */
+
+#if QEM_TRACE_ENABLED
+
+#include <stdint.h> /* Generic types */
+
+/*******************************************************************************
+ * CONSTANTS
+ ******************************************************************************/
+
+/* Number of cores merging their fetches, fetches of the cores above are not
+ * merged.
+ */
+#define QEM_TRACE_COALESCE_MAX_CORES 64
+
+#if QEM_TRACE_COALESCE_ENABLED
+#if QEM_TRACE_GATHER_META == 0
+#error "QEM_TRACE_COALESCE_ENABLED requires QEM_TRACE_GATHER_META"
+#endif
+#if QEM_TRACE_TYPE == QEM_TRACE_AGGREGATE
+#error "QEM_TRACE_COALESCE_ENABLED cannot be used with QEM_TRACE_AGGREGATE"
+#endif
+#if QEM_TRACE_COALESCE_SPAN < 2 || QEM_TRACE_COALESCE_SPAN > 64
+#error "QEM_TRACE_COALESCE_SPAN must be between 2 and 64"
+#endif
+#endif
+
+/*******************************************************************************
+ * FUNCTIONS
+ ******************************************************************************/
+
+#if QEM_TRACE_COALESCE_ENABLED
+
+/* Outputs the ranges not yet output, called when tracing stops. The other
+ * cores are stopped while their ranges are output.
+ */
+void qem_trace_coalesce_flush(void);
+
+#else
+
+#define qem_trace_coalesce_flush()
+
+#endif /* QEM_TRACE_COALESCE_ENABLED */
+
+#endif /* QEM_TRACE_ENABLED */
+
+#endif /* __QEM_TRACE_COALESCE_H_ */
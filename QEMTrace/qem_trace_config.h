@@ -48,13 +48,17 @@
 
 #define QEM_TRACE_FLASH_INV_INST_OP 0xFFFFFFF8
 #define QEM_TRACE_FLASH_INV_DATA_OP 0xFFFFFFF9
+
+#define QEM_TRACE_RING_TRIGGER_OP   0xFFFFFFFA
     
 /******************************
  * Trace type 
  *****************************/
-#define QEM_TRACE_PRINT 0
-#define QEM_TRACE_FILE  1
-#define QEM_TRACE_SMI   2
+#define QEM_TRACE_PRINT     0
+#define QEM_TRACE_FILE      1
+#define QEM_TRACE_SMI       2
+#define QEM_TRACE_AGGREGATE 3
+#define QEM_TRACE_RING      4
 
 /* Select the trace type */
 #define QEM_TRACE_TYPE QEM_TRACE_SMI
@@ -82,6 +86,287 @@
  */
 #define QEM_TRACE_GATHER_META 1
 
+/******************************
+ * Trace timestamps
+ *****************************/
+#define QEM_TRACE_TIME_RDTSC   0
+#define QEM_TRACE_TIME_ICOUNT  1
+#define QEM_TRACE_TIME_VIRTUAL 2
+
+/* Select the source of the records timestamp:
+ * QEM_TRACE_TIME_RDTSC   = Host time stamp counter when the record is built.
+ * QEM_TRACE_TIME_ICOUNT  = Number of guest instructions the core started
+ *                          before the traced one. Each translation block adds
+ *                          the instructions of the previous one to a per core
+ *                          base and each instruction stores its offset in its
+ *                          block, the timestamps are deterministic and only
+ *                          comparable between records of the same core.
+ * QEM_TRACE_TIME_VIRTUAL = Qemu virtual clock in nanoseconds, the guest time.
+ *                          With -icount the clock is read once when a core
+ *                          receives its instructions budget and each record
+ *                          adds the time of the instructions executed since
+ *                          then. As for the guest timers, a translation block
+ *                          accounts for all its instructions when it starts:
+ *                          the timestamps only advance once per translation
+ *                          block and all the records of a block get the time
+ *                          of its end. Use QEM_TRACE_TIME_ICOUNT to order the
+ *                          records inside a block. Without -icount the
+ *                          virtual clock is read for each record.
+ */
+#define QEM_TRACE_TIME_SOURCE QEM_TRACE_TIME_RDTSC
+
+/******************************
+ * Trace sampling 
+ *****************************/
+#define QEM_TRACE_SAMPLE_NONE   0
+#define QEM_TRACE_SAMPLE_ONE_IN 1
+#define QEM_TRACE_SAMPLE_BURST  2
+#define QEM_TRACE_SAMPLE_RANDOM 3
+
+/* Select the sampling mode:
+ * QEM_TRACE_SAMPLE_NONE   = Every event is traced.
+ * QEM_TRACE_SAMPLE_ONE_IN = One record in QEM_TRACE_SAMPLE_RATE is traced on
+ *                           each core.
+ * QEM_TRACE_SAMPLE_BURST  = QEM_TRACE_SAMPLE_WINDOW instructions are traced
+ *                           every QEM_TRACE_SAMPLE_PERIOD instructions on each
+ *                           core.
+ * QEM_TRACE_SAMPLE_RANDOM = Same as burst but the distance between two windows
+ *                           is random, QEM_TRACE_SAMPLE_PERIOD instructions on
+ *                           average.
+ * In the window modes, each window is surrounded by sampling marker records
+ * (see QEM_TRACE_SAMPLE_MARKER_E) when metadata gathering is enabled. Cache
+ * maintenance events are never sampled out.
+ */
+#define QEM_TRACE_SAMPLE_MODE   QEM_TRACE_SAMPLE_NONE
+#define QEM_TRACE_SAMPLE_RATE   100
+#define QEM_TRACE_SAMPLE_WINDOW 10000
+#define QEM_TRACE_SAMPLE_PERIOD 1000000
+#define QEM_TRACE_SAMPLE_SEED   0x2545F491
+
+/******************************
+ * Trace filters 
+ *****************************/
+
+/* Set this value to 1 to only trace the address ranges given in the
+ * QEM_TRACE_RANGES environment variable, read when Qemu starts. The variable
+ * is a comma separated list of ranges formatted as [+|-][v|p]FIRST-LAST:
+ *     + = Include range, - = Exclude range.
+ *     v = Virtual address range, p = Physical address range.
+ *     FIRST and LAST are the first and last addresses of the range, decimal or
+ *     0x prefixed hexadecimal.
+ * e.g. QEM_TRACE_RANGES="+v0x80000000-0x8000FFFF,-p0xB8000-0xBFFFF"
+ * An access is traced if its address is in one of the include ranges of its
+ * type (or there is none) and is in none of the exclude ranges. Physical
+ * ranges are checked against the address output as physical address.
+ * Instructions outside the virtual ranges are not instrumented at translation
+ * time and thus are not counted by the window sampling modes.
+ */
+#define QEM_TRACE_FILTER_ENABLED    0
+#define QEM_TRACE_FILTER_MAX_RANGES 64
+
+/* Set this value to 1 to only trace the address spaces given in the
+ * QEM_TRACE_ASIDS environment variable, read when Qemu starts. The variable
+ * is a comma separated list of address space identifiers, decimal or 0x
+ * prefixed hexadecimal:
+ *     i386 = Page directory base (CR3 & ~0xFFF).
+ *     ARM  = ASID of the PL1 translation regime.
+ *     PPC  = PID register on BookE and 4xx, VSID of segment 0 on 6xx/74xx.
+ * The identifier is checked when a translation block is entered, not on each
+ * access. Cache maintenance events are never filtered.
+ */
+#define QEM_TRACE_ASID_FILTER_ENABLED 0
+#define QEM_TRACE_ASID_MAX            16
+
+/******************************
+ * Trace PC triggers 
+ *****************************/
+
+/* Set this value to 1 to start and stop tracing when the guest reaches the
+ * instructions given in the QEM_TRACE_PC_TRIGGERS environment variable, read
+ * when Qemu starts, instead of using the trace instructions. The variable is
+ * a comma separated list of triggers formatted as
+ * [start|stop][d|i]ADDR[@ASID]:
+ *     start = Tracing starts before the instruction is executed.
+ *     stop  = Tracing stops before the instruction is executed.
+ *     d, i  = Only data or only instruction tracing, both when omitted.
+ *     ADDR  = Virtual address of the instruction.
+ *     ASID  = Only fire in this address space, see
+ *             QEM_TRACE_ASID_FILTER_ENABLED for the identifiers.
+ * e.g. QEM_TRACE_PC_TRIGGERS="start0x80001000@0x3F000,stop0x80001F00@0x3F000"
+ * The triggers are only instrumented in the translation blocks containing
+ * their instruction.
+ */
+#define QEM_TRACE_PC_TRIGGER_ENABLED 0
+#define QEM_TRACE_PC_TRIGGER_MAX     16
+
+/******************************
+ * Trace record/replay
+ *****************************/
+
+/* Set this value to 1 to only trace when Qemu replays an execution. The guest
+ * is first run untraced with -icount shift=N,rr=record,rrfile=FILE, then each
+ * run with rr=replay and the same FILE produces the trace of that execution.
+ * The trace instructions, PC triggers and ring triggers reached while
+ * recording or without record/replay are ignored, they fire at the same
+ * instructions when replaying. The filters, triggers and sampling given in
+ * the environment variables may differ between two replays of the same
+ * recording. Use QEM_TRACE_TIME_ICOUNT or QEM_TRACE_TIME_VIRTUAL to get the
+ * same timestamps in every replay.
+ */
+#define QEM_TRACE_REPLAY_ENABLED 0
+
+/******************************
+ * Trace event classes 
+ *****************************/
+#define QEM_TRACE_CLASS_LOAD   0x01
+#define QEM_TRACE_CLASS_STORE  0x02
+#define QEM_TRACE_CLASS_FETCH  0x04
+#define QEM_TRACE_CLASS_CACHE  0x08
+#define QEM_TRACE_CLASS_KERNEL 0x10
+#define QEM_TRACE_CLASS_USER   0x20
+
+#define QEM_TRACE_CLASS_EVENTS     0x0F
+#define QEM_TRACE_CLASS_PRIVILEGES 0x30
+#define QEM_TRACE_CLASS_ALL        0x3F
+
+/* Select the classes of events to trace. The translators do not instrument
+ * the disabled event classes, and do not instrument translation blocks
+ * running at a disabled privilege level at all.
+ * e.g. (QEM_TRACE_CLASS_STORE | QEM_TRACE_CLASS_USER) only traces the stores
+ * done in user mode.
+ */
+#define QEM_TRACE_CLASS_MASK QEM_TRACE_CLASS_ALL
+
+/******************************
+ * Trace cache filter 
+ *****************************/
+#define QEM_TRACE_CACHE_LRU  0
+#define QEM_TRACE_CACHE_PLRU 1
+
+/* Set this value to 1 to filter the memory events through a L1 instruction
+ * cache and a L1 data cache model per core. Only the misses, the dirty lines
+ * written back (see QEM_TRACE_CACHE_WRITEBACK_E) and the cache maintenance
+ * events are output. The caches are physically indexed, write back and write
+ * allocate, with the LRU or tree pseudo LRU replacement policy. Cache
+ * inhibited accesses and write through stores are always output. The caches
+ * of the different cores are not kept coherent with each other. Requires
+ * metadata gathering.
+ */
+#define QEM_TRACE_CACHE_FILTER_ENABLED 0
+#define QEM_TRACE_CACHE_SETS           64
+#define QEM_TRACE_CACHE_WAYS           8
+#define QEM_TRACE_CACHE_LINE_SIZE      64
+#define QEM_TRACE_CACHE_POLICY         QEM_TRACE_CACHE_LRU
+
+/******************************
+ * Trace fetch coalescing
+ *****************************/
+
+/* Set this value to 1 to merge the consecutive instruction fetches of a core
+ * into range records (see QEM_TRACE_FETCH_RANGE_E). A range holds the fetches
+ * with the same flags at increasing addresses less than
+ * QEM_TRACE_COALESCE_SPAN bytes after its first fetch, it only keeps the
+ * timestamp of the first fetch. The ranges of all the cores are output by
+ * the core stopping tracing while the other cores are stopped. Requires
+ * metadata gathering.
+ */
+#define QEM_TRACE_COALESCE_ENABLED 0
+#define QEM_TRACE_COALESCE_SPAN    64
+
+/******************************
+ * Trace string coalescing
+ *****************************/
+
+/* Set this value to 1 to merge the accesses of the repeated string
+ * instructions (rep movs, stos, lods, cmps, scas, ins and outs) of a core into
+ * block records (see QEM_TRACE_STRING_RANGE_E). A block holds the elements of
+ * one operand on one page, the address is only translated when a block
+ * starts. The instruction fetches of the next iterations are output as a
+ * block of the instruction address linked after the operands blocks, the
+ * decoder (SMILib/include/qem_trace_decoder.h) expands them between the
+ * elements of the iterations. The blocks of all the cores are output by the
+ * core stopping tracing while the other cores are stopped. Only used by the
+ * i386 architecture, requires metadata gathering.
+ */
+#define QEM_TRACE_STRING_ENABLED 0
+
+/******************************
+ * Trace multiple word transfers
+ *****************************/
+
+/* Set this value to 1 to output the words of a load or store multiple
+ * instruction (ARM LDM, STM, PUSH and POP, PPC lmw, stmw, lsw and stsw) on one
+ * page as a block record (see QEM_TRACE_STRING_RANGE_E). The address of a
+ * transfer is translated once per page whatever this value, the words of a
+ * page share its flags and timestamp. Requires metadata gathering.
+ */
+#define QEM_TRACE_MULTI_ENABLED 0
+
+/******************************
+ * Trace aggregation 
+ *****************************/
+#define QEM_TRACE_AGGREGATE_HISTOGRAM 0
+#define QEM_TRACE_AGGREGATE_TOP_K     1
+
+/* Settings of the QEM_TRACE_AGGREGATE trace type. No record is output, each
+ * core counts the reads, writes and instruction fetches of the memory blocks
+ * it accesses and the counters are saved in qem_aggregate_xx.out files (see
+ * qem_trace_aggregate_t).
+ * QEM_TRACE_AGGREGATE_MODE       = QEM_TRACE_AGGREGATE_HISTOGRAM counts every
+ *                                  block, QEM_TRACE_AGGREGATE_TOP_K only
+ *                                  keeps the QEM_TRACE_AGGREGATE_TOP_K_SIZE
+ *                                  most accessed lines and pages of each core
+ *                                  (Space-Saving, counts are overestimated by
+ *                                  at most the error field of the entry).
+ * QEM_TRACE_AGGREGATE_SHIFT      = Histogram block size in bits of address,
+ *                                  12 for 4KB pages, 6 for 64 bytes lines.
+ * QEM_TRACE_AGGREGATE_TABLE_SIZE = Initial number of blocks of the per core
+ *                                  histogram hash tables (power of 2), the
+ *                                  tables double when half full.
+ * QEM_TRACE_AGGREGATE_TOP_K_SIZE = Number of lines and of pages kept per core
+ *                                  in top K mode (power of 2).
+ * QEM_TRACE_AGGREGATE_LINE_SHIFT = Top K line size in bits of address.
+ * QEM_TRACE_AGGREGATE_PAGE_SHIFT = Top K page size in bits of address.
+ * QEM_TRACE_AGGREGATE_PERIOD     = A snapshot of the counters of a core is
+ *                                  saved every QEM_TRACE_AGGREGATE_PERIOD
+ *                                  accesses of the core, 0 to only save them
+ *                                  when tracing stops. Histogram counters
+ *                                  are not reset between snapshots, top K
+ *                                  counters restart at each snapshot.
+ */
+#define QEM_TRACE_AGGREGATE_MODE       QEM_TRACE_AGGREGATE_HISTOGRAM
+#define QEM_TRACE_AGGREGATE_SHIFT      12
+#define QEM_TRACE_AGGREGATE_TABLE_SIZE 4096
+#define QEM_TRACE_AGGREGATE_TOP_K_SIZE 256
+#define QEM_TRACE_AGGREGATE_LINE_SHIFT 6
+#define QEM_TRACE_AGGREGATE_PAGE_SHIFT 12
+#define QEM_TRACE_AGGREGATE_PERIOD     0
+
+/******************************
+ * Trace ring 
+ *****************************/
+
+/* Settings of the QEM_TRACE_RING trace type. Each vCPU keeps its records in
+ * its own ring of QEM_TRACE_RING_SIZE records (power of 2) overwriting the
+ * oldest ones, and nothing is written until a trigger fires.
+ * QEM_TRACE_RING_POST records after the trigger, the rings are taken from the
+ * vCPUs at the end of their current translation block and saved by another
+ * thread in a qem_ring_xx.out file with the trace file format, one vCPU after
+ * the other and oldest record first. The vCPUs go on with empty rings and the
+ * triggers fired before the file is written are ignored.
+ * The triggers are given in the QEM_TRACE_TRIGGERS environment variable, read
+ * when Qemu starts, as a comma separated list of:
+ *     pcADDR    = The instruction at virtual address ADDR is executed.
+ *     vectorNUM = The target exception NUM is raised (e.g. 14 for a page
+ *                 fault on i386, see the EXCP_* and POWERPC_EXCP_* values
+ *                 for ARM and PPC).
+ * e.g. QEM_TRACE_TRIGGERS="pc0xC0001000,vector14"
+ * The QEM_TRACE_RING_TRIGGER_OP instruction (0x0F36 on i386) always fires.
+ */
+#define QEM_TRACE_RING_SIZE         1048576
+#define QEM_TRACE_RING_POST         0
+#define QEM_TRACE_RING_MAX_TRIGGERS 16
+
 /******************************
  * Trace buffers 
  *****************************/
@@ -96,4 +381,82 @@
 #define QEM_SMI_BLOCK_COUNT 8
 #define QEM_SMI_BLOCK_SIZE  10000000
 
+/* Number of SMI readers the server waits for when connecting. Each block is
+ * delivered to every registered reader and is only recycled once all of them
+ * released it (at most 16 readers).
+ */
+#define QEM_SMI_READER_COUNT 1
+
+/* Number of SMI channels. Each channel is an independent buffer with its own
+ * readers, the trace of a core is sent on the channel core % channel count
+ * (at most 16 channels). Set this value to 0 to create one channel per vCPU:
+ * each channel is then only written by the thread running its vCPU, without
+ * any lock. The vCPUs sharing a channel take its lock. The readers connect to
+ * every channel of the session (see qem_smi_channels_connect).
+ */
+#define QEM_SMI_CHANNEL_COUNT 0
+
+/* Set this value to 1 to let the SMI readers get a pollable file descriptor
+ * signaled when blocks are ready (Linux eventfd given through a UNIX socket
+ * when the reader registers). The server takes the descriptors before writing
+ * each block and only keeps the descriptor of a reader slot when it comes from
+ * the process registered in the slot.
+ */
+#define QEM_SMI_EVENT_FD 0
+
+/******************************
+ * SMI slow readers policy 
+ *****************************/
+#define QEM_SMI_SLOW_READER_WAIT   0
+#define QEM_SMI_SLOW_READER_DETACH 1
+
+/* Select the slow readers policy:
+ * QEM_SMI_SLOW_READER_WAIT   = The server waits for all the readers.
+ * QEM_SMI_SLOW_READER_DETACH = A reader that did not release a block after
+ *                              QEM_SMI_READER_TIMEOUT milliseconds is detached.
+ */
+#define QEM_SMI_SLOW_READER_POLICY QEM_SMI_SLOW_READER_WAIT
+#define QEM_SMI_READER_TIMEOUT     1000
+
+/******************************
+ * SMI dispatch 
+ *****************************/
+#define QEM_SMI_DISPATCH_BROADCAST   0
+#define QEM_SMI_DISPATCH_ROUND_ROBIN 1
+#define QEM_SMI_DISPATCH_HASH        2
+
+/* Select how the stream is split between the SMI readers:
+ * QEM_SMI_DISPATCH_BROADCAST   = Every reader receives the whole stream.
+ * QEM_SMI_DISPATCH_ROUND_ROBIN = Each block is delivered to a single reader,
+ *                                in turn. The block sequence number can be
+ *                                used to restore the global order.
+ * QEM_SMI_DISPATCH_HASH        = Each trace entry is delivered to the reader
+ *                                (address >> QEM_SMI_HASH_SHIFT) %
+ *                                QEM_SMI_READER_COUNT, keeping all the accesses
+ *                                to a cache line or page on the same reader.
+ * In the partitioned modes, the blocks of a detached reader are dropped and
+ * the stream start and end sequences are sent to all the readers.
+ */
+#define QEM_SMI_DISPATCH   QEM_SMI_DISPATCH_BROADCAST
+#define QEM_SMI_HASH_SHIFT 6
+
+/******************************
+ * SMI full buffer policy 
+ *****************************/
+#define QEM_SMI_FULL_BLOCK            0
+#define QEM_SMI_FULL_DROP_NEWEST      1
+#define QEM_SMI_FULL_OVERWRITE_OLDEST 2
+
+/* Select what the server does when the next block was not released yet:
+ * QEM_SMI_FULL_BLOCK            = The server waits for the readers (see the
+ *                                 slow readers policy).
+ * QEM_SMI_FULL_DROP_NEWEST      = The new block is dropped.
+ * QEM_SMI_FULL_OVERWRITE_OLDEST = The oldest block is taken back from the
+ *                                 readers and overwritten.
+ * Lost messages are reported to the readers through the gap of the next block
+ * and the drop counter of the shared buffer. The stream start and end
+ * sequences are never dropped.
+ */
+#define QEM_SMI_FULL_POLICY QEM_SMI_FULL_BLOCK
+
 #endif /* __QEM_TRACE_CONFIG_H_ */
\ No newline at end of file
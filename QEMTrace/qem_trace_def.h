@@ -149,6 +149,67 @@ typedef enum
 } QEM_TRACE_EVENT_EXCLUSIVE_E;
 #define QEM_TRACE_EVENT_EXCLUSIVE_MASK 0x00800000
 
+/* Sampling markers, a marker record describes a sampling window instead of a
+ * memory event. The start marker address is the index of the first 
+ * instruction of the window on the core (low bits), the end marker address is
+ * the number of instructions in the window.
+ */
+typedef enum
+{
+    QEM_TRACE_SAMPLE_MARKER_NONE  = 0x00000000,
+    QEM_TRACE_SAMPLE_MARKER_START = 0x01000000,
+    QEM_TRACE_SAMPLE_MARKER_END   = 0x03000000
+} QEM_TRACE_SAMPLE_MARKER_E;
+#define QEM_TRACE_SAMPLE_MARKER_MASK 0x03000000
+
+/* Cache filter writeback, the record describes a dirty line evicted from the
+ * L1 cache model, its address is the line physical address.
+ */
+typedef enum
+{
+    QEM_TRACE_CACHE_WRITEBACK_OFF = 0x00000000,
+    QEM_TRACE_CACHE_WRITEBACK_ON  = 0x04000000
+} QEM_TRACE_CACHE_WRITEBACK_E;
+#define QEM_TRACE_CACHE_WRITEBACK_MASK 0x04000000
+
+/* Instruction fetch range, two consecutive records of a core describing
+ * instruction fetches merged by the fetch coalescing. The start record is the
+ * first fetch of the range. The offsets record has the same flags, its
+ * address is the number of fetches in the range and its timestamp the fetch
+ * offsets bitmap: bit n is set when an instruction was fetched n bytes after
+ * the start address. Each fetch of the range has the start record flags and
+ * timestamp, the fetches are done in increasing address order. Trace
+ * consumers expand the ranges with SMILib/include/qem_trace_decoder.h.
+ */
+typedef enum
+{
+    QEM_TRACE_FETCH_RANGE_NONE    = 0x00000000,
+    QEM_TRACE_FETCH_RANGE_START   = 0x08000000,
+    QEM_TRACE_FETCH_RANGE_OFFSETS = 0x10000000
+} QEM_TRACE_FETCH_RANGE_E;
+#define QEM_TRACE_FETCH_RANGE_MASK 0x18000000
+
+/* String block, two consecutive records of a core describing the elements of
+ * one operand of a repeated string instruction. The start record is the first
+ * element. The count record has the same flags, its address is the number of
+ * elements in the block and its timestamp the signed distance between two
+ * elements. Each element has the start record flags and timestamp. The blocks
+ * of the operands of an instruction are output together, the count record of
+ * each block but the last one is linked to the next block: the elements are
+ * then accessed in turn, first element of each block, second element of each
+ * block... The instruction fetches of the iterations after the first one
+ * are output as the last block, with a null distance. The words of a load or
+ * store multiple instruction on one page are output as one block.
+ */
+typedef enum
+{
+    QEM_TRACE_STRING_RANGE_NONE   = 0x00000000,
+    QEM_TRACE_STRING_RANGE_START  = 0x20000000,
+    QEM_TRACE_STRING_RANGE_COUNT  = 0x40000000,
+    QEM_TRACE_STRING_RANGE_LINKED = 0x60000000
+} QEM_TRACE_STRING_RANGE_E;
+#define QEM_TRACE_STRING_RANGE_MASK 0x60000000
+
 #else 
 typedef enum
 {
@@ -253,6 +314,42 @@ typedef enum
 } QEM_TRACE_EVENT_EXCLUSIVE_E;
 #define QEM_TRACE_EVENT_EXCLUSIVE_MASK 0x00000000
 
+/* Sampling markers */
+typedef enum
+{
+    QEM_TRACE_SAMPLE_MARKER_NONE  = 0x00000000,
+    QEM_TRACE_SAMPLE_MARKER_START = 0x00000000,
+    QEM_TRACE_SAMPLE_MARKER_END   = 0x00000000
+} QEM_TRACE_SAMPLE_MARKER_E;
+#define QEM_TRACE_SAMPLE_MARKER_MASK 0x00000000
+
+/* Cache filter writeback */
+typedef enum
+{
+    QEM_TRACE_CACHE_WRITEBACK_OFF = 0x00000000,
+    QEM_TRACE_CACHE_WRITEBACK_ON  = 0x00000020
+} QEM_TRACE_CACHE_WRITEBACK_E;
+#define QEM_TRACE_CACHE_WRITEBACK_MASK 0x00000020
+
+/* Instruction fetch range */
+typedef enum
+{
+    QEM_TRACE_FETCH_RANGE_NONE    = 0x00000000,
+    QEM_TRACE_FETCH_RANGE_START   = 0x00000000,
+    QEM_TRACE_FETCH_RANGE_OFFSETS = 0x00000000
+} QEM_TRACE_FETCH_RANGE_E;
+#define QEM_TRACE_FETCH_RANGE_MASK 0x00000000
+
+/* String block */
+typedef enum
+{
+    QEM_TRACE_STRING_RANGE_NONE   = 0x00000000,
+    QEM_TRACE_STRING_RANGE_START  = 0x00000000,
+    QEM_TRACE_STRING_RANGE_COUNT  = 0x00000000,
+    QEM_TRACE_STRING_RANGE_LINKED = 0x00000000
+} QEM_TRACE_STRING_RANGE_E;
+#define QEM_TRACE_STRING_RANGE_MASK 0x00000000
+
 #endif /* QEM_TRACE_GATHER_META */
 
 #endif /* QEM_TRACE_ENABLED */
@@ -33,13 +33,41 @@
 #include <stdint.h>        /* Generic types */   
 #include "cpu.h"           /* Qemu CPU types */
 #include "qem_trace_def.h" /* QEM Trace definition */
+#include "qem_trace_time.h" /* QEM Trace timestamps */
+#include "qem_trace_sample.h" /* QEM Trace sampling */
+#include "qem_trace_filter.h" /* QEM Trace address filters */
+#include "qem_trace_cache.h"  /* QEM Trace cache filter */
+#include "qem_trace_coalesce.h" /* QEM Trace fetch coalescing */
+#include "qem_trace_string.h" /* QEM Trace string coalescing */
+#include "qem_trace_multi.h"  /* QEM Trace multiple word transfers */
+#include "qem_trace_ring.h"   /* QEM Trace ring triggers */
+#include "qem_trace_trigger.h" /* QEM Trace PC triggers */
+#include "qem_trace_replay.h" /* QEM Trace record/replay */
+#include "qem_trace_exclusive.h" /* QEM Trace exclusive sections */
 
 
 /*******************************************************************************
  * CONSTANTS
  ******************************************************************************/
 
-/* None */
+/* Name of the output function implemented by the trace type. With the cache
+ * filter or the fetch coalescing, qem_trace_output is the first of them and
+ * the trace type outputs the records they forward. The cache filter forwards
+ * its records to the fetch coalescing when both are enabled.
+ */
+#if QEM_TRACE_CACHE_FILTER_ENABLED || QEM_TRACE_COALESCE_ENABLED
+#define QEM_TRACE_BACKEND_OUTPUT qem_trace_backend_output
+#else
+#define QEM_TRACE_BACKEND_OUTPUT qem_trace_output
+#endif
+
+#if QEM_TRACE_CACHE_FILTER_ENABLED && QEM_TRACE_COALESCE_ENABLED
+#define QEM_TRACE_COALESCE_OUTPUT qem_trace_coalesce_output
+#define QEM_TRACE_CACHE_NEXT      qem_trace_coalesce_output
+#else
+#define QEM_TRACE_COALESCE_OUTPUT qem_trace_output
+#define QEM_TRACE_CACHE_NEXT      QEM_TRACE_BACKEND_OUTPUT
+#endif
 
 /*******************************************************************************
  * STRUCTURES
@@ -85,6 +113,21 @@ typedef struct qem_trace_header
     uint8_t  reserved[5];
 }__attribute__((packed)) qem_trace_header_t;
 
+/* Aggregate file entry, counters of a memory block accessed by a core */
+typedef struct qem_trace_aggregate
+{
+    uint64_t address;
+    uint64_t reads;
+    uint64_t writes;
+    uint64_t fetches;
+    /* Maximal overestimation of reads + writes + fetches, top K mode only */
+    uint64_t error;
+    uint32_t snapshot;
+    uint16_t core;
+    /* Block size in bits of address */
+    uint16_t shift;
+}__attribute__((packed)) qem_trace_aggregate_t;
+
 /* Keeps track on the tracing state */
 extern volatile uint8_t qem_tracing_state;
 
@@ -136,6 +179,32 @@ void qem_trace_output(uint32_t virt_addr, uint32_t phys_addr,
                       uint32_t core, uint64_t time, uint32_t flags);
 #endif
 
+#if QEM_TRACE_CACHE_FILTER_ENABLED || QEM_TRACE_COALESCE_ENABLED
+/* Output a trace the cache filter or the fetch coalescing forwards, same
+ * parameters as qem_trace_output.
+ */
+#if QEM_TRACE_TARGET_64
+void qem_trace_backend_output(uint64_t virt_addr, uint64_t phys_addr,
+                              uint32_t core, uint64_t time, uint32_t flags);
+#else
+void qem_trace_backend_output(uint32_t virt_addr, uint32_t phys_addr,
+                              uint32_t core, uint64_t time, uint32_t flags);
+#endif
+#endif
+
+#if QEM_TRACE_CACHE_FILTER_ENABLED && QEM_TRACE_COALESCE_ENABLED
+/* Output a trace the cache filter forwards to the fetch coalescing, same
+ * parameters as qem_trace_output.
+ */
+#if QEM_TRACE_TARGET_64
+void qem_trace_coalesce_output(uint64_t virt_addr, uint64_t phys_addr,
+                               uint32_t core, uint64_t time, uint32_t flags);
+#else
+void qem_trace_coalesce_output(uint32_t virt_addr, uint32_t phys_addr,
+                               uint32_t core, uint64_t time, uint32_t flags);
+#endif
+#endif
+
 /*******************************************************************************
  * THE FOLLOWING FUNCTIONS HAVE TO BE IMPLEMENTED FOR EACH ARCHITECTURE
  ******************************************************************************/
@@ -175,6 +244,14 @@ uint32_t qem_trace_get_flags(const CPUArchState* env,
                              const uint32_t data_size,
                              const target_ulong phys_addr);
 
+/* Empties the translation information the architecture keeps for the CPU.
+ * Called by Qemu each time it flushes the CPU TLB, which it does when the
+ * guest modifies the MMU state.
+ *
+ * @param cs The CPU whose TLB is flushed.
+ */
+void qem_trace_tlb_flush(CPUState* cs);
+
 #endif /* QEM_TRACE_ENABLED */
 
 #endif /* __QEM_TRACE_ENGINE_H_ */
@@ -0,0 +1,82 @@
+/*
+ * Guest memory access tracing exclusive sections.
+ *
+ * Provides the sections in which the calling thread is the only one running
+ * guest code, used to read and reset the per core state of the other cores
+ * when tracing stops.
+ *
+ * Header included in
+ *     qem_trace_engine.h
+ *
+ *  Copyright (c) 2019 Alexy Torres Aurora Dugo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __QEM_TRACE_EXCLUSIVE_H_
+#define __QEM_TRACE_EXCLUSIVE_H_
+
+#include "qem_trace_config.h" /* QEM Trace configuration */
+
+#if QEM_TRACE_ENABLED
+
+#include "qom/cpu.h" /* start_exclusive, end_exclusive */
+
+/*******************************************************************************
+ * FUNCTIONS
+ ******************************************************************************/
+
+/* Stops the other vCPUs, they leave their translation block and wait for
+ * qem_trace_exclusive_end. When called from a helper, the calling vCPU leaves
+ * its execution section first so that the other vCPUs do not wait for it.
+ *
+ * @returns The vCPU to give back to qem_trace_exclusive_end, NULL when the
+ * caller was not executing guest code.
+ */
+static inline CPUState* qem_trace_exclusive_start(void)
+{
+    CPUState* cpu;
+
+    cpu = current_cpu;
+    if(cpu != NULL && atomic_read(&cpu->running))
+    {
+        cpu_exec_end(cpu);
+    }
+    else
+    {
+        cpu = NULL;
+    }
+
+    start_exclusive();
+
+    return cpu;
+}
+
+/* Lets the other vCPUs run again.
+ *
+ * @param cpu The vCPU returned by qem_trace_exclusive_start.
+ */
+static inline void qem_trace_exclusive_end(CPUState* cpu)
+{
+    end_exclusive();
+
+    if(cpu != NULL)
+    {
+        cpu_exec_start(cpu);
+    }
+}
+
+#endif /* QEM_TRACE_ENABLED */
+
+#endif /* __QEM_TRACE_EXCLUSIVE_H_ */
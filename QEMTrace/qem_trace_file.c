@@ -166,6 +166,8 @@ void qem_trace_enable(CPUState* cs, const QEM_TRACE_TTYPE_E type)
     {
         /* Open output file */
         qem_init_tracing();
+        qem_trace_sample_reset();
+        qem_trace_cache_reset();
     }
 
     /* Enable tracing state */
@@ -180,6 +182,10 @@ void qem_trace_disable(const QEM_TRACE_TTYPE_E type)
         return;
     }
 
+    /* Output the string accesses and the fetches not yet merged */
+    qem_trace_string_flush();
+    qem_trace_coalesce_flush();
+
     /* Enable tracing state */
     qem_tracing_state &= ~type;
 
@@ -207,11 +213,11 @@ void qem_trace_get_timer(void)
 }
 
 #if QEM_TRACE_TARGET_64
-void qem_trace_output(uint64_t virt_addr, uint64_t phys_addr,
-                      uint32_t core, uint64_t time, uint32_t flags)
+void QEM_TRACE_BACKEND_OUTPUT(uint64_t virt_addr, uint64_t phys_addr,
+                              uint32_t core, uint64_t time, uint32_t flags)
 #else
-void qem_trace_output(uint32_t virt_addr, uint32_t phys_addr,
-                      uint32_t core, uint64_t time, uint32_t flags)
+void QEM_TRACE_BACKEND_OUTPUT(uint32_t virt_addr, uint32_t phys_addr,
+                              uint32_t core, uint64_t time, uint32_t flags)
 #endif
 {
     int error;
@@ -0,0 +1,344 @@
+/*
+ * Guest memory access tracing address filters.
+ *
+ * Provides the address ranges index and the address spaces set loaded when
+ * Qemu starts, and the event classes of the block being translated.
+ *
+ *  Copyright (c) 2019 Alexy Torres Aurora Dugo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "qem_trace_config.h" /* QEM Trace configuration */
+
+#if QEM_TRACE_ENABLED
+
+#if QEM_TRACE_FILTER_ENABLED || QEM_TRACE_ASID_FILTER_ENABLED || \
+    (QEM_TRACE_CLASS_MASK & QEM_TRACE_CLASS_PRIVILEGES) != \
+    QEM_TRACE_CLASS_PRIVILEGES
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "qemu/osdep.h"
+#include "cpu.h"
+
+#include "qem_trace_logger.h" /* QEM logger */
+#include "qem_trace_filter.h" /* Filter header */
+
+/*******************************************************************************
+ * STRUCTURES
+ ******************************************************************************/
+
+#if QEM_TRACE_FILTER_ENABLED
+/* Address range, both bounds are included. */
+typedef struct
+{
+    uint64_t first;
+    uint64_t last;
+} qem_trace_range_t;
+
+/* Sorted set of disjoint address ranges. */
+typedef struct
+{
+    qem_trace_range_t ranges[QEM_TRACE_FILTER_MAX_RANGES];
+    uint32_t          count;
+} qem_trace_range_set_t;
+
+/* Include and exclude ranges of an address type. */
+typedef struct
+{
+    qem_trace_range_set_t include;
+    qem_trace_range_set_t exclude;
+} qem_trace_filter_t;
+#endif
+
+#if QEM_TRACE_ASID_FILTER_ENABLED
+/* Address space state of a core, only accessed by the thread running the
+ * core.
+ */
+typedef struct
+{
+    /* Address space identifier the core was last seen in. */
+    uint64_t asid;
+    /* Set when the state was updated at least once. */
+    uint8_t  valid;
+} qem_trace_asid_state_t;
+#endif
+
+/*******************************************************************************
+ * GLOBAL VARS
+ ******************************************************************************/
+
+#if QEM_TRACE_FILTER_ENABLED
+/* Virtual and physical address filters, only written at startup */
+static qem_trace_filter_t virt_filter;
+static qem_trace_filter_t phys_filter;
+#endif
+
+#if QEM_TRACE_ASID_FILTER_ENABLED
+/* Traced address spaces, only written at startup */
+static uint64_t asids[QEM_TRACE_ASID_MAX];
+static uint32_t asid_count;
+
+/* Address space state of the cores */
+static qem_trace_asid_state_t asid_states[QEM_TRACE_ASID_MAX_CORES];
+
+uint8_t qem_trace_asid_match[QEM_TRACE_ASID_MAX_CORES];
+#endif
+
+#if QEM_TRACE_CLASS_TB_FILTER
+__thread uint8_t qem_trace_tb_classes;
+#endif
+
+/*******************************************************************************
+ * FUNCTIONS
+ ******************************************************************************/
+
+#if QEM_TRACE_FILTER_ENABLED
+/* Returns 1 if the address is in one of the ranges of the set, 0 otherwise. */
+static inline uint8_t range_set_find(const qem_trace_range_set_t* set,
+                                     const uint64_t addr)
+{
+    uint32_t low;
+    uint32_t high;
+    uint32_t mid;
+
+    /* Find the last range starting at or before the address */
+    low  = 0;
+    high = set->count;
+    while(low < high)
+    {
+        mid = (low + high) / 2;
+        if(set->ranges[mid].first <= addr)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    return (low != 0 && addr <= set->ranges[low - 1].last);
+}
+
+/* Adds a range to the set, keeping the ranges sorted and disjoint. */
+static void range_set_add(qem_trace_range_set_t* set, uint64_t first,
+                          uint64_t last)
+{
+    uint32_t i;
+    uint32_t j;
+
+    /* Absorb the ranges overlapping or adjacent to the new one */
+    i = 0;
+    while(i < set->count)
+    {
+        if((first == 0 || set->ranges[i].last >= first - 1) &&
+           (last == UINT64_MAX || set->ranges[i].first <= last + 1))
+        {
+            first = MIN(first, set->ranges[i].first);
+            last  = MAX(last, set->ranges[i].last);
+            memmove(&set->ranges[i], &set->ranges[i + 1],
+                    (set->count - i - 1) * sizeof(qem_trace_range_t));
+            --set->count;
+        }
+        else
+        {
+            ++i;
+        }
+    }
+
+    if(set->count == QEM_TRACE_FILTER_MAX_RANGES)
+    {
+        QEM_TRACE_ERROR("Too many trace ranges", 1, 1);
+    }
+
+    /* Insert at its sorted position */
+    for(j = set->count; j > 0 && set->ranges[j - 1].first > first; --j)
+    {
+        set->ranges[j] = set->ranges[j - 1];
+    }
+    set->ranges[j].first = first;
+    set->ranges[j].last  = last;
+    ++set->count;
+}
+
+/* Parses one range, returns the position after it or NULL on error. */
+static const char* parse_range(const char* str)
+{
+    qem_trace_filter_t*    filter;
+    qem_trace_range_set_t* set;
+    uint64_t               first;
+    uint64_t               last;
+    char*                  end;
+
+    if(str[0] != '+' && str[0] != '-')
+    {
+        return NULL;
+    }
+    if(str[1] != 'v' && str[1] != 'p')
+    {
+        return NULL;
+    }
+
+    filter = (str[1] == 'v') ? &virt_filter : &phys_filter;
+    set    = (str[0] == '+') ? &filter->include : &filter->exclude;
+
+    first = strtoull(str + 2, &end, 0);
+    if(end == str + 2 || *end != '-')
+    {
+        return NULL;
+    }
+    str  = end + 1;
+    last = strtoull(str, &end, 0);
+    if(end == str || last < first || (*end != ',' && *end != 0))
+    {
+        return NULL;
+    }
+
+    range_set_add(set, first, last);
+
+    return end;
+}
+#endif
+
+#if QEM_TRACE_ASID_FILTER_ENABLED
+/* Parses one address space identifier, returns the position after it or NULL
+ * on error.
+ */
+static const char* parse_asid(const char* str)
+{
+    char* end;
+
+    if(asid_count == QEM_TRACE_ASID_MAX)
+    {
+        QEM_TRACE_ERROR("Too many trace address spaces", 1, 1);
+    }
+
+    asids[asid_count] = strtoull(str, &end, 0);
+    if(end == str || (*end != ',' && *end != 0))
+    {
+        return NULL;
+    }
+    ++asid_count;
+
+    return end;
+}
+#endif
+
+#if QEM_TRACE_FILTER_ENABLED || QEM_TRACE_ASID_FILTER_ENABLED
+/* Loads the filters before any code is translated. */
+static void __attribute__((constructor)) qem_trace_filter_load(void)
+{
+    const char* env_value;
+
+#if QEM_TRACE_FILTER_ENABLED
+    env_value = getenv(QEM_TRACE_FILTER_ENV);
+    while(env_value != NULL && *env_value != 0)
+    {
+        env_value = parse_range(env_value);
+        if(env_value == NULL)
+        {
+            QEM_TRACE_ERROR("Invalid " QEM_TRACE_FILTER_ENV " value", 1, 1);
+        }
+        if(*env_value == ',')
+        {
+            ++env_value;
+        }
+    }
+#endif
+
+#if QEM_TRACE_ASID_FILTER_ENABLED
+    env_value = getenv(QEM_TRACE_ASID_ENV);
+    while(env_value != NULL && *env_value != 0)
+    {
+        env_value = parse_asid(env_value);
+        if(env_value == NULL)
+        {
+            QEM_TRACE_ERROR("Invalid " QEM_TRACE_ASID_ENV " value", 1, 1);
+        }
+        if(*env_value == ',')
+        {
+            ++env_value;
+        }
+    }
+#endif
+}
+#endif
+
+#if QEM_TRACE_FILTER_ENABLED
+/* Returns 1 if the address passes the filter, 0 otherwise. */
+static inline uint8_t filter_check(const qem_trace_filter_t* filter,
+                                   const uint64_t addr)
+{
+    if(filter->include.count != 0 &&
+       range_set_find(&filter->include, addr) == 0)
+    {
+        return 0;
+    }
+    if(filter->exclude.count != 0 &&
+       range_set_find(&filter->exclude, addr) != 0)
+    {
+        return 0;
+    }
+    return 1;
+}
+
+uint8_t qem_trace_filter_virt(const uint64_t addr)
+{
+    return filter_check(&virt_filter, addr);
+}
+
+uint8_t qem_trace_filter_phys(const uint64_t addr)
+{
+    return filter_check(&phys_filter, addr);
+}
+#endif
+
+#if QEM_TRACE_ASID_FILTER_ENABLED
+void qem_trace_filter_asid_enter(const uint32_t core, const uint64_t asid)
+{
+    qem_trace_asid_state_t* state;
+    uint8_t                 match;
+    uint32_t                i;
+
+    if(core >= QEM_TRACE_ASID_MAX_CORES)
+    {
+        return;
+    }
+    state = &asid_states[core];
+
+    /* Only look the set up when the core switched address space */
+    if(state->valid != 0 && state->asid == asid)
+    {
+        return;
+    }
+
+    /* No address space given, trace all of them */
+    match = (asid_count == 0);
+    for(i = 0; i < asid_count && match == 0; ++i)
+    {
+        match = (asids[i] == asid);
+    }
+
+    state->asid  = asid;
+    state->valid = 1;
+    qem_trace_asid_match[core] = match;
+}
+#endif
+
+#endif /* Any filter enabled */
+
+#endif /* QEM_TRACE_ENABLED */
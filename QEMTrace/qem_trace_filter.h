@@ -0,0 +1,160 @@
+/*
+ * Guest memory access tracing address filters.
+ *
+ * Provides the translators and the arch helpers the address range checks,
+ * done before any address translation or record building, the address
+ * space checks, done when a translation block is entered, and the event
+ * classes checks, done when a translation block is translated.
+ *
+ * Header included in
+ *     qem_trace_engine.h
+ *
+ *  Copyright (c) 2019 Alexy Torres Aurora Dugo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __QEM_TRACE_FILTER_H_
+#define __QEM_TRACE_FILTER_H_
+
+#include "qem_trace_config.h" /* QEM Trace configuration */
+
+#if QEM_TRACE_ENABLED
+
+#include <stdint.h> /* Generic types */
+
+/*******************************************************************************
+ * CONSTANTS
+ ******************************************************************************/
+
+/* Environment variable containing the address ranges */
+#define QEM_TRACE_FILTER_ENV "QEM_TRACE_RANGES"
+
+/* Environment variable containing the address space identifiers */
+#define QEM_TRACE_ASID_ENV "QEM_TRACE_ASIDS"
+
+/* Number of cores with their own address space state, the cores above are
+ * traced in all the address spaces.
+ */
+#define QEM_TRACE_ASID_MAX_CORES 64
+
+#if QEM_TRACE_FILTER_ENABLED && QEM_TRACE_FILTER_MAX_RANGES < 1
+#error "QEM_TRACE_FILTER_MAX_RANGES must be greater than 0"
+#endif
+#if QEM_TRACE_ASID_FILTER_ENABLED && QEM_TRACE_ASID_MAX < 1
+#error "QEM_TRACE_ASID_MAX must be greater than 0"
+#endif
+#if (QEM_TRACE_CLASS_MASK & QEM_TRACE_CLASS_EVENTS) == 0 || \
+    (QEM_TRACE_CLASS_MASK & QEM_TRACE_CLASS_PRIVILEGES) == 0
+#error "QEM_TRACE_CLASS_MASK must contain an event class and a privilege level"
+#endif
+#if (QEM_TRACE_SAMPLE_MODE == QEM_TRACE_SAMPLE_BURST || \
+     QEM_TRACE_SAMPLE_MODE == QEM_TRACE_SAMPLE_RANDOM) && \
+    (QEM_TRACE_CLASS_MASK & QEM_TRACE_CLASS_FETCH) == 0
+#error "The window sampling modes count instructions, enable QEM_TRACE_CLASS_FETCH"
+#endif
+
+/* Set when the privilege level is only known when translating */
+#define QEM_TRACE_CLASS_TB_FILTER \
+    ((QEM_TRACE_CLASS_MASK & QEM_TRACE_CLASS_PRIVILEGES) != \
+     QEM_TRACE_CLASS_PRIVILEGES)
+
+/*******************************************************************************
+ * GLOBAL VARS
+ ******************************************************************************/
+
+#if QEM_TRACE_ASID_FILTER_ENABLED
+/* Set when the address space a core runs in is traced */
+extern uint8_t qem_trace_asid_match[QEM_TRACE_ASID_MAX_CORES];
+#endif
+
+#if QEM_TRACE_CLASS_TB_FILTER
+/* Event classes instrumented in the translation block being translated */
+extern __thread uint8_t qem_trace_tb_classes;
+#endif
+
+/*******************************************************************************
+ * FUNCTIONS
+ ******************************************************************************/
+
+#if QEM_TRACE_FILTER_ENABLED
+
+/* Returns 1 if the virtual address passes the virtual ranges, 0 otherwise.
+ *
+ * @param addr The virtual address to check.
+ */
+uint8_t qem_trace_filter_virt(const uint64_t addr);
+
+/* Returns 1 if the physical address passes the physical ranges, 0 otherwise.
+ *
+ * @param addr The physical address to check.
+ */
+uint8_t qem_trace_filter_phys(const uint64_t addr);
+
+#else
+
+#define qem_trace_filter_virt(addr) 1
+#define qem_trace_filter_phys(addr) 1
+
+#endif /* QEM_TRACE_FILTER_ENABLED */
+
+#if QEM_TRACE_ASID_FILTER_ENABLED
+
+/* Updates the address space state of the core, called when the core enters a
+ * translation block.
+ *
+ * @param core The core entering the translation block.
+ * @param asid The address space identifier the core runs in.
+ */
+void qem_trace_filter_asid_enter(const uint32_t core, const uint64_t asid);
+
+/* Returns 1 if the address space the core runs in is traced, 0 otherwise. */
+#define qem_trace_filter_asid(core) \
+    ((core) >= QEM_TRACE_ASID_MAX_CORES || qem_trace_asid_match[(core)])
+
+#else
+
+#define qem_trace_filter_asid_enter(core, asid)
+#define qem_trace_filter_asid(core) 1
+
+#endif /* QEM_TRACE_ASID_FILTER_ENABLED */
+
+#if QEM_TRACE_CLASS_TB_FILTER
+
+/* Selects the event classes instrumented in the translation block being
+ * translated, called before the block instructions are translated.
+ *
+ * @param user Set when the block runs in user mode.
+ */
+#define qem_trace_filter_tb_start(user)                                    \
+    qem_trace_tb_classes =                                                 \
+        (QEM_TRACE_CLASS_MASK & ((user) ? QEM_TRACE_CLASS_USER :           \
+                                          QEM_TRACE_CLASS_KERNEL)) ?       \
+        QEM_TRACE_CLASS_MASK : 0
+
+/* Returns 1 if the event class is instrumented in the translation block being
+ * translated, 0 otherwise.
+ */
+#define qem_trace_filter_class(class) ((qem_trace_tb_classes & (class)) != 0)
+
+#else
+
+#define qem_trace_filter_tb_start(user) (void)(user)
+#define qem_trace_filter_class(class) ((QEM_TRACE_CLASS_MASK & (class)) != 0)
+
+#endif /* QEM_TRACE_CLASS_TB_FILTER */
+
+#endif /* QEM_TRACE_ENABLED */
+
+#endif /* __QEM_TRACE_FILTER_H_ */
@@ -0,0 +1,96 @@
+/*
+ * Guest memory access tracing multiple word transfers.
+ *
+ * Provides the output of the words of the load and store multiple
+ * instructions.
+ *
+ *  Copyright (c) 2019 Alexy Torres Aurora Dugo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "qem_trace_config.h" /* QEM Trace configuration */
+
+#if QEM_TRACE_ENABLED
+
+#include "qemu/osdep.h"
+#include "cpu.h"
+
+#include "qem_trace_engine.h" /* Engine header */
+#include "qem_trace_def.h"    /* Trace format */
+#include "qem_trace_multi.h"  /* Multiple word transfers header */
+
+/*******************************************************************************
+ * FUNCTIONS
+ ******************************************************************************/
+
+/* Outputs words traced with no gap between them. */
+static void multi_output(const uint32_t core, const uint64_t virt_addr,
+                         const uint64_t phys_addr, const uint64_t time,
+                         const uint32_t flags, const uint32_t count,
+                         const uint32_t size)
+{
+    uint32_t i;
+
+#if QEM_TRACE_MULTI_ENABLED
+    if(count > 1)
+    {
+        qem_trace_output(virt_addr, phys_addr, core, time,
+                         flags | QEM_TRACE_STRING_RANGE_START);
+        qem_trace_output(count, count, core, (uint64_t)size,
+                         flags | QEM_TRACE_STRING_RANGE_COUNT);
+        return;
+    }
+#endif
+
+    for(i = 0; i < count; ++i)
+    {
+        qem_trace_output(virt_addr + (uint64_t)i * size,
+                         phys_addr + (uint64_t)i * size, core, time, flags);
+    }
+}
+
+void qem_trace_multi_output(const uint32_t core, const uint64_t virt_addr,
+                            const uint64_t phys_addr, const uint64_t time,
+                            const uint32_t flags, const uint32_t count,
+                            const uint32_t size)
+{
+    uint64_t offset;
+    uint32_t first;
+    uint32_t i;
+
+    first = 0;
+    for(i = 0; i < count; ++i)
+    {
+        offset = (uint64_t)i * size;
+        if(qem_trace_filter_virt(virt_addr + offset) &&
+           qem_trace_sample_record(core) &&
+           qem_trace_filter_phys(phys_addr + offset))
+        {
+            continue;
+        }
+
+        /* The word is not traced, the words before it end their block */
+        offset = (uint64_t)first * size;
+        multi_output(core, virt_addr + offset, phys_addr + offset, time,
+                     flags, i - first, size);
+        first = i + 1;
+    }
+
+    offset = (uint64_t)first * size;
+    multi_output(core, virt_addr + offset, phys_addr + offset, time, flags,
+                 count - first, size);
+}
+
+#endif /* QEM_TRACE_ENABLED */
@@ -0,0 +1,94 @@
+/*
+ * Guest memory access tracing multiple word transfers.
+ *
+ * Provides the output of the words of the load and store multiple
+ * instructions. The architecture helpers translate the address of a transfer
+ * once per page and give the words of each page to the output together.
+ *
+ * Header included in
+ *     qem_trace_engine.h
+ *
+ *  Copyright (c) 2019 Alexy Torres Aurora Dugo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __QEM_TRACE_MULTI_H_
+#define __QEM_TRACE_MULTI_H_
+
+#include "qem_trace_config.h" /* QEM Trace configuration */
+
+#if QEM_TRACE_ENABLED
+
+#include <stdint.h> /* Generic types */
+
+/*******************************************************************************
+ * CONSTANTS
+ ******************************************************************************/
+
+#if QEM_TRACE_MULTI_ENABLED
+#if QEM_TRACE_GATHER_META == 0
+#error "QEM_TRACE_MULTI_ENABLED requires QEM_TRACE_GATHER_META"
+#endif
+#if QEM_TRACE_TYPE == QEM_TRACE_AGGREGATE
+#error "QEM_TRACE_MULTI_ENABLED cannot be used with QEM_TRACE_AGGREGATE"
+#endif
+#if QEM_TRACE_CACHE_FILTER_ENABLED
+#error "QEM_TRACE_MULTI_ENABLED cannot be used with the cache filter"
+#endif
+#endif
+
+/*******************************************************************************
+ * FUNCTIONS
+ ******************************************************************************/
+
+/* Outputs the words of a transfer on one page, the words are size bytes apart
+ * in increasing address order. The address and sampling filters are applied
+ * to each word, the words traced with no gap are output as one block with
+ * QEM_TRACE_MULTI_ENABLED and as one record per word otherwise.
+ *
+ * @param core The core doing the transfer.
+ * @param virt_addr The virtual address of the first word.
+ * @param phys_addr The physical address of the first word.
+ * @param time The timestamp of the words.
+ * @param flags The flags of the words.
+ * @param count The number of words.
+ * @param size The size of a word in bytes.
+ */
+void qem_trace_multi_output(const uint32_t core, const uint64_t virt_addr,
+                            const uint64_t phys_addr, const uint64_t time,
+                            const uint32_t flags, const uint32_t count,
+                            const uint32_t size);
+
+/* Returns the number of words of a transfer starting on the page of the
+ * address, the word crossing the page end belongs to the page.
+ *
+ * @param addr The virtual address of the next word.
+ * @param count The number of words left.
+ * @param size The size of a word in bytes.
+ */
+static inline uint32_t qem_trace_multi_page_count(const uint64_t addr,
+                                                  const uint32_t count,
+                                                  const uint32_t size)
+{
+    uint64_t left;
+
+    left = (TARGET_PAGE_SIZE - (addr & ~TARGET_PAGE_MASK) + size - 1) / size;
+
+    return (left < count) ? (uint32_t)left : count;
+}
+
+#endif /* QEM_TRACE_ENABLED */
+
+#endif /* __QEM_TRACE_MULTI_H_ */
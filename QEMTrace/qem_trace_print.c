@@ -50,12 +50,22 @@ volatile uint64_t qem_time_start = 0;
 
 void qem_trace_enable(CPUState* cs, const QEM_TRACE_TTYPE_E type)
 {
+    if(qem_tracing_state == 0)
+    {
+        qem_trace_sample_reset();
+        qem_trace_cache_reset();
+    }
+
     /* Enable tracing state */
     qem_tracing_state = type;
 }
 
 void qem_trace_disable(const QEM_TRACE_TTYPE_E type)
 {
+    /* Output the string accesses and the fetches not yet merged */
+    qem_trace_string_flush();
+    qem_trace_coalesce_flush();
+
     /* Enable tracing state */
     qem_tracing_state &= ~type;
 }
@@ -77,13 +87,53 @@ void qem_trace_get_timer(void)
 }
 
 #if QEM_TRACE_TARGET_64
-void qem_trace_output(uint64_t virt_addr, uint64_t phys_addr,
-                      uint32_t core, uint64_t time, uint32_t flags)
+void QEM_TRACE_BACKEND_OUTPUT(uint64_t virt_addr, uint64_t phys_addr,
+                              uint32_t core, uint64_t time, uint32_t flags)
 #else
-void qem_trace_output(uint32_t virt_addr, uint32_t phys_addr,
-                      uint32_t core, uint64_t time, uint32_t flags)
+void QEM_TRACE_BACKEND_OUTPUT(uint32_t virt_addr, uint32_t phys_addr,
+                              uint32_t core, uint64_t time, uint32_t flags)
 #endif
 {
+    if((flags & QEM_TRACE_SAMPLE_MARKER_MASK) != 0)
+    {
+        printf("S %s | V 0x%08x | Core %d | Time %" PRIu64 "\n",
+               ((flags & QEM_TRACE_SAMPLE_MARKER_MASK) == 
+                QEM_TRACE_SAMPLE_MARKER_END) ? "END  " : "START",
+               virt_addr, core, time);
+        return;
+    }
+
+    if((flags & QEM_TRACE_FETCH_RANGE_MASK) ==
+       QEM_TRACE_FETCH_RANGE_OFFSETS)
+    {
+        printf("R OFFSETS | Count %u | Core %d | Offsets 0x%016" PRIx64 "\n",
+               (uint32_t)virt_addr, core, time);
+        return;
+    }
+
+    if((flags & QEM_TRACE_STRING_RANGE_MASK) == QEM_TRACE_STRING_RANGE_COUNT ||
+       (flags & QEM_TRACE_STRING_RANGE_MASK) == QEM_TRACE_STRING_RANGE_LINKED)
+    {
+        printf("B COUNT | Count %u | Core %d | Stride %" PRId64 " | Linked %c\n",
+               (uint32_t)virt_addr, core, (int64_t)time,
+               ((flags & QEM_TRACE_STRING_RANGE_MASK) ==
+                QEM_TRACE_STRING_RANGE_LINKED) ? 'Y' : 'N');
+        return;
+    }
+
+    if((flags & QEM_TRACE_CACHE_WRITEBACK_MASK) != 0)
+    {
+        printf("WB ");
+    }
+    if((flags & QEM_TRACE_FETCH_RANGE_MASK) == QEM_TRACE_FETCH_RANGE_START)
+    {
+        printf("R ");
+    }
+    if((flags & QEM_TRACE_STRING_RANGE_MASK) == QEM_TRACE_STRING_RANGE_START)
+    {
+        printf("B ");
+    }
+
     ((flags & QEM_TRACE_EVENT_DCBZ) == QEM_TRACE_EVENT_DCBZ) ? printf("D ") : (
         ((flags & QEM_TRACE_EVENT_PREFETCH) == QEM_TRACE_EVENT_PREFETCH) ? printf("P ") : (
             ((flags & QEM_TRACE_EVENT_UNLOCK) == QEM_TRACE_EVENT_UNLOCK) ? printf("U ") : (
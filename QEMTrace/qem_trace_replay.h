@@ -0,0 +1,62 @@
+/*
+ * Guest memory access tracing record/replay.
+ *
+ * Provides the check keeping tracing off while Qemu records an execution, the
+ * trace being produced when the execution is replayed.
+ *
+ * Header included in
+ *     qem_trace_engine.h
+ *
+ *  Copyright (c) 2019 Alexy Torres Aurora Dugo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __QEM_TRACE_REPLAY_H_
+#define __QEM_TRACE_REPLAY_H_
+
+#include "qem_trace_config.h" /* QEM Trace configuration */
+
+#if QEM_TRACE_ENABLED
+
+#include <stdint.h> /* Generic types */
+
+#if QEM_TRACE_REPLAY_ENABLED
+#include "sysemu/replay.h" /* Qemu record/replay mode */
+#endif
+
+/*******************************************************************************
+ * FUNCTIONS
+ ******************************************************************************/
+
+#if QEM_TRACE_REPLAY_ENABLED
+
+/* Returns 1 if tracing can start, 0 otherwise. Tracing only starts when Qemu
+ * replays an execution, the trace instructions and triggers reached while
+ * recording or without record/replay are ignored.
+ */
+static inline uint8_t qem_trace_replay_traced(void)
+{
+    return replay_mode == REPLAY_MODE_PLAY;
+}
+
+#else
+
+#define qem_trace_replay_traced() 1
+
+#endif /* QEM_TRACE_REPLAY_ENABLED */
+
+#endif /* QEM_TRACE_ENABLED */
+
+#endif /* __QEM_TRACE_REPLAY_H_ */
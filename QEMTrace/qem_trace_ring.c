@@ -0,0 +1,500 @@
+/*
+ * Guest memory access tracing engine.
+ *
+ * Provides tools to keep the last traces in memory and save them when a
+ * trigger fires.
+ *
+ *  Copyright (c) 2019 Alexy Torres Aurora Dugo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "qemu/osdep.h"
+#include "qemu/host-utils.h"
+#include "cpu.h"
+#include "qemu/timer.h"
+#include "sysemu/sysemu.h"
+
+#include "qem_trace_config.h" /* QEM Trace configuration */
+
+#if QEM_TRACE_ENABLED
+
+#if QEM_TRACE_TYPE == QEM_TRACE_RING
+
+#include "qem_trace_engine.h" /* Engine header */
+#include "qem_trace_logger.h" /* QEM logger */
+
+/*******************************************************************************
+ * CONSTANTS
+ ******************************************************************************/
+
+/* Ring states */
+#define RING_ARMED   0
+#define RING_POST    1
+#define RING_SAVING  2
+
+/*******************************************************************************
+ * STRUCTURES
+ ******************************************************************************/
+
+/* Ring of one core, only written by the core's vCPU thread. Aligned on a cache
+ * line so that the cores do not share the line holding their head.
+ */
+typedef struct
+{
+    /* Records, the record n is stored at n % QEM_TRACE_RING_SIZE */
+    qem_trace_t* records;
+
+    /* Number of records stored since tracing started */
+    uint64_t head;
+} __attribute__((aligned(64))) qem_ring_core_t;
+
+/* Rings taken from the cores when the trigger fired, written by the saving
+ * thread.
+ */
+typedef struct
+{
+    qem_ring_core_t* rings;
+    uint32_t         count;
+    uint32_t         file_index;
+} qem_ring_snapshot_t;
+
+/*******************************************************************************
+ * GLOBAL VARS
+ ******************************************************************************/
+/* Keeps track on the tracing state */
+volatile uint8_t qem_tracing_state = 0;
+
+/* Keeps track execution time */
+volatile uint64_t qem_time_start = 0;
+
+/* One ring per possible vCPU, allocated when tracing is first enabled */
+static qem_ring_core_t* qem_ring_cores = NULL;
+static uint32_t         qem_ring_core_count = 0;
+
+/* Ring state and number of records left before saving the ring */
+static uint32_t qem_ring_state = RING_ARMED;
+static uint32_t qem_ring_post = 0;
+
+/* Triggers, only written at startup */
+static uint64_t qem_ring_pcs[QEM_TRACE_RING_MAX_TRIGGERS];
+static uint32_t qem_ring_pc_count = 0;
+static int32_t  qem_ring_vectors[QEM_TRACE_RING_MAX_TRIGGERS];
+static uint32_t qem_ring_vector_count = 0;
+
+/* This is the file index ID. Each time the ring is saved, the index is
+ * incremented and the new file name will be of the form qem_ring_xx.out where
+ * xx is the file_index.
+ */
+static uint32_t qem_file_index = 0;
+
+/*******************************************************************************
+ * FUNCTIONS
+ ******************************************************************************/
+
+/* Parses one trigger, returns the position after it or NULL on error. */
+static const char* parse_trigger(const char* str)
+{
+    char* end;
+
+    if(strncmp(str, "pc", 2) == 0)
+    {
+        if(qem_ring_pc_count == QEM_TRACE_RING_MAX_TRIGGERS)
+        {
+            QEM_TRACE_ERROR("Too many PC triggers", 1, 1);
+        }
+        str += 2;
+        qem_ring_pcs[qem_ring_pc_count++] = strtoull(str, &end, 0);
+    }
+    else if(strncmp(str, "vector", 6) == 0)
+    {
+        if(qem_ring_vector_count == QEM_TRACE_RING_MAX_TRIGGERS)
+        {
+            QEM_TRACE_ERROR("Too many exception triggers", 1, 1);
+        }
+        str += 6;
+        qem_ring_vectors[qem_ring_vector_count++] = strtol(str, &end, 0);
+    }
+    else
+    {
+        return NULL;
+    }
+
+    if(end == str || (*end != ',' && *end != 0))
+    {
+        return NULL;
+    }
+
+    return end;
+}
+
+/* Loads the triggers before any code is translated. */
+static void __attribute__((constructor)) qem_trace_ring_load(void)
+{
+    const char* env_value;
+
+    env_value = getenv(QEM_TRACE_RING_ENV);
+    while(env_value != NULL && *env_value != 0)
+    {
+        env_value = parse_trigger(env_value);
+        if(env_value == NULL)
+        {
+            QEM_TRACE_ERROR("Invalid " QEM_TRACE_RING_ENV " value", 1, 1);
+        }
+        if(*env_value == ',')
+        {
+            ++env_value;
+        }
+    }
+}
+
+/* Writes the rings of the snapshot to a new trace file, one core after the
+ * other and oldest record first, then arms the trigger again.
+ */
+static void* qem_ring_save(void* args)
+{
+    qem_ring_snapshot_t* snapshot;
+    qem_ring_core_t*     ring;
+    qem_trace_header_t   header;
+    FILE*                file_fd;
+    uint64_t             count;
+    uint64_t             first;
+    uint64_t             total;
+    size_t               written;
+    uint32_t             i;
+    int                  error;
+    char                 filename[22];
+
+    snapshot = (qem_ring_snapshot_t*)args;
+
+    sprintf(filename, "qem_ring_%08d.out", snapshot->file_index);
+    filename[21] = 0;
+    remove(filename);
+
+    file_fd = fopen(filename, "wb");
+    if(file_fd == NULL)
+    {
+        QEM_TRACE_ERROR("Could not create or open the ring file", errno, 1);
+    }
+
+    total = 0;
+    for(i = 0; i < snapshot->count; ++i)
+    {
+        total += MIN(snapshot->rings[i].head, QEM_TRACE_RING_SIZE);
+    }
+
+    memset(&header, 0, sizeof(header));
+    header.size        = (total + 1) * sizeof(qem_trace_t);
+    header.struct_size = sizeof(qem_trace_t);
+    header.version     = 1;
+
+    error = fwrite(&header, sizeof(qem_trace_header_t), 1, file_fd);
+    if(error != 1)
+    {
+        QEM_TRACE_ERROR("Could not write the header", error, 1);
+    }
+
+    for(i = 0; i < snapshot->count; ++i)
+    {
+        ring  = &snapshot->rings[i];
+        count = MIN(ring->head, QEM_TRACE_RING_SIZE);
+        if(count == 0)
+        {
+            continue;
+        }
+
+        /* Oldest record still in the ring first */
+        first = (ring->head - count) & (QEM_TRACE_RING_SIZE - 1);
+        if(first + count > QEM_TRACE_RING_SIZE)
+        {
+            written = fwrite(&ring->records[first], sizeof(qem_trace_t),
+                             QEM_TRACE_RING_SIZE - first, file_fd);
+            if(written != QEM_TRACE_RING_SIZE - first)
+            {
+                QEM_TRACE_ERROR("Could not write the ring", (int)written, 1);
+            }
+            count -= QEM_TRACE_RING_SIZE - first;
+            first  = 0;
+        }
+        written = fwrite(&ring->records[first], sizeof(qem_trace_t), count,
+                         file_fd);
+        if(written != count)
+        {
+            QEM_TRACE_ERROR("Could not write the ring", (int)written, 1);
+        }
+    }
+
+    if(fclose(file_fd) < 0)
+    {
+        QEM_TRACE_ERROR("Error while closing the ring file", errno, 0);
+    }
+    else
+    {
+        QEM_TRACE_INFO("==== Ring file name", 0);
+        QEM_TRACE_INFO(filename, 0);
+    }
+
+    for(i = 0; i < snapshot->count; ++i)
+    {
+        free(snapshot->rings[i].records);
+    }
+    free(snapshot->rings);
+    free(snapshot);
+
+    /* Wait for the next trigger */
+    __atomic_store_n(&qem_ring_state, RING_ARMED, __ATOMIC_RELEASE);
+
+    return NULL;
+}
+
+/* Takes the rings from the cores and hands them to the saving thread. Runs
+ * while the other cores are stopped, the cores start again with empty rings.
+ */
+static void qem_ring_snapshot(CPUState* cpu, run_on_cpu_data data)
+{
+    qem_ring_snapshot_t* snapshot;
+    pthread_t            thread;
+    int                  error;
+
+    (void)cpu;
+    (void)data;
+
+    snapshot = malloc(sizeof(qem_ring_snapshot_t));
+    if(snapshot == NULL)
+    {
+        QEM_TRACE_ERROR("Could not allocate the ring snapshot", errno, 1);
+    }
+    snapshot->rings = qem_ring_cores;
+    snapshot->count = qem_ring_core_count;
+    snapshot->file_index = qem_file_index++;
+
+    qem_ring_cores = calloc(qem_ring_core_count, sizeof(qem_ring_core_t));
+    if(qem_ring_cores == NULL)
+    {
+        QEM_TRACE_ERROR("Could not allocate the rings", errno, 1);
+    }
+
+    error = pthread_create(&thread, NULL, qem_ring_save, snapshot);
+    if(error != 0)
+    {
+        QEM_TRACE_ERROR("Could not create the ring saving thread", error, 1);
+    }
+    error = pthread_detach(thread);
+    if(error != 0)
+    {
+        QEM_TRACE_ERROR("Could not detach the ring saving thread", error, 1);
+    }
+}
+
+/* Saves the rings once the current translation blocks are done. */
+static void qem_ring_schedule_save(void)
+{
+    CPUState* cpu;
+
+    cpu = current_cpu;
+    if(cpu == NULL)
+    {
+        cpu = first_cpu;
+    }
+    async_safe_run_on_cpu(cpu, qem_ring_snapshot, RUN_ON_CPU_NULL);
+}
+
+void qem_trace_ring_trigger(const uint32_t core, const uint64_t addr)
+{
+    uint32_t expected;
+
+    (void)core;
+    (void)addr;
+
+    /* The ring only holds the records of the current tracing */
+    if(qem_tracing_state == 0 || qem_trace_replay_traced() == 0)
+    {
+        return;
+    }
+
+    /* The saving state keeps the other triggers out until the post count is
+     * set
+     */
+    expected = RING_ARMED;
+    if(__atomic_compare_exchange_n(&qem_ring_state, &expected, RING_SAVING,
+                                   0, __ATOMIC_ACQ_REL,
+                                   __ATOMIC_RELAXED) == 0)
+    {
+        /* Already triggered */
+        return;
+    }
+
+    QEM_TRACE_INFO("Ring trigger fired", 0);
+
+    if(QEM_TRACE_RING_POST == 0)
+    {
+        qem_ring_schedule_save();
+    }
+    else
+    {
+        __atomic_store_n(&qem_ring_post, QEM_TRACE_RING_POST,
+                         __ATOMIC_RELAXED);
+        __atomic_store_n(&qem_ring_state, RING_POST, __ATOMIC_RELEASE);
+    }
+}
+
+uint8_t qem_trace_ring_pc_match(const uint64_t addr)
+{
+    uint32_t i;
+
+    for(i = 0; i < qem_ring_pc_count; ++i)
+    {
+        if(qem_ring_pcs[i] == addr)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void qem_trace_ring_exception(const uint32_t core, const int32_t vector)
+{
+    uint32_t i;
+
+    for(i = 0; i < qem_ring_vector_count; ++i)
+    {
+        if(qem_ring_vectors[i] == vector)
+        {
+            qem_trace_ring_trigger(core, 0);
+            return;
+        }
+    }
+}
+
+void qem_trace_enable(CPUState* cs, const QEM_TRACE_TTYPE_E type)
+{
+    uint32_t i;
+
+    if(qem_tracing_state == type)
+    {
+        return;
+    }
+
+    if(qem_tracing_state == 0)
+    {
+        /* Start from empty rings */
+        if(qem_ring_cores == NULL)
+        {
+            qem_ring_core_count = max_cpus;
+            qem_ring_cores = calloc(qem_ring_core_count,
+                                    sizeof(qem_ring_core_t));
+            if(qem_ring_cores == NULL)
+            {
+                QEM_TRACE_ERROR("Could not allocate the rings", errno, 1);
+            }
+        }
+        for(i = 0; i < qem_ring_core_count; ++i)
+        {
+            qem_ring_cores[i].head = 0;
+        }
+        qem_trace_sample_reset();
+        qem_trace_cache_reset();
+    }
+
+    /* Enable tracing state */
+    qem_tracing_state = type;
+}
+
+void qem_trace_disable(const QEM_TRACE_TTYPE_E type)
+{
+    if(qem_tracing_state == 0)
+    {
+        return;
+    }
+
+    /* Output the string accesses and the fetches not yet merged */
+    qem_trace_string_flush();
+    qem_trace_coalesce_flush();
+
+    /* Enable tracing state, the ring is kept for the next trigger */
+    qem_tracing_state &= ~type;
+}
+
+void qem_trace_start_timer(void)
+{
+    /* Save the current time */
+    qem_time_start = qemu_clock_get_ns(QEMU_CLOCK_REALTIME);
+}
+
+void qem_trace_get_timer(void)
+{
+    /* Get the current time and compares it to the previously defined start
+     * time.
+     */
+    uint64_t time_end;
+    time_end = qemu_clock_get_ns(QEMU_CLOCK_REALTIME);
+    printf("[QEMU] Elapsed time = %" PRIu64 "\n", (time_end - qem_time_start));
+}
+
+#if QEM_TRACE_TARGET_64
+void QEM_TRACE_BACKEND_OUTPUT(uint64_t virt_addr, uint64_t phys_addr,
+                              uint32_t core, uint64_t time, uint32_t flags)
+#else
+void QEM_TRACE_BACKEND_OUTPUT(uint32_t virt_addr, uint32_t phys_addr,
+                              uint32_t core, uint64_t time, uint32_t flags)
+#endif
+{
+    qem_ring_core_t* ring;
+    qem_trace_t*     trace;
+
+    (void)virt_addr;
+
+    if(core >= qem_ring_core_count)
+    {
+        return;
+    }
+
+    /* Only this vCPU writes its ring, the rings are taken while it is stopped */
+    ring = &qem_ring_cores[core];
+    if(ring->records == NULL)
+    {
+        ring->records = malloc(QEM_TRACE_RING_SIZE * sizeof(qem_trace_t));
+        if(ring->records == NULL)
+        {
+            QEM_TRACE_ERROR("Could not allocate the ring", errno, 1);
+        }
+    }
+
+    trace = &ring->records[ring->head & (QEM_TRACE_RING_SIZE - 1)];
+#if QEM_TRACE_GATHER_META
+    trace->address   = phys_addr;
+    trace->timestamp = time;
+    trace->flags     = (core & 0xFF) | (flags & 0xFFFFFF00);
+#else
+    (void)time;
+    trace->address = phys_addr;
+    trace->flags   = (uint8_t)flags;
+#endif
+    ++ring->head;
+
+    /* Save the rings once the records following the trigger are stored */
+    if(__atomic_load_n(&qem_ring_state, __ATOMIC_ACQUIRE) == RING_POST &&
+       __atomic_sub_fetch(&qem_ring_post, 1, __ATOMIC_ACQ_REL) == 0)
+    {
+        __atomic_store_n(&qem_ring_state, RING_SAVING, __ATOMIC_RELEASE);
+        qem_ring_schedule_save();
+    }
+}
+
+#endif /* QEM_TRACE_TYPE == QEM_TRACE_RING */
+
+#endif /* QEM_TRACE_ENABLED */
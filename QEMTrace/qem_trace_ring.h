@@ -0,0 +1,90 @@
+/*
+ * Guest memory access tracing ring triggers.
+ *
+ * Provides the translators and Qemu the triggers saving the records of the
+ * QEM_TRACE_RING trace type. PC triggers are checked when an instruction is
+ * translated, exception triggers when an exception is raised.
+ *
+ * Header included in
+ *     qem_trace_engine.h
+ *
+ *  Copyright (c) 2019 Alexy Torres Aurora Dugo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __QEM_TRACE_RING_H_
+#define __QEM_TRACE_RING_H_
+
+#include "qem_trace_config.h" /* QEM Trace configuration */
+
+#if QEM_TRACE_ENABLED
+
+#include <stdint.h> /* Generic types */
+
+/*******************************************************************************
+ * CONSTANTS
+ ******************************************************************************/
+
+/* Environment variable containing the triggers */
+#define QEM_TRACE_RING_ENV "QEM_TRACE_TRIGGERS"
+
+#if QEM_TRACE_TYPE == QEM_TRACE_RING
+#if QEM_TRACE_RING_SIZE < 1 || \
+    (QEM_TRACE_RING_SIZE & (QEM_TRACE_RING_SIZE - 1)) != 0
+#error "QEM_TRACE_RING_SIZE must be a power of 2"
+#endif
+#if QEM_TRACE_RING_POST < 0 || QEM_TRACE_RING_POST >= QEM_TRACE_RING_SIZE
+#error "QEM_TRACE_RING_POST must be lower than QEM_TRACE_RING_SIZE"
+#endif
+#endif
+
+/*******************************************************************************
+ * FUNCTIONS
+ ******************************************************************************/
+
+#if QEM_TRACE_TYPE == QEM_TRACE_RING
+
+/* Fires the ring trigger, the ring is saved after QEM_TRACE_RING_POST more
+ * records. Triggers fired before the ring is saved are ignored.
+ *
+ * @param core The core firing the trigger.
+ * @param addr The virtual address of the instruction firing the trigger.
+ */
+void qem_trace_ring_trigger(const uint32_t core, const uint64_t addr);
+
+/* Returns 1 if a PC trigger is set on the instruction, 0 otherwise.
+ *
+ * @param addr The virtual address of the instruction being translated.
+ */
+uint8_t qem_trace_ring_pc_match(const uint64_t addr);
+
+/* Fires the ring trigger if an exception trigger is set on the exception.
+ *
+ * @param core The core raising the exception.
+ * @param vector The target exception number.
+ */
+void qem_trace_ring_exception(const uint32_t core, const int32_t vector);
+
+#else
+
+#define qem_trace_ring_trigger(core, addr)
+#define qem_trace_ring_pc_match(addr) 0
+#define qem_trace_ring_exception(core, vector)
+
+#endif /* QEM_TRACE_TYPE == QEM_TRACE_RING */
+
+#endif /* QEM_TRACE_ENABLED */
+
+#endif /* __QEM_TRACE_RING_H_ */
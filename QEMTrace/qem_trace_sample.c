@@ -0,0 +1,188 @@
+/*
+ * Guest memory access tracing sampling.
+ *
+ * Provides the per core sampling state used to reduce the trace volume.
+ *
+ *  Copyright (c) 2019 Alexy Torres Aurora Dugo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "qem_trace_config.h" /* QEM Trace configuration */
+
+#if QEM_TRACE_ENABLED
+
+#if QEM_TRACE_SAMPLE_MODE != QEM_TRACE_SAMPLE_NONE
+
+#include <string.h>
+
+#include "qemu/osdep.h"
+#include "cpu.h"
+
+#include "qem_trace_engine.h" /* Engine header */
+#include "qem_trace_def.h"    /* Trace format */
+#include "qem_trace_sample.h" /* Sampling header */
+
+/*******************************************************************************
+ * STRUCTURES
+ ******************************************************************************/
+
+/* Sampling state of a core, only accessed by the thread running the core. */
+typedef struct
+{
+    /* Number of instructions executed since tracing started. */
+    uint64_t position;
+    /* Position at which the current window opens or closes. */
+    uint64_t next;
+    /* Number of records since the last traced one. */
+    uint32_t count;
+    /* Random generator state. */
+    uint32_t random;
+    /* Set when the core is inside a sampling window. */
+    uint8_t  in_window;
+} qem_trace_sample_state_t;
+
+/*******************************************************************************
+ * GLOBAL VARS
+ ******************************************************************************/
+
+/* Sampling state of the cores */
+static qem_trace_sample_state_t sample_states[QEM_TRACE_SAMPLE_MAX_CORES];
+
+/*******************************************************************************
+ * FUNCTIONS
+ ******************************************************************************/
+
+#if QEM_TRACE_SAMPLE_MODE == QEM_TRACE_SAMPLE_BURST || \
+    QEM_TRACE_SAMPLE_MODE == QEM_TRACE_SAMPLE_RANDOM
+
+/* Returns the number of instructions to skip before the next window. */
+static uint64_t get_gap(qem_trace_sample_state_t* state)
+{
+#if QEM_TRACE_SAMPLE_MODE == QEM_TRACE_SAMPLE_RANDOM
+    /* Xorshift, uniform gap keeping the average period */
+    state->random ^= state->random << 13;
+    state->random ^= state->random >> 17;
+    state->random ^= state->random << 5;
+    return 1 + state->random %
+           (2 * (QEM_TRACE_SAMPLE_PERIOD - QEM_TRACE_SAMPLE_WINDOW) - 1);
+#else
+    (void)state;
+    return QEM_TRACE_SAMPLE_PERIOD - QEM_TRACE_SAMPLE_WINDOW;
+#endif
+}
+
+#if QEM_TRACE_GATHER_META
+/* Outputs a window marker of the core. */
+static void output_marker(const uint32_t core, const uint64_t value,
+                          const uint32_t marker)
+{
+    /* Get time, same clock as the helpers running on the core thread */
+    qem_trace_output(value, value, core, qem_trace_get_time(current_cpu),
+                     marker);
+}
+#endif
+
+void qem_trace_sample_tick(const uint32_t core)
+{
+    qem_trace_sample_state_t* state;
+
+    if(core >= QEM_TRACE_SAMPLE_MAX_CORES)
+    {
+        return;
+    }
+    state = &sample_states[core];
+
+    if(state->position == state->next)
+    {
+        if(state->in_window == 0)
+        {
+#if QEM_TRACE_GATHER_META
+            output_marker(core, state->position,
+                          QEM_TRACE_SAMPLE_MARKER_START);
+#endif
+            state->in_window = 1;
+            state->next      = state->position + QEM_TRACE_SAMPLE_WINDOW;
+        }
+        else
+        {
+#if QEM_TRACE_GATHER_META
+            output_marker(core, QEM_TRACE_SAMPLE_WINDOW,
+                          QEM_TRACE_SAMPLE_MARKER_END);
+#endif
+            state->in_window = 0;
+            state->next      = state->position + get_gap(state);
+        }
+    }
+
+    ++state->position;
+}
+
+uint8_t qem_trace_sample_record(const uint32_t core)
+{
+    if(core >= QEM_TRACE_SAMPLE_MAX_CORES)
+    {
+        return 1;
+    }
+    return sample_states[core].in_window;
+}
+
+#else
+
+void qem_trace_sample_tick(const uint32_t core)
+{
+    (void)core;
+}
+
+uint8_t qem_trace_sample_record(const uint32_t core)
+{
+    qem_trace_sample_state_t* state;
+
+    if(core >= QEM_TRACE_SAMPLE_MAX_CORES)
+    {
+        return 1;
+    }
+    state = &sample_states[core];
+
+    if(++state->count < QEM_TRACE_SAMPLE_RATE)
+    {
+        return 0;
+    }
+
+    state->count = 0;
+    return 1;
+}
+
+#endif
+
+void qem_trace_sample_reset(void)
+{
+    uint32_t i;
+
+    memset(sample_states, 0, sizeof(sample_states));
+
+    /* Each core draws its own sequence of windows */
+    for(i = 0; i < QEM_TRACE_SAMPLE_MAX_CORES; ++i)
+    {
+        sample_states[i].random = QEM_TRACE_SAMPLE_SEED ^ ((i + 1) * 0x9E3779B9);
+        if(sample_states[i].random == 0)
+        {
+            sample_states[i].random = QEM_TRACE_SAMPLE_SEED;
+        }
+    }
+}
+
+#endif /* QEM_TRACE_SAMPLE_MODE != QEM_TRACE_SAMPLE_NONE */
+
+#endif /* QEM_TRACE_ENABLED */
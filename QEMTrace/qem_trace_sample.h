@@ -0,0 +1,88 @@
+/*
+ * Guest memory access tracing sampling.
+ *
+ * Provides the arch helpers the sampling decision, taken before any address
+ * translation is done.
+ *
+ * Header included in
+ *     qem_trace_engine.h
+ *
+ *  Copyright (c) 2019 Alexy Torres Aurora Dugo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __QEM_TRACE_SAMPLE_H_
+#define __QEM_TRACE_SAMPLE_H_
+
+#include "qem_trace_config.h" /* QEM Trace configuration */
+
+#if QEM_TRACE_ENABLED
+
+#include <stdint.h> /* Generic types */
+
+/*******************************************************************************
+ * CONSTANTS
+ ******************************************************************************/
+
+/* Number of cores with their own sampling state, all the accesses of the cores
+ * above are recorded.
+ */
+#define QEM_TRACE_SAMPLE_MAX_CORES 64
+
+#if QEM_TRACE_SAMPLE_MODE == QEM_TRACE_SAMPLE_ONE_IN && \
+    QEM_TRACE_SAMPLE_RATE < 1
+#error "QEM_TRACE_SAMPLE_RATE must be greater than 0"
+#endif
+#if (QEM_TRACE_SAMPLE_MODE == QEM_TRACE_SAMPLE_BURST || \
+     QEM_TRACE_SAMPLE_MODE == QEM_TRACE_SAMPLE_RANDOM) && \
+    (QEM_TRACE_SAMPLE_WINDOW < 1 || \
+     QEM_TRACE_SAMPLE_PERIOD <= QEM_TRACE_SAMPLE_WINDOW)
+#error "QEM_TRACE_SAMPLE_PERIOD must be greater than QEM_TRACE_SAMPLE_WINDOW"
+#endif
+
+/*******************************************************************************
+ * FUNCTIONS
+ ******************************************************************************/
+
+#if QEM_TRACE_SAMPLE_MODE != QEM_TRACE_SAMPLE_NONE
+
+/* Resets the sampling state of all the cores, called when tracing starts. */
+void qem_trace_sample_reset(void);
+
+/* Tells the sampler the core starts executing a new instruction. In the window
+ * modes, the window markers are output when a window opens or closes.
+ *
+ * @param core The core executing the instruction.
+ */
+void qem_trace_sample_tick(const uint32_t core);
+
+/* Returns 1 if the next record of the core must be traced, 0 otherwise. Must
+ * be called before the record is built.
+ *
+ * @param core The core the record belongs to.
+ */
+uint8_t qem_trace_sample_record(const uint32_t core);
+
+#else
+
+#define qem_trace_sample_reset()
+#define qem_trace_sample_tick(core)
+#define qem_trace_sample_record(core) 1
+
+#endif /* QEM_TRACE_SAMPLE_MODE != QEM_TRACE_SAMPLE_NONE */
+
+#endif /* QEM_TRACE_ENABLED */
+
+#endif /* __QEM_TRACE_SAMPLE_H_ */
@@ -31,6 +31,7 @@
 #include "qemu/host-utils.h"
 #include "cpu.h"
 #include "qemu/timer.h"
+#include "sysemu/sysemu.h" /* smp_cpus */
 
 #include "qem_trace_smi_engine.h" /* SMI engine */
 #include "qem_trace_engine.h"     /* Engine header */
@@ -58,7 +59,8 @@ static void qem_init_tracing(void)
     int32_t error = 0;
     if(connected == 0)
     {
-        qem_smi_client_init();
+        /* One channel per vCPU unless the channel count is set */
+        qem_smi_client_init(smp_cpus);
         error = qem_smi_client_connect(1, 1000);
         /* Connect the SMI */
         if(error != 0)
@@ -74,7 +76,7 @@ static void qem_init_tracing(void)
     uint32_t buffer;
 
     buffer = QEM_SMI_STREAM_VERSION;
-    error = qem_smi_client_send(&buffer, sizeof(uint32_t));
+    error = qem_smi_client_send_all(&buffer, sizeof(uint32_t));
     if(error != 0)
     {
         QEM_TRACE_ERROR("Error while connecting SMI (step 2)", 
@@ -82,7 +84,7 @@ static void qem_init_tracing(void)
     }
 
     buffer = sizeof(qem_trace_t);
-    error = qem_smi_client_send(&buffer, sizeof(uint32_t));
+    error = qem_smi_client_send_all(&buffer, sizeof(uint32_t));
     if(error != 0)
     {
         QEM_TRACE_ERROR("Error while connecting SMI (step 3)", 
@@ -97,7 +99,7 @@ static void qem_close_tracing(void)
     /* Send end stream sequence */
     int32_t error;
     uint8_t buffer[sizeof(qem_trace_t)] = {0};
-    error = qem_smi_client_send(buffer, sizeof(qem_trace_t));
+    error = qem_smi_client_send_all(buffer, sizeof(qem_trace_t));
     
     if(error != 0)
     {
@@ -121,6 +123,8 @@ void qem_trace_enable(CPUState* cs, const QEM_TRACE_TTYPE_E type)
     {
         /* Open output file */
         qem_init_tracing();
+        qem_trace_sample_reset();
+        qem_trace_cache_reset();
     }
 
     /* Enable tracing state */
@@ -130,11 +134,22 @@ void qem_trace_enable(CPUState* cs, const QEM_TRACE_TTYPE_E type)
 
 void qem_trace_disable(const QEM_TRACE_TTYPE_E type)
 {
+    CPUState* cpu;
+
     if(qem_tracing_state == 0)
     {
         return;
     }
 
+    /* Output the string accesses and the fetches not yet merged */
+    qem_trace_string_flush();
+    qem_trace_coalesce_flush();
+
+    /* The channels are written by their cores without lock, the end of the
+     * stream is sent while the cores are stopped.
+     */
+    cpu = qem_trace_exclusive_start();
+
     /* Enable tracing state */
     qem_tracing_state &= ~type;
 
@@ -143,6 +158,8 @@ void qem_trace_disable(const QEM_TRACE_TTYPE_E type)
         /* Close output file or stream */
         qem_close_tracing();
     }
+
+    qem_trace_exclusive_end(cpu);
 }
 
 void qem_trace_start_timer(void)
@@ -162,11 +179,11 @@ void qem_trace_get_timer(void)
 }
 
 #if QEM_TRACE_TARGET_64
-void qem_trace_output(uint64_t virt_addr, uint64_t phys_addr,
-                      uint32_t core, uint64_t time, uint32_t flags)
+void QEM_TRACE_BACKEND_OUTPUT(uint64_t virt_addr, uint64_t phys_addr,
+                              uint32_t core, uint64_t time, uint32_t flags)
 #else
-void qem_trace_output(uint32_t virt_addr, uint32_t phys_addr,
-                      uint32_t core, uint64_t time, uint32_t flags)
+void QEM_TRACE_BACKEND_OUTPUT(uint32_t virt_addr, uint32_t phys_addr,
+                              uint32_t core, uint64_t time, uint32_t flags)
 #endif
 {
     int32_t error;
@@ -185,8 +202,11 @@ void qem_trace_output(uint32_t virt_addr, uint32_t phys_addr,
      };
 #endif
 
-    /* Send the structure */
-    error = qem_smi_client_send(&new_trace, sizeof(qem_trace_t));
+    /* Send the structure on the core channel, the address selects the reader
+     * in hash dispatch
+     */
+    error = qem_smi_client_send_core(core, phys_addr, &new_trace, 
+                                     sizeof(qem_trace_t));
 
     if(error != 0)
     {
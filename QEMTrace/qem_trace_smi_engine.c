@@ -36,93 +36,657 @@
 #include <semaphore.h> /* semaphores */
 #include <time.h>      /* clock_gettime */
 #include <pthread.h>   /* pthread_mutex_t pthread_cond_t */
+#include <stddef.h>    /* offsetof */
+#if QEM_SMI_EVENT_FD
+#include <poll.h>       /* poll */
+#include <sys/socket.h> /* socket, recvmsg */
+#include <sys/un.h>     /* sockaddr_un */
+#endif
 
 #include "qem_trace_smi_engine.h"
 #include "qem_trace_logger.h"
 
 /*******************************************************************************
- * GLOBAL VARS
+ * CONSTANTS
  ******************************************************************************/
 
-/** Communication status code. */
-static QEM_SMI_STATUS_CODE_E error_code = QEM_SMI_UNINIT;
+/* Number of local buffers, one per partition in hash dispatch mode */
+#if QEM_SMI_DISPATCH == QEM_SMI_DISPATCH_HASH
+#define QEM_SMI_LOCAL_BUFFER_COUNT QEM_SMI_READER_COUNT
+#else
+#define QEM_SMI_LOCAL_BUFFER_COUNT 1
+#endif
+
+/* Partition value used to send a block to all the readers */
+#define QEM_SMI_ALL_READERS -1
+
+/* Messages cannot be split between blocks when a reader may miss a block */
+#if QEM_SMI_DISPATCH != QEM_SMI_DISPATCH_BROADCAST || \
+    QEM_SMI_FULL_POLICY != QEM_SMI_FULL_BLOCK
+#define QEM_SMI_WHOLE_MESSAGES 1
+#else
+#define QEM_SMI_WHOLE_MESSAGES 0
+#endif
+
+/*******************************************************************************
+ * STRUCTURES
+ ******************************************************************************/
+
+/** SMI channel, each channel owns its shared buffer and synchronization
+ * objects so that cores sending on different channels never share a lock.
+ */
+typedef struct
+{
+    /** Channel index. */
+    uint32_t id;
+
+    /** The shared memory zone */
+    uint8_t* shared_buffer;
+
+    /** The shared data part of the buffer */
+    uint8_t* shared_buffer_data;
+
+    /** Memory zone size. */
+    uint32_t shared_buffer_size;
+
+    /** The shared memory zone associated FD */
+    int32_t shm_fd;
+
+    /** Local buffers */
+    uint8_t* local_buffer[QEM_SMI_LOCAL_BUFFER_COUNT];
+
+    /** Local buffers index */
+    uint32_t local_buffer_index[QEM_SMI_LOCAL_BUFFER_COUNT];
+
+    /** Number of messages in the local buffers */
+    uint32_t local_buffer_msgs[QEM_SMI_LOCAL_BUFFER_COUNT];
+
+    /** Local buffers lock, only taken when several cores share the channel. */
+    pthread_mutex_t local_lock;
+
+    /** Server's synchronization semaphore. */
+    sem_t* server_sem;
+
+    /** Client's synchronization semaphore. */
+    sem_t* client_sem;
+
+    /** Monitor's mutex */
+    pthread_mutex_t* mon_lock;
+    /** Monitor mutex's file descriptor. */
+    int32_t mon_lock_fd;
+
+    /** Read block condition variable. */
+    pthread_cond_t* cond_read;
+    /** Read block condition's file descriptor. */
+    int32_t cond_read_fd;
+
+    /** Write block condition variable. */
+    pthread_cond_t* cond_write;
+    /** Write block condition's file descriptor. */
+    int32_t cond_write_fd;
+
+    /** Next block to use to flush the local buffer. */
+    uint32_t next_block;
+
+    /** Sequence number of the next committed block. */
+    uint32_t block_seq;
+
+#if QEM_SMI_DISPATCH == QEM_SMI_DISPATCH_ROUND_ROBIN
+    /** Last reader that received a block. */
+    uint32_t rr_reader;
+#endif
 
-/** The shared memory zone */
-static uint8_t* shared_buffer = NULL;
+#if QEM_SMI_EVENT_FD
+    /** Socket the readers give their event file descriptor through. */
+    int32_t event_socket;
 
-/** The shared data part of the buffer */
-static uint8_t* shared_buffer_data = NULL;
+    /** Event file descriptors of the readers. */
+    int32_t event_fds[QEM_SMI_MAX_READER_COUNT];
+#endif
 
-/** Memory zone size. */
-static uint32_t shared_buffer_size = 0;
+    /** Number of messages in each shared block. */
+    uint32_t block_msgs[QEM_SMI_MAX_BLOCK_COUNT];
+} qem_smi_channel_t;
 
-/** The shared memory zone associated FD */
-static int32_t shm_fd = -1;
+/*******************************************************************************
+ * GLOBAL VARS
+ ******************************************************************************/
 
-/** Local buffer */
-static uint8_t* local_buffer = NULL;
+/** Communication status code. */
+static QEM_SMI_STATUS_CODE_E error_code = QEM_SMI_UNINIT;
 
-/** Local buffer index */
-static uint32_t local_buffer_index = 0;
+/** SMI channels. */
+static qem_smi_channel_t channels[QEM_SMI_MAX_CHANNEL_COUNT];
 
-/** Server's synchronization semaphore. */
-static sem_t* server_sem = SEM_FAILED;
+/** Number of channels of the session. */
+static uint32_t channel_count = 1;
 
-/** Client's synchronization semaphore. */
-static sem_t* client_sem = SEM_FAILED;
+/** Set when there are more cores than channels, the cores sharing a channel
+ * then take its local lock.
+ */
+static uint8_t shared_channels = 0;
 
-/** Monitor's mutex */
-static pthread_mutex_t* mon_lock = (pthread_mutex_t*)MAP_FAILED;
-/** Monitor mutex's file descriptor. */
-static int32_t mon_lock_fd = -1;
 /** Monitor mutex's attributes. */
 pthread_mutexattr_t mon_lock_attr;
 
-/** Read block condition variable. */
-static pthread_cond_t* cond_read = (pthread_cond_t*)MAP_FAILED;
-/** Read block condition's file descriptor. */
-static int32_t cond_read_fd = -1;
 /** Read block condition's attributes. */
 pthread_condattr_t cond_read_attr;
 
-/** Write block condition variable. */
-static pthread_cond_t* cond_write = (pthread_cond_t*)MAP_FAILED;
-/** Write block condition's file descriptor. */
-static int32_t cond_write_fd = -1;
+/** Write block condition's attributes. */
 pthread_condattr_t cond_write_attr;
 
-/** Next block to use to flush the local buffer. */
-uint32_t next_block = 0;
-
 /** Number of blocks in the buffer */
 static uint32_t block_count = QEM_SMI_BLOCK_COUNT;
 
 /** Size of a buffer block. */
 static uint32_t block_size = QEM_SMI_BLOCK_SIZE;
 
+/** Session name, appended to the shared objects names. */
+static char session[QEM_SMI_SESSION_MAX + 1] = "";
+
+/** Scratch buffer used to build the shared objects names. */
+static char name[QEM_SMI_NAME_MAX];
+
 /*******************************************************************************
  * FUNCTIONS
  ******************************************************************************/
 
-static int32_t mmap_buffer(void)
+/* Returns the name of a shared object of a channel in the current session.
+ * The first channel keeps the single channel names.
+ */
+static const char* get_name(const qem_smi_channel_t* ch, const char* base)
+{
+    if(ch->id == 0)
+    {
+        snprintf(name, QEM_SMI_NAME_MAX, "%s%s", base, session);
+    }
+    else
+    {
+        snprintf(name, QEM_SMI_NAME_MAX, "%s%s.%u", base, session, ch->id);
+    }
+    return name;
+}
+
+#if QEM_SMI_EVENT_FD
+/* Signals the event file descriptors of the readers. */
+static void notify_readers(qem_smi_channel_t* ch, const uint32_t readers)
+{
+    uint64_t value;
+    uint32_t i;
+    ssize_t  written;
+
+    /* A full counter already wakes the reader, errors are ignored */
+    value = 1;
+    for(i = 0; i < QEM_SMI_MAX_READER_COUNT; ++i)
+    {
+        if((readers & (1 << i)) != 0 && ch->event_fds[i] != -1)
+        {
+            written = write(ch->event_fds[i], &value, sizeof(value));
+            (void)written;
+        }
+    }
+}
+#endif
+
+static uint32_t get_meta(const qem_smi_channel_t* ch, const uint32_t offset,
+                         const uint32_t size)
+{
+    uint32_t value = 0;
+    memcpy(&value, ch->shared_buffer + offset, size);
+    return value;
+}
+
+static void set_meta(qem_smi_channel_t* ch, const uint32_t offset,
+                     const uint32_t size, const uint32_t value)
+{
+    memcpy(ch->shared_buffer + offset, &value, size);
+}
+
+#if QEM_SMI_SLOW_READER_POLICY == QEM_SMI_SLOW_READER_DETACH
+/* Detaches the readers given as parameter. The monitor lock must be held. */
+static void detach_readers(qem_smi_channel_t* ch, const uint32_t readers)
+{
+    uint32_t i;
+    uint32_t pending;
+    uint32_t blocks;
+
+    set_meta(ch, QEM_SMI_META_READER_MASK_OFFSET,
+             QEM_SMI_META_READER_MASK_SIZE,
+             get_meta(ch, QEM_SMI_META_READER_MASK_OFFSET,
+                      QEM_SMI_META_READER_MASK_SIZE) & ~readers);
+    set_meta(ch, QEM_SMI_META_EVICT_MASK_OFFSET, QEM_SMI_META_EVICT_MASK_SIZE,
+             get_meta(ch, QEM_SMI_META_EVICT_MASK_OFFSET,
+                      QEM_SMI_META_EVICT_MASK_SIZE) | readers);
+
+    /* Release all the blocks still held by the readers */
+    blocks = 0;
+    for(i = 0; i < block_count; ++i)
+    {
+        pending = get_meta(ch, QEM_SMI_META_BLOCK_PEND(i),
+                           QEM_SMI_META_BLOCK_PEND_SIZE) & ~readers;
+        set_meta(ch, QEM_SMI_META_BLOCK_PEND(i), QEM_SMI_META_BLOCK_PEND_SIZE,
+                 pending);
+        if(pending != 0)
+        {
+            blocks |= 1 << i;
+        }
+    }
+    set_meta(ch, QEM_SMI_META_BLOCK_MASK_OFFSET, QEM_SMI_META_BLOCK_MASK_SIZE,
+             blocks);
+
+    /* Wake up the detached readers */
+    pthread_cond_broadcast(ch->cond_read);
+#if QEM_SMI_EVENT_FD
+    notify_readers(ch, readers);
+#endif
+
+    QEM_TRACE_WARNING("Detached slow SMI readers", readers);
+}
+#endif
+
+/* Waits for the next block to be released by all its readers. The monitor lock
+ * must be held.
+ */
+static void wait_free_block(qem_smi_channel_t* ch)
+{
+    uint32_t pending;
+#if QEM_SMI_SLOW_READER_POLICY == QEM_SMI_SLOW_READER_DETACH
+    struct timespec ts;
+
+    /* Compute the deadline after which the slow readers are detached */
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec  += QEM_SMI_READER_TIMEOUT / 1000;
+    ts.tv_nsec += (QEM_SMI_READER_TIMEOUT % 1000) * 1000000;
+    if(ts.tv_nsec >= 1000000000)
+    {
+        ts.tv_sec  += 1;
+        ts.tv_nsec -= 1000000000;
+    }
+#endif
+
+    pending = get_meta(ch, QEM_SMI_META_BLOCK_PEND(ch->next_block),
+                       QEM_SMI_META_BLOCK_PEND_SIZE);
+    while(pending != 0)
+    {
+#if QEM_SMI_SLOW_READER_POLICY == QEM_SMI_SLOW_READER_DETACH
+        if(pthread_cond_timedwait(ch->cond_write, ch->mon_lock, &ts) ==
+           ETIMEDOUT)
+        {
+            pending = get_meta(ch, QEM_SMI_META_BLOCK_PEND(ch->next_block),
+                               QEM_SMI_META_BLOCK_PEND_SIZE);
+            if(pending != 0)
+            {
+                detach_readers(ch, pending);
+            }
+        }
+#else
+        pthread_cond_wait(ch->cond_write, ch->mon_lock);
+#endif
+        pending = get_meta(ch, QEM_SMI_META_BLOCK_PEND(ch->next_block),
+                           QEM_SMI_META_BLOCK_PEND_SIZE);
+    }
+}
+
+/* Returns the mask of the readers that must receive the block of a partition.
+ * The monitor lock must be held.
+ */
+static uint32_t get_block_readers(qem_smi_channel_t* ch,
+                                  const int32_t partition)
+{
+    uint32_t readers;
+#if QEM_SMI_DISPATCH == QEM_SMI_DISPATCH_ROUND_ROBIN
+    uint32_t i;
+#endif
+
+    readers = get_meta(ch, QEM_SMI_META_READER_MASK_OFFSET,
+                       QEM_SMI_META_READER_MASK_SIZE);
+    if(partition == QEM_SMI_ALL_READERS || readers == 0)
+    {
+        return readers;
+    }
+
+#if QEM_SMI_DISPATCH == QEM_SMI_DISPATCH_ROUND_ROBIN
+    /* Give the block to the next registered reader */
+    for(i = 0; i < QEM_SMI_MAX_READER_COUNT; ++i)
+    {
+        ch->rr_reader = (ch->rr_reader + 1) % QEM_SMI_MAX_READER_COUNT;
+        if((readers & (1 << ch->rr_reader)) != 0)
+        {
+            break;
+        }
+    }
+    return 1 << ch->rr_reader;
+#elif QEM_SMI_DISPATCH == QEM_SMI_DISPATCH_HASH
+    return readers & (1 << partition);
+#else
+    return readers;
+#endif
+}
+
+#if QEM_SMI_FULL_POLICY != QEM_SMI_FULL_BLOCK
+/* Accounts lost messages in the total and in the counter of each reader that
+ * lost them. The monitor lock must be held.
+ */
+static void drop_messages(qem_smi_channel_t* ch, const uint32_t readers,
+                          const uint32_t messages)
+{
+    uint32_t i;
+
+    set_meta(ch, QEM_SMI_META_DROP_COUNT_OFFSET, QEM_SMI_META_DROP_COUNT_SIZE,
+             get_meta(ch, QEM_SMI_META_DROP_COUNT_OFFSET,
+                      QEM_SMI_META_DROP_COUNT_SIZE) + messages);
+
+    for(i = 0; i < QEM_SMI_MAX_READER_COUNT; ++i)
+    {
+        if((readers & (1 << i)) != 0)
+        {
+            set_meta(ch, QEM_SMI_META_READER_DROP(i),
+                     QEM_SMI_META_READER_DROP_SIZE,
+                     get_meta(ch, QEM_SMI_META_READER_DROP(i),
+                              QEM_SMI_META_READER_DROP_SIZE) + messages);
+        }
+    }
+}
+#endif
+
+#if QEM_SMI_FULL_POLICY == QEM_SMI_FULL_OVERWRITE_OLDEST
+/* Takes the next block back from the readers that did not release it yet. The
+ * monitor lock must be held.
+ */
+static void reclaim_block(qem_smi_channel_t* ch)
+{
+    uint32_t pending;
+
+    pending = get_meta(ch, QEM_SMI_META_BLOCK_PEND(ch->next_block),
+                       QEM_SMI_META_BLOCK_PEND_SIZE);
+    set_meta(ch, QEM_SMI_META_BLOCK_PEND(ch->next_block),
+             QEM_SMI_META_BLOCK_PEND_SIZE, 0);
+    set_meta(ch, QEM_SMI_META_BLOCK_MASK_OFFSET, QEM_SMI_META_BLOCK_MASK_SIZE,
+             get_meta(ch, QEM_SMI_META_BLOCK_MASK_OFFSET,
+                      QEM_SMI_META_BLOCK_MASK_SIZE) &
+             ~(1 << ch->next_block));
+
+    /* Only the readers that did not release the block lose it */
+    drop_messages(ch, pending, ch->block_msgs[ch->next_block]);
+    ch->block_msgs[ch->next_block] = 0;
+}
+#endif
+
+/* Hands the next block to the readers of the partition. The monitor lock must
+ * be held.
+ */
+static void commit_block(qem_smi_channel_t* ch, const int32_t partition,
+                         const uint32_t used, const uint32_t messages)
+{
+    uint32_t readers;
+    uint32_t block;
+    uint32_t i;
+
+    block   = ch->next_block;
+    readers = get_block_readers(ch, partition);
+    set_meta(ch, QEM_SMI_META_BLOCK_SEQ(block), QEM_SMI_META_BLOCK_SEQ_SIZE,
+             ch->block_seq++);
+    set_meta(ch, QEM_SMI_META_BLOCK_USED(block), QEM_SMI_META_BLOCK_USED_SIZE,
+             used);
+    for(i = 0; i < QEM_SMI_MAX_READER_COUNT; ++i)
+    {
+        if((readers & (1 << i)) != 0)
+        {
+            set_meta(ch, QEM_SMI_META_BLOCK_DROP(block, i),
+                     QEM_SMI_META_BLOCK_DROP_SIZE,
+                     get_meta(ch, QEM_SMI_META_READER_DROP(i),
+                              QEM_SMI_META_READER_DROP_SIZE));
+        }
+    }
+    ch->block_msgs[block] = messages;
+    set_meta(ch, QEM_SMI_META_BLOCK_PEND(block), QEM_SMI_META_BLOCK_PEND_SIZE,
+             readers);
+
+    /* If all the readers are gone, the block is directly recycled */
+    if(readers != 0)
+    {
+        set_meta(ch, QEM_SMI_META_BLOCK_MASK_OFFSET,
+                 QEM_SMI_META_BLOCK_MASK_SIZE,
+                 get_meta(ch, QEM_SMI_META_BLOCK_MASK_OFFSET,
+                          QEM_SMI_META_BLOCK_MASK_SIZE) | (1 << block));
+    }
+    ch->next_block = (block + 1) % block_count;
+
+    pthread_cond_broadcast(ch->cond_read);
+#if QEM_SMI_EVENT_FD
+    notify_readers(ch, readers);
+#endif
+}
+
+#if QEM_SMI_EVENT_FD
+/* Receives the event file descriptors sent by the readers since the last call.
+ * A reader sends its descriptor when it registers in a slot, during the
+ * handshake or later, and the server never waits for a reader that does not
+ * send one. A descriptor is only kept when the peer is the process that
+ * registered the reader slot, it replaces the one of the previous reader of the
+ * slot.
+ */
+static void accept_event_fd(qem_smi_channel_t* ch)
+{
+    struct msghdr   msg;
+    struct iovec    iov;
+    struct cmsghdr* cmsg;
+    struct ucred    cred;
+    socklen_t       cred_size;
+    uint32_t        readers;
+    uint32_t        pid;
+    int32_t         conn;
+    int32_t         id;
+    int32_t         fd;
+    union
+    {
+        char           buffer[CMSG_SPACE(sizeof(int32_t))];
+        struct cmsghdr align;
+    } control;
+
+    while((conn = accept(ch->event_socket, NULL, NULL)) >= 0)
+    {
+        iov.iov_base = &id;
+        iov.iov_len  = sizeof(id);
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov        = &iov;
+        msg.msg_iovlen     = 1;
+        msg.msg_control    = control.buffer;
+        msg.msg_controllen = sizeof(control.buffer);
+
+        fd        = -1;
+        cred_size = sizeof(cred);
+        if(getsockopt(conn, SOL_SOCKET, SO_PEERCRED, &cred, &cred_size) == 0 &&
+           recvmsg(conn, &msg, MSG_DONTWAIT) == sizeof(id))
+        {
+            cmsg = CMSG_FIRSTHDR(&msg);
+            if(cmsg != NULL && cmsg->cmsg_level == SOL_SOCKET &&
+               cmsg->cmsg_type == SCM_RIGHTS)
+            {
+                memcpy(&fd, CMSG_DATA(cmsg), sizeof(int32_t));
+            }
+        }
+        close(conn);
+
+        if(fd == -1)
+        {
+            continue;
+        }
+
+        /* Check the sender against the reader registered in the slot */
+        pid     = 0;
+        readers = 0;
+        if(id >= 0 && id < QEM_SMI_MAX_READER_COUNT)
+        {
+            pthread_mutex_lock(ch->mon_lock);
+            readers = get_meta(ch, QEM_SMI_META_READER_MASK_OFFSET,
+                               QEM_SMI_META_READER_MASK_SIZE) & (1 << id);
+            pid     = get_meta(ch, QEM_SMI_META_READER_PID(id),
+                               QEM_SMI_META_READER_PID_SIZE);
+            pthread_mutex_unlock(ch->mon_lock);
+        }
+        if(readers == 0 || pid == 0 || cred.pid != (pid_t)pid)
+        {
+            QEM_TRACE_WARNING("Rejected SMI event descriptor", 0);
+            close(fd);
+            continue;
+        }
+
+        if(ch->event_fds[id] != -1)
+        {
+            close(ch->event_fds[id]);
+        }
+        ch->event_fds[id] = fd;
+    }
+}
+#endif
+
+/* Copies the data to the next free block and hands it to the readers of the
+ * partition. Depending on the full buffer policy, the data or the oldest block
+ * may be lost if the readers are late. Blocks sent to all the readers are
+ * never lost.
+ */
+static void write_block(qem_smi_channel_t* ch, const uint8_t* data,
+                        const uint32_t used, const int32_t partition,
+                        const uint32_t messages)
+{
+#if QEM_SMI_EVENT_FD
+    /* Get the descriptors of the readers registered since the last block */
+    accept_event_fd(ch);
+#endif
+
+    pthread_mutex_lock(ch->mon_lock);
+
+#if QEM_SMI_FULL_POLICY == QEM_SMI_FULL_BLOCK
+    /* Check if the block is free */
+    wait_free_block(ch);
+#else
+    if(partition == QEM_SMI_ALL_READERS)
+    {
+        wait_free_block(ch);
+    }
+    else if(get_meta(ch, QEM_SMI_META_BLOCK_PEND(ch->next_block),
+                     QEM_SMI_META_BLOCK_PEND_SIZE) != 0)
+    {
+#if QEM_SMI_FULL_POLICY == QEM_SMI_FULL_DROP_NEWEST
+        /* The readers the block would have been handed to lose it, with
+         * round robin dispatch the next reader is skipped.
+         */
+        drop_messages(ch, get_block_readers(ch, partition), messages);
+        pthread_mutex_unlock(ch->mon_lock);
+        return;
+#else
+        reclaim_block(ch);
+#endif
+    }
+#endif
+
+    pthread_mutex_unlock(ch->mon_lock);
+
+    /* This part does not need to be locked as the other end cannot access
+     * it before it is set as used in the block mask.
+     */
+    /* Copy the data to the shared buffer */
+    memcpy(ch->shared_buffer_data + ch->next_block * block_size, data, used);
+
+    /* Update metadata */
+    pthread_mutex_lock(ch->mon_lock);
+
+    commit_block(ch, partition, used, messages);
+
+    pthread_mutex_unlock(ch->mon_lock);
+}
+
+/* Writes the local buffers of a channel to its shared buffer. The local lock
+ * must be held.
+ */
+static void flush_channel(qem_smi_channel_t* ch)
+{
+    uint32_t i;
+
+    for(i = 0; i < QEM_SMI_LOCAL_BUFFER_COUNT; ++i)
+    {
+        if(ch->local_buffer_index[i] == 0)
+        {
+            continue;
+        }
+
+        write_block(ch, ch->local_buffer[i], ch->local_buffer_index[i], i,
+                    ch->local_buffer_msgs[i]);
+
+        ch->local_buffer_index[i] = 0;
+        ch->local_buffer_msgs[i]  = 0;
+    }
+}
+
+/* Takes the local lock of a channel shared by several cores. A channel owned
+ * by one core is only written by the thread running the core, the other
+ * threads only send on it or flush it while the cores are stopped.
+ */
+static void lock_channel(qem_smi_channel_t* ch)
+{
+    if(shared_channels != 0)
+    {
+        pthread_mutex_lock(&ch->local_lock);
+    }
+}
+
+/* Releases the local lock taken by lock_channel. */
+static void unlock_channel(qem_smi_channel_t* ch)
+{
+    if(shared_channels != 0)
+    {
+        pthread_mutex_unlock(&ch->local_lock);
+    }
+}
+
+/* Resets a channel to its unallocated state. */
+static void init_channel(qem_smi_channel_t* ch, const uint32_t id)
+{
+    memset(ch, 0, sizeof(qem_smi_channel_t));
+
+    ch->id            = id;
+    ch->shm_fd        = -1;
+    ch->server_sem    = SEM_FAILED;
+    ch->client_sem    = SEM_FAILED;
+    ch->mon_lock      = (pthread_mutex_t*)MAP_FAILED;
+    ch->mon_lock_fd   = -1;
+    ch->cond_read     = (pthread_cond_t*)MAP_FAILED;
+    ch->cond_read_fd  = -1;
+    ch->cond_write    = (pthread_cond_t*)MAP_FAILED;
+    ch->cond_write_fd = -1;
+    ch->block_seq     = 1;
+#if QEM_SMI_DISPATCH == QEM_SMI_DISPATCH_ROUND_ROBIN
+    ch->rr_reader     = QEM_SMI_MAX_READER_COUNT - 1;
+#endif
+#if QEM_SMI_EVENT_FD
+    ch->event_socket  = -1;
+    memset(ch->event_fds, -1, sizeof(ch->event_fds));
+#endif
+
+    pthread_mutex_init(&ch->local_lock, NULL);
+}
+
+static int32_t mmap_buffer(qem_smi_channel_t* ch)
 {
     int32_t error;
     uint32_t buff;
 
     /* Creates the SHM file descriptor */
-    shm_fd = shm_open(QEM_SMI_SHM_NAME, O_RDWR | O_CREAT | O_TRUNC, 0666);
-    if(shm_fd < 0)
+    ch->shm_fd = shm_open(get_name(ch, QEM_SMI_SHM_NAME),
+                          O_RDWR | O_CREAT | O_TRUNC, 0666);
+    if(ch->shm_fd < 0)
     {
         qem_smi_client_disconnect();
         QEM_TRACE_ERROR("Could not open shared memory region", errno, 0);
         return -1;
     }
 
-    shared_buffer_size = block_count * block_size + 
-                         QEM_SMI_DATA_BUFFER_META_DATA_SIZE;
+    ch->shared_buffer_size = block_count * block_size +
+                             QEM_SMI_DATA_BUFFER_META_DATA_SIZE;
 
     /* Change fd size */
-    error = ftruncate(shm_fd, shared_buffer_size);
+    error = ftruncate(ch->shm_fd, ch->shared_buffer_size);
 	if (error != 0)
 	{
         qem_smi_client_disconnect();
@@ -131,65 +695,132 @@ static int32_t mmap_buffer(void)
 
 
     /* Just map the metadata to get the information */
-    shared_buffer = (uint8_t*)mmap(NULL, shared_buffer_size, 
-                                   PROT_READ | PROT_WRITE, MAP_SHARED, 
-                                   shm_fd, 0);
-    if (shared_buffer == MAP_FAILED)
+    ch->shared_buffer = (uint8_t*)mmap(NULL, ch->shared_buffer_size,
+                                       PROT_READ | PROT_WRITE, MAP_SHARED,
+                                       ch->shm_fd, 0);
+    if (ch->shared_buffer == MAP_FAILED)
 	{
+        ch->shared_buffer = NULL;
         qem_smi_client_disconnect();
         QEM_TRACE_ERROR("Could not mmap shared memory shm", errno, 0);
         return -1;
 	}
 
     /* Set the data part start */
-    shared_buffer_data = shared_buffer + QEM_SMI_DATA_BUFFER_META_DATA_SIZE;
+    ch->shared_buffer_data = ch->shared_buffer +
+                             QEM_SMI_DATA_BUFFER_META_DATA_SIZE;
 
     /* Initialize the shared memory metadata */
     buff = block_count;
-    memcpy(shared_buffer + QEM_SMI_META_BLOCK_COUNT_OFFSET,
+    memcpy(ch->shared_buffer + QEM_SMI_META_BLOCK_COUNT_OFFSET,
            &buff, QEM_SMI_META_BLOCK_COUNT_SIZE);
     buff = 0;
-    memcpy(shared_buffer + QEM_SMI_META_BLOCK_MASK_OFFSET,
+    memcpy(ch->shared_buffer + QEM_SMI_META_BLOCK_MASK_OFFSET,
            &buff, QEM_SMI_META_BLOCK_MASK_SIZE);
     buff = block_size;
-    memcpy(shared_buffer + QEM_SMI_META_BLOCK_SIZE_OFFSET,
-           &buff, QEM_SMI_META_BLOCK_SIZE_SIZE);    
+    memcpy(ch->shared_buffer + QEM_SMI_META_BLOCK_SIZE_OFFSET,
+           &buff, QEM_SMI_META_BLOCK_SIZE_SIZE);
+
+    /* No reader registered and no block pending yet */
+    memset(ch->shared_buffer + QEM_SMI_META_READER_MASK_OFFSET, 0,
+           QEM_SMI_DATA_BUFFER_META_DATA_SIZE -
+           QEM_SMI_META_READER_MASK_OFFSET);
+
+    /* Let the readers find the other channels of the session */
+    set_meta(ch, QEM_SMI_META_CHANNEL_COUNT_OFFSET,
+             QEM_SMI_META_CHANNEL_COUNT_SIZE, channel_count);
+    set_meta(ch, QEM_SMI_META_CHANNEL_ID_OFFSET,
+             QEM_SMI_META_CHANNEL_ID_SIZE, ch->id);
 
     return 0;
 }
 
-static int32_t create_local_buffer(void)
+static int32_t create_local_buffer(qem_smi_channel_t* ch)
 {
-    /* Create local buffer */
-    local_buffer_index = 0;
-    local_buffer       = (uint8_t*)malloc(block_size);
-    if(local_buffer == NULL)
+    uint32_t i;
+
+    /* Create local buffers */
+    for(i = 0; i < QEM_SMI_LOCAL_BUFFER_COUNT; ++i)
     {
-        qem_smi_client_disconnect();
-        QEM_TRACE_ERROR("Could not create local buffer", errno, 0);
+        ch->local_buffer_index[i] = 0;
+        ch->local_buffer_msgs[i]  = 0;
+        ch->local_buffer[i]       = (uint8_t*)malloc(block_size);
+        if(ch->local_buffer[i] == NULL)
+        {
+            qem_smi_client_disconnect();
+            QEM_TRACE_ERROR("Could not create local buffer", errno, 0);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int32_t create_sync_attr(void)
+{
+    int error;
+
+    /* Initializes attributes */
+    error = pthread_mutexattr_init(&mon_lock_attr);
+    if(error != 0)
+    {
+        QEM_TRACE_ERROR("Could not initialize synchronization", errno, 0);
+        return -1;
+    }
+    error = pthread_mutexattr_setpshared(&mon_lock_attr,
+                                         PTHREAD_PROCESS_SHARED);
+    if(error != 0)
+    {
+        QEM_TRACE_ERROR("Could not initialize synchronization", errno, 0);
+        return -1;
+    }
+    error = pthread_condattr_init(&cond_read_attr);
+    if(error != 0)
+    {
+        QEM_TRACE_ERROR("Could not initialize synchronization", errno, 0);
+        return -1;
+    }
+    error = pthread_condattr_setpshared(&cond_read_attr,
+                                        PTHREAD_PROCESS_SHARED);
+    if(error != 0)
+    {
+        QEM_TRACE_ERROR("Could not initialize synchronization", errno, 0);
+        return -1;
+    }
+    error = pthread_condattr_init(&cond_write_attr);
+    if(error != 0)
+    {
+        QEM_TRACE_ERROR("Could not initialize synchronization", errno, 0);
+        return -1;
+    }
+    error = pthread_condattr_setpshared(&cond_write_attr,
+                                        PTHREAD_PROCESS_SHARED);
+    if(error != 0)
+    {
+        QEM_TRACE_ERROR("Could not initialize synchronization", errno, 0);
         return -1;
     }
 
     return 0;
 }
 
-static int32_t create_sync(void)
+static int32_t create_sync(qem_smi_channel_t* ch)
 {
     int error;
-    
+
     /* Create the shared semaphores */
-    server_sem = sem_open(QEM_SMI_SHARED_SEM_SERVER, O_CREAT | O_EXCL,
-                               0666, 0);
-    if (server_sem == SEM_FAILED)
+    ch->server_sem = sem_open(get_name(ch, QEM_SMI_SHARED_SEM_SERVER),
+                              O_CREAT | O_EXCL, 0666, 0);
+    if (ch->server_sem == SEM_FAILED)
     {
         qem_smi_client_disconnect();
         QEM_TRACE_ERROR("Could not create server sem", errno, 0);
         return -1;
     }
 
-    client_sem = sem_open(QEM_SMI_SHARED_SEM_CLIENT, O_CREAT | O_EXCL,
-                               0666, 0);
-    if (client_sem == SEM_FAILED)
+    ch->client_sem = sem_open(get_name(ch, QEM_SMI_SHARED_SEM_CLIENT),
+                              O_CREAT | O_EXCL, 0666, 0);
+    if (ch->client_sem == SEM_FAILED)
     {
         qem_smi_client_disconnect();
         QEM_TRACE_ERROR("Could not create client sem", errno, 0);
@@ -197,24 +828,27 @@ static int32_t create_sync(void)
     }
 
     /* Open the file descriptors */
-    mon_lock_fd   = shm_open(QEM_SMI_SHARED_MUTEX, O_CREAT | O_RDWR | O_TRUNC, 0666);
-    if(mon_lock_fd < 0)
+    ch->mon_lock_fd   = shm_open(get_name(ch, QEM_SMI_SHARED_MUTEX),
+                                 O_CREAT | O_RDWR | O_TRUNC, 0666);
+    if(ch->mon_lock_fd < 0)
     {
         qem_smi_client_disconnect();
         QEM_TRACE_ERROR("Could not create monitor mutex", errno, 0);
         return -1;
-    } 
+    }
 
-    cond_read_fd  = shm_open(QEM_SMI_SHARED_COND_READ, O_CREAT | O_RDWR | O_TRUNC, 0666);
-    if(cond_read_fd < 0)
+    ch->cond_read_fd  = shm_open(get_name(ch, QEM_SMI_SHARED_COND_READ),
+                                 O_CREAT | O_RDWR | O_TRUNC, 0666);
+    if(ch->cond_read_fd < 0)
     {
         qem_smi_client_disconnect();
         QEM_TRACE_ERROR("Could not create monitor read cond", errno, 0);
         return -1;
     }
 
-    cond_write_fd = shm_open(QEM_SMI_SHARED_COND_WRITE, O_CREAT | O_RDWR | O_TRUNC, 0666);
-    if(cond_write_fd < 0)
+    ch->cond_write_fd = shm_open(get_name(ch, QEM_SMI_SHARED_COND_WRITE),
+                                 O_CREAT | O_RDWR | O_TRUNC, 0666);
+    if(ch->cond_write_fd < 0)
     {
         qem_smi_client_disconnect();
         QEM_TRACE_ERROR("Could not create monitor write cond", errno, 0);
@@ -222,21 +856,21 @@ static int32_t create_sync(void)
     }
 
     /* Allocate memory */
-    error = ftruncate(mon_lock_fd, sizeof(pthread_mutex_t));
+    error = ftruncate(ch->mon_lock_fd, sizeof(pthread_mutex_t));
 	if (error != 0)
 	{
         qem_smi_client_disconnect();
         QEM_TRACE_ERROR("Could not truncate monitor lock memory", errno, 0);
         return -1;
 	}
-    error = ftruncate(cond_read_fd, sizeof(pthread_cond_t));
+    error = ftruncate(ch->cond_read_fd, sizeof(pthread_cond_t));
 	if (error != 0)
 	{
         qem_smi_client_disconnect();
         QEM_TRACE_ERROR("Could not truncate monitor read memory", errno, 0);
         return -1;
 	}
-    error = ftruncate(cond_write_fd, sizeof(pthread_cond_t));
+    error = ftruncate(ch->cond_write_fd, sizeof(pthread_cond_t));
 	if (error != 0)
 	{
         qem_smi_client_disconnect();
@@ -245,137 +879,178 @@ static int32_t create_sync(void)
 	}
 
     /* Mmap the memory */
-    mon_lock = (pthread_mutex_t*)mmap(NULL, sizeof(pthread_mutex_t),
-                                      PROT_READ | PROT_WRITE, MAP_SHARED, 
-                                      mon_lock_fd, 0);
-    if(mon_lock == MAP_FAILED)
+    ch->mon_lock = (pthread_mutex_t*)mmap(NULL, sizeof(pthread_mutex_t),
+                                          PROT_READ | PROT_WRITE, MAP_SHARED,
+                                          ch->mon_lock_fd, 0);
+    if(ch->mon_lock == MAP_FAILED)
     {
         qem_smi_client_disconnect();
         QEM_TRACE_ERROR("Could not mmap monitor mutex", errno, 0);
         return -1;
     }
-    cond_read = (pthread_cond_t*)mmap(NULL, sizeof(pthread_cond_t),
-                                      PROT_READ | PROT_WRITE, MAP_SHARED, 
-                                      cond_read_fd, 0);
-    if(cond_read == MAP_FAILED)
+    ch->cond_read = (pthread_cond_t*)mmap(NULL, sizeof(pthread_cond_t),
+                                          PROT_READ | PROT_WRITE, MAP_SHARED,
+                                          ch->cond_read_fd, 0);
+    if(ch->cond_read == MAP_FAILED)
     {
         qem_smi_client_disconnect();
         QEM_TRACE_ERROR("Could not mmap monitor read cond", errno, 0);
         return -1;
     }
-    cond_write = (pthread_cond_t*)mmap(NULL, sizeof(pthread_cond_t),
-                                       PROT_READ | PROT_WRITE, MAP_SHARED, 
-                                       cond_write_fd, 0);
-    if(cond_write == MAP_FAILED)
+    ch->cond_write = (pthread_cond_t*)mmap(NULL, sizeof(pthread_cond_t),
+                                           PROT_READ | PROT_WRITE, MAP_SHARED,
+                                           ch->cond_write_fd, 0);
+    if(ch->cond_write == MAP_FAILED)
     {
         qem_smi_client_disconnect();
         QEM_TRACE_ERROR("Could not mmap monitor write cond", errno, 0);
         return -1;
     }
 
-    /* Initializes attributes */
-    error = pthread_mutexattr_init(&mon_lock_attr);
+    /* Initializes the shared synchronization objects */
+    error = pthread_mutex_init(ch->mon_lock, &mon_lock_attr);
     if(error != 0)
     {
         qem_smi_client_disconnect();
         QEM_TRACE_ERROR("Could not initialize synchronization", errno, 0);
         return -1;
     }
-    error = pthread_mutexattr_setpshared(&mon_lock_attr, 
-                                                PTHREAD_PROCESS_SHARED);
+    error = pthread_cond_init(ch->cond_read, &cond_read_attr);
     if(error != 0)
     {
         qem_smi_client_disconnect();
         QEM_TRACE_ERROR("Could not initialize synchronization", errno, 0);
         return -1;
     }
-    error = pthread_mutex_init(mon_lock, &mon_lock_attr);
+    error = pthread_cond_init(ch->cond_write, &cond_write_attr);
     if(error != 0)
     {
         qem_smi_client_disconnect();
         QEM_TRACE_ERROR("Could not initialize synchronization", errno, 0);
         return -1;
     }
-    error = pthread_condattr_init(&cond_read_attr);
-    if(error != 0)
+
+    return 0;
+}
+
+#if QEM_SMI_EVENT_FD
+static int32_t create_event_socket(qem_smi_channel_t* ch)
+{
+    struct sockaddr_un addr;
+
+    ch->event_socket = socket(AF_UNIX,
+                              SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(ch->event_socket < 0)
     {
         qem_smi_client_disconnect();
-        QEM_TRACE_ERROR("Could not initialize synchronization", errno, 0);
+        QEM_TRACE_ERROR("Could not create event socket", errno, 0);
         return -1;
     }
-    error = pthread_condattr_setpshared(&cond_read_attr, 
-                                                PTHREAD_PROCESS_SHARED);
-    if(error != 0)
+
+    /* Use the abstract namespace, nothing to clean on exit */
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    get_name(ch, QEM_SMI_SHARED_SOCKET);
+    memcpy(addr.sun_path + 1, name, strlen(name));
+
+    if(bind(ch->event_socket, (struct sockaddr*)&addr,
+            offsetof(struct sockaddr_un, sun_path) + 1 + strlen(name)) != 0 ||
+       listen(ch->event_socket, QEM_SMI_MAX_READER_COUNT) != 0)
     {
         qem_smi_client_disconnect();
-        QEM_TRACE_ERROR("Could not initialize synchronization", errno, 0);
+        QEM_TRACE_ERROR("Could not bind event socket", errno, 0);
         return -1;
     }
-    error = pthread_cond_init(cond_read, &cond_read_attr);
-    if(error != 0)
+
+    return 0;
+}
+#endif
+
+int32_t qem_smi_client_init(const uint32_t core_count)
+{
+    int32_t ret_val = 0;
+    const char* env_session;
+    uint32_t i;
+    qem_smi_channel_t* ch;
+
+#if QEM_SMI_CHANNEL_COUNT == 0
+    channel_count = core_count;
+#else
+    channel_count = QEM_SMI_CHANNEL_COUNT;
+#endif
+    if(channel_count < 1)
     {
-        qem_smi_client_disconnect();
-        QEM_TRACE_ERROR("Could not initialize synchronization", errno, 0);
-        return -1;
+        channel_count = 1;
     }
-    error = pthread_condattr_init(&cond_write_attr);
-    if(error != 0)
+    else if(channel_count > QEM_SMI_MAX_CHANNEL_COUNT)
     {
-        qem_smi_client_disconnect();
-        QEM_TRACE_ERROR("Could not initialize synchronization", errno, 0);
-        return -1;
+        channel_count = QEM_SMI_MAX_CHANNEL_COUNT;
     }
-    error = pthread_condattr_setpshared(&cond_write_attr, 
-                                                PTHREAD_PROCESS_SHARED);
-    if(error != 0)
+    shared_channels = (core_count > channel_count);
+
+    for(i = 0; i < channel_count; ++i)
     {
-        qem_smi_client_disconnect();
-        QEM_TRACE_ERROR("Could not initialize synchronization", errno, 0);
-        return -1;
+        init_channel(&channels[i], i);
     }
-    error = pthread_cond_init(cond_write, &cond_write_attr);
-    if(error != 0)
+
+    /* Get the session the SMI is created in */
+    env_session = getenv(QEM_SMI_SESSION_ENV);
+    session[0]  = 0;
+    if(env_session != NULL)
     {
-        qem_smi_client_disconnect();
-        QEM_TRACE_ERROR("Could not initialize synchronization", errno, 0);
-        return -1;
+        if(strlen(env_session) > QEM_SMI_SESSION_MAX ||
+           strchr(env_session, '/') != NULL)
+        {
+            QEM_TRACE_ERROR("Invalid SMI session name", 0, 0);
+            return -1;
+        }
+        strcpy(session, env_session);
     }
-    
-    return 0;
-}
 
-int32_t qem_smi_client_init(void)
-{
-    int32_t ret_val = 0;
-
-    shared_buffer_data = shared_buffer;
     error_code = QEM_SMI_NOT_CONNECTED;
 
-    local_buffer_index = 0;
-
-    shm_unlink(QEM_SMI_SHARED_MUTEX);
-    shm_unlink(QEM_SMI_SHARED_COND_READ);
-    shm_unlink(QEM_SMI_SHARED_COND_WRITE);
-    sem_unlink(QEM_SMI_SHARED_SEM_CLIENT);
-    sem_unlink(QEM_SMI_SHARED_SEM_SERVER);
-    shm_unlink(QEM_SMI_SHM_NAME);
-
-    if((ret_val = mmap_buffer()) != 0)
+    if((ret_val = create_sync_attr()) != 0)
     {
         qem_smi_client_disconnect();
         return ret_val;
     }
 
-    if((ret_val = create_local_buffer()) != 0)
+    for(i = 0; i < channel_count; ++i)
     {
-        qem_smi_client_disconnect();
-        return ret_val;
-    }
+        ch = &channels[i];
 
-    if((ret_val = create_sync()) != 0)
-    {
-        qem_smi_client_disconnect();
-        return ret_val;
+        shm_unlink(get_name(ch, QEM_SMI_SHARED_MUTEX));
+        shm_unlink(get_name(ch, QEM_SMI_SHARED_COND_READ));
+        shm_unlink(get_name(ch, QEM_SMI_SHARED_COND_WRITE));
+        sem_unlink(get_name(ch, QEM_SMI_SHARED_SEM_CLIENT));
+        sem_unlink(get_name(ch, QEM_SMI_SHARED_SEM_SERVER));
+        shm_unlink(get_name(ch, QEM_SMI_SHM_NAME));
+
+        if((ret_val = mmap_buffer(ch)) != 0)
+        {
+            qem_smi_client_disconnect();
+            return ret_val;
+        }
+
+        if((ret_val = create_local_buffer(ch)) != 0)
+        {
+            qem_smi_client_disconnect();
+            return ret_val;
+        }
+
+        if((ret_val = create_sync(ch)) != 0)
+        {
+            qem_smi_client_disconnect();
+            return ret_val;
+        }
+
+#if QEM_SMI_EVENT_FD
+        if((ret_val = create_event_socket(ch)) != 0)
+        {
+            qem_smi_client_disconnect();
+            return ret_val;
+        }
+#endif
     }
 
     return ret_val;
@@ -385,7 +1060,10 @@ int32_t qem_smi_client_connect(const uint32_t timeout, const uint32_t max_attemp
 {
     uint32_t buffer;
     uint32_t attempt;
+    uint32_t readers;
+    uint32_t i;
     int32_t  sem_get;
+    qem_smi_channel_t* ch;
 
     struct timespec ts;
     ts.tv_sec = timeout;
@@ -399,18 +1077,30 @@ int32_t qem_smi_client_connect(const uint32_t timeout, const uint32_t max_attemp
         return -1;
     }
 
-    /* Initialize named semaphore for handhake */
+    /* Initialize named semaphore for handhake, one token per reader of each
+     * channel.
+     */
     attempt = 0;
     buffer = QEM_SMI_HANDSHAKE_MAGIC;
-    memcpy(shared_buffer_data, &buffer, sizeof(uint32_t));
-    sem_post(client_sem);
+    for(i = 0; i < channel_count; ++i)
+    {
+        memcpy(channels[i].shared_buffer_data, &buffer, sizeof(uint32_t));
+        for(readers = 0; readers < QEM_SMI_READER_COUNT; ++readers)
+        {
+            sem_post(channels[i].client_sem);
+        }
+    }
+    readers = 0;
     sem_get = -1;
+    i       = 0;
     while(attempt < max_attempt)
     {
+        ch = &channels[i];
+
         /* Handle interruption while waiting */
         clock_gettime(CLOCK_REALTIME, &ts);
         ts.tv_sec += timeout;
-        while ((sem_get = sem_timedwait(server_sem, &ts)) == -1 &&
+        while ((sem_get = sem_timedwait(ch->server_sem, &ts)) == -1 &&
                errno == EINTR)
         {
             continue;
@@ -419,7 +1109,19 @@ int32_t qem_smi_client_connect(const uint32_t timeout, const uint32_t max_attemp
         /* Check if we got the sem */
         if(sem_get == 0)
         {
-            break;
+#if QEM_SMI_EVENT_FD
+            accept_event_fd(ch);
+#endif
+            /* Wait for the remaining readers, then for the next channel */
+            if(++readers == QEM_SMI_READER_COUNT)
+            {
+                readers = 0;
+                if(++i == channel_count)
+                {
+                    break;
+                }
+            }
+            continue;
         }
 
         if(attempt == 0)
@@ -438,7 +1140,7 @@ int32_t qem_smi_client_connect(const uint32_t timeout, const uint32_t max_attemp
     {
         printf(".\n");
     }
-    if(sem_get != 0)
+    if(i != channel_count)
     {
         qem_smi_client_disconnect();
         QEM_TRACE_ERROR("Client did not respond", 0, 0);
@@ -453,78 +1155,108 @@ int32_t qem_smi_client_connect(const uint32_t timeout, const uint32_t max_attemp
 
 void qem_smi_client_disconnect(void)
 {
+    uint32_t i;
+    uint32_t j;
+    qem_smi_channel_t* ch;
+
     if(error_code == QEM_SMI_CONNECTED)
     {
         qem_smi_client_flush();
     }
-    
-    if(shared_buffer != NULL)
-    {
-        munmap(shared_buffer, shared_buffer_size);
-        shared_buffer = NULL;
-    }
 
-    if(shm_fd != -1)
+    for(j = 0; j < channel_count; ++j)
     {
-        close(shm_fd);
-        shm_unlink(QEM_SMI_SHM_NAME);
-        shm_fd = -1;
-    }
+        ch = &channels[j];
 
-    if(local_buffer != NULL)
-    {
-        free(local_buffer);
-        local_buffer = NULL;
-    }
+        if(ch->shared_buffer != NULL)
+        {
+            munmap(ch->shared_buffer, ch->shared_buffer_size);
+            ch->shared_buffer = NULL;
+        }
 
-    if(server_sem != SEM_FAILED)
-    {
-        sem_close(server_sem);
-        sem_unlink(QEM_SMI_SHARED_SEM_SERVER);
-        server_sem = SEM_FAILED;
-    }
-    if(client_sem != SEM_FAILED)
-    {
-        sem_close(client_sem);
-        sem_unlink(QEM_SMI_SHARED_SEM_CLIENT);
-        client_sem = SEM_FAILED;
-    }
+        if(ch->shm_fd != -1)
+        {
+            close(ch->shm_fd);
+            shm_unlink(get_name(ch, QEM_SMI_SHM_NAME));
+            ch->shm_fd = -1;
+        }
 
-    if(mon_lock != MAP_FAILED)
-    {
-        pthread_mutex_destroy(mon_lock);
-        munmap(mon_lock, sizeof(pthread_mutex_t));
-        mon_lock = (pthread_mutex_t*)MAP_FAILED;
-    }
-    if(mon_lock_fd != -1)
-    {
-        close(mon_lock_fd);
-        shm_unlink(QEM_SMI_SHARED_MUTEX);
-        mon_lock_fd = -1;
-    }
-    if(cond_read != MAP_FAILED)
-    {
-        pthread_cond_destroy(cond_read);
-        munmap(cond_read, sizeof(pthread_cond_t));
-        cond_read = (pthread_cond_t*)MAP_FAILED;
-    }
-    if(cond_read_fd != -1)
-    {
-        close(cond_read_fd);
-        shm_unlink(QEM_SMI_SHARED_COND_READ);
-        cond_read_fd = -1;
-    }
-    if(cond_write != MAP_FAILED)
-    {
-        pthread_cond_destroy(cond_write);
-        munmap(cond_write, sizeof(pthread_cond_t));
-        cond_write = (pthread_cond_t*)MAP_FAILED;
-    }
-    if(cond_write_fd != -1)
-    {
-        close(cond_write_fd);
-        shm_unlink(QEM_SMI_SHARED_COND_WRITE);
-        cond_write_fd = -1;
+        for(i = 0; i < QEM_SMI_LOCAL_BUFFER_COUNT; ++i)
+        {
+            if(ch->local_buffer[i] != NULL)
+            {
+                free(ch->local_buffer[i]);
+                ch->local_buffer[i] = NULL;
+            }
+            ch->local_buffer_index[i] = 0;
+            ch->local_buffer_msgs[i]  = 0;
+        }
+
+        if(ch->server_sem != SEM_FAILED)
+        {
+            sem_close(ch->server_sem);
+            sem_unlink(get_name(ch, QEM_SMI_SHARED_SEM_SERVER));
+            ch->server_sem = SEM_FAILED;
+        }
+        if(ch->client_sem != SEM_FAILED)
+        {
+            sem_close(ch->client_sem);
+            sem_unlink(get_name(ch, QEM_SMI_SHARED_SEM_CLIENT));
+            ch->client_sem = SEM_FAILED;
+        }
+
+        if(ch->mon_lock != MAP_FAILED)
+        {
+            pthread_mutex_destroy(ch->mon_lock);
+            munmap(ch->mon_lock, sizeof(pthread_mutex_t));
+            ch->mon_lock = (pthread_mutex_t*)MAP_FAILED;
+        }
+        if(ch->mon_lock_fd != -1)
+        {
+            close(ch->mon_lock_fd);
+            shm_unlink(get_name(ch, QEM_SMI_SHARED_MUTEX));
+            ch->mon_lock_fd = -1;
+        }
+        if(ch->cond_read != MAP_FAILED)
+        {
+            pthread_cond_destroy(ch->cond_read);
+            munmap(ch->cond_read, sizeof(pthread_cond_t));
+            ch->cond_read = (pthread_cond_t*)MAP_FAILED;
+        }
+        if(ch->cond_read_fd != -1)
+        {
+            close(ch->cond_read_fd);
+            shm_unlink(get_name(ch, QEM_SMI_SHARED_COND_READ));
+            ch->cond_read_fd = -1;
+        }
+        if(ch->cond_write != MAP_FAILED)
+        {
+            pthread_cond_destroy(ch->cond_write);
+            munmap(ch->cond_write, sizeof(pthread_cond_t));
+            ch->cond_write = (pthread_cond_t*)MAP_FAILED;
+        }
+        if(ch->cond_write_fd != -1)
+        {
+            close(ch->cond_write_fd);
+            shm_unlink(get_name(ch, QEM_SMI_SHARED_COND_WRITE));
+            ch->cond_write_fd = -1;
+        }
+
+#if QEM_SMI_EVENT_FD
+        if(ch->event_socket != -1)
+        {
+            close(ch->event_socket);
+            ch->event_socket = -1;
+        }
+        for(i = 0; i < QEM_SMI_MAX_READER_COUNT; ++i)
+        {
+            if(ch->event_fds[i] != -1)
+            {
+                close(ch->event_fds[i]);
+                ch->event_fds[i] = -1;
+            }
+        }
+#endif
     }
 
     pthread_condattr_destroy(&cond_read_attr);
@@ -534,162 +1266,182 @@ void qem_smi_client_disconnect(void)
     error_code = QEM_SMI_UNINIT;
 }
 
-int32_t qem_smi_client_send(const void* buffer, const uint32_t size)
+/* Sends the data through the local buffer of a partition of a channel. The
+ * local lock must be held.
+ */
+static int32_t send_partition(qem_smi_channel_t* ch, const uint32_t partition,
+                              const void* buffer, const uint32_t size)
 {
     uint32_t write_size = 0;
     uint32_t to_write   = 0;
     uint32_t wrote     = 0;
-    uint32_t blocks    = 0;
+    uint8_t* lbuffer;
 
-    if(error_code != QEM_SMI_CONNECTED)
+    lbuffer = ch->local_buffer[partition];
+
+#if QEM_SMI_WHOLE_MESSAGES
+    /* A reader may not get all the blocks, messages cannot be split */
+    if(size > block_size)
     {
-        QEM_TRACE_ERROR("You must connect the SMI before calling send",
-                        0, 0);
+        QEM_TRACE_ERROR("Message does not fit in a SMI block", size, 0);
         return -1;
     }
-
-    if(buffer == NULL)
+    if(ch->local_buffer_index[partition] + size > block_size)
     {
-        QEM_TRACE_ERROR("Buffer cannot be NULL", 0, 0);
-        return -1;
+        write_block(ch, lbuffer, ch->local_buffer_index[partition], partition,
+                    ch->local_buffer_msgs[partition]);
+        ch->local_buffer_index[partition] = 0;
+        ch->local_buffer_msgs[partition]  = 0;
     }
+#endif
 
     /* Check if we can write to the local buffer */
     write_size = size;
-    while(local_buffer_index + write_size > block_size)
+    while(ch->local_buffer_index[partition] + write_size > block_size)
     {
         /* Write as much as we can */
-        to_write = block_size - local_buffer_index;
-        memcpy(local_buffer + local_buffer_index, 
-               (uint8_t*)buffer + wrote, 
+        to_write = block_size - ch->local_buffer_index[partition];
+        memcpy(lbuffer + ch->local_buffer_index[partition],
+               (uint8_t*)buffer + wrote,
                to_write);
-        wrote += to_write;         
+        wrote += to_write;
         write_size -= to_write;
-        local_buffer_index = 0;
-        
-        pthread_mutex_lock(mon_lock);
-
-        /* Check if the block is free */
-        memcpy(&blocks, 
-               shared_buffer + QEM_SMI_META_BLOCK_MASK_OFFSET, 
-               QEM_SMI_META_BLOCK_MASK_SIZE);
-
-        while((blocks & (1 << next_block)) != 0)
-        {
-            pthread_cond_wait(cond_write, mon_lock);
-            memcpy(&blocks, 
-               shared_buffer + QEM_SMI_META_BLOCK_MASK_OFFSET, 
-               QEM_SMI_META_BLOCK_MASK_SIZE);
-        }
-
-        pthread_mutex_unlock(mon_lock);
-
-        /* This part does not need to be locked as the other end cannot access
-         * it before it is set as used in the block mask.
-         */
-        /* Copy the local buffer to the shared buffer */
-        memcpy(shared_buffer_data + 
-                    next_block * block_size,
-              local_buffer,
-              block_size);
-
-        /* Update metadata */
-        pthread_mutex_lock(mon_lock);
+        ch->local_buffer_index[partition] = 0;
 
-
-        memcpy(&blocks, 
-               shared_buffer + QEM_SMI_META_BLOCK_MASK_OFFSET, 
-               QEM_SMI_META_BLOCK_MASK_SIZE);
-        blocks |= 1 << next_block;
-
-        memcpy(shared_buffer + QEM_SMI_META_BLOCK_MASK_OFFSET,
-               &blocks, 
-               QEM_SMI_META_BLOCK_MASK_SIZE);
-        next_block = (next_block + 1) % block_count;
-
-        pthread_cond_signal(cond_read);
-
-        pthread_mutex_unlock(mon_lock);
+        write_block(ch, lbuffer, block_size, partition,
+                    ch->local_buffer_msgs[partition]);
+        ch->local_buffer_msgs[partition] = 0;
     }
 
     /* If there is some rest to write */
     if(write_size != 0)
     {
-        memcpy(local_buffer + local_buffer_index, 
-               (uint8_t*)buffer + wrote, 
+        memcpy(lbuffer + ch->local_buffer_index[partition],
+               (uint8_t*)buffer + wrote,
                write_size);
-        local_buffer_index += write_size;
+        ch->local_buffer_index[partition] += write_size;
     }
+    ++ch->local_buffer_msgs[partition];
 
     return 0;
 }
 
-int32_t qem_smi_client_flush(void)
+int32_t qem_smi_client_send(const void* buffer, const uint32_t size)
 {
-    uint32_t blocks;
+    return qem_smi_client_send_core(0, 0, buffer, size);
+}
+
+int32_t qem_smi_client_send_keyed(const uint64_t key, const void* buffer,
+                                  const uint32_t size)
+{
+    return qem_smi_client_send_core(0, key, buffer, size);
+}
+
+int32_t qem_smi_client_send_core(const uint32_t core, const uint64_t key,
+                                 const void* buffer, const uint32_t size)
+{
+    int32_t            error;
+    uint32_t           partition;
+    qem_smi_channel_t* ch;
 
     if(error_code != QEM_SMI_CONNECTED)
     {
-        QEM_TRACE_ERROR("You must connect the SMI before calling flush", 0, 0);
+        QEM_TRACE_ERROR("You must connect the SMI before calling send",
+                        0, 0);
         return -1;
     }
 
-    if(local_buffer_index == 0)
+    if(buffer == NULL)
     {
-        return 0;
+        QEM_TRACE_ERROR("Buffer cannot be NULL", 0, 0);
+        return -1;
     }
-        
-    pthread_mutex_lock(mon_lock);
 
-    /* Check if the block is free */
-    memcpy(&blocks, 
-            shared_buffer + QEM_SMI_META_BLOCK_MASK_OFFSET, 
-            QEM_SMI_META_BLOCK_MASK_SIZE);
-    while((blocks & (1 << next_block)) != 0)
+#if QEM_SMI_DISPATCH == QEM_SMI_DISPATCH_HASH
+    /* Plain modulo keeps the neighbouring lines and pages spread evenly */
+    partition = (key >> QEM_SMI_HASH_SHIFT) % QEM_SMI_READER_COUNT;
+#else
+    (void)key;
+    partition = 0;
+#endif
+
+    /* Each core owns its channel unless there are more cores than channels */
+    ch = &channels[core % channel_count];
+
+    lock_channel(ch);
+    error = send_partition(ch, partition, buffer, size);
+    unlock_channel(ch);
+
+    return error;
+}
+
+int32_t qem_smi_client_send_all(const void* buffer, const uint32_t size)
+{
+    int32_t            error;
+    uint32_t           i;
+    qem_smi_channel_t* ch;
+
+    if(error_code != QEM_SMI_CONNECTED)
     {
-        pthread_cond_wait(cond_write, mon_lock);
-        memcpy(&blocks, 
-               shared_buffer + QEM_SMI_META_BLOCK_MASK_OFFSET, 
-               QEM_SMI_META_BLOCK_MASK_SIZE);
+        QEM_TRACE_ERROR("You must connect the SMI before calling send",
+                        0, 0);
+        return -1;
     }
-    
-    pthread_mutex_unlock(mon_lock);
 
-    /* This part does not need to be locked as the other end cannot access
-        * it before it is set as used in the block mask.
-        */
-    /* Copy the local buffer to the shared buffer */
-    memset(shared_buffer_data + 
-                next_block * block_size,
-            0,
-            block_size);
-
-    memcpy(shared_buffer_data + 
-                next_block * block_size,
-            local_buffer,
-            local_buffer_index);
+#if QEM_SMI_WHOLE_MESSAGES == 0
+    if(buffer == NULL)
+    {
+        QEM_TRACE_ERROR("Buffer cannot be NULL", 0, 0);
+        return -1;
+    }
+#else
+    if(buffer == NULL || size > block_size)
+    {
+        QEM_TRACE_ERROR("Cannot send message to all the SMI readers", size, 0);
+        return -1;
+    }
+#endif
 
-    /* Update metadata */
-    pthread_mutex_lock(mon_lock);
+    /* The message is sent on every channel */
+    error = 0;
+    for(i = 0; i < channel_count && error == 0; ++i)
+    {
+        ch = &channels[i];
+
+        lock_channel(ch);
+#if QEM_SMI_WHOLE_MESSAGES == 0
+        error = send_partition(ch, 0, buffer, size);
+#else
+        /* Keep the message ordered after the pending data */
+        flush_channel(ch);
+        write_block(ch, (const uint8_t*)buffer, size, QEM_SMI_ALL_READERS, 1);
+#endif
+        unlock_channel(ch);
+    }
 
-    memcpy(&blocks, 
-            shared_buffer + QEM_SMI_META_BLOCK_MASK_OFFSET, 
-            QEM_SMI_META_BLOCK_MASK_SIZE);
-    blocks |= 1 << next_block;
-    memcpy(shared_buffer + QEM_SMI_META_BLOCK_MASK_OFFSET,
-            &blocks, 
-            QEM_SMI_META_BLOCK_MASK_SIZE);
-    next_block = (next_block + 1) % block_count;
+    return error;
+}
 
-    pthread_cond_signal(cond_read);
+int32_t qem_smi_client_flush(void)
+{
+    uint32_t i;
 
-    pthread_mutex_unlock(mon_lock);
+    if(error_code != QEM_SMI_CONNECTED)
+    {
+        QEM_TRACE_ERROR("You must connect the SMI before calling flush", 0, 0);
+        return -1;
+    }
 
-    local_buffer_index = 0;
+    for(i = 0; i < channel_count; ++i)
+    {
+        lock_channel(&channels[i]);
+        flush_channel(&channels[i]);
+        unlock_channel(&channels[i]);
+    }
 
     return 0;
 }
 
 #endif /* QEM_TRACE_TYPE == QEM_TRACE_SMI */
 
-#endif /* QEM_TRACE_ENABLED */
\ No newline at end of file
+#endif /* QEM_TRACE_ENABLED */
@@ -44,14 +44,54 @@
 #define QEM_SMI_SHARED_MUTEX      "/QEM_SMI_MUTEX"
 #define QEM_SMI_SHARED_COND_READ  "/QEM_SMI_COND_READ"
 #define QEM_SMI_SHARED_COND_WRITE "/QEM_SMI_COND_WRITE"
+#define QEM_SMI_SHARED_SOCKET     "/QEM_SMI_SOCKET"
+
+/* Sessions, the session name is appended to the shared objects names so that
+ * several traced guests can run at the same time.
+ */
+#define QEM_SMI_SESSION_ENV       "QEM_SMI_SESSION"
+#define QEM_SMI_SESSION_MAX       32
+#define QEM_SMI_NAME_MAX          64
 
 #define QEM_SMI_HANDSHAKE_MAGIC   0xDEADCAFE
 
 /* Buffer representation */
 /*
- * #----------|-----------|-----------|-----------------------#
- * | BCNT 16b | BMASK 16b | BSIZE 32b | Buffer 1 ... Buffer n |
- * #----------|-----------|-----------|-----------------------#
+ * #----------|-----------|-----------|-----------|-----------|-------------#
+ * | BCNT 16b | BMASK 16b | BSIZE 32b | RMASK 16b | EMASK 16b | BPEND 16b*n |
+ * #----------|-----------|-----------|-----------|-----------|-------------#
+ * #-------------|--------------|---------------|-----------|-------------|
+ * | BSEQ 32b*n  | BUSED 32b*n  | BDROP 32b*n*r | DROPS 32b | RDROP 32b*r |
+ * #-------------|--------------|---------------|-----------|-------------|
+ * #-------------|----------|---------#
+ * | RPID 32b*r  | CCNT 32b | CID 32b |
+ * #-------------|----------|---------#
+ * #-----------------------#
+ * | Buffer 1 ... Buffer n |
+ * #-----------------------#
+ *
+ * RMASK is the mask of the registered readers (1 reader per bit), EMASK the
+ * mask of the readers detached by the server and BPEND the mask of the readers
+ * that still have to release each block. A block is recycled once its BPEND
+ * entry is cleared, BMASK is kept as the summary of the non empty BPEND
+ * entries.
+ * BSEQ is the sequence number of each block (starting at 1) and BUSED the
+ * number of bytes of the block that contain data. Readers always consume their
+ * blocks in sequence order.
+ * DROPS is the total number of messages dropped since the stream started and
+ * RDROP the number of them lost by each reader slot: the messages of a block
+ * dropped while it would have been handed to the reader, or of a block taken
+ * back before the reader released it. A slot counter is reset when a reader
+ * registers in the slot. BDROP holds the value of RDROP of each slot when
+ * each block was committed, the difference between two blocks a reader
+ * receives gives the number of messages it lost between them.
+ * RPID is the process identifier of the reader registered in each slot, set
+ * before the reader ends its handshake when it sends an event descriptor to
+ * the server and 0 otherwise. The server only accepts a descriptor for a slot
+ * from that process.
+ * CCNT is the number of channels of the session and CID the index of the
+ * channel owning the buffer. Each channel has its own shared objects, the
+ * first one uses the session names and channel n appends ".n" to them.
  */
 
 /** WARNING Block count must be set accordingly to the size of the block mask.
@@ -59,6 +99,13 @@
  */
 #define QEM_SMI_DATA_FIRST_BUFFER_OFFSET SMI_DATA_BUFFER_META_DATA_SIZE
 
+/* Maximal number of blocks and readers, bounded by the masks size */
+#define QEM_SMI_MAX_BLOCK_COUNT  16
+#define QEM_SMI_MAX_READER_COUNT 16
+
+/* Maximal number of channels of a session */
+#define QEM_SMI_MAX_CHANNEL_COUNT 16
+
 #define QEM_SMI_META_BLOCK_COUNT_OFFSET 0
 #define QEM_SMI_META_BLOCK_COUNT_SIZE   2
 
@@ -70,8 +117,88 @@
 (QEM_SMI_META_BLOCK_MASK_OFFSET + QEM_SMI_META_BLOCK_MASK_SIZE)
 #define QEM_SMI_META_BLOCK_SIZE_SIZE    4
 
-#define QEM_SMI_DATA_BUFFER_META_DATA_SIZE \
+#define QEM_SMI_META_READER_MASK_OFFSET \
 (QEM_SMI_META_BLOCK_SIZE_OFFSET + QEM_SMI_META_BLOCK_SIZE_SIZE)
+#define QEM_SMI_META_READER_MASK_SIZE   2
+
+#define QEM_SMI_META_EVICT_MASK_OFFSET \
+(QEM_SMI_META_READER_MASK_OFFSET + QEM_SMI_META_READER_MASK_SIZE)
+#define QEM_SMI_META_EVICT_MASK_SIZE    2
+
+#define QEM_SMI_META_BLOCK_PEND_OFFSET \
+(QEM_SMI_META_EVICT_MASK_OFFSET + QEM_SMI_META_EVICT_MASK_SIZE)
+#define QEM_SMI_META_BLOCK_PEND_SIZE    2
+
+#define QEM_SMI_META_BLOCK_SEQ_OFFSET \
+(QEM_SMI_META_BLOCK_PEND_OFFSET + \
+ QEM_SMI_MAX_BLOCK_COUNT * QEM_SMI_META_BLOCK_PEND_SIZE)
+#define QEM_SMI_META_BLOCK_SEQ_SIZE     4
+
+#define QEM_SMI_META_BLOCK_USED_OFFSET \
+(QEM_SMI_META_BLOCK_SEQ_OFFSET + \
+ QEM_SMI_MAX_BLOCK_COUNT * QEM_SMI_META_BLOCK_SEQ_SIZE)
+#define QEM_SMI_META_BLOCK_USED_SIZE    4
+
+#define QEM_SMI_META_BLOCK_DROP_OFFSET \
+(QEM_SMI_META_BLOCK_USED_OFFSET + \
+ QEM_SMI_MAX_BLOCK_COUNT * QEM_SMI_META_BLOCK_USED_SIZE)
+#define QEM_SMI_META_BLOCK_DROP_SIZE    4
+
+#define QEM_SMI_META_DROP_COUNT_OFFSET \
+(QEM_SMI_META_BLOCK_DROP_OFFSET + \
+ QEM_SMI_MAX_BLOCK_COUNT * QEM_SMI_MAX_READER_COUNT * \
+ QEM_SMI_META_BLOCK_DROP_SIZE)
+#define QEM_SMI_META_DROP_COUNT_SIZE    4
+
+#define QEM_SMI_META_READER_DROP_OFFSET \
+(QEM_SMI_META_DROP_COUNT_OFFSET + QEM_SMI_META_DROP_COUNT_SIZE)
+#define QEM_SMI_META_READER_DROP_SIZE   4
+
+#define QEM_SMI_META_READER_PID_OFFSET \
+(QEM_SMI_META_READER_DROP_OFFSET + \
+ QEM_SMI_MAX_READER_COUNT * QEM_SMI_META_READER_DROP_SIZE)
+#define QEM_SMI_META_READER_PID_SIZE    4
+
+#define QEM_SMI_META_CHANNEL_COUNT_OFFSET \
+(QEM_SMI_META_READER_PID_OFFSET + \
+ QEM_SMI_MAX_READER_COUNT * QEM_SMI_META_READER_PID_SIZE)
+#define QEM_SMI_META_CHANNEL_COUNT_SIZE 4
+
+#define QEM_SMI_META_CHANNEL_ID_OFFSET \
+(QEM_SMI_META_CHANNEL_COUNT_OFFSET + QEM_SMI_META_CHANNEL_COUNT_SIZE)
+#define QEM_SMI_META_CHANNEL_ID_SIZE    4
+
+/* Offset of the per block metadata */
+#define QEM_SMI_META_BLOCK_PEND(BLOCK) \
+(QEM_SMI_META_BLOCK_PEND_OFFSET + (BLOCK) * QEM_SMI_META_BLOCK_PEND_SIZE)
+#define QEM_SMI_META_BLOCK_SEQ(BLOCK) \
+(QEM_SMI_META_BLOCK_SEQ_OFFSET + (BLOCK) * QEM_SMI_META_BLOCK_SEQ_SIZE)
+#define QEM_SMI_META_BLOCK_USED(BLOCK) \
+(QEM_SMI_META_BLOCK_USED_OFFSET + (BLOCK) * QEM_SMI_META_BLOCK_USED_SIZE)
+#define QEM_SMI_META_BLOCK_DROP(BLOCK, READER) \
+(QEM_SMI_META_BLOCK_DROP_OFFSET + \
+ ((BLOCK) * QEM_SMI_MAX_READER_COUNT + (READER)) * \
+ QEM_SMI_META_BLOCK_DROP_SIZE)
+
+/* Offset of the per reader metadata */
+#define QEM_SMI_META_READER_DROP(READER) \
+(QEM_SMI_META_READER_DROP_OFFSET + (READER) * QEM_SMI_META_READER_DROP_SIZE)
+#define QEM_SMI_META_READER_PID(READER) \
+(QEM_SMI_META_READER_PID_OFFSET + (READER) * QEM_SMI_META_READER_PID_SIZE)
+
+#define QEM_SMI_DATA_BUFFER_META_DATA_SIZE \
+(QEM_SMI_META_CHANNEL_ID_OFFSET + QEM_SMI_META_CHANNEL_ID_SIZE)
+
+#if QEM_SMI_BLOCK_COUNT > QEM_SMI_MAX_BLOCK_COUNT
+#error "QEM_SMI_BLOCK_COUNT cannot be greater than QEM_SMI_MAX_BLOCK_COUNT"
+#endif
+#if QEM_SMI_READER_COUNT > QEM_SMI_MAX_READER_COUNT || QEM_SMI_READER_COUNT < 1
+#error "QEM_SMI_READER_COUNT must be between 1 and QEM_SMI_MAX_READER_COUNT"
+#endif
+#if QEM_SMI_CHANNEL_COUNT > QEM_SMI_MAX_CHANNEL_COUNT || \
+    QEM_SMI_CHANNEL_COUNT < 0
+#error "QEM_SMI_CHANNEL_COUNT must be between 0 and QEM_SMI_MAX_CHANNEL_COUNT"
+#endif
 
 /*******************************************************************************
  * STRUCTURES
@@ -101,10 +228,14 @@ typedef enum
 /**
  * @brief Initializes the SMI. 
  * 
+ * @param[in] core_count The number of cores sending messages. When
+ * QEM_SMI_CHANNEL_COUNT is 0, one channel is created per core (at most
+ * QEM_SMI_MAX_CHANNEL_COUNT).
+ * 
  * @returns -1 is returned in case of error during the communication. 0 is 
  * returned otherwise.
  */
-int32_t qem_smi_client_init(void);
+int32_t qem_smi_client_init(const uint32_t core_count);
 
 /**
  * @brief Connect the SMI server with the client. 
@@ -155,10 +286,57 @@ int32_t qem_smi_client_receive(void* buffer, const uint32_t size);
 int32_t qem_smi_client_send(const void* buffer, const uint32_t size);
 
 /**
- * @brief Flushed the content of the local buffer to the shared 
+ * @brief Sent a message to the SMI reader in charge of the key. When the
+ * dispatch mode is not QEM_SMI_DISPATCH_HASH, the key is ignored and the
+ * function behaves as qem_smi_client_send.
+ * 
+ * @param[in] key The key used to select the reader (usually an address).
+ * @param[in] buffer The buffer containing the data to be sent.
+ * @param[in] size The size of the data to be sent in bytes.
+ * 
+ * @returns -1 is returned in case of error during the communication. 0 is 
+ * returned otherwise.
+ */
+int32_t qem_smi_client_send_keyed(const uint64_t key, const void* buffer, 
+                                  const uint32_t size);
+
+/**
+ * @brief Sent a message on the SMI channel of a core. The channel is selected
+ * as core % channel count. When each core has its own channel, the message is
+ * sent without taking any lock and only the thread running the core may send
+ * on the channel. When cores share a channel, they take its lock. The key
+ * selects the reader as in qem_smi_client_send_keyed.
+ * 
+ * @param[in] core The index of the core that produced the message.
+ * @param[in] key The key used to select the reader (usually an address).
+ * @param[in] buffer The buffer containing the data to be sent.
+ * @param[in] size The size of the data to be sent in bytes.
+ * 
+ * @returns -1 is returned in case of error during the communication. 0 is 
+ * returned otherwise.
+ */
+int32_t qem_smi_client_send_core(const uint32_t core, const uint64_t key,
+                                 const void* buffer, const uint32_t size);
+
+/**
+ * @brief Sent a message to all the SMI readers of all the channels, whatever
+ * the dispatch mode.
+ * The pending data of the local buffers is flushed before the message. The
+ * cores sending on the channels must be stopped.
+ * 
+ * @param[in] buffer The buffer containing the data to be sent.
+ * @param[in] size The size of the data to be sent in bytes.
+ * 
+ * @returns -1 is returned in case of error during the communication. 0 is 
+ * returned otherwise.
+ */
+int32_t qem_smi_client_send_all(const void* buffer, const uint32_t size);
+
+/**
+ * @brief Flushed the content of the local buffers to the shared 
  * buffer.
  * This function will block until the next block in the buffer is 
- * free.
+ * free. The cores sending on the channels must be stopped.
  */
 int32_t qem_smi_client_flush(void);
 
@@ -0,0 +1,323 @@
+/*
+ * Guest memory access tracing string coalescing.
+ *
+ * Provides the per core blocks merging the accesses of the repeated string
+ * instructions before they enter the trace output.
+ *
+ *  Copyright (c) 2019 Alexy Torres Aurora Dugo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "qem_trace_config.h" /* QEM Trace configuration */
+
+#if QEM_TRACE_ENABLED
+
+#if QEM_TRACE_STRING_ENABLED
+
+#include "qemu/osdep.h"
+#include "cpu.h"
+
+#include "qem_trace_engine.h" /* Engine header */
+#include "qem_trace_def.h"    /* Trace format */
+#include "qem_trace_string.h" /* String coalescing header */
+
+/*******************************************************************************
+ * STRUCTURES
+ ******************************************************************************/
+
+/* Elements of one memory operand merged and not yet output. */
+typedef struct
+{
+    /* First element of the block. */
+    uint64_t virt;
+    uint64_t phys;
+    /* Distance between two elements. */
+    int64_t  stride;
+    /* Flags shared by the elements. */
+    uint32_t flags;
+    /* Access type and size of the elements. */
+    uint32_t kind;
+    /* Number of elements. */
+    uint32_t count;
+} qem_trace_block_t;
+
+/* Blocks of a core, only accessed by the thread running the core and by the
+ * flush when tracing stops.
+ */
+typedef struct
+{
+    qem_trace_block_t blocks[QEM_TRACE_STRING_SLOTS];
+    /* Fetches of the instruction not output while the blocks are open, the
+     * fetch of the next iteration is counted once the elements of an
+     * iteration are merged.
+     */
+    qem_trace_block_t fetch;
+    /* Last instruction fetched by the core. */
+    uint64_t          pc;
+    /* 1 when the first fetch of the instruction was traced. */
+    uint32_t          traced;
+    /* Timestamp of the first element of the blocks. */
+    uint64_t          time;
+    /* Number of open blocks, 0 when the core has no block. */
+    uint32_t          slots;
+} qem_trace_string_t;
+
+/*******************************************************************************
+ * GLOBAL VARS
+ ******************************************************************************/
+
+/* Current blocks of the cores */
+static qem_trace_string_t strings[QEM_TRACE_STRING_MAX_CORES];
+
+/*******************************************************************************
+ * FUNCTIONS
+ ******************************************************************************/
+
+/* Outputs the blocks and closes them, single elements are output unchanged.
+ * The fetch block follows the operands blocks, the fetch of each iteration is
+ * then expanded after the elements of the previous iteration.
+ */
+static void string_output(qem_trace_string_t* string, const uint32_t core)
+{
+    qem_trace_block_t* blocks[QEM_TRACE_STRING_SLOTS + 1];
+    qem_trace_block_t* block;
+    uint32_t           count;
+    uint32_t           single;
+    uint32_t           i;
+
+    count = 0;
+    for(i = 0; i < string->slots; ++i)
+    {
+        blocks[count++] = &string->blocks[i];
+    }
+    if(string->fetch.count != 0)
+    {
+        blocks[count++] = &string->fetch;
+    }
+
+    single = 1;
+    for(i = 0; i < count; ++i)
+    {
+        single &= (blocks[i]->count == 1);
+    }
+
+    for(i = 0; i < count; ++i)
+    {
+        block = blocks[i];
+        if(single != 0)
+        {
+            qem_trace_output(block->virt, block->phys, core, string->time,
+                             block->flags);
+            continue;
+        }
+
+        qem_trace_output(block->virt, block->phys, core, string->time,
+                         block->flags | QEM_TRACE_STRING_RANGE_START);
+        qem_trace_output(block->count, block->count, core,
+                         (uint64_t)block->stride,
+                         block->flags | ((i + 1 < count) ?
+                                         QEM_TRACE_STRING_RANGE_LINKED :
+                                         QEM_TRACE_STRING_RANGE_COUNT));
+    }
+    string->slots       = 0;
+    string->fetch.count = 0;
+}
+
+uint8_t qem_trace_string_extend(const uint32_t core, const uint64_t virt_addr,
+                                const uint32_t slot, const uint32_t kind)
+{
+    qem_trace_block_t* block;
+    uint64_t           next;
+
+    if(core >= QEM_TRACE_STRING_MAX_CORES || slot >= strings[core].slots)
+    {
+        return 0;
+    }
+    block = &strings[core].blocks[slot];
+
+    /* The element must follow the last one on the same page */
+    next = block->virt + block->count * block->stride;
+    if(block->kind != kind || virt_addr != next ||
+       (virt_addr & TARGET_PAGE_MASK) != (block->virt & TARGET_PAGE_MASK))
+    {
+        return 0;
+    }
+
+    /* An element filtered out ends the block, the caller drops it */
+    if(qem_trace_filter_phys(block->phys + block->count * block->stride) == 0)
+    {
+        return 0;
+    }
+
+    ++block->count;
+    return 1;
+}
+
+void qem_trace_string_start(const uint32_t core, const uint64_t virt_addr,
+                            const uint64_t phys_addr, const uint64_t time,
+                            const uint32_t flags, const uint32_t slot,
+                            const uint32_t kind, const int64_t stride)
+{
+    qem_trace_string_t* string;
+    qem_trace_block_t*  block;
+    uint32_t            i;
+    uint8_t             append;
+
+    if(core >= QEM_TRACE_STRING_MAX_CORES || slot >= QEM_TRACE_STRING_SLOTS)
+    {
+        qem_trace_string_end(core);
+        qem_trace_output(virt_addr, phys_addr, core, time, flags);
+        return;
+    }
+    string = &strings[core];
+
+    /* The operands before the element are already merged for this
+     * iteration, the element is only appended when they are in their first
+     * iteration.
+     */
+    append = (slot == string->slots);
+    for(i = 0; i < slot && i < string->slots; ++i)
+    {
+        append &= (string->blocks[i].count == 1);
+    }
+
+    if(slot > string->slots)
+    {
+        /* The first operands were not traced */
+        string_output(string, core);
+        qem_trace_output(virt_addr, phys_addr, core, time, flags);
+        return;
+    }
+    else if(slot == 0)
+    {
+        string_output(string, core);
+    }
+    else if(append == 0)
+    {
+        for(i = 0; i < slot && slot < string->slots; ++i)
+        {
+            if(string->blocks[i].count <= string->blocks[slot].count)
+            {
+                /* The first operands were not traced in this iteration */
+                string_output(string, core);
+                qem_trace_output(virt_addr, phys_addr, core, time, flags);
+                return;
+            }
+        }
+
+        /* Close the blocks at the previous iteration, the operands before the
+         * element start the next blocks with their last element.
+         */
+        for(i = 0; i < slot; ++i)
+        {
+            --string->blocks[i].count;
+        }
+        string_output(string, core);
+        for(i = 0; i < slot; ++i)
+        {
+            block          = &string->blocks[i];
+            block->virt   += block->count * block->stride;
+            block->phys   += block->count * block->stride;
+            block->count   = 1;
+        }
+        string->slots = slot;
+        string->time  = time;
+    }
+
+    if(string->slots == 0)
+    {
+        string->time = time;
+    }
+
+    block         = &string->blocks[slot];
+    block->virt   = virt_addr;
+    block->phys   = phys_addr;
+    block->stride = stride;
+    block->flags  = flags;
+    block->kind   = kind;
+    block->count  = 1;
+    string->slots = slot + 1;
+}
+
+uint8_t qem_trace_string_fetch(const uint32_t core, const uint64_t addr)
+{
+    if(core >= QEM_TRACE_STRING_MAX_CORES)
+    {
+        return 0;
+    }
+
+    /* A new iteration of the instruction keeps its blocks open */
+    if(strings[core].slots != 0 && strings[core].pc == addr)
+    {
+        strings[core].fetch.count += strings[core].traced;
+        return 1;
+    }
+
+    string_output(&strings[core], core);
+    strings[core].pc     = addr;
+    strings[core].traced = 0;
+    return 0;
+}
+
+void qem_trace_string_fetch_traced(const uint32_t core,
+                                   const uint64_t virt_addr,
+                                   const uint64_t phys_addr,
+                                   const uint32_t flags)
+{
+    qem_trace_block_t* fetch;
+
+    if(core >= QEM_TRACE_STRING_MAX_CORES)
+    {
+        return;
+    }
+    fetch = &strings[core].fetch;
+
+    fetch->virt   = virt_addr;
+    fetch->phys   = phys_addr;
+    fetch->stride = 0;
+    fetch->flags  = flags;
+    fetch->kind   = 0;
+    fetch->count  = 0;
+
+    strings[core].traced = 1;
+}
+
+void qem_trace_string_end(const uint32_t core)
+{
+    if(core < QEM_TRACE_STRING_MAX_CORES)
+    {
+        string_output(&strings[core], core);
+    }
+}
+
+void qem_trace_string_flush(void)
+{
+    CPUState* cpu;
+    uint32_t  core;
+
+    /* The other cores extend their blocks until they are stopped */
+    cpu = qem_trace_exclusive_start();
+
+    for(core = 0; core < QEM_TRACE_STRING_MAX_CORES; ++core)
+    {
+        string_output(&strings[core], core);
+    }
+
+    qem_trace_exclusive_end(cpu);
+}
+
+#endif /* QEM_TRACE_STRING_ENABLED */
+
+#endif /* QEM_TRACE_ENABLED */
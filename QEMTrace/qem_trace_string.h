@@ -0,0 +1,142 @@
+/*
+ * Guest memory access tracing string coalescing.
+ *
+ * Provides the merging of the accesses of the repeated string instructions of
+ * a core into block records. The translators give each memory operand of a
+ * string instruction a slot, the elements of a slot following each other on
+ * the same page are merged in the slot block.
+ *
+ * Header included in
+ *     qem_trace_engine.h
+ *
+ *  Copyright (c) 2019 Alexy Torres Aurora Dugo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __QEM_TRACE_STRING_H_
+#define __QEM_TRACE_STRING_H_
+
+#include "qem_trace_config.h" /* QEM Trace configuration */
+
+#if QEM_TRACE_ENABLED
+
+#include <stdint.h> /* Generic types */
+
+/*******************************************************************************
+ * CONSTANTS
+ ******************************************************************************/
+
+/* Number of cores merging their string accesses, the accesses of the cores
+ * above are not merged.
+ */
+#define QEM_TRACE_STRING_MAX_CORES 64
+
+/* Number of memory operands of a string instruction */
+#define QEM_TRACE_STRING_SLOTS 2
+
+#if QEM_TRACE_STRING_ENABLED
+#if QEM_TRACE_GATHER_META == 0
+#error "QEM_TRACE_STRING_ENABLED requires QEM_TRACE_GATHER_META"
+#endif
+#if QEM_TRACE_TYPE == QEM_TRACE_AGGREGATE
+#error "QEM_TRACE_STRING_ENABLED cannot be used with QEM_TRACE_AGGREGATE"
+#endif
+#if QEM_TRACE_CACHE_FILTER_ENABLED
+#error "QEM_TRACE_STRING_ENABLED cannot be used with the cache filter"
+#endif
+#endif
+
+/*******************************************************************************
+ * FUNCTIONS
+ ******************************************************************************/
+
+#if QEM_TRACE_STRING_ENABLED
+
+/* Returns 1 if the element follows the last element of its slot block on the
+ * same page and its physical address is traced, it is then merged in the block
+ * and must not be output. Returns 0 otherwise, the element must then be given
+ * to qem_trace_string_start if it passes the filters.
+ *
+ * @param core The core accessing the element.
+ * @param virt_addr The virtual address of the element.
+ * @param slot The memory operand of the instruction.
+ * @param kind The access type and size of the element.
+ */
+uint8_t qem_trace_string_extend(const uint32_t core, const uint64_t virt_addr,
+                                const uint32_t slot, const uint32_t kind);
+
+/* Starts a new slot block with the element. The blocks of the core are output
+ * first when the element cannot be added to them.
+ *
+ * @param core The core accessing the element.
+ * @param virt_addr The virtual address of the element.
+ * @param phys_addr The physical address of the element.
+ * @param time The element timestamp.
+ * @param flags The element flags.
+ * @param slot The memory operand of the instruction.
+ * @param kind The access type and size of the element.
+ * @param stride The signed distance to the next element.
+ */
+void qem_trace_string_start(const uint32_t core, const uint64_t virt_addr,
+                            const uint64_t phys_addr, const uint64_t time,
+                            const uint32_t flags, const uint32_t slot,
+                            const uint32_t kind, const int64_t stride);
+
+/* Returns 1 if the instruction fetch is a new iteration of the string
+ * instruction of the core blocks, it must then not be output: it is counted
+ * in the fetch block output after the blocks of the operands. Otherwise the
+ * blocks of the core are output and 0 is returned.
+ *
+ * @param core The core fetching the instruction.
+ * @param addr The virtual address of the instruction.
+ */
+uint8_t qem_trace_string_fetch(const uint32_t core, const uint64_t addr);
+
+/* Keeps the record of the fetch qem_trace_string_fetch did not merge, the
+ * next iterations of the instruction are only counted when it was traced.
+ *
+ * @param core The core fetching the instruction.
+ * @param virt_addr The virtual address of the instruction.
+ * @param phys_addr The physical address of the instruction.
+ * @param flags The fetch flags.
+ */
+void qem_trace_string_fetch_traced(const uint32_t core,
+                                   const uint64_t virt_addr,
+                                   const uint64_t phys_addr,
+                                   const uint32_t flags);
+
+/* Outputs the blocks of the core, called before any other record of the core.
+ *
+ * @param core The core outputting a record.
+ */
+void qem_trace_string_end(const uint32_t core);
+
+/* Outputs the blocks not yet output, called when tracing stops. The other
+ * cores are stopped while their blocks are output.
+ */
+void qem_trace_string_flush(void);
+
+#else
+
+#define qem_trace_string_fetch(core, addr) 0
+#define qem_trace_string_fetch_traced(core, virt_addr, phys_addr, flags)
+#define qem_trace_string_end(core)
+#define qem_trace_string_flush()
+
+#endif /* QEM_TRACE_STRING_ENABLED */
+
+#endif /* QEM_TRACE_ENABLED */
+
+#endif /* __QEM_TRACE_STRING_H_ */
@@ -0,0 +1,91 @@
+/*
+ * Guest memory access tracing timestamps.
+ *
+ * Provides the timestamp of the records built by the helpers, read from the
+ * source selected by QEM_TRACE_TIME_SOURCE.
+ *
+ * Header included in
+ *     qem_trace_engine.h
+ *
+ *  Copyright (c) 2019 Alexy Torres Aurora Dugo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __QEM_TRACE_TIME_H_
+#define __QEM_TRACE_TIME_H_
+
+#include "qem_trace_config.h" /* QEM Trace configuration */
+
+#if QEM_TRACE_ENABLED
+
+#include <stdint.h> /* Generic types */
+
+#if QEM_TRACE_TIME_SOURCE == QEM_TRACE_TIME_VIRTUAL
+#include "qemu/timer.h"   /* Qemu clocks */
+#include "sysemu/cpus.h"  /* Instruction counting mode */
+#endif
+
+/*******************************************************************************
+ * CONSTANTS
+ ******************************************************************************/
+
+#if QEM_TRACE_TIME_SOURCE != QEM_TRACE_TIME_RDTSC && \
+    QEM_TRACE_TIME_SOURCE != QEM_TRACE_TIME_ICOUNT && \
+    QEM_TRACE_TIME_SOURCE != QEM_TRACE_TIME_VIRTUAL
+#error "Unknown QEM_TRACE_TIME_SOURCE"
+#endif
+
+/*******************************************************************************
+ * FUNCTIONS
+ ******************************************************************************/
+
+/* Returns the timestamp of a record of the core.
+ *
+ * @param cs The core the record belongs to.
+ */
+static inline uint64_t qem_trace_get_time(CPUState* cs)
+{
+#if QEM_TRACE_TIME_SOURCE == QEM_TRACE_TIME_ICOUNT
+    return cs->qem_time_base + cs->qem_time_offset;
+#elif QEM_TRACE_TIME_SOURCE == QEM_TRACE_TIME_VIRTUAL
+    int64_t executed;
+
+    if(use_icount == 0)
+    {
+        return qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+    }
+
+    /* Reading the clock while the core runs would account the instructions,
+     * only the counters of the core are read. They are decremented by whole
+     * translation blocks, the records of a block share its end time.
+     */
+    executed = cs->qem_time_budget -
+               (cs->icount_decr.u16.low + cs->icount_extra);
+
+    return cs->qem_time_base + cpu_icount_to_ns(executed);
+#else
+    /* Get time, we prefer to use TSC to lower overhead */
+    unsigned a, d;
+
+    (void)cs;
+    asm volatile("rdtsc" : "=a" (a), "=d" (d) : : "%rbx", "%rcx");
+
+    return ((uint64_t) a) | (((uint64_t) d) << 32);
+#endif
+}
+
+#endif /* QEM_TRACE_ENABLED */
+
+#endif /* __QEM_TRACE_TIME_H_ */
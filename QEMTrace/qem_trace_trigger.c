@@ -0,0 +1,199 @@
+/*
+ * Guest memory access tracing PC triggers.
+ *
+ * Provides the start and stop triggers loaded when Qemu starts.
+ *
+ *  Copyright (c) 2019 Alexy Torres Aurora Dugo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "qem_trace_config.h" /* QEM Trace configuration */
+
+#if QEM_TRACE_ENABLED
+
+#if QEM_TRACE_PC_TRIGGER_ENABLED
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "qemu/osdep.h"
+#include "cpu.h"
+
+#include "qem_trace_engine.h"  /* Engine header */
+#include "qem_trace_logger.h"  /* QEM logger */
+#include "qem_trace_trigger.h" /* Trigger header */
+
+/*******************************************************************************
+ * STRUCTURES
+ ******************************************************************************/
+
+/* Start or stop trigger. */
+typedef struct
+{
+    /* Virtual address of the instruction. */
+    uint64_t          addr;
+    /* Address space identifier, only checked when has_asid is set. */
+    uint64_t          asid;
+    /* Trace type started or stopped. */
+    QEM_TRACE_TTYPE_E type;
+    /* Set when the trigger only fires in one address space. */
+    uint8_t           has_asid;
+    /* Set for a start trigger, cleared for a stop trigger. */
+    uint8_t           start;
+} qem_trace_trigger_t;
+
+/*******************************************************************************
+ * GLOBAL VARS
+ ******************************************************************************/
+
+/* Triggers, only written at startup */
+static qem_trace_trigger_t triggers[QEM_TRACE_PC_TRIGGER_MAX];
+static uint32_t            trigger_count;
+
+/*******************************************************************************
+ * FUNCTIONS
+ ******************************************************************************/
+
+/* Parses one trigger, returns the position after it or NULL on error. */
+static const char* parse_trigger(const char* str)
+{
+    qem_trace_trigger_t* trigger;
+    char*                end;
+
+    if(trigger_count == QEM_TRACE_PC_TRIGGER_MAX)
+    {
+        QEM_TRACE_ERROR("Too many trace PC triggers", 1, 1);
+    }
+    trigger = &triggers[trigger_count];
+
+    if(strncmp(str, "start", 5) == 0)
+    {
+        trigger->start = 1;
+        str += 5;
+    }
+    else if(strncmp(str, "stop", 4) == 0)
+    {
+        trigger->start = 0;
+        str += 4;
+    }
+    else
+    {
+        return NULL;
+    }
+
+    trigger->type = QEM_TRACE_ALLTRACE;
+    if(*str == 'd')
+    {
+        trigger->type = QEM_TRACE_DTRACE;
+        ++str;
+    }
+    else if(*str == 'i')
+    {
+        trigger->type = QEM_TRACE_ITRACE;
+        ++str;
+    }
+
+    trigger->addr = strtoull(str, &end, 0);
+    if(end == str)
+    {
+        return NULL;
+    }
+
+    if(*end == '@')
+    {
+        str = end + 1;
+        trigger->asid     = strtoull(str, &end, 0);
+        trigger->has_asid = 1;
+        if(end == str)
+        {
+            return NULL;
+        }
+    }
+
+    if(*end != ',' && *end != 0)
+    {
+        return NULL;
+    }
+    ++trigger_count;
+
+    return end;
+}
+
+/* Loads the triggers before any code is translated. */
+static void __attribute__((constructor)) qem_trace_trigger_load(void)
+{
+    const char* env_value;
+
+    env_value = getenv(QEM_TRACE_PC_TRIGGER_ENV);
+    while(env_value != NULL && *env_value != 0)
+    {
+        env_value = parse_trigger(env_value);
+        if(env_value == NULL)
+        {
+            QEM_TRACE_ERROR("Invalid " QEM_TRACE_PC_TRIGGER_ENV " value", 1, 1);
+        }
+        if(*env_value == ',')
+        {
+            ++env_value;
+        }
+    }
+}
+
+uint8_t qem_trace_trigger_pc_match(const uint64_t addr)
+{
+    uint32_t i;
+
+    for(i = 0; i < trigger_count; ++i)
+    {
+        if(triggers[i].addr == addr)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void qem_trace_trigger_fire(CPUState* cs, const uint64_t addr,
+                            const uint64_t asid)
+{
+    uint32_t i;
+
+    if(qem_trace_replay_traced() == 0)
+    {
+        return;
+    }
+
+    for(i = 0; i < trigger_count; ++i)
+    {
+        if(triggers[i].addr != addr ||
+           (triggers[i].has_asid != 0 && triggers[i].asid != asid))
+        {
+            continue;
+        }
+
+        if(triggers[i].start != 0)
+        {
+            qem_trace_enable(cs, triggers[i].type);
+        }
+        else
+        {
+            qem_trace_disable(triggers[i].type);
+        }
+    }
+}
+
+#endif /* QEM_TRACE_PC_TRIGGER_ENABLED */
+
+#endif /* QEM_TRACE_ENABLED */
@@ -0,0 +1,76 @@
+/*
+ * Guest memory access tracing PC triggers.
+ *
+ * Provides the translators the instructions starting or stopping tracing,
+ * checked when an instruction is translated, and the triggers firing, done
+ * when the instruction is executed.
+ *
+ * Header included in
+ *     qem_trace_engine.h
+ *
+ *  Copyright (c) 2019 Alexy Torres Aurora Dugo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __QEM_TRACE_TRIGGER_H_
+#define __QEM_TRACE_TRIGGER_H_
+
+#include "qem_trace_config.h" /* QEM Trace configuration */
+
+#if QEM_TRACE_ENABLED
+
+#include <stdint.h> /* Generic types */
+
+/*******************************************************************************
+ * CONSTANTS
+ ******************************************************************************/
+
+/* Environment variable containing the PC triggers */
+#define QEM_TRACE_PC_TRIGGER_ENV "QEM_TRACE_PC_TRIGGERS"
+
+#if QEM_TRACE_PC_TRIGGER_ENABLED && QEM_TRACE_PC_TRIGGER_MAX < 1
+#error "QEM_TRACE_PC_TRIGGER_MAX must be greater than 0"
+#endif
+
+/*******************************************************************************
+ * FUNCTIONS
+ ******************************************************************************/
+
+#if QEM_TRACE_PC_TRIGGER_ENABLED
+
+/* Returns 1 if a trigger is set on the instruction, 0 otherwise.
+ *
+ * @param addr The virtual address of the instruction being translated.
+ */
+uint8_t qem_trace_trigger_pc_match(const uint64_t addr);
+
+/* Fires the triggers set on the instruction for the address space.
+ *
+ * @param cs The CPU executing the instruction.
+ * @param addr The virtual address of the instruction.
+ * @param asid The address space identifier the CPU runs in.
+ */
+void qem_trace_trigger_fire(CPUState* cs, const uint64_t addr,
+                            const uint64_t asid);
+
+#else
+
+#define qem_trace_trigger_pc_match(addr) 0
+
+#endif /* QEM_TRACE_PC_TRIGGER_ENABLED */
+
+#endif /* QEM_TRACE_ENABLED */
+
+#endif /* __QEM_TRACE_TRIGGER_H_ */
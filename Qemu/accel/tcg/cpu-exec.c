@@ -36,6 +36,15 @@
 #include "sysemu/cpus.h"
 #include "sysemu/replay.h"
 
+/*******************************************************************************
+ * QEMTrace START
+ ******************************************************************************/
+#include "../../../QEMTrace/qem_trace_engine.h"
+#include "../../../QEMTrace/qem_trace_config.h"
+/*******************************************************************************
+ * QEMTrace END
+ ******************************************************************************/
+
 /* -icount align implementation. */
 
 typedef struct SyncClocks {
@@ -483,6 +492,15 @@ static inline bool cpu_handle_exception(CPUState *cpu, int *ret)
         cpu->exception_index = -1;
         return true;
     } else {
+/*******************************************************************************
+ * QEMTrace START
+ ******************************************************************************/
+#if QEM_TRACE_ENABLED
+        qem_trace_ring_exception(cpu->cpu_index, cpu->exception_index);
+#endif /* QEM_TRACE_ENABLED */
+/*******************************************************************************
+ * QEMTrace END
+ ******************************************************************************/
 #if defined(CONFIG_USER_ONLY)
         /* if user mode only, we simulate a fake exception
            which will be handled outside the cpu execution
@@ -1392,6 +1392,18 @@ static void prepare_icount_for_run(CPUState *cpu)
         cpu->icount_decr.u16.low = insns_left;
         cpu->icount_extra = cpu->icount_budget - insns_left;
 
+/*******************************************************************************
+ * QEMTrace START
+ ******************************************************************************/
+#if QEM_TRACE_ENABLED && QEM_TRACE_TIME_SOURCE == QEM_TRACE_TIME_VIRTUAL
+        /* The records of the budget are stamped from this time */
+        cpu->qem_time_base   = cpu_get_icount();
+        cpu->qem_time_budget = cpu->icount_budget;
+#endif
+/*******************************************************************************
+ * QEMTrace END
+ ******************************************************************************/
+
         replay_mutex_lock();
     }
 }
@@ -30,6 +30,14 @@
 #include "qemu/queue.h"
 #include "qemu/thread.h"
 
+/*******************************************************************************
+ * QEMTrace START
+ ******************************************************************************/
+#include "../../../QEMTrace/qem_trace_config.h"
+/*******************************************************************************
+ * QEMTrace END
+ ******************************************************************************/
+
 typedef int (*WriteCoreDumpFunction)(const void *buf, size_t size,
                                      void *opaque);
 
@@ -418,6 +426,28 @@ struct CPUState {
 
     bool ignore_memory_transaction_failures;
 
+/*******************************************************************************
+ * QEMTrace START
+ ******************************************************************************/
+#if QEM_TRACE_ENABLED && QEM_TRACE_TIME_SOURCE == QEM_TRACE_TIME_ICOUNT
+    /* Instructions started before the current translation block and offset
+     * of the executing instruction in the block, written by the generated
+     * code and read by the trace helpers. The offset is -1 after a reset,
+     * before the core starts its first instruction.
+     */
+    uint64_t qem_time_base;
+    int32_t  qem_time_offset;
+#elif QEM_TRACE_ENABLED && QEM_TRACE_TIME_SOURCE == QEM_TRACE_TIME_VIRTUAL
+    /* Virtual clock when the core received its icount budget and that
+     * budget, written by the core thread before it executes the budget.
+     */
+    uint64_t qem_time_base;
+    int64_t  qem_time_budget;
+#endif
+/*******************************************************************************
+ * QEMTrace END
+ ******************************************************************************/
+
     /* Note that this is accessed at the start of every TB via a negative
        offset from AREG0.  Leave this field at the end so as to make the
        (absolute value) offset as small as possible.  This reduces code
@@ -271,6 +271,18 @@ static void cpu_common_reset(CPUState *cpu)
     cpu->crash_occurred = false;
     cpu->cflags_next_tb = -1;
 
+/*******************************************************************************
+ * QEMTrace START
+ ******************************************************************************/
+#if QEM_TRACE_ENABLED && QEM_TRACE_TIME_SOURCE == QEM_TRACE_TIME_ICOUNT
+    /* The first translation block starts at instruction 0 */
+    cpu->qem_time_base   = 0;
+    cpu->qem_time_offset = -1;
+#endif
+/*******************************************************************************
+ * QEMTrace END
+ ******************************************************************************/
+
     if (tcg_enabled()) {
         cpu_tb_jmp_cache_clear(cpu);
 
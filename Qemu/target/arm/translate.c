@@ -95,6 +95,15 @@ typedef void NeonGenThreeOpEnvFn(TCGv_i32, TCGv_env, TCGv_i32,
 #if QEM_TRACE_ENABLED
 static void gen_qem_instld_trace(const target_ulong cur_eip, const int size, int mmu_idx)
 {
+    /* Disabled fetches and instructions outside the traced ranges are never
+     * instrumented
+     */
+    if(qem_trace_filter_class(QEM_TRACE_CLASS_FETCH) == 0 ||
+       qem_trace_filter_virt(cur_eip) == 0)
+    {
+        return;
+    }
+
     /* Call the trace helper */
     TCGv t0 = tcg_const_tl(cur_eip);
     TCGv_i32 t1 = tcg_const_i32(size);
@@ -105,11 +114,71 @@ static void gen_qem_instld_trace(const target_ulong cur_eip, const int size, int
     tcg_temp_free_i32(t2);
 }
 
+/* Fires the ring trigger when the instruction is executed */
+static void gen_qem_ring_trigger(const target_ulong cur_eip)
+{
+    TCGv t0 = tcg_const_tl(cur_eip);
+    gen_helper_qem_ring_trigger(cpu_env, t0);
+    tcg_temp_free(t0);
+}
+
+#if QEM_TRACE_PC_TRIGGER_ENABLED
+/* Fires the PC triggers of the instruction when it is executed */
+static void gen_qem_pc_trigger(const target_ulong cur_eip)
+{
+    TCGv t0 = tcg_const_tl(cur_eip);
+    gen_helper_qem_pc_trigger(cpu_env, t0);
+    tcg_temp_free(t0);
+}
+#endif
+
+#if QEM_TRACE_TIME_SOURCE == QEM_TRACE_TIME_ICOUNT
+/* Adds the instructions the core started in its previous translation block to
+ * the timestamp base of the core. The offset is -1 until the core starts its
+ * first instruction, the records of the block entry use offset 0.
+ */
+static void gen_qem_time_tb_start(void)
+{
+    TCGv_i64 t0 = tcg_temp_new_i64();
+    TCGv_i64 t1 = tcg_temp_new_i64();
+    TCGv_i32 t2 = tcg_const_i32(0);
+    tcg_gen_ld_i64(t0, cpu_env,
+                   -ENV_OFFSET + offsetof(CPUState, qem_time_base));
+    tcg_gen_ld32s_i64(t1, cpu_env,
+                      -ENV_OFFSET + offsetof(CPUState, qem_time_offset));
+    tcg_gen_add_i64(t0, t0, t1);
+    tcg_gen_addi_i64(t0, t0, 1);
+    tcg_gen_st_i64(t0, cpu_env,
+                   -ENV_OFFSET + offsetof(CPUState, qem_time_base));
+    tcg_gen_st_i32(t2, cpu_env,
+                   -ENV_OFFSET + offsetof(CPUState, qem_time_offset));
+    tcg_temp_free_i64(t0);
+    tcg_temp_free_i64(t1);
+    tcg_temp_free_i32(t2);
+}
+
+/* Stores the offset of the instruction in its translation block, the
+ * timestamp of its records
+ */
+static void gen_qem_time_insn(const int offset)
+{
+    TCGv_i32 t0 = tcg_const_i32(offset);
+    tcg_gen_st_i32(t0, cpu_env,
+                   -ENV_OFFSET + offsetof(CPUState, qem_time_offset));
+    tcg_temp_free_i32(t0);
+}
+#endif
+
 /**************************************** LOAD ********************************/
 
 static void gen_qem_datald_trace(const TCGv addr,
                                  const int size, int mmu_idx)
 {
+    if(qem_trace_filter_class(QEM_TRACE_CLASS_LOAD) == 0)
+    {
+        return;
+    }
+
     /* Call the trace helper */
     TCGv_i32 t1 = tcg_const_i32(size);
     TCGv_i32 t2 = tcg_const_i32(mmu_idx);
@@ -123,6 +192,11 @@ static void gen_qem_datald_trace(const TCGv addr,
 static void gen_qem_datald_ex_trace(const TCGv addr,
                                  const int size, int mmu_idx)
 {
+    if(qem_trace_filter_class(QEM_TRACE_CLASS_LOAD) == 0)
+    {
+        return;
+    }
+
     /* Call the trace helper */
     TCGv_i32 t1 = tcg_const_i32(size);
     TCGv_i32 t2 = tcg_const_i32(mmu_idx);
@@ -138,6 +212,11 @@ static void gen_qem_datald_ex_trace(const TCGv addr,
 static void gen_qem_datast_trace(const TCGv addr,
                                  const int size, int mmu_idx)
 {
+    if(qem_trace_filter_class(QEM_TRACE_CLASS_STORE) == 0)
+    {
+        return;
+    }
+
     /* Call the trace helper */
     TCGv_i32 t1 = tcg_const_i32(size);
     TCGv_i32 t2 = tcg_const_i32(mmu_idx);
@@ -151,6 +230,11 @@ static void gen_qem_datast_trace(const TCGv addr,
 static void gen_qem_datast_ex_trace(const TCGv addr,
                                  const int size, int mmu_idx)
 {
+    if(qem_trace_filter_class(QEM_TRACE_CLASS_STORE) == 0)
+    {
+        return;
+    }
+
     /* Call the trace helper */
     TCGv_i32 t1 = tcg_const_i32(size);
     TCGv_i32 t2 = tcg_const_i32(mmu_idx);
@@ -1217,7 +1301,10 @@ static void gen_aa32_ld_i32(DisasContext *s, TCGv_i32 val, TCGv_i32 a32,
  * QEMTrace START
  ******************************************************************************/
 #if QEM_TRACE_ENABLED
-    gen_qem_datald_trace(addr, (int)opc & MO_SIZE, s->mmu_idx);
+    if(s->qem_multi == false)
+    {
+        gen_qem_datald_trace(addr, (int)opc & MO_SIZE, s->mmu_idx);
+    }
 #endif /* QEM_TRACE_ENABLED */
 /*******************************************************************************
  * QEMTrace END
@@ -1268,7 +1355,10 @@ static void gen_aa32_st_i32(DisasContext *s, TCGv_i32 val, TCGv_i32 a32,
  * QEMTrace START
  ******************************************************************************/
 #if QEM_TRACE_ENABLED
-    gen_qem_datast_trace(addr, (int)opc & MO_SIZE, s->mmu_idx);
+    if(s->qem_multi == false)
+    {
+        gen_qem_datast_trace(addr, (int)opc & MO_SIZE, s->mmu_idx);
+    }
 #endif /* QEM_TRACE_ENABLED */
 /*******************************************************************************
  * QEMTrace END
@@ -1278,6 +1368,50 @@ static void gen_aa32_st_i32(DisasContext *s, TCGv_i32 val, TCGv_i32 a32,
     tcg_temp_free(addr);
 }
 
+/*******************************************************************************
+ * QEMTrace START
+ ******************************************************************************/
+#if QEM_TRACE_ENABLED
+/* Traces the count words of a load or store multiple from the lowest address
+ * a32, the words accessed until gen_qem_multi_end are not traced one by one.
+ */
+static void gen_qem_multi_begin(DisasContext *s, TCGv_i32 a32,
+                                const int count, const int store)
+{
+    s->qem_multi = true;
+
+    if(qem_trace_filter_class(store ? QEM_TRACE_CLASS_STORE :
+                                      QEM_TRACE_CLASS_LOAD) == 0)
+    {
+        return;
+    }
+
+    /* Call the trace helper */
+    TCGv addr = gen_aa32_addr(s, a32, MO_UL);
+    TCGv_i32 t1 = tcg_const_i32(count);
+    TCGv_i32 t2 = tcg_const_i32(s->mmu_idx);
+    if(store)
+    {
+        gen_helper_qem_datast_multi_trace(cpu_env, addr, t1, t2);
+    }
+    else
+    {
+        gen_helper_qem_datald_multi_trace(cpu_env, addr, t1, t2);
+    }
+    tcg_temp_free(addr);
+    tcg_temp_free_i32(t1);
+    tcg_temp_free_i32(t2);
+}
+
+static inline void gen_qem_multi_end(DisasContext *s)
+{
+    s->qem_multi = false;
+}
+#endif /* QEM_TRACE_ENABLED */
+/*******************************************************************************
+ * QEMTrace END
+ ******************************************************************************/
+
 #define DO_GEN_LD(SUFF, OPC)                                             \
 static inline void gen_aa32_ld##SUFF(DisasContext *s, TCGv_i32 val,      \
                                      TCGv_i32 a32, int index)            \
@@ -9221,6 +9355,12 @@ static void disas_arm_insn(DisasContext *s, unsigned int insn)
         tcg_temp_free_i32(t0);
         return;
     }
+    /* Ring trigger opcode */
+    else if(insn == QEM_TRACE_RING_TRIGGER_OP)
+    {
+        gen_qem_ring_trigger(s->pc - 4);
+        return;
+    }
     
 #endif /* QEM_TRACE_ENABLED */
 /*******************************************************************************
@@ -10643,6 +10783,15 @@ static void disas_arm_insn(DisasContext *s, unsigned int insn)
                         tcg_gen_addi_i32(addr, addr, -((n - 1) * 4));
                     }
                 }
+/*******************************************************************************
+ * QEMTrace START
+ ******************************************************************************/
+#if QEM_TRACE_ENABLED
+                gen_qem_multi_begin(s, addr, n, !is_load);
+#endif /* QEM_TRACE_ENABLED */
+/*******************************************************************************
+ * QEMTrace END
+ ******************************************************************************/
                 j = 0;
                 for(i=0;i<16;i++) {
                     if (insn & (1 << i)) {
@@ -10687,6 +10836,15 @@ static void disas_arm_insn(DisasContext *s, unsigned int insn)
                             tcg_gen_addi_i32(addr, addr, 4);
                     }
                 }
+/*******************************************************************************
+ * QEMTrace START
+ ******************************************************************************/
+#if QEM_TRACE_ENABLED
+                gen_qem_multi_end(s);
+#endif /* QEM_TRACE_ENABLED */
+/*******************************************************************************
+ * QEMTrace END
+ ******************************************************************************/
                 if (insn & (1 << 21)) {
                     /* write back */
                     if (insn & (1 << 23)) {
@@ -11263,6 +11421,17 @@ static void disas_thumb2_insn(DisasContext *s, uint32_t insn)
                     gen_helper_v8m_stackcheck(cpu_env, addr);
                 }
 
+/*******************************************************************************
+ * QEMTrace START
+ ******************************************************************************/
+#if QEM_TRACE_ENABLED
+                gen_qem_multi_begin(s, addr, offset / 4,
+                                    (insn & (1 << 20)) == 0);
+#endif /* QEM_TRACE_ENABLED */
+/*******************************************************************************
+ * QEMTrace END
+ ******************************************************************************/
+
                 loaded_var = NULL;
                 for (i = 0; i < 16; i++) {
                     if ((insn & (1 << i)) == 0)
@@ -11287,6 +11456,15 @@ static void disas_thumb2_insn(DisasContext *s, uint32_t insn)
                     }
                     tcg_gen_addi_i32(addr, addr, 4);
                 }
+/*******************************************************************************
+ * QEMTrace START
+ ******************************************************************************/
+#if QEM_TRACE_ENABLED
+                gen_qem_multi_end(s);
+#endif /* QEM_TRACE_ENABLED */
+/*******************************************************************************
+ * QEMTrace END
+ ******************************************************************************/
                 if (loaded_base) {
                     store_reg(s, rn, loaded_var);
                 }
@@ -12989,6 +13167,16 @@ static void disas_thumb_insn(DisasContext *s, uint32_t insn)
                 gen_helper_v8m_stackcheck(cpu_env, addr);
             }
 
+/*******************************************************************************
+ * QEMTrace START
+ ******************************************************************************/
+#if QEM_TRACE_ENABLED
+            gen_qem_multi_begin(s, addr, offset / 4, (insn & (1 << 11)) == 0);
+#endif /* QEM_TRACE_ENABLED */
+/*******************************************************************************
+ * QEMTrace END
+ ******************************************************************************/
+
             for (i = 0; i < 8; i++) {
                 if (insn & (1 << i)) {
                     if (insn & (1 << 11)) {
@@ -13022,6 +13210,15 @@ static void disas_thumb_insn(DisasContext *s, uint32_t insn)
                 }
                 tcg_gen_addi_i32(addr, addr, 4);
             }
+/*******************************************************************************
+ * QEMTrace START
+ ******************************************************************************/
+#if QEM_TRACE_ENABLED
+            gen_qem_multi_end(s);
+#endif /* QEM_TRACE_ENABLED */
+/*******************************************************************************
+ * QEMTrace END
+ ******************************************************************************/
             if ((insn & (1 << 11)) == 0) {
                 tcg_gen_addi_i32(addr, addr, -offset);
             }
@@ -13152,6 +13349,16 @@ static void disas_thumb_insn(DisasContext *s, uint32_t insn)
         TCGv_i32 loaded_var = NULL;
         rn = (insn >> 8) & 0x7;
         addr = load_reg(s, rn);
+/*******************************************************************************
+ * QEMTrace START
+ ******************************************************************************/
+#if QEM_TRACE_ENABLED
+        gen_qem_multi_begin(s, addr, ctpop8(insn & 0xff),
+                            (insn & (1 << 11)) == 0);
+#endif /* QEM_TRACE_ENABLED */
+/*******************************************************************************
+ * QEMTrace END
+ ******************************************************************************/
         for (i = 0; i < 8; i++) {
             if (insn & (1 << i)) {
                 if (insn & (1 << 11)) {
@@ -13173,6 +13380,15 @@ static void disas_thumb_insn(DisasContext *s, uint32_t insn)
                 tcg_gen_addi_i32(addr, addr, 4);
             }
         }
+/*******************************************************************************
+ * QEMTrace START
+ ******************************************************************************/
+#if QEM_TRACE_ENABLED
+        gen_qem_multi_end(s);
+#endif /* QEM_TRACE_ENABLED */
+/*******************************************************************************
+ * QEMTrace END
+ ******************************************************************************/
         if ((insn & (1 << rn)) == 0) {
             /* base reg not in list: base register writeback */
             store_reg(s, rn, addr);
@@ -13288,6 +13504,15 @@ static void arm_tr_init_disas_context(DisasContextBase *dcbase, CPUState *cs)
     dc->isar = &cpu->isar;
     dc->pc = dc->base.pc_first;
     dc->condjmp = 0;
+/*******************************************************************************
+ * QEMTrace START
+ ******************************************************************************/
+#if QEM_TRACE_ENABLED
+    dc->qem_multi = false;
+#endif /* QEM_TRACE_ENABLED */
+/*******************************************************************************
+ * QEMTrace END
+ ******************************************************************************/
 
     dc->aarch64 = 0;
     /* If we are coming from secure EL0 in a system with a 32-bit EL3, then
@@ -13403,6 +13628,27 @@ static void arm_tr_tb_start(DisasContextBase *dcbase, CPUState *cpu)
         tcg_gen_movi_i32(tmp, 0);
         store_cpu_field(tmp, condexec_bits);
     }
+
+/*******************************************************************************
+ * QEMTrace START
+ ******************************************************************************/
+#if QEM_TRACE_ENABLED
+    /* Select the event classes instrumented in this translation block */
+    qem_trace_filter_tb_start(dc->user);
+#if QEM_TRACE_TIME_SOURCE == QEM_TRACE_TIME_ICOUNT
+    gen_qem_time_tb_start();
+#endif
+#if QEM_TRACE_ASID_FILTER_ENABLED
+    /* Check the address space once per translation block */
+    if(qem_trace_filter_class(QEM_TRACE_CLASS_EVENTS))
+    {
+        gen_helper_qem_tb_enter_trace(cpu_env);
+    }
+#endif
+#endif /* QEM_TRACE_ENABLED */
+/*******************************************************************************
+ * QEMTrace END
+ ******************************************************************************/
 }
 
 static void arm_tr_insn_start(DisasContextBase *dcbase, CPUState *cpu)
@@ -13503,7 +13749,21 @@ static void arm_tr_translate_insn(DisasContextBase *dcbase, CPUState *cpu)
  ******************************************************************************/
 #if QEM_TRACE_ENABLED
 
+#if QEM_TRACE_TIME_SOURCE == QEM_TRACE_TIME_ICOUNT
+    gen_qem_time_insn(dc->base.num_insns - 1);
+#endif
+
     /* We add a call to the trace helper */
+#if QEM_TRACE_PC_TRIGGER_ENABLED
+    if(qem_trace_trigger_pc_match(dc->pc))
+    {
+        gen_qem_pc_trigger(dc->pc);
+    }
+#endif
+    if(qem_trace_ring_pc_match(dc->pc))
+    {
+        gen_qem_ring_trigger(dc->pc);
+    }
     gen_qem_instld_trace(dc->pc, MO_32, dc->mmu_idx);
 
 #endif /* QEM_TRACE_ENABLED */
@@ -13589,6 +13849,31 @@ static void thumb_tr_translate_insn(DisasContextBase *dcbase, CPUState *cpu)
     }
     dc->insn = insn;
 
+/*******************************************************************************
+ * QEMTrace START
+ ******************************************************************************/
+#if QEM_TRACE_ENABLED
+#if QEM_TRACE_TIME_SOURCE == QEM_TRACE_TIME_ICOUNT
+    gen_qem_time_insn(dc->base.num_insns - 1);
+#endif
+
+    /* The instruction starts at pc_next, dc->pc is past it */
+#if QEM_TRACE_PC_TRIGGER_ENABLED
+    if(qem_trace_trigger_pc_match(dc->base.pc_next))
+    {
+        gen_qem_pc_trigger(dc->base.pc_next);
+    }
+#endif
+    if(qem_trace_ring_pc_match(dc->base.pc_next))
+    {
+        gen_qem_ring_trigger(dc->base.pc_next);
+    }
+#endif /* QEM_TRACE_ENABLED */
+/*******************************************************************************
+ * QEMTrace END
+ ******************************************************************************/
+
+
     if (dc->condexec_mask && !thumb_insn_is_unconditional(dc, insn)) {
         uint32_t cond = dc->condexec_cond;
 
@@ -3,6 +3,14 @@
 
 #include "exec/translator.h"
 
+/*******************************************************************************
+ * QEMTrace START
+ ******************************************************************************/
+#include "../../QEMTrace/qem_trace_config.h"
+/*******************************************************************************
+ * QEMTrace END
+ ******************************************************************************/
+
 
 /* internal defines */
 typedef struct DisasContext {
@@ -75,6 +83,15 @@ typedef struct DisasContext {
 #define TMP_A64_MAX 16
     int tmp_a64_count;
     TCGv_i64 tmp_a64[TMP_A64_MAX];
+/*******************************************************************************
+ * QEMTrace START
+ ******************************************************************************/
+#if QEM_TRACE_ENABLED
+    bool qem_multi; /* true while a load/store multiple is translated */
+#endif
+/*******************************************************************************
+ * QEMTrace END
+ ******************************************************************************/
 } DisasContext;
 
 typedef struct DisasCompare {
@@ -152,6 +152,15 @@ typedef struct DisasContext {
     TCGv_i64 tmp1_i64;
 
     sigjmp_buf jmpbuf;
+/*******************************************************************************
+ * QEMTrace START
+ ******************************************************************************/
+#if QEM_TRACE_ENABLED && QEM_TRACE_STRING_ENABLED
+    int qem_string_slot; /* next string operand, -1 outside rep string ops */
+#endif
+/*******************************************************************************
+ * QEMTrace END
+ ******************************************************************************/
 } DisasContext;
 
 static void gen_eob(DisasContext *s);
@@ -247,6 +256,15 @@ static const uint8_t cc_op_live[CC_OP_NB] = {
 
 static void gen_qem_instld_trace(DisasContext *s, target_ulong cur_eip, int size)
 {
+    /* Disabled fetches and instructions outside the traced ranges are never
+     * instrumented
+     */
+    if(qem_trace_filter_class(QEM_TRACE_CLASS_FETCH) == 0 ||
+       qem_trace_filter_virt(cur_eip) == 0)
+    {
+        return;
+    }
+
     TCGv t0 = tcg_const_tl(cur_eip);
     TCGv_i32 t1 = tcg_const_i32(size);
     /* Call the trace helper */
@@ -255,6 +273,61 @@ static void gen_qem_instld_trace(DisasContext *s, target_ulong cur_eip, int size
     tcg_temp_free_i32(t1);
 }
 
+/* Fires the ring trigger when the instruction is executed */
+static void gen_qem_ring_trigger(const target_ulong cur_eip)
+{
+    TCGv t0 = tcg_const_tl(cur_eip);
+    gen_helper_qem_ring_trigger(cpu_env, t0);
+    tcg_temp_free(t0);
+}
+
+#if QEM_TRACE_PC_TRIGGER_ENABLED
+/* Fires the PC triggers of the instruction when it is executed */
+static void gen_qem_pc_trigger(const target_ulong cur_eip)
+{
+    TCGv t0 = tcg_const_tl(cur_eip);
+    gen_helper_qem_pc_trigger(cpu_env, t0);
+    tcg_temp_free(t0);
+}
+#endif
+
+#if QEM_TRACE_TIME_SOURCE == QEM_TRACE_TIME_ICOUNT
+/* Adds the instructions the core started in its previous translation block to
+ * the timestamp base of the core. The offset is -1 until the core starts its
+ * first instruction, the records of the block entry use offset 0.
+ */
+static void gen_qem_time_tb_start(void)
+{
+    TCGv_i64 t0 = tcg_temp_new_i64();
+    TCGv_i64 t1 = tcg_temp_new_i64();
+    TCGv_i32 t2 = tcg_const_i32(0);
+    tcg_gen_ld_i64(t0, cpu_env,
+                   -ENV_OFFSET + offsetof(CPUState, qem_time_base));
+    tcg_gen_ld32s_i64(t1, cpu_env,
+                      -ENV_OFFSET + offsetof(CPUState, qem_time_offset));
+    tcg_gen_add_i64(t0, t0, t1);
+    tcg_gen_addi_i64(t0, t0, 1);
+    tcg_gen_st_i64(t0, cpu_env,
+                   -ENV_OFFSET + offsetof(CPUState, qem_time_base));
+    tcg_gen_st_i32(t2, cpu_env,
+                   -ENV_OFFSET + offsetof(CPUState, qem_time_offset));
+    tcg_temp_free_i64(t0);
+    tcg_temp_free_i64(t1);
+    tcg_temp_free_i32(t2);
+}
+
+/* Stores the offset of the instruction in its translation block, the
+ * timestamp of its records
+ */
+static void gen_qem_time_insn(const int offset)
+{
+    TCGv_i32 t0 = tcg_const_i32(offset);
+    tcg_gen_st_i32(t0, cpu_env,
+                   -ENV_OFFSET + offsetof(CPUState, qem_time_offset));
+    tcg_temp_free_i32(t0);
+}
+#endif
+
 /**************************************** LOAD ********************************/
 
 
@@ -263,6 +336,32 @@ static void gen_qem_instld_trace(DisasContext *s, target_ulong cur_eip, int size
 
 
 #endif /* QEM_TRACE_ENABLED */
+
+#if QEM_TRACE_ENABLED && QEM_TRACE_STRING_ENABLED
+/* The accesses of a repeated string instruction are traced as elements of its
+ * blocks, each memory operand uses the slot of its order in the iteration.
+ */
+static inline void gen_qem_string_begin(DisasContext *s)
+{
+    s->qem_string_slot = 0;
+}
+
+static inline void gen_qem_string_end(DisasContext *s)
+{
+    s->qem_string_slot = -1;
+}
+
+static void gen_qem_string_trace(DisasContext *s, TCGv a0, TCGv_i32 size,
+                                 int store)
+{
+    TCGv_i32 t0 = tcg_const_i32((s->qem_string_slot++ << 1) | store);
+    gen_helper_qem_string_trace(cpu_env, a0, size, t0);
+    tcg_temp_free_i32(t0);
+}
+#else
+#define gen_qem_string_begin(s)
+#define gen_qem_string_end(s)
+#endif
 /*******************************************************************************
  * QEMTrace END
  ******************************************************************************/
@@ -467,9 +566,19 @@ static inline void gen_op_ld_v(DisasContext *s, int idx, TCGv t0, TCGv a0)
  * QEMTrace START 
  ******************************************************************************/ 
 #if QEM_TRACE_ENABLED
-    TCGv_i32 t1 = tcg_const_i32(idx & MO_SIZE);
-    gen_helper_qem_datald_trace(cpu_env, a0, t1);
-    tcg_temp_free_i32(t1);
+    if(qem_trace_filter_class(QEM_TRACE_CLASS_LOAD))
+    {
+        TCGv_i32 t1 = tcg_const_i32(idx & MO_SIZE);
+#if QEM_TRACE_STRING_ENABLED
+        if(s->qem_string_slot >= 0)
+        {
+            gen_qem_string_trace(s, a0, t1, 0);
+        }
+        else
+#endif
+        gen_helper_qem_datald_trace(cpu_env, a0, t1);
+        tcg_temp_free_i32(t1);
+    }
 #endif /* QEM_TRACE_ENABLED */
 /******************************************************************************* 
  * QEMTrace END 
@@ -483,9 +592,19 @@ static inline void gen_op_st_v(DisasContext *s, int idx, TCGv t0, TCGv a0)
  * QEMTrace START 
  ******************************************************************************/ 
 #if QEM_TRACE_ENABLED
-    TCGv_i32 t1 = tcg_const_i32(idx & MO_SIZE);
-    gen_helper_qem_datast_trace(cpu_env, a0, t1);
-    tcg_temp_free_i32(t1);
+    if(qem_trace_filter_class(QEM_TRACE_CLASS_STORE))
+    {
+        TCGv_i32 t1 = tcg_const_i32(idx & MO_SIZE);
+#if QEM_TRACE_STRING_ENABLED
+        if(s->qem_string_slot >= 0)
+        {
+            gen_qem_string_trace(s, a0, t1, 1);
+        }
+        else
+#endif
+        gen_helper_qem_datast_trace(cpu_env, a0, t1);
+        tcg_temp_free_i32(t1);
+    }
 #endif /* QEM_TRACE_ENABLED */
 /******************************************************************************* 
  * QEMTrace END 
@@ -1236,7 +1355,9 @@ static inline void gen_repz_ ## op(DisasContext *s, TCGMemOp ot,              \
     TCGLabel *l2;                                                             \
     gen_update_cc_op(s);                                                      \
     l2 = gen_jz_ecx_string(s, next_eip);                                      \
+    gen_qem_string_begin(s);                                                  \
     gen_ ## op(s, ot);                                                        \
+    gen_qem_string_end(s);                                                    \
     gen_op_add_reg_im(s, s->aflag, R_ECX, -1);                                \
     /* a loop would cause two single step exceptions if ECX = 1               \
        before rep string_insn */                                              \
@@ -1254,7 +1375,9 @@ static inline void gen_repz_ ## op(DisasContext *s, TCGMemOp ot,              \
     TCGLabel *l2;                                                             \
     gen_update_cc_op(s);                                                      \
     l2 = gen_jz_ecx_string(s, next_eip);                                      \
+    gen_qem_string_begin(s);                                                  \
     gen_ ## op(s, ot);                                                        \
+    gen_qem_string_end(s);                                                    \
     gen_op_add_reg_im(s, s->aflag, R_ECX, -1);                                \
     gen_update_cc_op(s);                                                      \
     gen_jcc1(s, (JCC_Z << 1) | (nz ^ 1), l2);                                 \
@@ -4567,7 +4690,20 @@ static target_ulong disas_insn(DisasContext *s, CPUState *cpu)
  * QEMTrace START
  ******************************************************************************/
 #if QEM_TRACE_ENABLED
+#if QEM_TRACE_TIME_SOURCE == QEM_TRACE_TIME_ICOUNT
+    gen_qem_time_insn(s->base.num_insns - 1);
+#endif
     /* We add a call to the trace helper TODO: Add instruction size */
+#if QEM_TRACE_PC_TRIGGER_ENABLED
+    if(qem_trace_trigger_pc_match(pc_start))
+    {
+        gen_qem_pc_trigger(pc_start);
+    }
+#endif
+    if(qem_trace_ring_pc_match(pc_start))
+    {
+        gen_qem_ring_trigger(pc_start);
+    }
     gen_qem_instld_trace(s, pc_start, 0);
 #endif /* QEM_TRACE_ENABLED */
 /*******************************************************************************
@@ -4732,57 +4868,28 @@ static target_ulong disas_insn(DisasContext *s, CPUState *cpu)
  * QEMTrace START
  ******************************************************************************/
 #if QEM_TRACE_ENABLED
+    /* The first operand byte selects the trace type (QEM_TRACE_TTYPE_E), 0
+     * selects both. 0x0FA8 to 0x0FAB are not used since they are
+     * push gs, pop gs, rsm and bts.
+     */
     case 0x1A6: /* Start mem tracing custom instruction */
         /* Consume next two bytes */
         b = x86_ldub_code(env, s);
+        tmptrace = tcg_const_i32((b & QEM_TRACE_ALLTRACE) ?
+                                 (b & QEM_TRACE_ALLTRACE) : QEM_TRACE_ALLTRACE);
         b = x86_ldub_code(env, s);
-        tmptrace = tcg_const_i32(QEM_TRACE_ALLTRACE);
         gen_helper_qem_start_trace(cpu_env, tmptrace);
         tcg_temp_free_i32(tmptrace);
         break;
     case 0x1A7: /* Stop mem tracing custom instruction */
         /* Consume next two bytes */
         b = x86_ldub_code(env, s);
+        tmptrace = tcg_const_i32((b & QEM_TRACE_ALLTRACE) ?
+                                 (b & QEM_TRACE_ALLTRACE) : QEM_TRACE_ALLTRACE);
         b = x86_ldub_code(env, s);
-        tmptrace = tcg_const_i32(QEM_TRACE_ALLTRACE);
         gen_helper_qem_stop_trace(tmptrace);
         tcg_temp_free_i32(tmptrace);
         break;
- /* TODO Update tracing point */
- #if 0
-    case 0x1A8: /* Start mem tracing custom instruction */
-        /* Consume next two bytes */
-        b = x86_ldub_code(env, s);
-        b = x86_ldub_code(env, s);
-        tmptrace = tcg_const_i32(QEM_TRACE_ITRACE);
-        gen_helper_qem_start_trace(cpu_env, tmptrace);
-        tcg_temp_free_i32(tmptrace);
-        break;
-    case 0x1A9: /* Stop mem tracing custom instruction */
-        /* Consume next two bytes */
-        b = x86_ldub_code(env, s);
-        b = x86_ldub_code(env, s);
-        tmptrace = tcg_const_i32(QEM_TRACE_ITRACE);
-        gen_helper_qem_stop_trace(tmptrace);
-        tcg_temp_free_i32(tmptrace);
-        break;
-    case 0x1AA: /* Start mem tracing custom instruction */
-        /* Consume next two bytes */
-        b = x86_ldub_code(env, s);
-        b = x86_ldub_code(env, s);
-        tmptrace = tcg_const_i32(QEM_TRACE_DTRACE);
-        gen_helper_qem_start_trace(cpu_env, tmptrace);
-        tcg_temp_free_i32(tmptrace);
-        break;
-    case 0x1AB: /* Stop mem tracing custom instruction */
-        /* Consume next two bytes */
-        b = x86_ldub_code(env, s);
-        b = x86_ldub_code(env, s);
-        tmptrace = tcg_const_i32(QEM_TRACE_DTRACE);
-        gen_helper_qem_stop_trace(tmptrace);
-        tcg_temp_free_i32(tmptrace);
-        break;
-#endif
     case 0x17A: /* Start counter custom instruction */
         /* Consume next two bytes */
         b = x86_ldub_code(env, s);
@@ -4795,6 +4902,12 @@ static target_ulong disas_insn(DisasContext *s, CPUState *cpu)
         b = x86_ldub_code(env, s);
         gen_helper_qem_trace_get_timer();
         break;
+    case 0x136: /* Ring trigger custom instruction */
+        /* Consume next two bytes */
+        b = x86_ldub_code(env, s);
+        b = x86_ldub_code(env, s);
+        gen_qem_ring_trigger(pc_start);
+        break;
 #endif /* QEM_TRACE_ENABLED */
 /*******************************************************************************
  * QEMTrace END
@@ -8617,6 +8730,15 @@ static void i386_tr_init_disas_context(DisasContextBase *dcbase, CPUState *cpu)
        additional step for ecx=0 when icount is enabled.
      */
     dc->repz_opt = !dc->jmp_opt && !(tb_cflags(dc->base.tb) & CF_USE_ICOUNT);
+/*******************************************************************************
+ * QEMTrace START
+ ******************************************************************************/
+#if QEM_TRACE_ENABLED && QEM_TRACE_STRING_ENABLED
+    dc->qem_string_slot = -1;
+#endif
+/*******************************************************************************
+ * QEMTrace END
+ ******************************************************************************/
 #if 0
     /* check addseg logic */
     if (!dc->addseg && (dc->vm86 || !dc->pe || !dc->code32))
@@ -8639,6 +8761,28 @@ static void i386_tr_init_disas_context(DisasContextBase *dcbase, CPUState *cpu)
 
 static void i386_tr_tb_start(DisasContextBase *db, CPUState *cpu)
 {
+/*******************************************************************************
+ * QEMTrace START
+ ******************************************************************************/
+#if QEM_TRACE_ENABLED
+    DisasContext *dc = container_of(db, DisasContext, base);
+
+    /* Select the event classes instrumented in this translation block */
+    qem_trace_filter_tb_start(dc->cpl == 3);
+#if QEM_TRACE_TIME_SOURCE == QEM_TRACE_TIME_ICOUNT
+    gen_qem_time_tb_start();
+#endif
+#if QEM_TRACE_ASID_FILTER_ENABLED
+    /* Check the address space once per translation block */
+    if(qem_trace_filter_class(QEM_TRACE_CLASS_EVENTS))
+    {
+        gen_helper_qem_tb_enter_trace(cpu_env);
+    }
+#endif
+#endif /* QEM_TRACE_ENABLED */
+/*******************************************************************************
+ * QEMTrace END
+ ******************************************************************************/
 }
 
 static void i386_tr_insn_start(DisasContextBase *dcbase, CPUState *cpu)
@@ -65,28 +65,52 @@ static inline target_ulong addr_add(CPUPPCState *env, target_ulong addr,
 
 void helper_lmw(CPUPPCState *env, target_ulong addr, uint32_t reg)
 {
+/*******************************************************************************
+ * QEMTrace START
+ ******************************************************************************/
+#if QEM_TRACE_ENABLED
+    /* The words are traced once the transfer did not fault */
+    target_ulong qem_addr = addr;
+    uint32_t qem_count = 32 - reg;
+#endif /* QEM_TRACE_ENABLED */
+/*******************************************************************************
+ * QEMTrace END
+ ******************************************************************************/
+
     for (; reg < 32; reg++) {
         if (needs_byteswap(env)) {
             env->gpr[reg] = bswap32(cpu_ldl_data_ra(env, addr, GETPC()));
         } else {
             env->gpr[reg] = cpu_ldl_data_ra(env, addr, GETPC());
         }
+        addr = addr_add(env, addr, 4);
+    }
+
 /*******************************************************************************
  * QEMTrace START
  ******************************************************************************/
 #if QEM_TRACE_ENABLED
-        helper_qem_datald_trace_direct(env, addr, 4);
+    helper_qem_datald_multi_trace_direct(env, qem_addr, qem_count, 4);
 #endif /* QEM_TRACE_ENABLED */
 /*******************************************************************************
  * QEMTrace END
  ******************************************************************************/
-
-        addr = addr_add(env, addr, 4);
-    }
 }
 
 void helper_stmw(CPUPPCState *env, target_ulong addr, uint32_t reg)
 {
+/*******************************************************************************
+ * QEMTrace START
+ ******************************************************************************/
+#if QEM_TRACE_ENABLED
+    /* The words are traced once the transfer did not fault */
+    target_ulong qem_addr = addr;
+    uint32_t qem_count = 32 - reg;
+#endif /* QEM_TRACE_ENABLED */
+/*******************************************************************************
+ * QEMTrace END
+ ******************************************************************************/
+
     for (; reg < 32; reg++) {
         if (needs_byteswap(env)) {
             cpu_stl_data_ra(env, addr, bswap32((uint32_t)env->gpr[reg]),
@@ -94,17 +118,18 @@ void helper_stmw(CPUPPCState *env, target_ulong addr, uint32_t reg)
         } else {
             cpu_stl_data_ra(env, addr, (uint32_t)env->gpr[reg], GETPC());
         }
+        addr = addr_add(env, addr, 4);
+    }
+
 /*******************************************************************************
  * QEMTrace START
  ******************************************************************************/
 #if QEM_TRACE_ENABLED
-        helper_qem_datast_trace_direct(env, addr, 4);
+    helper_qem_datast_multi_trace_direct(env, qem_addr, qem_count, 4);
 #endif /* QEM_TRACE_ENABLED */
 /*******************************************************************************
  * QEMTrace END
  ******************************************************************************/
-        addr = addr_add(env, addr, 4);
-    }
 }
 
 static void do_lsw(CPUPPCState *env, target_ulong addr, uint32_t nb,
@@ -112,36 +137,43 @@ static void do_lsw(CPUPPCState *env, target_ulong addr, uint32_t nb,
 {
     int sh;
 
-    for (; nb > 3; nb -= 4) {
-        env->gpr[reg] = cpu_ldl_data_ra(env, addr, raddr);
-        reg = (reg + 1) % 32;
 /*******************************************************************************
  * QEMTrace START
  ******************************************************************************/
 #if QEM_TRACE_ENABLED
-        helper_qem_datald_trace_direct(env, addr, 4);
+    /* The words are traced once the transfer did not fault */
+    target_ulong qem_addr = addr;
+    uint32_t qem_nb = nb;
 #endif /* QEM_TRACE_ENABLED */
 /*******************************************************************************
  * QEMTrace END
  ******************************************************************************/
+
+    for (; nb > 3; nb -= 4) {
+        env->gpr[reg] = cpu_ldl_data_ra(env, addr, raddr);
+        reg = (reg + 1) % 32;
         addr = addr_add(env, addr, 4);
     }
     if (unlikely(nb > 0)) {
         env->gpr[reg] = 0;
         for (sh = 24; nb > 0; nb--, sh -= 8) {
             env->gpr[reg] |= cpu_ldub_data_ra(env, addr, raddr) << sh;
+            addr = addr_add(env, addr, 1);
+        }
+    }
+
 /*******************************************************************************
  * QEMTrace START
  ******************************************************************************/
 #if QEM_TRACE_ENABLED
-        helper_qem_datald_trace_direct(env, addr, 4);
+    helper_qem_datald_multi_trace_direct(env, qem_addr, qem_nb >> 2, 4);
+    helper_qem_datald_multi_trace_direct(env,
+                                         addr_add(env, qem_addr, qem_nb & ~3),
+                                         qem_nb & 3, 1);
 #endif /* QEM_TRACE_ENABLED */
 /*******************************************************************************
  * QEMTrace END
  ******************************************************************************/
-            addr = addr_add(env, addr, 1);
-        }
-    }
 }
 
 void helper_lsw(CPUPPCState *env, target_ulong addr, uint32_t nb, uint32_t reg)
@@ -175,35 +207,42 @@ void helper_stsw(CPUPPCState *env, target_ulong addr, uint32_t nb,
 {
     int sh;
 
-    for (; nb > 3; nb -= 4) {
-        cpu_stl_data_ra(env, addr, env->gpr[reg], GETPC());
-        reg = (reg + 1) % 32;
 /*******************************************************************************
  * QEMTrace START
  ******************************************************************************/
 #if QEM_TRACE_ENABLED
-        helper_qem_datast_trace_direct(env, addr, 4);
+    /* The words are traced once the transfer did not fault */
+    target_ulong qem_addr = addr;
+    uint32_t qem_nb = nb;
 #endif /* QEM_TRACE_ENABLED */
 /*******************************************************************************
  * QEMTrace END
  ******************************************************************************/
+
+    for (; nb > 3; nb -= 4) {
+        cpu_stl_data_ra(env, addr, env->gpr[reg], GETPC());
+        reg = (reg + 1) % 32;
         addr = addr_add(env, addr, 4);
     }
     if (unlikely(nb > 0)) {
         for (sh = 24; nb > 0; nb--, sh -= 8) {
             cpu_stb_data_ra(env, addr, (env->gpr[reg] >> sh) & 0xFF, GETPC());
+            addr = addr_add(env, addr, 1);
+        }
+    }
+
 /*******************************************************************************
  * QEMTrace START
  ******************************************************************************/
 #if QEM_TRACE_ENABLED
-        helper_qem_datast_trace_direct(env, addr, 4);
+    helper_qem_datast_multi_trace_direct(env, qem_addr, qem_nb >> 2, 4);
+    helper_qem_datast_multi_trace_direct(env,
+                                         addr_add(env, qem_addr, qem_nb & ~3),
+                                         qem_nb & 3, 1);
 #endif /* QEM_TRACE_ENABLED */
 /*******************************************************************************
  * QEMTrace END
  ******************************************************************************/
-            addr = addr_add(env, addr, 1);
-        }
-    }
 }
 
 static void dcbz_common(CPUPPCState *env, target_ulong addr,
@@ -32,6 +32,19 @@
 #include "mmu-book3s-v3.h"
 #include "mmu-radix64.h"
 
+/*******************************************************************************
+ * QEMTrace START
+ ******************************************************************************/
+#include "../../QEMTrace/qem_trace_config.h"
+
+#if QEM_TRACE_ENABLED
+/* Trace BookE 2.06 TLB index and 6xx/74xx translation cache */
+#include "../../QEMTrace/arch/ppc/qem_trace_mmu.h"
+#endif /* QEM_TRACE_ENABLED */
+/*******************************************************************************
+ * QEMTrace END
+ ******************************************************************************/
+
 //#define DEBUG_MMU
 //#define DEBUG_BATS
 //#define DEBUG_SOFTWARE_TLB
@@ -268,6 +281,17 @@ static inline void ppc6xx_tlb_invalidate_all(CPUPPCState *env)
         tlb = &env->tlb.tlb6[nr];
         pte_invalidate(&tlb->pte0);
     }
+
+/*******************************************************************************
+ * QEMTrace START
+ ******************************************************************************/
+#if QEM_TRACE_ENABLED
+    qem_ppc_6xx_cache_invalidate_all(env);
+#endif /* QEM_TRACE_ENABLED */
+/*******************************************************************************
+ * QEMTrace END
+ ******************************************************************************/
+
     tlb_flush(CPU(cpu));
 }
 
@@ -295,6 +319,16 @@ static inline void ppc6xx_tlb_invalidate_virt2(CPUPPCState *env,
     /* XXX: PowerPC specification say this is valid as well */
     ppc6xx_tlb_invalidate_all(env);
 #endif
+
+/*******************************************************************************
+ * QEMTrace START
+ ******************************************************************************/
+#if QEM_TRACE_ENABLED
+    qem_ppc_6xx_cache_invalidate_page(env, eaddr);
+#endif /* QEM_TRACE_ENABLED */
+/*******************************************************************************
+ * QEMTrace END
+ ******************************************************************************/
 }
 
 static inline void ppc6xx_tlb_invalidate_virt(CPUPPCState *env,
@@ -315,6 +349,20 @@ static void ppc6xx_tlb_store(CPUPPCState *env, target_ulong EPN, int way,
               " PTE1 " TARGET_FMT_lx "\n", nr, env->nb_tlb, EPN, pte0, pte1);
     /* Invalidate any pending reference in QEMU for this virtual address */
     ppc6xx_tlb_invalidate_virt2(env, EPN, is_code, 1);
+
+/*******************************************************************************
+ * QEMTrace START
+ ******************************************************************************/
+#if QEM_TRACE_ENABLED
+    /* The victim way may hold another page, its translation is evicted */
+    if (tlb->EPN != EPN) {
+        qem_ppc_6xx_cache_invalidate_page(env, tlb->EPN);
+    }
+#endif /* QEM_TRACE_ENABLED */
+/*******************************************************************************
+ * QEMTrace END
+ ******************************************************************************/
+
     tlb->pte0 = pte0;
     tlb->pte1 = pte1;
     tlb->EPN = EPN;
@@ -886,6 +934,16 @@ static void booke206_flush_tlb(CPUPPCState *env, int flags,
         tlb += booke206_tlb_size(env, i);
     }
 
+/*******************************************************************************
+ * QEMTrace START
+ ******************************************************************************/
+#if QEM_TRACE_ENABLED
+    qem_ppc_tlb_index_invalidate();
+#endif /* QEM_TRACE_ENABLED */
+/*******************************************************************************
+ * QEMTrace END
+ ******************************************************************************/
+
     tlb_flush(CPU(cpu));
 }
 
@@ -2124,6 +2182,16 @@ void ppc_store_sdr1(CPUPPCState *env, target_ulong value)
 #endif /* defined(TARGET_PPC64) */
     /* FIXME: Should check for valid HTABMASK values in 32-bit case */
     env->spr[SPR_SDR1] = value;
+
+/*******************************************************************************
+ * QEMTrace START
+ ******************************************************************************/
+#if QEM_TRACE_ENABLED
+    qem_ppc_6xx_cache_invalidate_all(env);
+#endif /* QEM_TRACE_ENABLED */
+/*******************************************************************************
+ * QEMTrace END
+ ******************************************************************************/
 }
 
 #if defined(TARGET_PPC64)
@@ -2828,6 +2896,16 @@ void helper_booke206_tlbwe(CPUPPCState *env)
         tlb->mas1 &= ~MAS1_IPROT;
     }
 
+/*******************************************************************************
+ * QEMTrace START
+ ******************************************************************************/
+#if QEM_TRACE_ENABLED
+    qem_ppc_tlb_index_invalidate();
+#endif /* QEM_TRACE_ENABLED */
+/*******************************************************************************
+ * QEMTrace END
+ ******************************************************************************/
+
     flush_page(env, tlb);
 }
 
@@ -2930,6 +3008,16 @@ static inline void booke206_invalidate_ea_tlb(CPUPPCState *env, int tlbn,
             tlb->mas1 &= ~MAS1_VALID;
         }
     }
+
+/*******************************************************************************
+ * QEMTrace START
+ ******************************************************************************/
+#if QEM_TRACE_ENABLED
+    qem_ppc_tlb_index_invalidate();
+#endif /* QEM_TRACE_ENABLED */
+/*******************************************************************************
+ * QEMTrace END
+ ******************************************************************************/
 }
 
 void helper_booke206_tlbivax(CPUPPCState *env, target_ulong address)
@@ -2988,6 +3076,17 @@ void helper_booke206_tlbilx1(CPUPPCState *env, target_ulong address)
         }
         tlb += booke206_tlb_size(env, i);
     }
+
+/*******************************************************************************
+ * QEMTrace START
+ ******************************************************************************/
+#if QEM_TRACE_ENABLED
+    qem_ppc_tlb_index_invalidate();
+#endif /* QEM_TRACE_ENABLED */
+/*******************************************************************************
+ * QEMTrace END
+ ******************************************************************************/
+
     tlb_flush(CPU(cpu));
 }
 
@@ -3029,6 +3128,17 @@ void helper_booke206_tlbilx3(CPUPPCState *env, target_ulong address)
             tlb->mas1 &= ~MAS1_VALID;
         }
     }
+
+/*******************************************************************************
+ * QEMTrace START
+ ******************************************************************************/
+#if QEM_TRACE_ENABLED
+    qem_ppc_tlb_index_invalidate();
+#endif /* QEM_TRACE_ENABLED */
+/*******************************************************************************
+ * QEMTrace END
+ ******************************************************************************/
+
     tlb_flush(CPU(cpu));
 }
 
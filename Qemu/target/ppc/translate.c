@@ -95,6 +95,15 @@ static TCGv_i32 cpu_access_type;
 #if QEM_TRACE_ENABLED
 static void gen_qem_instld_trace(const target_ulong cur_eip, const int size)
 {
+    /* Disabled fetches and instructions outside the traced ranges are never
+     * instrumented
+     */
+    if(qem_trace_filter_class(QEM_TRACE_CLASS_FETCH) == 0 ||
+       qem_trace_filter_virt(cur_eip) == 0)
+    {
+        return;
+    }
+
     /* Call the trace helper */
     TCGv t0 = tcg_const_tl(cur_eip);
     TCGv_i32 t1 = tcg_const_i32(size);
@@ -103,11 +112,71 @@ static void gen_qem_instld_trace(const target_ulong cur_eip, const int size)
     tcg_temp_free_i32(t1);
 }
 
+/* Fires the ring trigger when the instruction is executed */
+static void gen_qem_ring_trigger(const target_ulong cur_eip)
+{
+    TCGv t0 = tcg_const_tl(cur_eip);
+    gen_helper_qem_ring_trigger(cpu_env, t0);
+    tcg_temp_free(t0);
+}
+
+#if QEM_TRACE_PC_TRIGGER_ENABLED
+/* Fires the PC triggers of the instruction when it is executed */
+static void gen_qem_pc_trigger(const target_ulong cur_eip)
+{
+    TCGv t0 = tcg_const_tl(cur_eip);
+    gen_helper_qem_pc_trigger(cpu_env, t0);
+    tcg_temp_free(t0);
+}
+#endif
+
+#if QEM_TRACE_TIME_SOURCE == QEM_TRACE_TIME_ICOUNT
+/* Adds the instructions the core started in its previous translation block to
+ * the timestamp base of the core. The offset is -1 until the core starts its
+ * first instruction, the records of the block entry use offset 0.
+ */
+static void gen_qem_time_tb_start(void)
+{
+    TCGv_i64 t0 = tcg_temp_new_i64();
+    TCGv_i64 t1 = tcg_temp_new_i64();
+    TCGv_i32 t2 = tcg_const_i32(0);
+    tcg_gen_ld_i64(t0, cpu_env,
+                   -ENV_OFFSET + offsetof(CPUState, qem_time_base));
+    tcg_gen_ld32s_i64(t1, cpu_env,
+                      -ENV_OFFSET + offsetof(CPUState, qem_time_offset));
+    tcg_gen_add_i64(t0, t0, t1);
+    tcg_gen_addi_i64(t0, t0, 1);
+    tcg_gen_st_i64(t0, cpu_env,
+                   -ENV_OFFSET + offsetof(CPUState, qem_time_base));
+    tcg_gen_st_i32(t2, cpu_env,
+                   -ENV_OFFSET + offsetof(CPUState, qem_time_offset));
+    tcg_temp_free_i64(t0);
+    tcg_temp_free_i64(t1);
+    tcg_temp_free_i32(t2);
+}
+
+/* Stores the offset of the instruction in its translation block, the
+ * timestamp of its records
+ */
+static void gen_qem_time_insn(const int offset)
+{
+    TCGv_i32 t0 = tcg_const_i32(offset);
+    tcg_gen_st_i32(t0, cpu_env,
+                   -ENV_OFFSET + offsetof(CPUState, qem_time_offset));
+    tcg_temp_free_i32(t0);
+}
+#endif
+
 /**************************************** LOAD ********************************/
 
 static void gen_qem_datald_trace(const target_ulong simm, const int reg,
                              const int size)
 {
+    if(qem_trace_filter_class(QEM_TRACE_CLASS_LOAD) == 0)
+    {
+        return;
+    }
+
     /* Call the trace helper */
     TCGv t0 = tcg_const_tl(simm);
     TCGv_i32 t1 = tcg_const_i32(reg);
@@ -121,6 +190,11 @@ static void gen_qem_datald_trace(const target_ulong simm, const int reg,
 static void gen_qem_datald_ex_trace(const target_ulong simm, const int reg,
                              const int size)
 {
+    if(qem_trace_filter_class(QEM_TRACE_CLASS_LOAD) == 0)
+    {
+        return;
+    }
+
     /* Call the trace helper */
     TCGv t0 = tcg_const_tl(simm);
     TCGv_i32 t1 = tcg_const_i32(reg);
@@ -134,6 +208,11 @@ static void gen_qem_datald_ex_trace(const target_ulong simm, const int reg,
 static void gen_qem_datald_trace_trad(const int reg0, const int reg1,
                                   const int size)
 {
+    if(qem_trace_filter_class(QEM_TRACE_CLASS_LOAD) == 0)
+    {
+        return;
+    }
+
     /* Call the trace helper */
     TCGv_i32 t0 = tcg_const_i32(reg0);
     TCGv_i32 t1 = tcg_const_i32(reg1);
@@ -147,6 +226,11 @@ static void gen_qem_datald_trace_trad(const int reg0, const int reg1,
 static void gen_qem_datald_ex_trace_trad(const int reg0, const int reg1,
                                   const int size)
 {
+    if(qem_trace_filter_class(QEM_TRACE_CLASS_LOAD) == 0)
+    {
+        return;
+    }
+
     /* Call the trace helper */
     TCGv_i32 t0 = tcg_const_i32(reg0);
     TCGv_i32 t1 = tcg_const_i32(reg1);
@@ -210,6 +294,11 @@ static void gen_qem_datald_trace_ldarx(const target_ulong simm, const int reg)
 static void gen_qem_datast_trace(const target_ulong simm, const int reg,
                              const int size)
 {
+    if(qem_trace_filter_class(QEM_TRACE_CLASS_STORE) == 0)
+    {
+        return;
+    }
+
     /* Call the trace helper */
     TCGv t0 = tcg_const_tl(simm);
     TCGv_i32 t1 = tcg_const_i32(reg);
@@ -223,6 +312,11 @@ static void gen_qem_datast_trace(const target_ulong simm, const int reg,
 static void gen_qem_datast_ex_trace(const target_ulong simm, const int reg,
                              const int size)
 {
+    if(qem_trace_filter_class(QEM_TRACE_CLASS_STORE) == 0)
+    {
+        return;
+    }
+
     /* Call the trace helper */
     TCGv t0 = tcg_const_tl(simm);
     TCGv_i32 t1 = tcg_const_i32(reg);
@@ -236,6 +330,11 @@ static void gen_qem_datast_ex_trace(const target_ulong simm, const int reg,
 static void gen_qem_datast_trace_trad(const int reg0, const int reg1,
                                   const int size)
 {
+    if(qem_trace_filter_class(QEM_TRACE_CLASS_STORE) == 0)
+    {
+        return;
+    }
+
     /* Call the trace helper */
     TCGv_i32 t0 = tcg_const_i32(reg0);
     TCGv_i32 t1 = tcg_const_i32(reg1);
@@ -249,6 +348,11 @@ static void gen_qem_datast_trace_trad(const int reg0, const int reg1,
 static void gen_qem_datast_ex_trace_trad(const int reg0, const int reg1,
                                   const int size)
 {
+    if(qem_trace_filter_class(QEM_TRACE_CLASS_STORE) == 0)
+    {
+        return;
+    }
+
     /* Call the trace helper */
     TCGv_i32 t0 = tcg_const_i32(reg0);
     TCGv_i32 t1 = tcg_const_i32(reg1);
@@ -262,6 +366,11 @@ static void gen_qem_datast_ex_trace_trad(const int reg0, const int reg1,
 static void gen_qem_dcbz_trace_trad(const int reg0, const int reg1,
                                 const int size)
 {
+    if(qem_trace_filter_class(QEM_TRACE_CLASS_CACHE) == 0)
+    {
+        return;
+    }
+
     /* Call the trace helper */
     TCGv_i32 t0 = tcg_const_i32(reg0);
     TCGv_i32 t1 = tcg_const_i32(reg1);
@@ -5085,15 +5194,18 @@ static void gen_dcbf(DisasContext *ctx)
  * QEMTrace START
  ******************************************************************************/
 #if QEM_TRACE_ENABLED
-    TCGv_i32 t1 = tcg_const_i32(rA(ctx->opcode));
-    TCGv_i32 t2 = tcg_const_i32(rB(ctx->opcode));
-    TCGv_i32 t3 = tcg_const_i32(rS(ctx->opcode));
-    TCGv_i32 t4 = tcg_const_i32(QEM_TRACE_GRANULARITY_LINE);
-    gen_helper_qem_dcache_flush_inval(cpu_env, t1, t2, t3, t4);
-    tcg_temp_free_i32(t1);
-    tcg_temp_free_i32(t2);
-    tcg_temp_free_i32(t3);
-    tcg_temp_free_i32(t4);
+    if(qem_trace_filter_class(QEM_TRACE_CLASS_CACHE))
+    {
+        TCGv_i32 t1 = tcg_const_i32(rA(ctx->opcode));
+        TCGv_i32 t2 = tcg_const_i32(rB(ctx->opcode));
+        TCGv_i32 t3 = tcg_const_i32(rS(ctx->opcode));
+        TCGv_i32 t4 = tcg_const_i32(QEM_TRACE_GRANULARITY_LINE);
+        gen_helper_qem_dcache_flush_inval(cpu_env, t1, t2, t3, t4);
+        tcg_temp_free_i32(t1);
+        tcg_temp_free_i32(t2);
+        tcg_temp_free_i32(t3);
+        tcg_temp_free_i32(t4);
+    }
 #endif /* QEM_TRACE_ENABLED */
 /*******************************************************************************
  * QEMTrace END
@@ -5115,15 +5227,18 @@ static void gen_dcbfep(DisasContext *ctx)
  * QEMTrace START
  ******************************************************************************/
 #if QEM_TRACE_ENABLED
-    TCGv_i32 t1 = tcg_const_i32(rA(ctx->opcode));
-    TCGv_i32 t2 = tcg_const_i32(rB(ctx->opcode));
-    TCGv_i32 t3 = tcg_const_i32(rS(ctx->opcode));
-    TCGv_i32 t4 = tcg_const_i32(QEM_TRACE_GRANULARITY_LINE);
-    gen_helper_qem_dcache_flush_inval(cpu_env, t1, t2, t3, t4);
-    tcg_temp_free_i32(t1);
-    tcg_temp_free_i32(t2);
-    tcg_temp_free_i32(t3);
-    tcg_temp_free_i32(t4);
+    if(qem_trace_filter_class(QEM_TRACE_CLASS_CACHE))
+    {
+        TCGv_i32 t1 = tcg_const_i32(rA(ctx->opcode));
+        TCGv_i32 t2 = tcg_const_i32(rB(ctx->opcode));
+        TCGv_i32 t3 = tcg_const_i32(rS(ctx->opcode));
+        TCGv_i32 t4 = tcg_const_i32(QEM_TRACE_GRANULARITY_LINE);
+        gen_helper_qem_dcache_flush_inval(cpu_env, t1, t2, t3, t4);
+        tcg_temp_free_i32(t1);
+        tcg_temp_free_i32(t2);
+        tcg_temp_free_i32(t3);
+        tcg_temp_free_i32(t4);
+    }
 #endif /* QEM_TRACE_ENABLED */
 /*******************************************************************************
  * QEMTrace END
@@ -5152,15 +5267,18 @@ static void gen_dcbi(DisasContext *ctx)
  * QEMTrace START
  ******************************************************************************/
 #if QEM_TRACE_ENABLED
-    TCGv_i32 t1 = tcg_const_i32(rA(ctx->opcode));
-    TCGv_i32 t2 = tcg_const_i32(rB(ctx->opcode));
-    TCGv_i32 t3 = tcg_const_i32(rS(ctx->opcode));
-    TCGv_i32 t4 = tcg_const_i32(QEM_TRACE_GRANULARITY_LINE);
-    gen_helper_qem_dcache_inval(cpu_env, t1, t2, t3, t4);
-    tcg_temp_free_i32(t1);
-    tcg_temp_free_i32(t2);
-    tcg_temp_free_i32(t3);
-    tcg_temp_free_i32(t4);
+    if(qem_trace_filter_class(QEM_TRACE_CLASS_CACHE))
+    {
+        TCGv_i32 t1 = tcg_const_i32(rA(ctx->opcode));
+        TCGv_i32 t2 = tcg_const_i32(rB(ctx->opcode));
+        TCGv_i32 t3 = tcg_const_i32(rS(ctx->opcode));
+        TCGv_i32 t4 = tcg_const_i32(QEM_TRACE_GRANULARITY_LINE);
+        gen_helper_qem_dcache_inval(cpu_env, t1, t2, t3, t4);
+        tcg_temp_free_i32(t1);
+        tcg_temp_free_i32(t2);
+        tcg_temp_free_i32(t3);
+        tcg_temp_free_i32(t4);
+    }
 #endif /* QEM_TRACE_ENABLED */
 /*******************************************************************************
  * QEMTrace END
@@ -5184,32 +5302,35 @@ static void gen_dcbst(DisasContext *ctx)
  * QEMTrace START
  ******************************************************************************/
 #if QEM_TRACE_ENABLED
-#define MEM_E500
-/* On E500 DCBST act like  DCBF */
-#ifndef MEM_E500
-    TCGv_i32 t1 = tcg_const_i32(rA(ctx->opcode));
-    TCGv_i32 t2 = tcg_const_i32(rB(ctx->opcode));
-    TCGv_i32 t3 = tcg_const_i32(rS(ctx->opcode));
-    TCGv_i32 t4 = tcg_const_i32(QEM_TRACE_GRANULARITY_LINE);
-    TCGv_i32 t5 = tcg_const_i32(1);
-    gen_helper_qem_dcache_flush(cpu_env, t1, t2, t3, t4, t5);
-    tcg_temp_free_i32(t1);
-    tcg_temp_free_i32(t2);
-    tcg_temp_free_i32(t3);
-    tcg_temp_free_i32(t4);
-    tcg_temp_free_i32(t5);
-#else
-    TCGv_i32 t1 = tcg_const_i32(rA(ctx->opcode));
-    TCGv_i32 t2 = tcg_const_i32(rB(ctx->opcode));
-    TCGv_i32 t3 = tcg_const_i32(rS(ctx->opcode));
-    TCGv_i32 t4 = tcg_const_i32(QEM_TRACE_GRANULARITY_LINE);
-    gen_helper_qem_dcache_flush_inval(cpu_env, t1, t2, t3, t4);
-    tcg_temp_free_i32(t1);
-    tcg_temp_free_i32(t2);
-    tcg_temp_free_i32(t3);
-    tcg_temp_free_i32(t4);
-#endif /* MEM_E500 */
-#undef MEM_E500
+    if(qem_trace_filter_class(QEM_TRACE_CLASS_CACHE))
+    {
+    #define MEM_E500
+    /* On E500 DCBST act like  DCBF */
+    #ifndef MEM_E500
+        TCGv_i32 t1 = tcg_const_i32(rA(ctx->opcode));
+        TCGv_i32 t2 = tcg_const_i32(rB(ctx->opcode));
+        TCGv_i32 t3 = tcg_const_i32(rS(ctx->opcode));
+        TCGv_i32 t4 = tcg_const_i32(QEM_TRACE_GRANULARITY_LINE);
+        TCGv_i32 t5 = tcg_const_i32(1);
+        gen_helper_qem_dcache_flush(cpu_env, t1, t2, t3, t4, t5);
+        tcg_temp_free_i32(t1);
+        tcg_temp_free_i32(t2);
+        tcg_temp_free_i32(t3);
+        tcg_temp_free_i32(t4);
+        tcg_temp_free_i32(t5);
+    #else
+        TCGv_i32 t1 = tcg_const_i32(rA(ctx->opcode));
+        TCGv_i32 t2 = tcg_const_i32(rB(ctx->opcode));
+        TCGv_i32 t3 = tcg_const_i32(rS(ctx->opcode));
+        TCGv_i32 t4 = tcg_const_i32(QEM_TRACE_GRANULARITY_LINE);
+        gen_helper_qem_dcache_flush_inval(cpu_env, t1, t2, t3, t4);
+        tcg_temp_free_i32(t1);
+        tcg_temp_free_i32(t2);
+        tcg_temp_free_i32(t3);
+        tcg_temp_free_i32(t4);
+    #endif /* MEM_E500 */
+    #undef MEM_E500
+    }
 #endif /* QEM_TRACE_ENABLED */
 /*******************************************************************************
  * QEMTrace END
@@ -5232,32 +5353,35 @@ static void gen_dcbstep(DisasContext *ctx)
  * QEMTrace START
  ******************************************************************************/
 #if QEM_TRACE_ENABLED
-#define MEM_E500
-/* On E500 DCBST act like  DCBF */
-#ifndef MEM_E500
-    TCGv_i32 t1 = tcg_const_i32(rA(ctx->opcode));
-    TCGv_i32 t2 = tcg_const_i32(rB(ctx->opcode));
-    TCGv_i32 t3 = tcg_const_i32(rS(ctx->opcode));
-    TCGv_i32 t4 = tcg_const_i32(QEM_TRACE_GRANULARITY_LINE);
-    TCGv_i32 t5 = tcg_const_i32(1);
-    gen_helper_qem_dcache_flush(cpu_env, t1, t2, t3, t4, t5);
-    tcg_temp_free_i32(t1);
-    tcg_temp_free_i32(t2);
-    tcg_temp_free_i32(t3);
-    tcg_temp_free_i32(t4);
-    tcg_temp_free_i32(t5);
-#else
-    TCGv_i32 t1 = tcg_const_i32(rA(ctx->opcode));
-    TCGv_i32 t2 = tcg_const_i32(rB(ctx->opcode));
-    TCGv_i32 t3 = tcg_const_i32(rS(ctx->opcode));
-    TCGv_i32 t4 = tcg_const_i32(QEM_TRACE_GRANULARITY_LINE);
-    gen_helper_qem_dcache_flush_inval(cpu_env, t1, t2, t3, t4);
-    tcg_temp_free_i32(t1);
-    tcg_temp_free_i32(t2);
-    tcg_temp_free_i32(t3);
-    tcg_temp_free_i32(t4);
-#endif /* MEM_E500 */
-#undef MEM_E500
+    if(qem_trace_filter_class(QEM_TRACE_CLASS_CACHE))
+    {
+    #define MEM_E500
+    /* On E500 DCBST act like  DCBF */
+    #ifndef MEM_E500
+        TCGv_i32 t1 = tcg_const_i32(rA(ctx->opcode));
+        TCGv_i32 t2 = tcg_const_i32(rB(ctx->opcode));
+        TCGv_i32 t3 = tcg_const_i32(rS(ctx->opcode));
+        TCGv_i32 t4 = tcg_const_i32(QEM_TRACE_GRANULARITY_LINE);
+        TCGv_i32 t5 = tcg_const_i32(1);
+        gen_helper_qem_dcache_flush(cpu_env, t1, t2, t3, t4, t5);
+        tcg_temp_free_i32(t1);
+        tcg_temp_free_i32(t2);
+        tcg_temp_free_i32(t3);
+        tcg_temp_free_i32(t4);
+        tcg_temp_free_i32(t5);
+    #else
+        TCGv_i32 t1 = tcg_const_i32(rA(ctx->opcode));
+        TCGv_i32 t2 = tcg_const_i32(rB(ctx->opcode));
+        TCGv_i32 t3 = tcg_const_i32(rS(ctx->opcode));
+        TCGv_i32 t4 = tcg_const_i32(QEM_TRACE_GRANULARITY_LINE);
+        gen_helper_qem_dcache_flush_inval(cpu_env, t1, t2, t3, t4);
+        tcg_temp_free_i32(t1);
+        tcg_temp_free_i32(t2);
+        tcg_temp_free_i32(t3);
+        tcg_temp_free_i32(t4);
+    #endif /* MEM_E500 */
+    #undef MEM_E500
+    }
 #endif /* QEM_TRACE_ENABLED */
 /*******************************************************************************
  * QEMTrace END
@@ -5277,17 +5401,20 @@ static void gen_dcbt(DisasContext *ctx)
  * QEMTrace START
  ******************************************************************************/
 #if QEM_TRACE_ENABLED
-    TCGv_i32 t1 = tcg_const_i32(rA(ctx->opcode));
-    TCGv_i32 t2 = tcg_const_i32(rB(ctx->opcode));
-    TCGv_i32 t3 = tcg_const_i32(rS(ctx->opcode));
-    TCGv_i32 t4 = tcg_const_i32(QEM_TRACE_GRANULARITY_LINE);
-    TCGv_i32 t5 = tcg_const_i32(0);
-    gen_helper_qem_dcache_prefetch_non_inibited(cpu_env, t1, t2, t3, t4, t5);
-    tcg_temp_free_i32(t1);
-    tcg_temp_free_i32(t2);
-    tcg_temp_free_i32(t3);
-    tcg_temp_free_i32(t4);
-    tcg_temp_free_i32(t5);
+    if(qem_trace_filter_class(QEM_TRACE_CLASS_CACHE))
+    {
+        TCGv_i32 t1 = tcg_const_i32(rA(ctx->opcode));
+        TCGv_i32 t2 = tcg_const_i32(rB(ctx->opcode));
+        TCGv_i32 t3 = tcg_const_i32(rS(ctx->opcode));
+        TCGv_i32 t4 = tcg_const_i32(QEM_TRACE_GRANULARITY_LINE);
+        TCGv_i32 t5 = tcg_const_i32(0);
+        gen_helper_qem_dcache_prefetch_non_inibited(cpu_env, t1, t2, t3, t4, t5);
+        tcg_temp_free_i32(t1);
+        tcg_temp_free_i32(t2);
+        tcg_temp_free_i32(t3);
+        tcg_temp_free_i32(t4);
+        tcg_temp_free_i32(t5);
+    }
 #endif /* QEM_TRACE_ENABLED */
 /*******************************************************************************
  * QEMTrace END
@@ -5305,17 +5432,20 @@ static void gen_dcbtep(DisasContext *ctx)
  * QEMTrace START
  ******************************************************************************/
 #if QEM_TRACE_ENABLED
-    TCGv_i32 t1 = tcg_const_i32(rA(ctx->opcode));
-    TCGv_i32 t2 = tcg_const_i32(rB(ctx->opcode));
-    TCGv_i32 t3 = tcg_const_i32(rS(ctx->opcode));
-    TCGv_i32 t4 = tcg_const_i32(QEM_TRACE_GRANULARITY_LINE);
-    TCGv_i32 t5 = tcg_const_i32(0);
-    gen_helper_qem_dcache_prefetch_non_inibited(cpu_env, t1, t2, t3, t4, t5);
-    tcg_temp_free_i32(t1);
-    tcg_temp_free_i32(t2);
-    tcg_temp_free_i32(t3);
-    tcg_temp_free_i32(t4);
-    tcg_temp_free_i32(t5);
+    if(qem_trace_filter_class(QEM_TRACE_CLASS_CACHE))
+    {
+        TCGv_i32 t1 = tcg_const_i32(rA(ctx->opcode));
+        TCGv_i32 t2 = tcg_const_i32(rB(ctx->opcode));
+        TCGv_i32 t3 = tcg_const_i32(rS(ctx->opcode));
+        TCGv_i32 t4 = tcg_const_i32(QEM_TRACE_GRANULARITY_LINE);
+        TCGv_i32 t5 = tcg_const_i32(0);
+        gen_helper_qem_dcache_prefetch_non_inibited(cpu_env, t1, t2, t3, t4, t5);
+        tcg_temp_free_i32(t1);
+        tcg_temp_free_i32(t2);
+        tcg_temp_free_i32(t3);
+        tcg_temp_free_i32(t4);
+        tcg_temp_free_i32(t5);
+    }
 #endif /* QEM_TRACE_ENABLED */
 /*******************************************************************************
  * QEMTrace END
@@ -5333,17 +5463,20 @@ static void gen_dcbtst(DisasContext *ctx)
  * QEMTrace START
  ******************************************************************************/
 #if QEM_TRACE_ENABLED
-    TCGv_i32 t1 = tcg_const_i32(rA(ctx->opcode));
-    TCGv_i32 t2 = tcg_const_i32(rB(ctx->opcode));
-    TCGv_i32 t3 = tcg_const_i32(rS(ctx->opcode));
-    TCGv_i32 t4 = tcg_const_i32(QEM_TRACE_GRANULARITY_LINE);
-    TCGv_i32 t5 = tcg_const_i32(1);
-    gen_helper_qem_dcache_prefetch_non_inibited(cpu_env, t1, t2, t3, t4, t5);
-    tcg_temp_free_i32(t1);
-    tcg_temp_free_i32(t2);
-    tcg_temp_free_i32(t3);
-    tcg_temp_free_i32(t4);
-    tcg_temp_free_i32(t5);
+    if(qem_trace_filter_class(QEM_TRACE_CLASS_CACHE))
+    {
+        TCGv_i32 t1 = tcg_const_i32(rA(ctx->opcode));
+        TCGv_i32 t2 = tcg_const_i32(rB(ctx->opcode));
+        TCGv_i32 t3 = tcg_const_i32(rS(ctx->opcode));
+        TCGv_i32 t4 = tcg_const_i32(QEM_TRACE_GRANULARITY_LINE);
+        TCGv_i32 t5 = tcg_const_i32(1);
+        gen_helper_qem_dcache_prefetch_non_inibited(cpu_env, t1, t2, t3, t4, t5);
+        tcg_temp_free_i32(t1);
+        tcg_temp_free_i32(t2);
+        tcg_temp_free_i32(t3);
+        tcg_temp_free_i32(t4);
+        tcg_temp_free_i32(t5);
+    }
 #endif /* QEM_TRACE_ENABLED */
 /*******************************************************************************
  * QEMTrace END
@@ -5361,17 +5494,20 @@ static void gen_dcbtstep(DisasContext *ctx)
  * QEMTrace START
  ******************************************************************************/
 #if QEM_TRACE_ENABLED
-    TCGv_i32 t1 = tcg_const_i32(rA(ctx->opcode));
-    TCGv_i32 t2 = tcg_const_i32(rB(ctx->opcode));
-    TCGv_i32 t3 = tcg_const_i32(rS(ctx->opcode));
-    TCGv_i32 t4 = tcg_const_i32(QEM_TRACE_GRANULARITY_LINE);
-    TCGv_i32 t5 = tcg_const_i32(1);
-    gen_helper_qem_dcache_prefetch_non_inibited(cpu_env, t1, t2, t3, t4, t5);
-    tcg_temp_free_i32(t1);
-    tcg_temp_free_i32(t2);
-    tcg_temp_free_i32(t3);
-    tcg_temp_free_i32(t4);
-    tcg_temp_free_i32(t5);
+    if(qem_trace_filter_class(QEM_TRACE_CLASS_CACHE))
+    {
+        TCGv_i32 t1 = tcg_const_i32(rA(ctx->opcode));
+        TCGv_i32 t2 = tcg_const_i32(rB(ctx->opcode));
+        TCGv_i32 t3 = tcg_const_i32(rS(ctx->opcode));
+        TCGv_i32 t4 = tcg_const_i32(QEM_TRACE_GRANULARITY_LINE);
+        TCGv_i32 t5 = tcg_const_i32(1);
+        gen_helper_qem_dcache_prefetch_non_inibited(cpu_env, t1, t2, t3, t4, t5);
+        tcg_temp_free_i32(t1);
+        tcg_temp_free_i32(t2);
+        tcg_temp_free_i32(t3);
+        tcg_temp_free_i32(t4);
+        tcg_temp_free_i32(t5);
+    }
 #endif /* QEM_TRACE_ENABLED */
 /*******************************************************************************
  * QEMTrace END
@@ -5391,17 +5527,20 @@ static void gen_dcbtls(DisasContext *ctx)
  * QEMTrace START
  ******************************************************************************/
 #if QEM_TRACE_ENABLED
-    TCGv_i32 t1 = tcg_const_i32(rA(ctx->opcode));
-    TCGv_i32 t2 = tcg_const_i32(rB(ctx->opcode));
-    TCGv_i32 t3 = tcg_const_i32(rS(ctx->opcode));
-    TCGv_i32 t4 = tcg_const_i32(QEM_TRACE_GRANULARITY_LINE);
-    TCGv_i32 t5 = tcg_const_i32(0);
-    gen_helper_qem_dcache_lock(cpu_env, t1, t2, t3, t4, t5);
-    tcg_temp_free_i32(t1);
-    tcg_temp_free_i32(t2);
-    tcg_temp_free_i32(t3);
-    tcg_temp_free_i32(t4);
-    tcg_temp_free_i32(t5);
+    if(qem_trace_filter_class(QEM_TRACE_CLASS_CACHE))
+    {
+        TCGv_i32 t1 = tcg_const_i32(rA(ctx->opcode));
+        TCGv_i32 t2 = tcg_const_i32(rB(ctx->opcode));
+        TCGv_i32 t3 = tcg_const_i32(rS(ctx->opcode));
+        TCGv_i32 t4 = tcg_const_i32(QEM_TRACE_GRANULARITY_LINE);
+        TCGv_i32 t5 = tcg_const_i32(0);
+        gen_helper_qem_dcache_lock(cpu_env, t1, t2, t3, t4, t5);
+        tcg_temp_free_i32(t1);
+        tcg_temp_free_i32(t2);
+        tcg_temp_free_i32(t3);
+        tcg_temp_free_i32(t4);
+        tcg_temp_free_i32(t5);
+    }
 #endif /* QEM_TRACE_ENABLED */
 /*******************************************************************************
  * QEMTrace END
@@ -5417,6 +5556,11 @@ static void gen_dcbtls(DisasContext *ctx)
 /* dcbtstls */
 static void gen_dcbtstls(DisasContext *ctx)
 {
+    if(qem_trace_filter_class(QEM_TRACE_CLASS_CACHE) == 0)
+    {
+        return;
+    }
+
     TCGv_i32 t0 = tcg_const_i32(1);
     TCGv_i32 t1 = tcg_const_i32(rA(ctx->opcode));
     TCGv_i32 t2 = tcg_const_i32(rB(ctx->opcode));
@@ -5434,6 +5578,11 @@ static void gen_dcbtstls(DisasContext *ctx)
 /* dcblc */
 static void gen_dcblc(DisasContext *ctx)
 {
+    if(qem_trace_filter_class(QEM_TRACE_CLASS_CACHE) == 0)
+    {
+        return;
+    }
+
     TCGv_i32 t1 = tcg_const_i32(rA(ctx->opcode));
     TCGv_i32 t2 = tcg_const_i32(rB(ctx->opcode));
     TCGv_i32 t3 = tcg_const_i32(rS(ctx->opcode));
@@ -5448,6 +5597,11 @@ static void gen_dcblc(DisasContext *ctx)
 /* icbtls */
 static void gen_icbtls(DisasContext *ctx)
 {
+    if(qem_trace_filter_class(QEM_TRACE_CLASS_CACHE) == 0)
+    {
+        return;
+    }
+
     TCGv_i32 t1 = tcg_const_i32(rA(ctx->opcode));
     TCGv_i32 t2 = tcg_const_i32(rB(ctx->opcode));
     TCGv_i32 t3 = tcg_const_i32(rS(ctx->opcode));
@@ -5464,6 +5618,11 @@ static void gen_icbtls(DisasContext *ctx)
 /* icblc */
 static void gen_icblc(DisasContext *ctx)
 {
+    if(qem_trace_filter_class(QEM_TRACE_CLASS_CACHE) == 0)
+    {
+        return;
+    }
+
     TCGv_i32 t1 = tcg_const_i32(rA(ctx->opcode));
     TCGv_i32 t2 = tcg_const_i32(rB(ctx->opcode));
     TCGv_i32 t3 = tcg_const_i32(rS(ctx->opcode));
@@ -5581,15 +5740,18 @@ static void gen_icbi(DisasContext *ctx)
  * QEMTrace START
  ******************************************************************************/
 #if QEM_TRACE_ENABLED
-    TCGv_i32 t1 = tcg_const_i32(rA(ctx->opcode));
-    TCGv_i32 t2 = tcg_const_i32(rB(ctx->opcode));
-    TCGv_i32 t3 = tcg_const_i32(rS(ctx->opcode));
-    TCGv_i32 t4 = tcg_const_i32(QEM_TRACE_GRANULARITY_LINE);
-    gen_helper_qem_icache_inval(cpu_env, t1, t2, t3, t4);
-    tcg_temp_free_i32(t1);
-    tcg_temp_free_i32(t2);
-    tcg_temp_free_i32(t3);
-    tcg_temp_free_i32(t4);
+    if(qem_trace_filter_class(QEM_TRACE_CLASS_CACHE))
+    {
+        TCGv_i32 t1 = tcg_const_i32(rA(ctx->opcode));
+        TCGv_i32 t2 = tcg_const_i32(rB(ctx->opcode));
+        TCGv_i32 t3 = tcg_const_i32(rS(ctx->opcode));
+        TCGv_i32 t4 = tcg_const_i32(QEM_TRACE_GRANULARITY_LINE);
+        gen_helper_qem_icache_inval(cpu_env, t1, t2, t3, t4);
+        tcg_temp_free_i32(t1);
+        tcg_temp_free_i32(t2);
+        tcg_temp_free_i32(t3);
+        tcg_temp_free_i32(t4);
+    }
 #endif /* QEM_TRACE_ENABLED */
 
 /*******************************************************************************
@@ -5612,15 +5774,18 @@ static void gen_icbiep(DisasContext *ctx)
  * QEMTrace START
  ******************************************************************************/
 #if QEM_TRACE_ENABLED
-    TCGv_i32 t1 = tcg_const_i32(rA(ctx->opcode));
-    TCGv_i32 t2 = tcg_const_i32(rB(ctx->opcode));
-    TCGv_i32 t3 = tcg_const_i32(rS(ctx->opcode));
-    TCGv_i32 t4 = tcg_const_i32(QEM_TRACE_GRANULARITY_LINE);
-    gen_helper_qem_icache_inval(cpu_env, t1, t2, t3, t4);
-    tcg_temp_free_i32(t1);
-    tcg_temp_free_i32(t2);
-    tcg_temp_free_i32(t3);
-    tcg_temp_free_i32(t4);
+    if(qem_trace_filter_class(QEM_TRACE_CLASS_CACHE))
+    {
+        TCGv_i32 t1 = tcg_const_i32(rA(ctx->opcode));
+        TCGv_i32 t2 = tcg_const_i32(rB(ctx->opcode));
+        TCGv_i32 t3 = tcg_const_i32(rS(ctx->opcode));
+        TCGv_i32 t4 = tcg_const_i32(QEM_TRACE_GRANULARITY_LINE);
+        gen_helper_qem_icache_inval(cpu_env, t1, t2, t3, t4);
+        tcg_temp_free_i32(t1);
+        tcg_temp_free_i32(t2);
+        tcg_temp_free_i32(t3);
+        tcg_temp_free_i32(t4);
+    }
 #endif /* QEM_TRACE_ENABLED */
 
 /*******************************************************************************
@@ -6735,19 +6900,22 @@ static void gen_clf(DisasContext *ctx)
  * QEMTrace START
  ******************************************************************************/
 #if QEM_TRACE_ENABLED
-    /* We flush both instruction and data cache */
-    TCGv_i32 t1 = tcg_const_i32(rA(ctx->opcode));
-    TCGv_i32 t2 = tcg_const_i32(rB(ctx->opcode));
-    TCGv_i32 t3 = tcg_const_i32(rS(ctx->opcode));
-    TCGv_i32 t4 = tcg_const_i32(QEM_TRACE_GRANULARITY_LINE);
-    TCGv_i32 t5 = tcg_const_i32(0);
-    gen_helper_qem_dcache_flush(cpu_env, t1, t2, t3, t4, t5);
-    gen_helper_qem_icache_flush(cpu_env, t1, t2, t3, t4);
-    tcg_temp_free_i32(t1);
-    tcg_temp_free_i32(t2);
-    tcg_temp_free_i32(t3);
-    tcg_temp_free_i32(t4);
-    tcg_temp_free_i32(t5);
+    if(qem_trace_filter_class(QEM_TRACE_CLASS_CACHE))
+    {
+        /* We flush both instruction and data cache */
+        TCGv_i32 t1 = tcg_const_i32(rA(ctx->opcode));
+        TCGv_i32 t2 = tcg_const_i32(rB(ctx->opcode));
+        TCGv_i32 t3 = tcg_const_i32(rS(ctx->opcode));
+        TCGv_i32 t4 = tcg_const_i32(QEM_TRACE_GRANULARITY_LINE);
+        TCGv_i32 t5 = tcg_const_i32(0);
+        gen_helper_qem_dcache_flush(cpu_env, t1, t2, t3, t4, t5);
+        gen_helper_qem_icache_flush(cpu_env, t1, t2, t3, t4);
+        tcg_temp_free_i32(t1);
+        tcg_temp_free_i32(t2);
+        tcg_temp_free_i32(t3);
+        tcg_temp_free_i32(t4);
+        tcg_temp_free_i32(t5);
+    }
 #endif /* QNE_TRACE_ENABLED */
 /*******************************************************************************
  * QEMTrace END
@@ -6764,17 +6932,20 @@ static void gen_cli(DisasContext *ctx)
  * QEMTrace START
  ******************************************************************************/
 #if QEM_TRACE_ENABLED
-    /* We invalidate both instruction and data cache */
-    TCGv_i32 t1 = tcg_const_i32(rA(ctx->opcode));
-    TCGv_i32 t2 = tcg_const_i32(rB(ctx->opcode));
-    TCGv_i32 t3 = tcg_const_i32(rS(ctx->opcode));
-    TCGv_i32 t4 = tcg_const_i32(QEM_TRACE_GRANULARITY_LINE);
-    gen_helper_qem_dcache_inval(cpu_env, t1, t2, t3, t4);
-    gen_helper_qem_icache_inval(cpu_env, t1, t2, t3, t4);
-    tcg_temp_free_i32(t1);
-    tcg_temp_free_i32(t2);
-    tcg_temp_free_i32(t3);
-    tcg_temp_free_i32(t4);
+    if(qem_trace_filter_class(QEM_TRACE_CLASS_CACHE))
+    {
+        /* We invalidate both instruction and data cache */
+        TCGv_i32 t1 = tcg_const_i32(rA(ctx->opcode));
+        TCGv_i32 t2 = tcg_const_i32(rB(ctx->opcode));
+        TCGv_i32 t3 = tcg_const_i32(rS(ctx->opcode));
+        TCGv_i32 t4 = tcg_const_i32(QEM_TRACE_GRANULARITY_LINE);
+        gen_helper_qem_dcache_inval(cpu_env, t1, t2, t3, t4);
+        gen_helper_qem_icache_inval(cpu_env, t1, t2, t3, t4);
+        tcg_temp_free_i32(t1);
+        tcg_temp_free_i32(t2);
+        tcg_temp_free_i32(t3);
+        tcg_temp_free_i32(t4);
+    }
 #endif /* QNE_TRACE_ENABLED */
 /*******************************************************************************
  * QEMTrace END
@@ -7206,13 +7377,16 @@ static void gen_icbt_40x(DisasContext *ctx)
  * QEMTrace START
  ******************************************************************************/
 #if QEM_TRACE_ENABLED
-     TCGv_i32 t1 = tcg_const_i32(rA(ctx->opcode));
-     TCGv_i32 t2 = tcg_const_i32(rB(ctx->opcode));
-     TCGv_i32 t3 = tcg_const_i32(rS(ctx->opcode));
-     gen_helper_qem_icbt(cpu_env, t1, t2, t3);
-     tcg_temp_free_i32(t1);
-     tcg_temp_free_i32(t2);
-     tcg_temp_free_i32(t3);
+    if(qem_trace_filter_class(QEM_TRACE_CLASS_CACHE))
+    {
+         TCGv_i32 t1 = tcg_const_i32(rA(ctx->opcode));
+         TCGv_i32 t2 = tcg_const_i32(rB(ctx->opcode));
+         TCGv_i32 t3 = tcg_const_i32(rS(ctx->opcode));
+         gen_helper_qem_icbt(cpu_env, t1, t2, t3);
+         tcg_temp_free_i32(t1);
+         tcg_temp_free_i32(t2);
+         tcg_temp_free_i32(t3);
+    }
 #endif /* QEM_TRACE_ENABLED */
 /*******************************************************************************
  * QEMTrace END
@@ -7228,16 +7402,19 @@ static void gen_iccci(DisasContext *ctx)
  * QEMTrace START
  ******************************************************************************/
 #if QEM_TRACE_ENABLED
-    TCGv_i32 t1 = tcg_const_i32(rA(ctx->opcode));
-    TCGv_i32 t2 = tcg_const_i32(rB(ctx->opcode));
-    TCGv_i32 t3 = tcg_const_i32(rS(ctx->opcode));
-    TCGv_i32 t4 = tcg_const_i32(QEM_TRACE_GRANULARITY_SET);
-    gen_helper_qem_dcache_inval(cpu_env, t1, t2, t3, t4);
-    gen_helper_qem_icache_inval(cpu_env, t1, t2, t3, t4);
-    tcg_temp_free_i32(t1);
-    tcg_temp_free_i32(t2);
-    tcg_temp_free_i32(t3);
-    tcg_temp_free_i32(t4);
+    if(qem_trace_filter_class(QEM_TRACE_CLASS_CACHE))
+    {
+        TCGv_i32 t1 = tcg_const_i32(rA(ctx->opcode));
+        TCGv_i32 t2 = tcg_const_i32(rB(ctx->opcode));
+        TCGv_i32 t3 = tcg_const_i32(rS(ctx->opcode));
+        TCGv_i32 t4 = tcg_const_i32(QEM_TRACE_GRANULARITY_SET);
+        gen_helper_qem_dcache_inval(cpu_env, t1, t2, t3, t4);
+        gen_helper_qem_icache_inval(cpu_env, t1, t2, t3, t4);
+        tcg_temp_free_i32(t1);
+        tcg_temp_free_i32(t2);
+        tcg_temp_free_i32(t3);
+        tcg_temp_free_i32(t4);
+    }
 #endif /* QEM_TRACE_ENABLED */
 /*******************************************************************************
  * QEMTrace END
@@ -7616,14 +7793,17 @@ static void gen_icbt_440(DisasContext *ctx)
  * QEMTrace START
  ******************************************************************************/
 #if QEM_TRACE_ENABLED
+    if(qem_trace_filter_class(QEM_TRACE_CLASS_CACHE))
+    {
 
-     TCGv_i32 t1 = tcg_const_i32(rA(ctx->opcode));
-     TCGv_i32 t2 = tcg_const_i32(rB(ctx->opcode));
-     TCGv_i32 t3 = tcg_const_i32(rS(ctx->opcode));
-     gen_helper_qem_icbt(cpu_env, t1, t2, t3);
-     tcg_temp_free_i32(t1);
-     tcg_temp_free_i32(t2);
-     tcg_temp_free_i32(t3);
+         TCGv_i32 t1 = tcg_const_i32(rA(ctx->opcode));
+         TCGv_i32 t2 = tcg_const_i32(rB(ctx->opcode));
+         TCGv_i32 t3 = tcg_const_i32(rS(ctx->opcode));
+         gen_helper_qem_icbt(cpu_env, t1, t2, t3);
+         tcg_temp_free_i32(t1);
+         tcg_temp_free_i32(t2);
+         tcg_temp_free_i32(t3);
+    }
 #endif /* QEM_TRACE_ENABLED */
 /*******************************************************************************
  * QEMTrace END
@@ -8810,6 +8990,28 @@ static void ppc_tr_init_disas_context(DisasContextBase *dcbase, CPUState *cs)
 
 static void ppc_tr_tb_start(DisasContextBase *db, CPUState *cs)
 {
+/*******************************************************************************
+ * QEMTrace START
+ ******************************************************************************/
+#if QEM_TRACE_ENABLED
+    DisasContext *ctx = container_of(db, DisasContext, base);
+
+    /* Select the event classes instrumented in this translation block */
+    qem_trace_filter_tb_start(ctx->pr);
+#if QEM_TRACE_TIME_SOURCE == QEM_TRACE_TIME_ICOUNT
+    gen_qem_time_tb_start();
+#endif
+#if QEM_TRACE_ASID_FILTER_ENABLED
+    /* Check the address space once per translation block */
+    if(qem_trace_filter_class(QEM_TRACE_CLASS_EVENTS))
+    {
+        gen_helper_qem_tb_enter_trace(cpu_env);
+    }
+#endif
+#endif /* QEM_TRACE_ENABLED */
+/*******************************************************************************
+ * QEMTrace END
+ ******************************************************************************/
 }
 
 static void ppc_tr_insn_start(DisasContextBase *dcbase, CPUState *cs)
@@ -8857,7 +9059,21 @@ static void ppc_tr_translate_insn(DisasContextBase *dcbase, CPUState *cs)
  ******************************************************************************/
 #if QEM_TRACE_ENABLED
 
+#if QEM_TRACE_TIME_SOURCE == QEM_TRACE_TIME_ICOUNT
+    gen_qem_time_insn(ctx->base.num_insns - 1);
+#endif
+
     /* We add a call to the trace helper */
+#if QEM_TRACE_PC_TRIGGER_ENABLED
+    if(qem_trace_trigger_pc_match(ctx->base.pc_next))
+    {
+        gen_qem_pc_trigger(ctx->base.pc_next);
+    }
+#endif
+    if(qem_trace_ring_pc_match(ctx->base.pc_next))
+    {
+        gen_qem_ring_trigger(ctx->base.pc_next);
+    }
     gen_qem_instld_trace(ctx->base.pc_next, 4);
 
 #endif /* QEM_TRACE_ENABLED */
@@ -8943,6 +9159,12 @@ static void ppc_tr_translate_insn(DisasContextBase *dcbase, CPUState *cs)
         gen_helper_qem_flash_inval_dcache(cpu_env);
         custom_inst = 1;
     }
+    /* Ring trigger opcode */
+    else if(ctx->opcode == QEM_TRACE_RING_TRIGGER_OP)
+    {
+        gen_qem_ring_trigger(ctx->base.pc_next - 4);
+        custom_inst = 1;
+    }
 
     if(custom_inst == 0)
     {
@@ -9,12 +9,16 @@
  *
  * This class is an implementation of the SMI. This
  * SMI is developped for POSIX compliant environments.
- * The client is part of a 1 to 1 unidirectionnal pipe
- * between two process.
- * Its behaviour will not be correct if more than one process is using it as a
- * sender or as a receiver. At any time only one sender and only one receiver is
- * authorized.
- * The client can only receive data.
+ * The client is part of a 1 to N unidirectionnal pipe
+ * between processes.
+ * At any time only one sender is authorized. Up to QEM_SMI_MAX_READER_COUNT
+ * receivers can be connected, from different processes or from different
+ * threads of the same process (one qem_smi_reader_t per thread). Depending on
+ * the sender configuration, each receiver gets the whole stream or a
+ * partition of the stream. The number of receivers is set by the sender that
+ * waits for all of them before starting the stream.
+ * The client can only receive data. The ranges of the received trace are
+ * expanded with qem_trace_decoder.h.
  ******************************************************************************/
 
 #ifndef __QEM_POSIX_SMI_H_
@@ -22,6 +26,7 @@
 
 #include <stdint.h>    /* Genetric types */
 #include <semaphore.h> /* semaphores */
+#include <pthread.h>   /* pthread_mutex_t pthread_cond_t */
 
 
 /*******************************************************************************
@@ -38,14 +43,54 @@
 #define QEM_SMI_SHARED_MUTEX      "/QEM_SMI_MUTEX"
 #define QEM_SMI_SHARED_COND_READ  "/QEM_SMI_COND_READ"
 #define QEM_SMI_SHARED_COND_WRITE "/QEM_SMI_COND_WRITE"
+#define QEM_SMI_SHARED_SOCKET     "/QEM_SMI_SOCKET"
+
+/* Sessions, the session name is appended to the shared objects names so that
+ * several traced guests can run at the same time.
+ */
+#define QEM_SMI_SESSION_ENV       "QEM_SMI_SESSION"
+#define QEM_SMI_SESSION_MAX       32
+#define QEM_SMI_NAME_MAX          64
 
 #define QEM_SMI_HANDSHAKE_MAGIC   0xDEADCAFE
 
 /* Buffer representation */
 /*
- * #----------|-----------|-----------|-----------------------#
- * | BCNT 16b | BMASK 16b | BSIZE 32b | Buffer 1 ... Buffer n |
- * #----------|-----------|-----------|-----------------------#
+ * #----------|-----------|-----------|-----------|-----------|-------------#
+ * | BCNT 16b | BMASK 16b | BSIZE 32b | RMASK 16b | EMASK 16b | BPEND 16b*n |
+ * #----------|-----------|-----------|-----------|-----------|-------------#
+ * #-------------|--------------|---------------|-----------|-------------|
+ * | BSEQ 32b*n  | BUSED 32b*n  | BDROP 32b*n*r | DROPS 32b | RDROP 32b*r |
+ * #-------------|--------------|---------------|-----------|-------------|
+ * #-------------|----------|---------#
+ * | RPID 32b*r  | CCNT 32b | CID 32b |
+ * #-------------|----------|---------#
+ * #-----------------------#
+ * | Buffer 1 ... Buffer n |
+ * #-----------------------#
+ *
+ * RMASK is the mask of the registered readers (1 reader per bit), EMASK the
+ * mask of the readers detached by the server and BPEND the mask of the readers
+ * that still have to release each block. A block is recycled once its BPEND
+ * entry is cleared, BMASK is kept as the summary of the non empty BPEND
+ * entries.
+ * BSEQ is the sequence number of each block (starting at 1) and BUSED the
+ * number of bytes of the block that contain data. Readers always consume their
+ * blocks in sequence order.
+ * DROPS is the total number of messages dropped since the stream started and
+ * RDROP the number of them lost by each reader slot: the messages of a block
+ * dropped while it would have been handed to the reader, or of a block taken
+ * back before the reader released it. A slot counter is reset when a reader
+ * registers in the slot. BDROP holds the value of RDROP of each slot when
+ * each block was committed, the difference between two blocks a reader
+ * receives gives the number of messages it lost between them.
+ * RPID is the process identifier of the reader registered in each slot, set
+ * before the reader ends its handshake when it sends an event descriptor to
+ * the server and 0 otherwise. The server only accepts a descriptor for a slot
+ * from that process.
+ * CCNT is the number of channels of the session and CID the index of the
+ * channel owning the buffer. Each channel has its own shared objects, the
+ * first one uses the session names and channel n appends ".n" to them.
  */
 
 /** WARNING Block count must be set accordingly to the size of the block mask.
@@ -53,6 +98,13 @@
  */
 #define QEM_SMI_DATA_FIRST_BUFFER_OFFSET SMI_DATA_BUFFER_META_DATA_SIZE
 
+/* Maximal number of blocks and readers, bounded by the masks size */
+#define QEM_SMI_MAX_BLOCK_COUNT  16
+#define QEM_SMI_MAX_READER_COUNT 16
+
+/* Maximal number of channels of a session */
+#define QEM_SMI_MAX_CHANNEL_COUNT 16
+
 #define QEM_SMI_META_BLOCK_COUNT_OFFSET 0
 #define QEM_SMI_META_BLOCK_COUNT_SIZE   2
 
@@ -64,8 +116,77 @@
 (QEM_SMI_META_BLOCK_MASK_OFFSET + QEM_SMI_META_BLOCK_MASK_SIZE)
 #define QEM_SMI_META_BLOCK_SIZE_SIZE    4
 
-#define QEM_SMI_DATA_BUFFER_META_DATA_SIZE \
+#define QEM_SMI_META_READER_MASK_OFFSET \
 (QEM_SMI_META_BLOCK_SIZE_OFFSET + QEM_SMI_META_BLOCK_SIZE_SIZE)
+#define QEM_SMI_META_READER_MASK_SIZE   2
+
+#define QEM_SMI_META_EVICT_MASK_OFFSET \
+(QEM_SMI_META_READER_MASK_OFFSET + QEM_SMI_META_READER_MASK_SIZE)
+#define QEM_SMI_META_EVICT_MASK_SIZE    2
+
+#define QEM_SMI_META_BLOCK_PEND_OFFSET \
+(QEM_SMI_META_EVICT_MASK_OFFSET + QEM_SMI_META_EVICT_MASK_SIZE)
+#define QEM_SMI_META_BLOCK_PEND_SIZE    2
+
+#define QEM_SMI_META_BLOCK_SEQ_OFFSET \
+(QEM_SMI_META_BLOCK_PEND_OFFSET + \
+ QEM_SMI_MAX_BLOCK_COUNT * QEM_SMI_META_BLOCK_PEND_SIZE)
+#define QEM_SMI_META_BLOCK_SEQ_SIZE     4
+
+#define QEM_SMI_META_BLOCK_USED_OFFSET \
+(QEM_SMI_META_BLOCK_SEQ_OFFSET + \
+ QEM_SMI_MAX_BLOCK_COUNT * QEM_SMI_META_BLOCK_SEQ_SIZE)
+#define QEM_SMI_META_BLOCK_USED_SIZE    4
+
+#define QEM_SMI_META_BLOCK_DROP_OFFSET \
+(QEM_SMI_META_BLOCK_USED_OFFSET + \
+ QEM_SMI_MAX_BLOCK_COUNT * QEM_SMI_META_BLOCK_USED_SIZE)
+#define QEM_SMI_META_BLOCK_DROP_SIZE    4
+
+#define QEM_SMI_META_DROP_COUNT_OFFSET \
+(QEM_SMI_META_BLOCK_DROP_OFFSET + \
+ QEM_SMI_MAX_BLOCK_COUNT * QEM_SMI_MAX_READER_COUNT * \
+ QEM_SMI_META_BLOCK_DROP_SIZE)
+#define QEM_SMI_META_DROP_COUNT_SIZE    4
+
+#define QEM_SMI_META_READER_DROP_OFFSET \
+(QEM_SMI_META_DROP_COUNT_OFFSET + QEM_SMI_META_DROP_COUNT_SIZE)
+#define QEM_SMI_META_READER_DROP_SIZE   4
+
+#define QEM_SMI_META_READER_PID_OFFSET \
+(QEM_SMI_META_READER_DROP_OFFSET + \
+ QEM_SMI_MAX_READER_COUNT * QEM_SMI_META_READER_DROP_SIZE)
+#define QEM_SMI_META_READER_PID_SIZE    4
+
+#define QEM_SMI_META_CHANNEL_COUNT_OFFSET \
+(QEM_SMI_META_READER_PID_OFFSET + \
+ QEM_SMI_MAX_READER_COUNT * QEM_SMI_META_READER_PID_SIZE)
+#define QEM_SMI_META_CHANNEL_COUNT_SIZE 4
+
+#define QEM_SMI_META_CHANNEL_ID_OFFSET \
+(QEM_SMI_META_CHANNEL_COUNT_OFFSET + QEM_SMI_META_CHANNEL_COUNT_SIZE)
+#define QEM_SMI_META_CHANNEL_ID_SIZE    4
+
+/* Offset of the per block metadata */
+#define QEM_SMI_META_BLOCK_PEND(BLOCK) \
+(QEM_SMI_META_BLOCK_PEND_OFFSET + (BLOCK) * QEM_SMI_META_BLOCK_PEND_SIZE)
+#define QEM_SMI_META_BLOCK_SEQ(BLOCK) \
+(QEM_SMI_META_BLOCK_SEQ_OFFSET + (BLOCK) * QEM_SMI_META_BLOCK_SEQ_SIZE)
+#define QEM_SMI_META_BLOCK_USED(BLOCK) \
+(QEM_SMI_META_BLOCK_USED_OFFSET + (BLOCK) * QEM_SMI_META_BLOCK_USED_SIZE)
+#define QEM_SMI_META_BLOCK_DROP(BLOCK, READER) \
+(QEM_SMI_META_BLOCK_DROP_OFFSET + \
+ ((BLOCK) * QEM_SMI_MAX_READER_COUNT + (READER)) * \
+ QEM_SMI_META_BLOCK_DROP_SIZE)
+
+/* Offset of the per reader metadata */
+#define QEM_SMI_META_READER_DROP(READER) \
+(QEM_SMI_META_READER_DROP_OFFSET + (READER) * QEM_SMI_META_READER_DROP_SIZE)
+#define QEM_SMI_META_READER_PID(READER) \
+(QEM_SMI_META_READER_PID_OFFSET + (READER) * QEM_SMI_META_READER_PID_SIZE)
+
+#define QEM_SMI_DATA_BUFFER_META_DATA_SIZE \
+(QEM_SMI_META_CHANNEL_ID_OFFSET + QEM_SMI_META_CHANNEL_ID_SIZE)
 
 /* Errors */
 #define QEM_SMI_SHM_FD_ERROR         100
@@ -81,6 +202,15 @@
 #define QEM_SMI_TIMEOUT_ERROR        110
 #define QEM_SMI_WRONG_MAGIC_ERROR    111
 #define QEM_SMI_NULL_BUFFER_ERROR    112
+#define QEM_SMI_NO_READER_SLOT_ERROR 113
+#define QEM_SMI_DETACHED_ERROR       114
+#define QEM_SMI_SESSION_ERROR        115
+#define QEM_SMI_WOULD_BLOCK          116
+#define QEM_SMI_CHANNEL_ERROR        117
+#define QEM_SMI_RECORD_ERROR         118
+
+/* Maximal size of a record merged by a channel set */
+#define QEM_SMI_MAX_RECORD_SIZE 64
 
 /*******************************************************************************
  * STRUCTURES
@@ -103,19 +233,140 @@ typedef enum
     QEM_SMI_SENDER
 } QEM_SMI_DIRECTION_E;
 
+/** SMI reader, one per receiving thread */
+typedef struct qem_smi_reader
+{
+    /** Communication status code. */
+    QEM_SMI_STATUS_CODE_E error_code;
+
+    /** The shared memory zone */
+    uint8_t* shared_buffer;
+    /** The shared data part of the buffer */
+    uint8_t* shared_buffer_data;
+    /** Memory zone size. */
+    uint32_t shared_buffer_size;
+    /** The shared memory zone associated FD */
+    int32_t shm_fd;
+
+    /** Local buffer */
+    uint8_t* local_buffer;
+    /** Local buffer index */
+    uint32_t local_buffer_index;
+    /** Number of valid bytes in the local buffer */
+    uint32_t local_buffer_end;
+
+    /** Server's synchronization semaphore. */
+    sem_t* server_sem;
+    /** Client's synchronization semaphore. */
+    sem_t* client_sem;
+
+    /** Monitor's mutex */
+    pthread_mutex_t* mon_lock;
+    /** Monitor mutex's file descriptor. */
+    int32_t mon_lock_fd;
+    /** Read block condition variable. */
+    pthread_cond_t* cond_read;
+    /** Read block condition's file descriptor. */
+    int32_t cond_read_fd;
+    /** Write block condition variable. */
+    pthread_cond_t* cond_write;
+    /** Write block condition's file descriptor. */
+    int32_t cond_write_fd;
+
+    /** Number of blocks in the buffer */
+    uint32_t block_count;
+    /** Size of a buffer block. */
+    uint32_t block_size;
+
+    /** Reader slot of the client, -1 when not registered. */
+    int32_t reader_id;
+    /** Sequence number of the block in the local buffer. */
+    uint32_t block_seq;
+    /** Messages dropped by the server before the block in the local buffer. */
+    uint32_t block_gap;
+    /** Drop counter of the reader slot when the block in the local buffer was
+     * sent.
+     */
+    uint32_t block_drops;
+
+    /** Event file descriptor signaled by the server, -1 when unavailable. */
+    int32_t event_fd;
+
+    /** Channel of the reader. */
+    uint32_t channel;
+    /** Number of channels of the session, read when connecting. */
+    uint32_t channel_count;
+
+    /** Session of the reader. */
+    char session[QEM_SMI_SESSION_MAX + 1];
+    /** Scratch buffer used to build the shared objects names. */
+    char name[QEM_SMI_NAME_MAX];
+} qem_smi_reader_t;
+
+/** Set of readers, one per channel of a session. */
+typedef struct qem_smi_channels
+{
+    /** Reader of each channel. */
+    qem_smi_reader_t readers[QEM_SMI_MAX_CHANNEL_COUNT];
+    /** Number of channels of the session, 0 when not connected. */
+    uint32_t count;
+
+    /** Size of the merged records. */
+    uint32_t record_size;
+    /** Offset of the 64 bits timestamp in the merged records. */
+    uint32_t timestamp_offset;
+
+    /** Next record of each channel. */
+    uint8_t heads[QEM_SMI_MAX_CHANNEL_COUNT][QEM_SMI_MAX_RECORD_SIZE];
+    /** State of the next record of each channel. */
+    uint8_t head_state[QEM_SMI_MAX_CHANNEL_COUNT];
+} qem_smi_channels_t;
+
 /*******************************************************************************
  * FUNCTIONS
  ******************************************************************************/
 
 /**
- * @brief Initializes the SMI memory space.
+ * @brief Initializes a SMI reader.
+ *
+ * @param[out] reader The reader to initialize.
  */
-void qem_smi_init(void);
+void qem_smi_reader_init(qem_smi_reader_t* reader);
 
-            /**
- * @brief Connect the client to the server. This function will block
- * the thread until the client is connected.
+/**
+ * @brief Sets the session the reader connects to. The default session is the 
+ * one given by the QEM_SMI_SESSION environment variable, or the unnamed 
+ * session if the variable is not set. Must be called before connecting.
+ *
+ * @param[in, out] reader The reader to set the session of.
+ * @param[in] session The session name, at most QEM_SMI_SESSION_MAX 
+ * characters and no '/'. An empty string selects the unnamed session.
  *
+ * @returns QEM_SMI_SESSION_ERROR is returned if the name is invalid. 0 is 
+ * returned otherwise.
+ */
+int32_t qem_smi_reader_set_session(qem_smi_reader_t* reader, 
+                                   const char* session);
+
+/**
+ * @brief Sets the channel the reader connects to. The server sends the trace
+ * of each core on the channel core % channel count. The default channel is 0.
+ * Must be called before connecting.
+ *
+ * @param[in, out] reader The reader to set the channel of.
+ * @param[in] channel The channel index.
+ *
+ * @returns QEM_SMI_CHANNEL_ERROR is returned if the channel is not lower
+ * than QEM_SMI_MAX_CHANNEL_COUNT. 0 is returned otherwise.
+ */
+int32_t qem_smi_reader_set_channel(qem_smi_reader_t* reader,
+                                   const uint32_t channel);
+
+/**
+ * @brief Connect the reader to the server. This function will block
+ * the thread until the reader is connected.
+ *
+ * @param[in, out] reader The reader to connect.
  * @param[in] timeout The time in seconds at which should occur
  * a timeout when waiting for the server to connect.
  * @param[in] max_attempt The maximal number of time a timeout can
@@ -125,21 +376,121 @@ void qem_smi_init(void);
  * called its init function. Otherwise there might be old SHM junks
  * in the system that could break the communicator.
  */
-int32_t qem_smi_connect(const uint32_t timeout, const uint32_t max_attempt);
+int32_t qem_smi_reader_connect(qem_smi_reader_t* reader, 
+                               const uint32_t timeout, 
+                               const uint32_t max_attempt);
 
 /**
- * @brief Disconnects the client from the server.
+ * @brief Disconnects the reader from the server. The blocks still held by 
+ * the reader are released and the server stops delivering blocks to it.
+ *
+ * @param[in, out] reader The reader to disconnect.
  */
-void qem_smi_disconnect(void);
+void qem_smi_reader_disconnect(qem_smi_reader_t* reader);
+
+/**
+ * @brief Returns the reader slot the reader registered in when connecting.
+ * When the server partitions the stream by address, the slot is the 
+ * partition received by the reader.
+ *
+ * @param[in] reader The reader to get the slot of.
+ *
+ * @returns The reader slot, -1 if the reader is not connected.
+ */
+int32_t qem_smi_reader_get_id(const qem_smi_reader_t* reader);
+
+/**
+ * @brief Returns the number of channels of the session the reader is
+ * connected to.
+ *
+ * @param[in] reader A connected reader.
+ *
+ * @returns The number of channels, 0 if the reader never connected.
+ */
+uint32_t qem_smi_reader_get_channel_count(const qem_smi_reader_t* reader);
+
+/**
+ * @brief Returns the sequence number of the block the last received data
+ * came from. When the server partitions the stream, a message never spans
+ * two blocks and the sequence number can be used to recombine the results
+ * of the different readers in order.
+ *
+ * @param[in] reader The reader to get the sequence number of.
+ *
+ * @returns The sequence number of the current block, 0 if no block was 
+ * received yet.
+ */
+uint32_t qem_smi_reader_get_block_seq(const qem_smi_reader_t* reader);
+
+/**
+ * @brief Returns the number of messages the server dropped between the
+ * previous block received by the reader and the block the last received data
+ * came from. Messages are only dropped when the
+ * server uses a lossy full buffer policy, in that case a message never spans
+ * two blocks. Only the messages lost by this reader are counted: when the
+ * server partitions the stream, the messages of the blocks that would have
+ * been handed to it.
+ *
+ * @param[in] reader The reader to get the gap of.
+ *
+ * @returns The number of messages dropped before the current block.
+ */
+uint32_t qem_smi_reader_get_block_gap(const qem_smi_reader_t* reader);
+
+/**
+ * @brief Returns the total number of messages dropped by the server since the
+ * stream started, for all the readers of the channel.
+ *
+ * @param[in] reader A connected reader.
+ *
+ * @returns The number of dropped messages, 0 if the reader is not connected.
+ */
+uint32_t qem_smi_reader_get_drop_count(qem_smi_reader_t* reader);
+
+/**
+ * @brief Returns a file descriptor that becomes readable when the server
+ * hands a new block to the reader or detaches it. The descriptor can be 
+ * watched with poll, select or epoll, the reader then calls 
+ * qem_smi_reader_try_receive until it returns QEM_SMI_WOULD_BLOCK. The 
+ * descriptor is owned by the reader and is closed on disconnection.
+ *
+ * @param[in] reader The reader to get the descriptor of.
+ *
+ * @returns The file descriptor, -1 if the server does not support 
+ * notifications or the reader is not connected.
+ */
+int32_t qem_smi_reader_get_fd(const qem_smi_reader_t* reader);
+
+/**
+ * @brief Receive a message from the communicator without waiting for the
+ * server. Either the whole message is received or nothing is consumed.
+ * The function may still wait if the message spans more than one new block.
+ *
+ * @param[in, out] reader The reader to receive from.
+ * @param[out] buffer The buffer to fill.
+ * @param[in] size The size of the data to be received in bytes.
+ *
+ * @returns QEM_SMI_WOULD_BLOCK is returned if no block is ready, the reader 
+ * event file descriptor is then reset. See qem_smi_reader_receive for the 
+ * other return values.
+ */
+int32_t qem_smi_reader_try_receive(qem_smi_reader_t* reader, void* buffer, 
+                                   const uint32_t size);
 
 /**
  * @brief Receive a message from the communicator. The function will
  * block the caller until all the data are received.
  *
+ * @param[in, out] reader The reader to receive from.
  * @param[out] buffer The buffer to fill.
  * @param[in] size The size of the data to be received in bytes.
+ *
+ * @returns QEM_SMI_DETACHED_ERROR is returned if the sender detached the 
+ * reader because it was too slow to release the blocks. 0 is returned on 
+ * success.
  */
-int32_t qem_smi_receive(void* buffer, const uint32_t size);
+int32_t qem_smi_reader_receive(qem_smi_reader_t* reader, void* buffer, 
+                               const uint32_t size);
 
 /**
  * @brief Performs post server flush cleanup. This is to be used when
@@ -147,6 +498,168 @@ int32_t qem_smi_receive(void* buffer, const uint32_t size);
  * sequence). Quen End SMI sequence occurs you should call this function
  * as end smi sequenc is user defined and the client cannot detect this 
  * sequence.
+ *
+ * @param[in, out] reader The reader to cleanup.
+ */
+void qem_smi_reader_post_server_flush(qem_smi_reader_t* reader);
+
+/**
+ * @brief Initializes a channel set.
+ *
+ * @param[out] channels The channel set to initialize.
+ */
+void qem_smi_channels_init(qem_smi_channels_t* channels);
+
+/**
+ * @brief Sets the session of all the readers of the channel set.
+ * See qem_smi_reader_set_session.
+ */
+int32_t qem_smi_channels_set_session(qem_smi_channels_t* channels, 
+                                     const char* session);
+
+/**
+ * @brief Connects a reader to every channel of the session. The first
+ * channel gives the number of channels, the other ones are then connected in
+ * order. See qem_smi_reader_connect.
+ *
+ * @param[in, out] channels The channel set to connect.
+ * @param[in] timeout The time in seconds at which should occur
+ * a timeout when waiting for the server to connect.
+ * @param[in] max_attempt The maximal number of time a timeout can
+ * occur before stoping the connection process.
+ *
+ * @returns The error of the first reader that failed to connect, all the
+ * readers are then disconnected. 0 is returned on success.
+ */
+int32_t qem_smi_channels_connect(qem_smi_channels_t* channels, 
+                                 const uint32_t timeout, 
+                                 const uint32_t max_attempt);
+
+/**
+ * @brief Disconnects all the readers of the channel set.
+ *
+ * @param[in, out] channels The channel set to disconnect.
+ */
+void qem_smi_channels_disconnect(qem_smi_channels_t* channels);
+
+/**
+ * @brief Returns the number of channels of the connected session.
+ *
+ * @param[in] channels The channel set.
+ *
+ * @returns The number of channels, 0 if the set is not connected.
+ */
+uint32_t qem_smi_channels_get_count(const qem_smi_channels_t* channels);
+
+/**
+ * @brief Returns the reader of a channel, to consume the channels one by one
+ * (for instance one thread per channel or a poll loop on the readers event 
+ * file descriptors).
+ *
+ * @param[in] channels The channel set.
+ * @param[in] channel The channel index.
+ *
+ * @returns The reader of the channel, NULL if the channel does not exist.
+ */
+qem_smi_reader_t* qem_smi_channels_get_reader(qem_smi_channels_t* channels,
+                                              const uint32_t channel);
+
+/**
+ * @brief Sets the records format used by qem_smi_channels_receive_merged.
+ *
+ * @param[in, out] channels The channel set.
+ * @param[in] record_size The size of a record in bytes.
+ * @param[in] timestamp_offset The offset of the 64 bits timestamp in a
+ * record.
+ *
+ * @returns QEM_SMI_RECORD_ERROR is returned if the record is greater than
+ * QEM_SMI_MAX_RECORD_SIZE or does not contain the timestamp. 0 is returned
+ * otherwise.
+ */
+int32_t qem_smi_channels_set_merge(qem_smi_channels_t* channels, 
+                                   const uint32_t record_size,
+                                   const uint32_t timestamp_offset);
+
+/**
+ * @brief Receives the record with the lowest timestamp among the next 
+ * record of every channel. A record filled with zeros ends a channel, it is
+ * returned once all the channels ended. The stream start sequence must be
+ * read on each reader before merging.
+ *
+ * @param[in, out] channels The channel set.
+ * @param[out] buffer The buffer to fill, of the record size.
+ *
+ * @returns See qem_smi_reader_receive.
+ *
+ * @warning A record is only returned once every running channel has a 
+ * record ready, an idle core delays the merge until the server flushes its 
+ * channel.
+ */
+int32_t qem_smi_channels_receive_merged(qem_smi_channels_t* channels, 
+                                        void* buffer);
+
+/**
+ * @brief Initializes the SMI memory space of the default reader.
+ */
+void qem_smi_init(void);
+
+/**
+ * @brief Connect the default reader to the server. 
+ * See qem_smi_reader_connect.
+ */
+int32_t qem_smi_connect(const uint32_t timeout, const uint32_t max_attempt);
+
+/**
+ * @brief Disconnects the default reader from the server.
+ * See qem_smi_reader_disconnect.
+ */
+void qem_smi_disconnect(void);
+
+/**
+ * @brief Returns the reader slot of the default reader.
+ * See qem_smi_reader_get_id.
+ */
+int32_t qem_smi_get_reader_id(void);
+
+/**
+ * @brief Returns the sequence number of the current block of the default 
+ * reader. See qem_smi_reader_get_block_seq.
+ */
+uint32_t qem_smi_get_block_seq(void);
+
+/**
+ * @brief Returns the gap before the current block of the default reader.
+ * See qem_smi_reader_get_block_gap.
+ */
+uint32_t qem_smi_get_block_gap(void);
+
+/**
+ * @brief Returns the number of messages dropped by the server.
+ * See qem_smi_reader_get_drop_count.
+ */
+uint32_t qem_smi_get_drop_count(void);
+
+/**
+ * @brief Receive a message with the default reader.
+ * See qem_smi_reader_receive.
+ */
+int32_t qem_smi_receive(void* buffer, const uint32_t size);
+
+/**
+ * @brief Returns the event file descriptor of the default reader.
+ * See qem_smi_reader_get_fd.
+ */
+int32_t qem_smi_get_fd(void);
+
+/**
+ * @brief Receive a message with the default reader without waiting.
+ * See qem_smi_reader_try_receive.
+ */
+int32_t qem_smi_try_receive(void* buffer, const uint32_t size);
+
+/**
+ * @brief Performs post server flush cleanup of the default reader.
+ * See qem_smi_reader_post_server_flush.
  */
 void qem_smi_post_server_flush(void);
 
@@ -0,0 +1,325 @@
+/*******************************************************************************
+ * File: qem_trace_decoder.h
+ *
+ * Author: Alexy Torres Aurora Dugo
+ *
+ * Date: 19/09/2018
+ *
+ * Version: 1.0
+ *
+ * Decoder of the QEMTrace records, header only so that any trace consumer
+ * (SMI reader, trace file reader) can include it without linking against the
+ * SMI library.
+ * The fetch coalescing, the string coalescing and the multiple word transfers
+ * output several memory accesses as one range made of consecutive records
+ * (see the QEM_TRACE_FETCH_RANGE_E and QEM_TRACE_STRING_RANGE_E definitions of
+ * the trace format). The range decoder gathers these records and expands
+ * them back into one record per memory access, in access order.
+ ******************************************************************************/
+
+#ifndef __QEM_TRACE_DECODER_H_
+#define __QEM_TRACE_DECODER_H_
+
+#include <stdint.h> /* Generic types */
+#include <string.h> /* memcpy */
+
+/*******************************************************************************
+ * CONSTANTS
+ ******************************************************************************/
+
+/* Size of the records gathering the metadata, for 32 and 64 bits targets */
+#define QEM_TRACE_RECORD_SIZE_32 16
+#define QEM_TRACE_RECORD_SIZE_64 20
+
+/* Range flags of the records */
+#define QEM_TRACE_RANGE_FETCH_START   0x08000000
+#define QEM_TRACE_RANGE_FETCH_OFFSETS 0x10000000
+#define QEM_TRACE_RANGE_FETCH_MASK    0x18000000
+
+#define QEM_TRACE_RANGE_STRING_START  0x20000000
+#define QEM_TRACE_RANGE_STRING_COUNT  0x40000000
+#define QEM_TRACE_RANGE_STRING_LINKED 0x60000000
+#define QEM_TRACE_RANGE_STRING_MASK   0x60000000
+
+/* Maximal number of linked blocks of a range */
+#define QEM_TRACE_RANGE_MAX_BLOCKS 4
+
+/* Errors */
+#define QEM_TRACE_RANGE_FORMAT_ERROR 119
+
+/*******************************************************************************
+ * STRUCTURES
+ ******************************************************************************/
+
+/** Record, independent of the target width. */
+typedef struct qem_trace_record
+{
+    /** Accessed address. */
+    uint64_t address;
+    /** Timestamp of the access. */
+    uint64_t timestamp;
+    /** Flags of the access, the core is given by the low 8 bits. */
+    uint32_t flags;
+} qem_trace_record_t;
+
+/** Range being gathered or expanded, one per core. */
+typedef struct qem_trace_range
+{
+    /** Start record of each block. */
+    qem_trace_record_t starts[QEM_TRACE_RANGE_MAX_BLOCKS];
+    /** Number of accesses of each block. */
+    uint64_t counts[QEM_TRACE_RANGE_MAX_BLOCKS];
+    /** Distance between two accesses of each string block, offsets bitmap
+     * not yet expanded of a fetch range.
+     */
+    uint64_t steps[QEM_TRACE_RANGE_MAX_BLOCKS];
+    /** Number of blocks of the range. */
+    uint32_t block_count;
+    /** 1 when the next record is a start record, 0 when it ends a block. */
+    uint32_t expect_start;
+    /** 1 once the last block ended. */
+    uint32_t complete;
+    /** Number of records added. */
+    uint32_t record_count;
+
+    /** Next access to expand. */
+    uint64_t index;
+    uint32_t block;
+} qem_trace_range_t;
+
+/*******************************************************************************
+ * FUNCTIONS
+ ******************************************************************************/
+
+/**
+ * @brief Decodes a record read from a trace file or a SMI reader.
+ *
+ * @param[out] record The decoded record.
+ * @param[in] buffer The raw record.
+ * @param[in] size The raw record size, QEM_TRACE_RECORD_SIZE_32 or
+ * QEM_TRACE_RECORD_SIZE_64.
+ *
+ * @returns QEM_TRACE_RANGE_FORMAT_ERROR is returned if the size is not a
+ * record size. 0 is returned otherwise.
+ */
+static inline int32_t qem_trace_record_decode(qem_trace_record_t* record,
+                                              const void* buffer,
+                                              const uint32_t size)
+{
+    const uint8_t* raw = (const uint8_t*)buffer;
+    uint32_t       address;
+
+    if(size == QEM_TRACE_RECORD_SIZE_32)
+    {
+        memcpy(&address, raw, sizeof(uint32_t));
+        record->address = address;
+        raw += sizeof(uint32_t);
+    }
+    else if(size == QEM_TRACE_RECORD_SIZE_64)
+    {
+        memcpy(&record->address, raw, sizeof(uint64_t));
+        raw += sizeof(uint64_t);
+    }
+    else
+    {
+        return QEM_TRACE_RANGE_FORMAT_ERROR;
+    }
+
+    memcpy(&record->timestamp, raw, sizeof(uint64_t));
+    memcpy(&record->flags, raw + sizeof(uint64_t), sizeof(uint32_t));
+
+    return 0;
+}
+
+/**
+ * @brief Tells if a record starts a range, the range is then gathered with
+ * qem_trace_range_add.
+ *
+ * @param[in] record The record to check.
+ *
+ * @returns 1 if the record starts a range, 0 otherwise.
+ */
+static inline uint8_t qem_trace_range_starts(const qem_trace_record_t* record)
+{
+    return (record->flags & QEM_TRACE_RANGE_FETCH_MASK) ==
+           QEM_TRACE_RANGE_FETCH_START ||
+           (record->flags & QEM_TRACE_RANGE_STRING_MASK) ==
+           QEM_TRACE_RANGE_STRING_START;
+}
+
+/**
+ * @brief Initializes an empty range.
+ *
+ * @param[out] range The range to initialize.
+ */
+static inline void qem_trace_range_init(qem_trace_range_t* range)
+{
+    memset(range, 0, sizeof(qem_trace_range_t));
+    range->expect_start = 1;
+}
+
+/**
+ * @brief Adds the next record of the core to the range. The first record
+ * must start the range, the records are then added until
+ * qem_trace_range_complete returns 1.
+ *
+ * @param[in, out] range The range being gathered.
+ * @param[in] record The record to add.
+ *
+ * @returns QEM_TRACE_RANGE_FORMAT_ERROR is returned if the record does not
+ * continue the range, the range is then left unchanged. 0 is returned
+ * otherwise.
+ */
+static inline int32_t qem_trace_range_add(qem_trace_range_t* range,
+                                          const qem_trace_record_t* record)
+{
+    uint32_t block;
+
+    block = range->block_count;
+    if(range->complete != 0)
+    {
+        return QEM_TRACE_RANGE_FORMAT_ERROR;
+    }
+
+    if(range->expect_start != 0)
+    {
+        /* Only string blocks are linked */
+        if(block == QEM_TRACE_RANGE_MAX_BLOCKS ||
+           (block == 0 && qem_trace_range_starts(record) == 0) ||
+           (block != 0 && (record->flags & QEM_TRACE_RANGE_STRING_MASK) !=
+                          QEM_TRACE_RANGE_STRING_START))
+        {
+            return QEM_TRACE_RANGE_FORMAT_ERROR;
+        }
+
+        range->starts[block] = *record;
+        range->expect_start  = 0;
+        ++range->record_count;
+        return 0;
+    }
+
+    if((range->starts[block].flags & QEM_TRACE_RANGE_FETCH_MASK) != 0)
+    {
+        if((record->flags & QEM_TRACE_RANGE_FETCH_MASK) !=
+           QEM_TRACE_RANGE_FETCH_OFFSETS)
+        {
+            return QEM_TRACE_RANGE_FORMAT_ERROR;
+        }
+        range->complete = 1;
+    }
+    else if((record->flags & QEM_TRACE_RANGE_STRING_MASK) ==
+            QEM_TRACE_RANGE_STRING_LINKED)
+    {
+        range->expect_start = 1;
+    }
+    else if((record->flags & QEM_TRACE_RANGE_STRING_MASK) ==
+            QEM_TRACE_RANGE_STRING_COUNT)
+    {
+        range->complete = 1;
+    }
+    else
+    {
+        return QEM_TRACE_RANGE_FORMAT_ERROR;
+    }
+
+    range->counts[block] = record->address;
+    range->steps[block]  = record->timestamp;
+    ++range->block_count;
+    ++range->record_count;
+
+    return 0;
+}
+
+/**
+ * @brief Tells if no record was added to the range since it was initialized.
+ *
+ * @param[in] range The range to check.
+ *
+ * @returns 1 if the range is empty, 0 otherwise.
+ */
+static inline uint8_t qem_trace_range_empty(const qem_trace_range_t* range)
+{
+    return range->record_count == 0;
+}
+
+/**
+ * @brief Tells if all the records of the range were added.
+ *
+ * @param[in] range The range being gathered.
+ *
+ * @returns 1 if the range can be expanded, 0 otherwise.
+ */
+static inline uint8_t qem_trace_range_complete(const qem_trace_range_t* range)
+{
+    return range->complete != 0;
+}
+
+/**
+ * @brief Returns the next access of a complete range. The accesses of a fetch
+ * range are returned in increasing address order, the accesses of linked
+ * string blocks in turn: first access of each block, second access of each
+ * block... Each access has the flags and the timestamp of its block start
+ * record, without the range flags.
+ *
+ * @param[in, out] range The range to expand.
+ * @param[out] record The next access.
+ *
+ * @returns 1 if an access was returned, 0 once the range is fully expanded.
+ */
+static inline uint8_t qem_trace_range_next(qem_trace_range_t* range,
+                                           qem_trace_record_t* record)
+{
+    uint64_t max_count;
+    uint64_t index;
+    uint32_t i;
+
+    if(range->complete == 0)
+    {
+        return 0;
+    }
+
+    if((range->starts[0].flags & QEM_TRACE_RANGE_FETCH_MASK) != 0)
+    {
+        /* One fetch per bit of the offsets bitmap */
+        if(range->steps[0] == 0)
+        {
+            return 0;
+        }
+        *record          = range->starts[0];
+        record->address += __builtin_ctzll(range->steps[0]);
+        record->flags   &= ~QEM_TRACE_RANGE_FETCH_MASK;
+        range->steps[0] &= range->steps[0] - 1;
+        return 1;
+    }
+
+    max_count = 0;
+    for(i = 0; i < range->block_count; ++i)
+    {
+        max_count = (range->counts[i] > max_count) ? range->counts[i] :
+                                                     max_count;
+    }
+
+    /* The blocks with less accesses are skipped once they are expanded */
+    while(range->index < max_count)
+    {
+        i     = range->block;
+        index = range->index;
+        if(++range->block == range->block_count)
+        {
+            range->block = 0;
+            ++range->index;
+        }
+
+        if(index < range->counts[i])
+        {
+            *record          = range->starts[i];
+            record->address += index * range->steps[i];
+            record->flags   &= ~QEM_TRACE_RANGE_STRING_MASK;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+#endif /* __QEM_TRACE_DECODER_H_ */
@@ -9,15 +9,15 @@
  *
  * This class is an implementation of the communicator interface. This
  * communicator is developped for POSIX compliant environments.
- * A PosixCommunicatorClient is the server part of a 1 to 1 unidirectionnal pipe
- * between two process.
- * Its behaviour will not be correct if more than one process is using it as a
- * sender or as a receiver. At any time only one sender and only one receiver is
- * authorized.
+ * A PosixCommunicatorClient is the server part of a 1 to N unidirectionnal
+ * pipe between processes.
+ * Only one process can use it as a sender. Each receiver uses its own
+ * reader, several readers can live in the same process.
  * The server can only send and the client can only receive.
  ******************************************************************************/
 
 #include <stdint.h>    /* uint32_t */
+#include <stddef.h>    /* offsetof */
 #include <stdlib.h>    /* malloc */
 #include <string.h>    /* memcpy */
 #include <fcntl.h>     /* open */
@@ -29,186 +29,481 @@
 #include <pthread.h>   /* pthread_mutex */
 #include <time.h>      /* nanosleep */
 #include <sys/mman.h>  /* mmap */
+#include <sys/socket.h>  /* socket, sendmsg */
+#include <sys/un.h>      /* sockaddr_un */
+#include <sys/eventfd.h> /* eventfd */
+#include <stdio.h>       /* snprintf */
 
 /* nsCommunicator::CommunicatorException */
 #include "qem_posix_smi.h"
 
-/** Communication status code. */
-QEM_SMI_STATUS_CODE_E error_code = QEM_SMI_UNINIT;
+/** Reader used by the single reader API. */
+static qem_smi_reader_t default_reader;
 
-/** The shared memory zone */
-uint8_t* shared_buffer = NULL;
+/* State of the next record of a channel in a channel set */
+#define QEM_SMI_HEAD_EMPTY 0
+#define QEM_SMI_HEAD_READY 1
+#define QEM_SMI_HEAD_ENDED 2
 
-/** The shared data aprt of the buffer */
-uint8_t* shared_buffer_data = NULL;
-
-/** Memory zone size. */
-uint32_t shared_buffer_size = 0;
-
-/** The shared memory zone associated FD */
-int32_t shm_fd = -1;
-
-/** Local buffer */
-uint8_t* local_buffer = NULL;
-
-/** Local buffer index */
-uint32_t local_buffer_index = 0;
-
-/** Server's synchronization semaphore. */
-sem_t* server_sem = SEM_FAILED;
-
-/** Client's synchronization semaphore. */
-sem_t* client_sem = SEM_FAILED;
-
-/** Monitor's mutex */
-pthread_mutex_t* mon_lock = (pthread_mutex_t*)MAP_FAILED;
-/** Monitor mutex's file descriptor. */
-int32_t mon_lock_fd = -1;
-
-/** Read block condition variable. */
-pthread_cond_t* cond_read = (pthread_cond_t*)MAP_FAILED;
-/** Read block condition's file descriptor. */
-int32_t cond_read_fd = -1;
-
-/** Write block condition variable. */
-pthread_cond_t* cond_write = (pthread_cond_t*)MAP_FAILED;
-/** Write block condition's file descriptor. */
-int32_t cond_write_fd = -1;
-
-/** Next block to use to flush the local buffer. */
-uint32_t next_block = 0;
-
-/** Number of blocks in the buffer */
-uint32_t block_count = 0;
+static uint32_t get_meta(const qem_smi_reader_t* reader,
+                         const uint32_t offset, const uint32_t size)
+{
+    uint32_t value = 0;
+    memcpy(&value, reader->shared_buffer + offset, size);
+    return value;
+}
 
-/** Size of a buffer block. */
-uint32_t block_size = 0;
+static void set_meta(qem_smi_reader_t* reader,
+                     const uint32_t offset, const uint32_t size,
+                     const uint32_t value)
+{
+    memcpy(reader->shared_buffer + offset, &value, size);
+}
 
+/* Returns the name of a shared object of the reader channel in the reader
+ * session. The first channel keeps the single channel names.
+ */
+static const char* get_name(qem_smi_reader_t* reader, const char* base)
+{
+    if(reader->channel == 0)
+    {
+        snprintf(reader->name, QEM_SMI_NAME_MAX, "%s%s", base,
+                 reader->session);
+    }
+    else
+    {
+        snprintf(reader->name, QEM_SMI_NAME_MAX, "%s%s.%u", base,
+                 reader->session, reader->channel);
+    }
+    return reader->name;
+}
 
-static int32_t mapp_buffer(void)
+static int32_t mapp_buffer(qem_smi_reader_t* reader)
 {
     /* Creates the SHM file descriptor */
-    shm_fd = shm_open(QEM_SMI_SHM_NAME, O_RDWR, 0666);
-    if(shm_fd < 0)
+    reader->shm_fd = shm_open(get_name(reader, QEM_SMI_SHM_NAME), O_RDWR, 0666);
+    if(reader->shm_fd < 0)
     {
-        qem_smi_disconnect();
+        qem_smi_reader_disconnect(reader);
         return QEM_SMI_SHM_FD_ERROR;
     }
 
     /* Just map the metadata to get the information */
-    shared_buffer = (uint8_t*)mmap(NULL, QEM_SMI_DATA_BUFFER_META_DATA_SIZE,
-                                         PROT_READ | PROT_WRITE, MAP_SHARED,
-                                         shm_fd, 0);
-    if (shared_buffer == MAP_FAILED)
+    reader->shared_buffer = (uint8_t*)mmap(NULL,
+                                           QEM_SMI_DATA_BUFFER_META_DATA_SIZE,
+                                           PROT_READ | PROT_WRITE, MAP_SHARED,
+                                           reader->shm_fd, 0);
+    if (reader->shared_buffer == MAP_FAILED)
 	{
-        qem_smi_disconnect();
+        reader->shared_buffer = NULL;
+        qem_smi_reader_disconnect(reader);
         return QEM_SMI_SHM_MMAP_ERROR;
 	}
 
     /* Get the metadata */
-    memcpy(&block_count,
-           shared_buffer + QEM_SMI_META_BLOCK_COUNT_OFFSET,
-           QEM_SMI_META_BLOCK_COUNT_SIZE);
-    memcpy(&block_size,
-           shared_buffer + QEM_SMI_META_BLOCK_SIZE_OFFSET,
-           QEM_SMI_META_BLOCK_SIZE_SIZE);
+    reader->block_count = get_meta(reader, QEM_SMI_META_BLOCK_COUNT_OFFSET,
+                                   QEM_SMI_META_BLOCK_COUNT_SIZE);
+    reader->block_size  = get_meta(reader, QEM_SMI_META_BLOCK_SIZE_OFFSET,
+                                   QEM_SMI_META_BLOCK_SIZE_SIZE);
+    reader->channel_count = get_meta(reader,
+                                     QEM_SMI_META_CHANNEL_COUNT_OFFSET,
+                                     QEM_SMI_META_CHANNEL_COUNT_SIZE);
 
-    shared_buffer_size = block_count * block_size +
-                             QEM_SMI_DATA_BUFFER_META_DATA_SIZE;
+    reader->shared_buffer_size = reader->block_count * reader->block_size +
+                                 QEM_SMI_DATA_BUFFER_META_DATA_SIZE;
 
     /* Unmap the temporary metadata */
-    munmap(shared_buffer, QEM_SMI_DATA_BUFFER_META_DATA_SIZE);
+    munmap(reader->shared_buffer, QEM_SMI_DATA_BUFFER_META_DATA_SIZE);
 
     /* Map the shared memory region */
-    shared_buffer = (uint8_t*)mmap(NULL, shared_buffer_size,
-                                         PROT_READ | PROT_WRITE, MAP_SHARED,
-                                         shm_fd, 0);
-    if (shared_buffer == MAP_FAILED)
+    reader->shared_buffer = (uint8_t*)mmap(NULL, reader->shared_buffer_size,
+                                           PROT_READ | PROT_WRITE, MAP_SHARED,
+                                           reader->shm_fd, 0);
+    if (reader->shared_buffer == MAP_FAILED)
 	{
-        qem_smi_disconnect();
+        reader->shared_buffer = NULL;
+        qem_smi_reader_disconnect(reader);
         return QEM_SMI_SHM_MMAP_ERROR;
 	}
 
     /* Set the data part start */
-    shared_buffer_data = shared_buffer + QEM_SMI_DATA_BUFFER_META_DATA_SIZE;
+    reader->shared_buffer_data = reader->shared_buffer +
+                                 QEM_SMI_DATA_BUFFER_META_DATA_SIZE;
 
     return 0;
 }
 
-static int32_t createlocal_buffer(void)
+static int32_t createlocal_buffer(qem_smi_reader_t* reader)
 {
     /* Create local buffer */
-    local_buffer_index = 0;
-    local_buffer       = (uint8_t*)malloc(shared_buffer_size);
-    if (local_buffer == NULL)
+    reader->local_buffer_index = 0;
+    reader->local_buffer_end   = 0;
+    reader->local_buffer       = (uint8_t*)malloc(reader->block_size);
+    if (reader->local_buffer == NULL)
 	{
-        qem_smi_disconnect();
+        qem_smi_reader_disconnect(reader);
         return QEM_SMI_CREATE_LBUFFER_ERROR;
 	}
 
     return 0;
 }
 
-static int32_t create_sync(void)
+static int32_t create_sync(qem_smi_reader_t* reader)
 {
     /* Open the file descriptors */
-    mon_lock_fd   = shm_open(QEM_SMI_SHARED_MUTEX, O_RDWR, 0666);
-    if(mon_lock_fd < 0)
+    reader->mon_lock_fd   = shm_open(get_name(reader, QEM_SMI_SHARED_MUTEX), O_RDWR, 0666);
+    if(reader->mon_lock_fd < 0)
     {
-        qem_smi_disconnect();
+        qem_smi_reader_disconnect(reader);
         return QEM_SMI_SHM_LOCK_ERROR;
     }
 
-    cond_read_fd  = shm_open(QEM_SMI_SHARED_COND_READ, O_RDWR, 0666);
-    if(cond_read_fd < 0)
+    reader->cond_read_fd  = shm_open(get_name(reader, QEM_SMI_SHARED_COND_READ), O_RDWR, 0666);
+    if(reader->cond_read_fd < 0)
     {
-        qem_smi_disconnect();
+        qem_smi_reader_disconnect(reader);
         return QEM_SMI_SHM_RCOND_ERROR;
     }
 
-    cond_write_fd = shm_open(QEM_SMI_SHARED_COND_WRITE, O_RDWR, 0666);
-    if(cond_write_fd < 0)
+    reader->cond_write_fd = shm_open(get_name(reader, QEM_SMI_SHARED_COND_WRITE), O_RDWR, 0666);
+    if(reader->cond_write_fd < 0)
     {
-        qem_smi_disconnect();
+        qem_smi_reader_disconnect(reader);
         return QEM_SMI_SHM_WCOND_ERROR;
     }
 
     /* Mmap the memory */
-    mon_lock = (pthread_mutex_t*)mmap(NULL, sizeof(pthread_mutex_t),
-                                           PROT_READ | PROT_WRITE, MAP_SHARED,
-                                           mon_lock_fd, 0);
-    if(mon_lock == MAP_FAILED)
+    reader->mon_lock = (pthread_mutex_t*)mmap(NULL, sizeof(pthread_mutex_t),
+                                              PROT_READ | PROT_WRITE,
+                                              MAP_SHARED,
+                                              reader->mon_lock_fd, 0);
+    if(reader->mon_lock == MAP_FAILED)
     {
-        qem_smi_disconnect();
+        qem_smi_reader_disconnect(reader);
         return QEM_SMI_MMAP_LOCK_ERROR;
     }
-    cond_read = (pthread_cond_t*)mmap(NULL, sizeof(pthread_cond_t),
-                                        PROT_READ | PROT_WRITE, MAP_SHARED,
-                                        cond_read_fd, 0);
-    if(cond_read == MAP_FAILED)
+    reader->cond_read = (pthread_cond_t*)mmap(NULL, sizeof(pthread_cond_t),
+                                              PROT_READ | PROT_WRITE,
+                                              MAP_SHARED,
+                                              reader->cond_read_fd, 0);
+    if(reader->cond_read == MAP_FAILED)
     {
-        qem_smi_disconnect();
+        qem_smi_reader_disconnect(reader);
         return QEM_SMI_MMAP_RCOND_ERROR;
     }
-    cond_write = (pthread_cond_t*)mmap(NULL, sizeof(pthread_cond_t),
-                                         PROT_READ | PROT_WRITE, MAP_SHARED,
-                                         cond_write_fd, 0);
-    if(cond_write == MAP_FAILED)
+    reader->cond_write = (pthread_cond_t*)mmap(NULL, sizeof(pthread_cond_t),
+                                               PROT_READ | PROT_WRITE,
+                                               MAP_SHARED,
+                                               reader->cond_write_fd, 0);
+    if(reader->cond_write == MAP_FAILED)
     {
-        qem_smi_disconnect();
+        qem_smi_reader_disconnect(reader);
         return QEM_SMI_MMAP_WCOND_ERROR;
     }
 
     return 0;
 }
 
-void qem_smi_init(void)
+static int32_t register_reader(qem_smi_reader_t* reader)
 {
-    shared_buffer_data = shared_buffer;
-    error_code = QEM_SMI_NOT_CONNECTED;
+    uint32_t readers;
+    int32_t  i;
+
+    pthread_mutex_lock(reader->mon_lock);
+
+    /* Get the first free reader slot */
+    readers = get_meta(reader, QEM_SMI_META_READER_MASK_OFFSET,
+                       QEM_SMI_META_READER_MASK_SIZE);
+    for(i = 0; i < QEM_SMI_MAX_READER_COUNT; ++i)
+    {
+        if((readers & (1 << i)) == 0)
+        {
+            break;
+        }
+    }
+    if(i == QEM_SMI_MAX_READER_COUNT)
+    {
+        pthread_mutex_unlock(reader->mon_lock);
+        return QEM_SMI_NO_READER_SLOT_ERROR;
+    }
+
+    set_meta(reader, QEM_SMI_META_READER_MASK_OFFSET,
+             QEM_SMI_META_READER_MASK_SIZE, readers | (1 << i));
+    set_meta(reader, QEM_SMI_META_EVICT_MASK_OFFSET,
+             QEM_SMI_META_EVICT_MASK_SIZE,
+             get_meta(reader, QEM_SMI_META_EVICT_MASK_OFFSET,
+                      QEM_SMI_META_EVICT_MASK_SIZE) & ~(1 << i));
+    /* Forget the messages lost by the previous reader of the slot */
+    set_meta(reader, QEM_SMI_META_READER_DROP(i),
+             QEM_SMI_META_READER_DROP_SIZE, 0);
+    /* No event descriptor announced yet */
+    set_meta(reader, QEM_SMI_META_READER_PID(i),
+             QEM_SMI_META_READER_PID_SIZE, 0);
+    reader->reader_id = i;
+
+    pthread_mutex_unlock(reader->mon_lock);
+
+    return 0;
 }
 
-int32_t qem_smi_connect(const uint32_t timeout, const uint32_t max_attempt)
+/* Releases a block for the reader, the monitor lock must be held. */
+static void release_block(qem_smi_reader_t* reader, const uint32_t block)
+{
+    uint32_t pending;
+
+    pending = get_meta(reader, QEM_SMI_META_BLOCK_PEND(block),
+                       QEM_SMI_META_BLOCK_PEND_SIZE) &
+              ~(1 << reader->reader_id);
+    set_meta(reader, QEM_SMI_META_BLOCK_PEND(block),
+             QEM_SMI_META_BLOCK_PEND_SIZE, pending);
+
+    /* Last reader to release the block, let the server reuse it */
+    if(pending == 0)
+    {
+        set_meta(reader, QEM_SMI_META_BLOCK_MASK_OFFSET,
+                 QEM_SMI_META_BLOCK_MASK_SIZE,
+                 get_meta(reader, QEM_SMI_META_BLOCK_MASK_OFFSET,
+                          QEM_SMI_META_BLOCK_MASK_SIZE) & ~(1 << block));
+        pthread_cond_signal(reader->cond_write);
+    }
+}
+
+/* Returns the oldest block pending for the reader, -1 if there is none. The
+ * monitor lock must be held.
+ */
+static int32_t get_next_block(const qem_smi_reader_t* reader)
+{
+    uint32_t i;
+    uint32_t seq;
+    uint32_t best_seq;
+    int32_t  best;
+
+    best     = -1;
+    best_seq = 0;
+    for(i = 0; i < reader->block_count; ++i)
+    {
+        if((get_meta(reader, QEM_SMI_META_BLOCK_PEND(i),
+                     QEM_SMI_META_BLOCK_PEND_SIZE) &
+            (1 << reader->reader_id)) == 0)
+        {
+            continue;
+        }
+
+        seq = get_meta(reader, QEM_SMI_META_BLOCK_SEQ(i),
+                       QEM_SMI_META_BLOCK_SEQ_SIZE);
+        if(best == -1 || (int32_t)(seq - best_seq) < 0)
+        {
+            best     = i;
+            best_seq = seq;
+        }
+    }
+
+    return best;
+}
+
+/* Tells the server which process sends the event descriptor of the reader
+ * slot, 0 when no descriptor is sent.
+ */
+static void set_reader_pid(qem_smi_reader_t* reader, const uint32_t pid)
+{
+    pthread_mutex_lock(reader->mon_lock);
+    set_meta(reader, QEM_SMI_META_READER_PID(reader->reader_id),
+             QEM_SMI_META_READER_PID_SIZE, pid);
+    pthread_mutex_unlock(reader->mon_lock);
+}
+
+/* Creates the reader event file descriptor and gives it to the server. The
+ * reader works without notifications if the server does not provide them.
+ */
+static void create_event_fd(qem_smi_reader_t* reader)
+{
+    struct sockaddr_un addr;
+    struct msghdr      msg;
+    struct iovec       iov;
+    struct cmsghdr*    cmsg;
+    uint64_t           value;
+    ssize_t            written;
+    int32_t            sock;
+    int32_t            id;
+    union
+    {
+        char           buffer[CMSG_SPACE(sizeof(int32_t))];
+        struct cmsghdr align;
+    } control;
+
+    reader->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if(reader->event_fd < 0)
+    {
+        reader->event_fd = -1;
+        return;
+    }
+
+    sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(sock < 0)
+    {
+        close(reader->event_fd);
+        reader->event_fd = -1;
+        return;
+    }
+
+    /* The server socket lives in the abstract namespace */
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    get_name(reader, QEM_SMI_SHARED_SOCKET);
+    memcpy(addr.sun_path + 1, reader->name, strlen(reader->name));
+
+    /* Send the reader slot along with the descriptor */
+    id               = reader->reader_id;
+    iov.iov_base     = &id;
+    iov.iov_len      = sizeof(id);
+    memset(&msg, 0, sizeof(msg));
+    memset(&control, 0, sizeof(control));
+    msg.msg_iov        = &iov;
+    msg.msg_iovlen     = 1;
+    msg.msg_control    = control.buffer;
+    msg.msg_controllen = sizeof(control.buffer);
+    cmsg               = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level   = SOL_SOCKET;
+    cmsg->cmsg_type    = SCM_RIGHTS;
+    cmsg->cmsg_len     = CMSG_LEN(sizeof(int32_t));
+    memcpy(CMSG_DATA(cmsg), &reader->event_fd, sizeof(int32_t));
+
+    /* The server checks the sender against the announced process */
+    set_reader_pid(reader, getpid());
+    if(connect(sock, (struct sockaddr*)&addr,
+               offsetof(struct sockaddr_un, sun_path) + 1 +
+               strlen(reader->name)) != 0 ||
+       sendmsg(sock, &msg, 0) != sizeof(id))
+    {
+        set_reader_pid(reader, 0);
+        close(reader->event_fd);
+        reader->event_fd = -1;
+    }
+    else
+    {
+        /* The server takes the descriptor before writing its next block, the
+         * blocks written before are announced here
+         */
+        value   = 1;
+        written = write(reader->event_fd, &value, sizeof(value));
+        (void)written;
+    }
+
+    close(sock);
+}
+
+/* Resets the reader event file descriptor. */
+static void clear_event_fd(qem_smi_reader_t* reader)
+{
+    uint64_t value;
+
+    if(reader->event_fd != -1)
+    {
+        while(read(reader->event_fd, &value, sizeof(value)) == sizeof(value))
+        {
+            continue;
+        }
+    }
+}
+
+/* Unregisters the reader and returns the number of readers left. */
+static uint32_t unregister_reader(qem_smi_reader_t* reader)
+{
+    uint32_t readers;
+    uint32_t i;
+    uint32_t count;
+
+    pthread_mutex_lock(reader->mon_lock);
+
+    /* Release the blocks the server is still waiting on */
+    if((get_meta(reader, QEM_SMI_META_EVICT_MASK_OFFSET,
+                 QEM_SMI_META_EVICT_MASK_SIZE) &
+        (1 << reader->reader_id)) == 0)
+    {
+        for(i = 0; i < reader->block_count; ++i)
+        {
+            if((get_meta(reader, QEM_SMI_META_BLOCK_PEND(i),
+                         QEM_SMI_META_BLOCK_PEND_SIZE) &
+                (1 << reader->reader_id)) != 0)
+            {
+                release_block(reader, i);
+            }
+        }
+    }
+
+    readers = get_meta(reader, QEM_SMI_META_READER_MASK_OFFSET,
+                       QEM_SMI_META_READER_MASK_SIZE) &
+              ~(1 << reader->reader_id);
+    set_meta(reader, QEM_SMI_META_READER_MASK_OFFSET,
+             QEM_SMI_META_READER_MASK_SIZE, readers);
+
+    pthread_mutex_unlock(reader->mon_lock);
+
+    reader->reader_id = -1;
+
+    count = 0;
+    for(i = 0; i < QEM_SMI_MAX_READER_COUNT; ++i)
+    {
+        count += (readers >> i) & 0x1;
+    }
+    return count;
+}
+
+void qem_smi_reader_init(qem_smi_reader_t* reader)
+{
+    memset(reader, 0, sizeof(qem_smi_reader_t));
+
+    reader->shm_fd        = -1;
+    reader->server_sem    = SEM_FAILED;
+    reader->client_sem    = SEM_FAILED;
+    reader->mon_lock      = (pthread_mutex_t*)MAP_FAILED;
+    reader->mon_lock_fd   = -1;
+    reader->cond_read     = (pthread_cond_t*)MAP_FAILED;
+    reader->cond_read_fd  = -1;
+    reader->cond_write    = (pthread_cond_t*)MAP_FAILED;
+    reader->cond_write_fd = -1;
+    reader->reader_id     = -1;
+    reader->event_fd      = -1;
+
+    /* Default session */
+    qem_smi_reader_set_session(reader, getenv(QEM_SMI_SESSION_ENV));
+
+    reader->error_code = QEM_SMI_NOT_CONNECTED;
+}
+
+int32_t qem_smi_reader_set_session(qem_smi_reader_t* reader, 
+                                   const char* session)
+{
+    if(session == NULL)
+    {
+        reader->session[0] = 0;
+        return 0;
+    }
+
+    if(strlen(session) > QEM_SMI_SESSION_MAX || strchr(session, '/') != NULL)
+    {
+        return QEM_SMI_SESSION_ERROR;
+    }
+
+    strcpy(reader->session, session);
+    return 0;
+}
+
+int32_t qem_smi_reader_set_channel(qem_smi_reader_t* reader,
+                                   const uint32_t channel)
+{
+    if(channel >= QEM_SMI_MAX_CHANNEL_COUNT)
+    {
+        return QEM_SMI_CHANNEL_ERROR;
+    }
+
+    reader->channel = channel;
+    return 0;
+}
+
+int32_t qem_smi_reader_connect(qem_smi_reader_t* reader,
+                               const uint32_t timeout,
+                               const uint32_t max_attempt)
 {
     uint32_t buffer;
     uint32_t attempt;
@@ -218,9 +513,9 @@ int32_t qem_smi_connect(const uint32_t timeout, const uint32_t max_attempt)
     ts.tv_sec = timeout;
     ts.tv_nsec = 0;
 
-    if(error_code != QEM_SMI_NOT_CONNECTED)
+    if(reader->error_code != QEM_SMI_NOT_CONNECTED)
     {
-        qem_smi_disconnect();
+        qem_smi_reader_disconnect(reader);
         return QEM_SMI_NOT_CONNECTED_ERROR;
     }
 
@@ -228,8 +523,8 @@ int32_t qem_smi_connect(const uint32_t timeout, const uint32_t max_attempt)
     attempt = 0;
     while(attempt < max_attempt)
     {
-        server_sem = sem_open(QEM_SMI_SHARED_SEM_SERVER, O_RDWR);
-        if(server_sem != SEM_FAILED)
+        reader->server_sem = sem_open(get_name(reader, QEM_SMI_SHARED_SEM_SERVER), O_RDWR);
+        if(reader->server_sem != SEM_FAILED)
         {
             break;
         }
@@ -237,149 +532,280 @@ int32_t qem_smi_connect(const uint32_t timeout, const uint32_t max_attempt)
         ++attempt;
         nanosleep(&ts, NULL);
     }
-    
+
     if(attempt == max_attempt)
     {
-        qem_smi_disconnect();
+        qem_smi_reader_disconnect(reader);
         return QEM_SMI_TIMEOUT_ERROR;
     }
     attempt = 0;
     while(attempt < max_attempt)
     {
-        client_sem = sem_open(QEM_SMI_SHARED_SEM_CLIENT, O_RDWR);
-        if(client_sem != SEM_FAILED)
+        reader->client_sem = sem_open(get_name(reader, QEM_SMI_SHARED_SEM_CLIENT), O_RDWR);
+        if(reader->client_sem != SEM_FAILED)
         {
             break;
         }
-        
+
         ++attempt;
         nanosleep(&ts, NULL);
     }
 
     if(attempt == max_attempt)
     {
-        qem_smi_disconnect();
+        qem_smi_reader_disconnect(reader);
         return QEM_SMI_TIMEOUT_ERROR;
     }
 
     /* Handshake with the client */
-    sem_wait(client_sem);
+    sem_wait(reader->client_sem);
 
     /* Retreive the server data */
-    error = mapp_buffer();
+    error = mapp_buffer(reader);
     if(error != 0)
     {
         return error;
     }
 
-    error = createlocal_buffer();
+    error = createlocal_buffer(reader);
     if(error != 0)
     {
         return error;
     }
 
-    error = create_sync();
+    error = create_sync(reader);
     if(error != 0)
     {
         return error;
     }
 
-    memcpy(&buffer, shared_buffer_data, sizeof(uint32_t));
+    memcpy(&buffer, reader->shared_buffer_data, sizeof(uint32_t));
     if(buffer != QEM_SMI_HANDSHAKE_MAGIC)
     {
-        qem_smi_disconnect();
+        qem_smi_reader_disconnect(reader);
         return QEM_SMI_WRONG_MAGIC_ERROR;
     }
 
-    sem_post(server_sem);
+    /* Get a reader slot before acknowledging the handshake */
+    error = register_reader(reader);
+    if(error != 0)
+    {
+        qem_smi_reader_disconnect(reader);
+        return error;
+    }
+
+    /* The server gets the event descriptor before the handshake ends */
+    create_event_fd(reader);
+
+    sem_post(reader->server_sem);
 
     /* The first time we will read we will need to populate the buffer */
-    local_buffer_index = block_size;
+    reader->local_buffer_index = 0;
+    reader->local_buffer_end   = 0;
+    reader->block_seq          = 0;
+    reader->block_gap          = 0;
+    reader->block_drops        = 0;
 
-    error_code = QEM_SMI_CONNECTED;
+    reader->error_code = QEM_SMI_CONNECTED;
 
     return 0;
 }
 
-void qem_smi_disconnect(void)
+void qem_smi_reader_disconnect(qem_smi_reader_t* reader)
 {
-    if(shared_buffer != NULL)
+    uint8_t unlink_shm;
+
+    /* Only the last reader removes the shared objects */
+    unlink_shm = 1;
+    if(reader->reader_id != -1 && reader->mon_lock != MAP_FAILED &&
+       reader->shared_buffer != NULL)
+    {
+        unlink_shm = (unregister_reader(reader) == 0);
+    }
+    reader->reader_id = -1;
+
+    if(reader->shared_buffer != NULL)
     {
-        munmap(shared_buffer, shared_buffer_size);
-        shared_buffer = NULL;
+        munmap(reader->shared_buffer, reader->shared_buffer_size);
+        reader->shared_buffer = NULL;
     }
 
-    if(shm_fd != -1)
+    if(reader->shm_fd != -1)
     {
-        close(shm_fd);
-        shm_unlink(QEM_SMI_SHM_NAME);
-        shm_fd = -1;
+        close(reader->shm_fd);
+        if(unlink_shm != 0)
+        {
+            shm_unlink(get_name(reader, QEM_SMI_SHM_NAME));
+        }
+        reader->shm_fd = -1;
+    }
+
+    if(reader->local_buffer != NULL)
+    {
+        free(reader->local_buffer);
+        reader->local_buffer = NULL;
     }
 
-    if(local_buffer != NULL)
+    if(reader->event_fd != -1)
     {
-        free(local_buffer);
-        local_buffer = NULL;
+        close(reader->event_fd);
+        reader->event_fd = -1;
     }
 
-    if(server_sem != SEM_FAILED)
+    if(reader->server_sem != SEM_FAILED)
     {
-        sem_close(server_sem);
-        sem_unlink(QEM_SMI_SHARED_SEM_SERVER);
-        server_sem = SEM_FAILED;
+        sem_close(reader->server_sem);
+        if(unlink_shm != 0)
+        {
+            sem_unlink(get_name(reader, QEM_SMI_SHARED_SEM_SERVER));
+        }
+        reader->server_sem = SEM_FAILED;
     }
-    if(client_sem != SEM_FAILED)
+    if(reader->client_sem != SEM_FAILED)
     {
-        sem_close(client_sem);
-        sem_unlink(QEM_SMI_SHARED_SEM_CLIENT);
-        client_sem = SEM_FAILED;
+        sem_close(reader->client_sem);
+        if(unlink_shm != 0)
+        {
+            sem_unlink(get_name(reader, QEM_SMI_SHARED_SEM_CLIENT));
+        }
+        reader->client_sem = SEM_FAILED;
     }
 
-    if(mon_lock != MAP_FAILED)
+    if(reader->mon_lock != MAP_FAILED)
     {
-        munmap(mon_lock, sizeof(pthread_mutex_t));
-        mon_lock = (pthread_mutex_t*)MAP_FAILED;
+        munmap(reader->mon_lock, sizeof(pthread_mutex_t));
+        reader->mon_lock = (pthread_mutex_t*)MAP_FAILED;
     }
-    if(mon_lock_fd != -1)
+    if(reader->mon_lock_fd != -1)
     {
-        close(mon_lock_fd);
-        shm_unlink(QEM_SMI_SHARED_MUTEX);
-        mon_lock_fd = -1;
+        close(reader->mon_lock_fd);
+        if(unlink_shm != 0)
+        {
+            shm_unlink(get_name(reader, QEM_SMI_SHARED_MUTEX));
+        }
+        reader->mon_lock_fd = -1;
     }
-    if(cond_read != MAP_FAILED)
+    if(reader->cond_read != MAP_FAILED)
     {
-        munmap(cond_read, sizeof(pthread_cond_t));
-        cond_read = (pthread_cond_t*)MAP_FAILED;
+        munmap(reader->cond_read, sizeof(pthread_cond_t));
+        reader->cond_read = (pthread_cond_t*)MAP_FAILED;
     }
-    if(cond_read_fd != -1)
+    if(reader->cond_read_fd != -1)
     {
-        close(cond_read_fd);
-        shm_unlink(QEM_SMI_SHARED_COND_READ);
-        cond_read_fd = -1;
+        close(reader->cond_read_fd);
+        if(unlink_shm != 0)
+        {
+            shm_unlink(get_name(reader, QEM_SMI_SHARED_COND_READ));
+        }
+        reader->cond_read_fd = -1;
     }
-    if(cond_write != MAP_FAILED)
+    if(reader->cond_write != MAP_FAILED)
     {
-        munmap(cond_write, sizeof(pthread_cond_t));
-        cond_write = (pthread_cond_t*)MAP_FAILED;
+        munmap(reader->cond_write, sizeof(pthread_cond_t));
+        reader->cond_write = (pthread_cond_t*)MAP_FAILED;
     }
-    if(cond_write_fd != -1)
+    if(reader->cond_write_fd != -1)
     {
-        close(cond_write_fd);
-        shm_unlink(QEM_SMI_SHARED_COND_WRITE);
-        cond_write_fd = -1;
+        close(reader->cond_write_fd);
+        if(unlink_shm != 0)
+        {
+            shm_unlink(get_name(reader, QEM_SMI_SHARED_COND_WRITE));
+        }
+        reader->cond_write_fd = -1;
     }
 
-    error_code = QEM_SMI_UNINIT;
+    reader->error_code = QEM_SMI_UNINIT;
 }
 
-int32_t qem_smi_receive(void* buffer, const uint32_t size)
+int32_t qem_smi_reader_get_id(const qem_smi_reader_t* reader)
+{
+    return reader->reader_id;
+}
+
+uint32_t qem_smi_reader_get_channel_count(const qem_smi_reader_t* reader)
+{
+    return reader->channel_count;
+}
+
+uint32_t qem_smi_reader_get_block_seq(const qem_smi_reader_t* reader)
+{
+    return reader->block_seq;
+}
+
+uint32_t qem_smi_reader_get_block_gap(const qem_smi_reader_t* reader)
+{
+    return reader->block_gap;
+}
+
+uint32_t qem_smi_reader_get_drop_count(qem_smi_reader_t* reader)
+{
+    uint32_t drops;
+
+    if(reader->error_code != QEM_SMI_CONNECTED)
+    {
+        return 0;
+    }
+
+    pthread_mutex_lock(reader->mon_lock);
+    drops = get_meta(reader, QEM_SMI_META_DROP_COUNT_OFFSET,
+                     QEM_SMI_META_DROP_COUNT_SIZE);
+    pthread_mutex_unlock(reader->mon_lock);
+
+    return drops;
+}
+
+int32_t qem_smi_reader_get_fd(const qem_smi_reader_t* reader)
+{
+    return reader->event_fd;
+}
+
+int32_t qem_smi_reader_try_receive(qem_smi_reader_t* reader, void* buffer, 
+                                   const uint32_t size)
+{
+    int32_t ready;
+
+    if(reader->error_code != QEM_SMI_CONNECTED)
+    {
+        return QEM_SMI_NOT_CONNECTED_ERROR;
+    }
+
+    if(reader->local_buffer_index + size <= reader->local_buffer_end)
+    {
+        return qem_smi_reader_receive(reader, buffer, size);
+    }
+
+    /* Reset the notification before checking so that a block committed
+     * after the check signals the descriptor again.
+     */
+    clear_event_fd(reader);
+
+    pthread_mutex_lock(reader->mon_lock);
+    ready = (get_next_block(reader) != -1) ||
+            (get_meta(reader, QEM_SMI_META_EVICT_MASK_OFFSET,
+                      QEM_SMI_META_EVICT_MASK_SIZE) & 
+             (1 << reader->reader_id)) != 0;
+    pthread_mutex_unlock(reader->mon_lock);
+
+    if(ready == 0)
+    {
+        return QEM_SMI_WOULD_BLOCK;
+    }
+
+    return qem_smi_reader_receive(reader, buffer, size);
+}
+
+int32_t qem_smi_reader_receive(qem_smi_reader_t* reader, void* buffer,
+                               const uint32_t size)
 {
     uint32_t readSize;
     uint32_t toRead;
     uint32_t read = 0;
-    uint32_t blocks;
+    uint32_t reader_mask;
+    uint32_t block_seq;
+    uint32_t block_drops;
+    int32_t  block;
 
-    if(error_code != QEM_SMI_CONNECTED)
+    if(reader->error_code != QEM_SMI_CONNECTED)
     {
         return QEM_SMI_NOT_CONNECTED_ERROR;
     }
@@ -389,80 +815,359 @@ int32_t qem_smi_receive(void* buffer, const uint32_t size)
         return QEM_SMI_NULL_BUFFER_ERROR;
     }
 
+    reader_mask = 1 << reader->reader_id;
     readSize  = size;
-    while(local_buffer_index + readSize > block_size)
+    while(reader->local_buffer_index + readSize > reader->local_buffer_end)
     {
         /* Read as much as we can */
-        toRead = block_size - local_buffer_index;
+        toRead = reader->local_buffer_end - reader->local_buffer_index;
 
         if(toRead > 0)
         {
             memcpy((uint8_t*)buffer + read,
-                local_buffer + local_buffer_index,
+                reader->local_buffer + reader->local_buffer_index,
                 toRead);
 
             read += toRead;
             readSize -= toRead;
         }
 
-        local_buffer_index = 0;
-
-        pthread_mutex_lock(mon_lock);
+        reader->local_buffer_index = 0;
+        reader->local_buffer_end   = 0;
 
-        /* Check if the block is free */
-        memcpy(&blocks,
-               shared_buffer + QEM_SMI_META_BLOCK_MASK_OFFSET,
-               QEM_SMI_META_BLOCK_MASK_SIZE);
+        pthread_mutex_lock(reader->mon_lock);
 
-        while((blocks & (1 << next_block)) == 0)
+        /* Wait for a block to be ready for this reader */
+        while((block = get_next_block(reader)) == -1)
         {
-            pthread_cond_wait(cond_read, mon_lock);
-            memcpy(&blocks,
-               shared_buffer + QEM_SMI_META_BLOCK_MASK_OFFSET,
-               QEM_SMI_META_BLOCK_MASK_SIZE);
+            if((get_meta(reader, QEM_SMI_META_EVICT_MASK_OFFSET,
+                         QEM_SMI_META_EVICT_MASK_SIZE) & reader_mask) != 0)
+            {
+                pthread_mutex_unlock(reader->mon_lock);
+                return QEM_SMI_DETACHED_ERROR;
+            }
+            pthread_cond_wait(reader->cond_read, reader->mon_lock);
         }
 
-        pthread_mutex_unlock(mon_lock);
+        block_seq = get_meta(reader, QEM_SMI_META_BLOCK_SEQ(block),
+                             QEM_SMI_META_BLOCK_SEQ_SIZE);
+        block_drops = get_meta(reader,
+                               QEM_SMI_META_BLOCK_DROP(block,
+                                                       reader->reader_id),
+                               QEM_SMI_META_BLOCK_DROP_SIZE);
+        reader->local_buffer_end = get_meta(reader,
+                                            QEM_SMI_META_BLOCK_USED(block),
+                                            QEM_SMI_META_BLOCK_USED_SIZE);
+
+        pthread_mutex_unlock(reader->mon_lock);
 
         /* This part does not need to be locked as the other end cannot access
          * it before it is set as used in the block mask.
          */
         /* Copy the shared buffer to the local buffer */
-        memcpy(local_buffer,
-               shared_buffer_data +
-                    next_block * block_size,
-               block_size);
+        memcpy(reader->local_buffer,
+               reader->shared_buffer_data +
+                    block * reader->block_size,
+               reader->local_buffer_end);
 
         /* Update metadata */
-        pthread_mutex_lock(mon_lock);
+        pthread_mutex_lock(reader->mon_lock);
+
+        /* The server may have detached us while we were copying the block */
+        if((get_meta(reader, QEM_SMI_META_EVICT_MASK_OFFSET,
+                     QEM_SMI_META_EVICT_MASK_SIZE) & reader_mask) != 0)
+        {
+            pthread_mutex_unlock(reader->mon_lock);
+            return QEM_SMI_DETACHED_ERROR;
+        }
+
+        /* The server may have overwritten the block while we were copying it,
+         * the lost messages are accounted in the drop counter.
+         */
+        if((get_meta(reader, QEM_SMI_META_BLOCK_PEND(block),
+                     QEM_SMI_META_BLOCK_PEND_SIZE) & reader_mask) == 0 ||
+           get_meta(reader, QEM_SMI_META_BLOCK_SEQ(block),
+                    QEM_SMI_META_BLOCK_SEQ_SIZE) != block_seq)
+        {
+            pthread_mutex_unlock(reader->mon_lock);
+            reader->local_buffer_end = 0;
+            continue;
+        }
 
-        memcpy(&blocks,
-               shared_buffer + QEM_SMI_META_BLOCK_MASK_OFFSET,
-               QEM_SMI_META_BLOCK_MASK_SIZE);
-        blocks &= ~(1 << next_block);
-        memcpy(shared_buffer + QEM_SMI_META_BLOCK_MASK_OFFSET,
-               &blocks,
-               QEM_SMI_META_BLOCK_MASK_SIZE);
-        next_block = (next_block + 1) % block_count;
+        release_block(reader, block);
 
-        pthread_cond_signal(cond_write);
+        pthread_mutex_unlock(reader->mon_lock);
 
-        pthread_mutex_unlock(mon_lock);
+        reader->block_seq   = block_seq;
+        reader->block_gap   = block_drops - reader->block_drops;
+        reader->block_drops = block_drops;
     }
 
     /* If there is some rest to read */
     if(readSize != 0)
     {
         memcpy((uint8_t*)buffer + read,
-               local_buffer + local_buffer_index,
+               reader->local_buffer + reader->local_buffer_index,
                readSize);
-        local_buffer_index += readSize;
+        reader->local_buffer_index += readSize;
+    }
+
+    return 0;
+}
+
+void qem_smi_reader_post_server_flush(qem_smi_reader_t* reader)
+{
+    reader->local_buffer_index = reader->local_buffer_end;
+}
+
+void qem_smi_channels_init(qem_smi_channels_t* channels)
+{
+    uint32_t i;
+
+    memset(channels, 0, sizeof(qem_smi_channels_t));
+
+    for(i = 0; i < QEM_SMI_MAX_CHANNEL_COUNT; ++i)
+    {
+        qem_smi_reader_init(&channels->readers[i]);
+        qem_smi_reader_set_channel(&channels->readers[i], i);
+    }
+}
+
+int32_t qem_smi_channels_set_session(qem_smi_channels_t* channels, 
+                                     const char* session)
+{
+    uint32_t i;
+    int32_t  error;
+
+    for(i = 0; i < QEM_SMI_MAX_CHANNEL_COUNT; ++i)
+    {
+        error = qem_smi_reader_set_session(&channels->readers[i], session);
+        if(error != 0)
+        {
+            return error;
+        }
+    }
+
+    return 0;
+}
+
+int32_t qem_smi_channels_connect(qem_smi_channels_t* channels, 
+                                 const uint32_t timeout, 
+                                 const uint32_t max_attempt)
+{
+    uint32_t i;
+    uint32_t count;
+    int32_t  error;
+
+    /* The first channel tells how many channels the session has */
+    error = qem_smi_reader_connect(&channels->readers[0], timeout, 
+                                   max_attempt);
+    if(error != 0)
+    {
+        return error;
+    }
+
+    count = qem_smi_reader_get_channel_count(&channels->readers[0]);
+    if(count == 0 || count > QEM_SMI_MAX_CHANNEL_COUNT)
+    {
+        qem_smi_reader_disconnect(&channels->readers[0]);
+        return QEM_SMI_CHANNEL_ERROR;
+    }
+
+    for(i = 1; i < count; ++i)
+    {
+        error = qem_smi_reader_connect(&channels->readers[i], timeout, 
+                                       max_attempt);
+        if(error != 0)
+        {
+            channels->count = i;
+            qem_smi_channels_disconnect(channels);
+            return error;
+        }
+    }
+
+    channels->count = count;
+    memset(channels->head_state, QEM_SMI_HEAD_EMPTY, 
+           sizeof(channels->head_state));
+
+    return 0;
+}
+
+void qem_smi_channels_disconnect(qem_smi_channels_t* channels)
+{
+    uint32_t i;
+
+    for(i = 0; i < channels->count; ++i)
+    {
+        qem_smi_reader_disconnect(&channels->readers[i]);
+    }
+
+    channels->count = 0;
+}
+
+uint32_t qem_smi_channels_get_count(const qem_smi_channels_t* channels)
+{
+    return channels->count;
+}
+
+qem_smi_reader_t* qem_smi_channels_get_reader(qem_smi_channels_t* channels,
+                                              const uint32_t channel)
+{
+    if(channel >= channels->count)
+    {
+        return NULL;
     }
 
+    return &channels->readers[channel];
+}
+
+int32_t qem_smi_channels_set_merge(qem_smi_channels_t* channels, 
+                                   const uint32_t record_size,
+                                   const uint32_t timestamp_offset)
+{
+    if(record_size > QEM_SMI_MAX_RECORD_SIZE || 
+       timestamp_offset + sizeof(uint64_t) > record_size)
+    {
+        return QEM_SMI_RECORD_ERROR;
+    }
+
+    channels->record_size      = record_size;
+    channels->timestamp_offset = timestamp_offset;
+
     return 0;
 }
 
-void qem_smi_post_server_flush(void) 
+int32_t qem_smi_channels_receive_merged(qem_smi_channels_t* channels, 
+                                        void* buffer)
 {
-    local_buffer_index = block_size;
-}
\ No newline at end of file
+    uint32_t i;
+    uint32_t j;
+    int32_t  error;
+    int32_t  next;
+    uint64_t timestamp;
+    uint64_t next_timestamp;
+
+    if(channels->count == 0)
+    {
+        return QEM_SMI_NOT_CONNECTED_ERROR;
+    }
+    if(channels->record_size == 0)
+    {
+        return QEM_SMI_RECORD_ERROR;
+    }
+    if(buffer == NULL)
+    {
+        return QEM_SMI_NULL_BUFFER_ERROR;
+    }
+
+    /* Get the next record of every running channel */
+    next           = -1;
+    next_timestamp = 0;
+    for(i = 0; i < channels->count; ++i)
+    {
+        if(channels->head_state[i] == QEM_SMI_HEAD_EMPTY)
+        {
+            error = qem_smi_reader_receive(&channels->readers[i], 
+                                           channels->heads[i], 
+                                           channels->record_size);
+            if(error != 0)
+            {
+                return error;
+            }
+
+            /* Check for the end of the channel stream */
+            channels->head_state[i] = QEM_SMI_HEAD_ENDED;
+            for(j = 0; j < channels->record_size; ++j)
+            {
+                if(channels->heads[i][j] != 0)
+                {
+                    channels->head_state[i] = QEM_SMI_HEAD_READY;
+                    break;
+                }
+            }
+            if(channels->head_state[i] == QEM_SMI_HEAD_ENDED)
+            {
+                qem_smi_reader_post_server_flush(&channels->readers[i]);
+            }
+        }
+
+        if(channels->head_state[i] == QEM_SMI_HEAD_READY)
+        {
+            memcpy(&timestamp, 
+                   channels->heads[i] + channels->timestamp_offset, 
+                   sizeof(uint64_t));
+            if(next == -1 || timestamp < next_timestamp)
+            {
+                next           = i;
+                next_timestamp = timestamp;
+            }
+        }
+    }
+
+    /* All the channels ended, return the end record */
+    if(next == -1)
+    {
+        memset(buffer, 0, channels->record_size);
+        return 0;
+    }
+
+    memcpy(buffer, channels->heads[next], channels->record_size);
+    channels->head_state[next] = QEM_SMI_HEAD_EMPTY;
+
+    return 0;
+}
+
+void qem_smi_init(void)
+{
+    qem_smi_reader_init(&default_reader);
+}
+
+int32_t qem_smi_connect(const uint32_t timeout, const uint32_t max_attempt)
+{
+    return qem_smi_reader_connect(&default_reader, timeout, max_attempt);
+}
+
+void qem_smi_disconnect(void)
+{
+    qem_smi_reader_disconnect(&default_reader);
+}
+
+int32_t qem_smi_get_reader_id(void)
+{
+    return qem_smi_reader_get_id(&default_reader);
+}
+
+uint32_t qem_smi_get_block_seq(void)
+{
+    return qem_smi_reader_get_block_seq(&default_reader);
+}
+
+uint32_t qem_smi_get_block_gap(void)
+{
+    return qem_smi_reader_get_block_gap(&default_reader);
+}
+
+uint32_t qem_smi_get_drop_count(void)
+{
+    return qem_smi_reader_get_drop_count(&default_reader);
+}
+
+int32_t qem_smi_receive(void* buffer, const uint32_t size)
+{
+    return qem_smi_reader_receive(&default_reader, buffer, size);
+}
+
+int32_t qem_smi_get_fd(void)
+{
+    return qem_smi_reader_get_fd(&default_reader);
+}
+
+int32_t qem_smi_try_receive(void* buffer, const uint32_t size)
+{
+    return qem_smi_reader_try_receive(&default_reader, buffer, size);
+}
+
+void qem_smi_post_server_flush(void)
+{
+    qem_smi_reader_post_server_flush(&default_reader);
+}
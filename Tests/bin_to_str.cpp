@@ -7,6 +7,8 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 
+#include "../SMILib/include/qem_trace_decoder.h"
+
 //* Tracing acces types, if the access is a read or a write */
 typedef enum
 {
@@ -111,6 +113,30 @@ typedef enum
 } MEM_TRACE_EVENT_EXCLUSIVE_E;
 #define MEM_TRACE_EVENT_EXCLUSIVE_MASK 0x00800000
 
+/* Instruction fetch range, the start record is followed by the offsets
+ * record, its timestamp bit n is set for a fetch n bytes after the start.
+ */
+typedef enum
+{
+    MEM_TRACE_FETCH_RANGE_NONE    = 0x00000000,
+    MEM_TRACE_FETCH_RANGE_START   = 0x08000000,
+    MEM_TRACE_FETCH_RANGE_OFFSETS = 0x10000000
+} MEM_TRACE_FETCH_RANGE_E;
+#define MEM_TRACE_FETCH_RANGE_MASK 0x18000000
+
+/* String block, the start record is followed by the count record, its address
+ * is the number of elements and its timestamp the signed element stride. The
+ * elements of linked blocks are accessed in turn.
+ */
+typedef enum
+{
+    MEM_TRACE_STRING_RANGE_NONE   = 0x00000000,
+    MEM_TRACE_STRING_RANGE_START  = 0x20000000,
+    MEM_TRACE_STRING_RANGE_COUNT  = 0x40000000,
+    MEM_TRACE_STRING_RANGE_LINKED = 0x60000000
+} MEM_TRACE_STRING_RANGE_E;
+#define MEM_TRACE_STRING_RANGE_MASK 0x60000000
+
 typedef struct mem_trace_32
 {
     uint32_t address;
@@ -133,9 +159,155 @@ typedef struct mem_trace_header
     uint8_t  reserved[5];
 }__attribute__((packed)) mem_trace_header_t;
 
+/* Keeps track of the timestamps order */
+static uint64_t lasttime = 0;
+
+/* Prints one access */
+static void print_record(const int size, const qem_trace_record_t* record)
+{
+    mem_trace_32_t w_buf;
+    mem_trace_64_t l_buf;
+
+    w_buf.address   = record->address;
+    w_buf.timestamp = record->timestamp;
+    w_buf.flags     = record->flags;
+    l_buf.address   = record->address;
+    l_buf.timestamp = record->timestamp;
+    l_buf.flags     = record->flags;
+
+    if(size == sizeof(mem_trace_32_t))
+    {
+        ((w_buf.flags & MEM_TRACE_EVENT_MASK) == MEM_TRACE_EVENT_DCBZ) ? printf("D ") : (
+            ((w_buf.flags & MEM_TRACE_EVENT_MASK) == MEM_TRACE_EVENT_PREFETCH) ? printf("P ") : (
+                ((w_buf.flags & MEM_TRACE_EVENT_MASK) == MEM_TRACE_EVENT_UNLOCK) ? printf("U ") : (
+                     ((w_buf.flags & MEM_TRACE_EVENT_LOCK) == MEM_TRACE_EVENT_LOCK) ? printf("L ") : (
+                             ((w_buf.flags & MEM_TRACE_EVENT_MASK) == (MEM_TRACE_EVENT_INVALIDATE | MEM_TRACE_EVENT_FLUSH)) ? printf("FL/INV ") : (
+                                 ((w_buf.flags & MEM_TRACE_EVENT_MASK) == MEM_TRACE_EVENT_INVALIDATE) ? printf("INV ") : (
+                                     ((w_buf.flags & MEM_TRACE_EVENT_MASK) == MEM_TRACE_EVENT_FLUSH) ? printf("FL ") : ((w_buf.flags & MEM_TRACE_DATA_TYPE_INST) ? printf("I "): printf("D "))))))));
+
+
+        if(w_buf.flags & MEM_TRACE_ACCESS_TYPE_WRITE)
+        {
+            printf("ST ");
+        }
+        else
+        {
+            printf("LD ");
+        }
+
+        if(lasttime > w_buf.timestamp)
+        {
+            printf("ERROR WRONG TIMESTAMP\n");
+            exit(-1);
+        }
+        lasttime = w_buf.timestamp;
+
+        printf("| P 0x%08x | Core %d | Time %llu | RW: %c | ID: %c | PL: %c | E: %c | G: %c | S: %c | CR: %c | CL: %c | CI: %c | WT: %c | EX: %c\n",
+                w_buf.address, w_buf.flags & 0xFF, w_buf.timestamp,
+               (w_buf.flags & MEM_TRACE_ACCESS_TYPE_WRITE) ? 'W' : 'R',
+
+               (w_buf.flags & MEM_TRACE_DATA_TYPE_INST) ? 'I' : 'D',
+
+               (w_buf.flags & MEM_TRACE_PL_USER) ? 'U' : 'K',
+
+               ((w_buf.flags & MEM_TRACE_EVENT_MASK) == MEM_TRACE_EVENT_DCBZ) ? 'D' : (
+                   ((w_buf.flags & MEM_TRACE_EVENT_MASK) == MEM_TRACE_EVENT_PREFETCH) ? 'P' : (
+                       ((w_buf.flags & MEM_TRACE_EVENT_MASK) == MEM_TRACE_EVENT_UNLOCK) ? 'U' : (
+                            ((w_buf.flags & MEM_TRACE_EVENT_MASK) == MEM_TRACE_EVENT_LOCK) ? 'L' : (
+                                    ((w_buf.flags & MEM_TRACE_EVENT_MASK) == (MEM_TRACE_EVENT_INVALIDATE | MEM_TRACE_EVENT_FLUSH)) ? 'B' : (
+                                        ((w_buf.flags & MEM_TRACE_EVENT_MASK) == MEM_TRACE_EVENT_INVALIDATE) ? 'I' : (
+                                            ((w_buf.flags & MEM_TRACE_EVENT_MASK) == MEM_TRACE_EVENT_FLUSH) ? 'F' : 'A')))))),
+
+               ((w_buf.flags & MEM_TRACE_GRANULARITY_MASK) == MEM_TRACE_GRANULARITY_SET) ? 'S' :
+               ((w_buf.flags & MEM_TRACE_GRANULARITY_MASK) == MEM_TRACE_GRANULARITY_WAY) ? 'W' :
+               ((w_buf.flags & MEM_TRACE_GRANULARITY_MASK) == MEM_TRACE_GRANULARITY_GLOBAL) ? 'G' : 'L',
+
+               ((w_buf.flags & MEM_TRACE_DATA_SIZE_MASK) == MEM_TRACE_DATA_SIZE_16_BITS) ? 'H' :
+               ((w_buf.flags & MEM_TRACE_DATA_SIZE_MASK) == MEM_TRACE_DATA_SIZE_32_BITS) ? 'W' :
+               ((w_buf.flags & MEM_TRACE_DATA_SIZE_MASK) == MEM_TRACE_DATA_SIZE_64_BITS) ? 'D' : 'B',
+
+               (w_buf.flags & MEM_TRACE_COHERENCY_REQ) ? 'Y' : 'N',
+
+               ((w_buf.flags & MEM_TRACE_CACHE_LEVEL_MASK) == MEM_TRACE_CACHE_LEVEL_ALL) ? 'A' :
+               ((w_buf.flags & MEM_TRACE_CACHE_LEVEL_MASK) == MEM_TRACE_CACHE_LEVEL_3) ? '3' :
+               ((w_buf.flags & MEM_TRACE_CACHE_LEVEL_MASK) == MEM_TRACE_CACHE_LEVEL_2) ? '2' : '1',
+
+               (w_buf.flags & MEM_TRACE_CACHE_INHIBIT_ON) ? 'Y' : 'N',
+
+               (w_buf.flags & MEM_TRACE_CACHE_WT_ON) ? 'E' : 'D',
+
+               (w_buf.flags & MEM_TRACE_EVENT_EXCLUSIVE) ? 'Y' : 'N'
+            );
+    }
+
+    else
+    {
+        ((l_buf.flags & MEM_TRACE_EVENT_DCBZ) == MEM_TRACE_EVENT_DCBZ) ? printf("D ") : (
+            ((l_buf.flags & MEM_TRACE_EVENT_PREFETCH) == MEM_TRACE_EVENT_PREFETCH) ? printf("P ") : (
+                ((l_buf.flags & MEM_TRACE_EVENT_UNLOCK) == MEM_TRACE_EVENT_UNLOCK) ? printf("U ") : (
+                     ((l_buf.flags & MEM_TRACE_EVENT_LOCK) == MEM_TRACE_EVENT_LOCK) ? printf("L ") : (
+                             ((l_buf.flags & (MEM_TRACE_EVENT_INVALIDATE | MEM_TRACE_EVENT_FLUSH)) == (MEM_TRACE_EVENT_INVALIDATE | MEM_TRACE_EVENT_FLUSH)) ? printf("FL/INV ") : (
+                                 ((l_buf.flags & MEM_TRACE_EVENT_INVALIDATE) == MEM_TRACE_EVENT_INVALIDATE) ? printf("INV ") : (
+                                     ((l_buf.flags & MEM_TRACE_EVENT_FLUSH) == MEM_TRACE_EVENT_FLUSH) ? printf("FL ") : ((l_buf.flags & MEM_TRACE_DATA_TYPE_INST) ? printf("I "): printf("D "))))))));
+
+
+        if(l_buf.flags & MEM_TRACE_ACCESS_TYPE_WRITE)
+        {
+            printf("ST ");
+        }
+        else
+        {
+            printf("LD ");
+        }
+        
+        if(lasttime > l_buf.timestamp)
+        {
+            printf("ERROR WRONG TIMESTAMP\n");
+            exit(-1);
+        }
+        lasttime = l_buf.timestamp;
+
+        printf("| P 0x%16x | Core %d | Time %llu | RW: %c | ID: %c | PL: %c | E: %c | G: %c | S: %c | CR: %c | CL: %c | CI: %c | WT: %c | EX: %c\n",
+                l_buf.address, l_buf.flags & 0xFF, l_buf.timestamp,
+               (l_buf.flags & MEM_TRACE_ACCESS_TYPE_WRITE) ? 'W' : 'R',
+
+               (l_buf.flags & MEM_TRACE_DATA_TYPE_INST) ? 'I' : 'D',
+
+               (l_buf.flags & MEM_TRACE_PL_USER) ? 'U' : 'K',
+
+               ((l_buf.flags & MEM_TRACE_EVENT_DCBZ) == MEM_TRACE_EVENT_DCBZ) ? 'D' : (
+                   ((l_buf.flags & MEM_TRACE_EVENT_PREFETCH) == MEM_TRACE_EVENT_PREFETCH) ? 'P' : (
+                       ((l_buf.flags & MEM_TRACE_EVENT_UNLOCK) == MEM_TRACE_EVENT_UNLOCK) ? 'U' : (
+                            ((l_buf.flags & MEM_TRACE_EVENT_LOCK) == MEM_TRACE_EVENT_LOCK) ? 'L' : (
+                                    ((l_buf.flags & (MEM_TRACE_EVENT_INVALIDATE | MEM_TRACE_EVENT_FLUSH)) == (MEM_TRACE_EVENT_INVALIDATE | MEM_TRACE_EVENT_FLUSH)) ? 'B' : (
+                                        ((l_buf.flags & MEM_TRACE_EVENT_INVALIDATE) == MEM_TRACE_EVENT_INVALIDATE) ? 'I' : (
+                                            ((l_buf.flags & MEM_TRACE_EVENT_FLUSH) == MEM_TRACE_EVENT_FLUSH) ? 'F' : 'A')))))),
+
+               ((l_buf.flags & MEM_TRACE_GRANULARITY_SET) == MEM_TRACE_GRANULARITY_SET) ? 'S' :
+               ((l_buf.flags & MEM_TRACE_GRANULARITY_WAY) == MEM_TRACE_GRANULARITY_WAY) ? 'W' :
+               ((l_buf.flags & MEM_TRACE_GRANULARITY_GLOBAL) == MEM_TRACE_GRANULARITY_GLOBAL) ? 'G' : 'L',
+
+               ((l_buf.flags & MEM_TRACE_DATA_SIZE_16_BITS) == MEM_TRACE_DATA_SIZE_16_BITS) ? 'H' :
+               ((l_buf.flags & MEM_TRACE_DATA_SIZE_32_BITS) == MEM_TRACE_DATA_SIZE_32_BITS) ? 'W' :
+               ((l_buf.flags & MEM_TRACE_DATA_SIZE_64_BITS) == MEM_TRACE_DATA_SIZE_64_BITS) ? 'D' : 'B',
+
+               (l_buf.flags & MEM_TRACE_COHERENCY_REQ) ? 'Y' : 'N',
+
+               ((l_buf.flags & MEM_TRACE_CACHE_LEVEL_ALL) == MEM_TRACE_CACHE_LEVEL_ALL) ? 'A' :
+               ((l_buf.flags & MEM_TRACE_CACHE_LEVEL_3) == MEM_TRACE_CACHE_LEVEL_3) ? '3' :
+               ((l_buf.flags & MEM_TRACE_CACHE_LEVEL_2) == MEM_TRACE_CACHE_LEVEL_2) ? '2' : '1',
+
+               (l_buf.flags & MEM_TRACE_CACHE_INHIBIT_ON) ? 'Y' : 'N',
+
+               (l_buf.flags & MEM_TRACE_CACHE_WT_ON) ? 'E' : 'D',
+
+               (l_buf.flags & MEM_TRACE_EVENT_EXCLUSIVE) ? 'Y' : 'N'
+           );
+    }
+}
+
 int main(int argc, char** argv)
 {
-    uint64_t lasttime = 0;
     int size = -1;
     if(argc != 3)
     {
@@ -143,7 +315,7 @@ int main(int argc, char** argv)
         return -1;
     }
     FILE* fdin = fopen(argv[1], "rb");
-    if(fdin < 0)
+    if(fdin == NULL)
     {
         printf("Cannot open input file\n");
         return -1;
@@ -178,136 +350,42 @@ int main(int argc, char** argv)
     //printf("Trace file size %lu, trace size: %d, version %d\n",
     //        header.size, header.struct_size, header.version);
 
+    /* Range being gathered by each core, the records of the other cores may
+     * be interleaved with its records.
+     */
+    static qem_trace_range_t ranges[256];
+    qem_trace_record_t       record;
+    qem_trace_range_t*       range;
+
+    for(int i = 0; i < 256; ++i)
+    {
+        qem_trace_range_init(&ranges[i]);
+    }
+
     while(fread(buffer, size, 1, fdin) == 1)
     {
-        if(size == sizeof(mem_trace_32_t))
+        qem_trace_record_decode(&record, buffer, size);
+        range = &ranges[record.flags & 0xFF];
+        if(qem_trace_range_empty(range) != 0 &&
+           qem_trace_range_starts(&record) == 0)
         {
-            ((w_buf.flags & MEM_TRACE_EVENT_MASK) == MEM_TRACE_EVENT_DCBZ) ? printf("D ") : (
-                ((w_buf.flags & MEM_TRACE_EVENT_MASK) == MEM_TRACE_EVENT_PREFETCH) ? printf("P ") : (
-                    ((w_buf.flags & MEM_TRACE_EVENT_MASK) == MEM_TRACE_EVENT_UNLOCK) ? printf("U ") : (
-                         ((w_buf.flags & MEM_TRACE_EVENT_LOCK) == MEM_TRACE_EVENT_LOCK) ? printf("L ") : (
-                                 ((w_buf.flags & MEM_TRACE_EVENT_MASK) == (MEM_TRACE_EVENT_INVALIDATE | MEM_TRACE_EVENT_FLUSH)) ? printf("FL/INV ") : (
-                                     ((w_buf.flags & MEM_TRACE_EVENT_MASK) == MEM_TRACE_EVENT_INVALIDATE) ? printf("INV ") : (
-                                         ((w_buf.flags & MEM_TRACE_EVENT_MASK) == MEM_TRACE_EVENT_FLUSH) ? printf("FL ") : ((w_buf.flags & MEM_TRACE_DATA_TYPE_INST) ? printf("I "): printf("D "))))))));
-
-
-            if(w_buf.flags & MEM_TRACE_ACCESS_TYPE_WRITE)
-            {
-                printf("ST ");
-            }
-            else
-            {
-                printf("LD ");
-            }
-
-            if(lasttime > w_buf.timestamp)
-            {
-                printf("ERROR WRONG TIMESTAMP\n");
-                exit(-1);
-            }
-            lasttime = w_buf.timestamp;
-
-            printf("| P 0x%08x | Core %d | Time %llu | RW: %c | ID: %c | PL: %c | E: %c | G: %c | S: %c | CR: %c | CL: %c | CI: %c | WT: %c | EX: %c\n",
-                    w_buf.address, w_buf.flags & 0xFF, w_buf.timestamp,
-                   (w_buf.flags & MEM_TRACE_ACCESS_TYPE_WRITE) ? 'W' : 'R',
-
-                   (w_buf.flags & MEM_TRACE_DATA_TYPE_INST) ? 'I' : 'D',
-
-                   (w_buf.flags & MEM_TRACE_PL_USER) ? 'U' : 'K',
-
-                   ((w_buf.flags & MEM_TRACE_EVENT_MASK) == MEM_TRACE_EVENT_DCBZ) ? 'D' : (
-                       ((w_buf.flags & MEM_TRACE_EVENT_MASK) == MEM_TRACE_EVENT_PREFETCH) ? 'P' : (
-                           ((w_buf.flags & MEM_TRACE_EVENT_MASK) == MEM_TRACE_EVENT_UNLOCK) ? 'U' : (
-                                ((w_buf.flags & MEM_TRACE_EVENT_MASK) == MEM_TRACE_EVENT_LOCK) ? 'L' : (
-                                        ((w_buf.flags & MEM_TRACE_EVENT_MASK) == (MEM_TRACE_EVENT_INVALIDATE | MEM_TRACE_EVENT_FLUSH)) ? 'B' : (
-                                            ((w_buf.flags & MEM_TRACE_EVENT_MASK) == MEM_TRACE_EVENT_INVALIDATE) ? 'I' : (
-                                                ((w_buf.flags & MEM_TRACE_EVENT_MASK) == MEM_TRACE_EVENT_FLUSH) ? 'F' : 'A')))))),
-
-                   ((w_buf.flags & MEM_TRACE_GRANULARITY_MASK) == MEM_TRACE_GRANULARITY_SET) ? 'S' :
-                   ((w_buf.flags & MEM_TRACE_GRANULARITY_MASK) == MEM_TRACE_GRANULARITY_WAY) ? 'W' :
-                   ((w_buf.flags & MEM_TRACE_GRANULARITY_MASK) == MEM_TRACE_GRANULARITY_GLOBAL) ? 'G' : 'L',
-
-                   ((w_buf.flags & MEM_TRACE_DATA_SIZE_MASK) == MEM_TRACE_DATA_SIZE_16_BITS) ? 'H' :
-                   ((w_buf.flags & MEM_TRACE_DATA_SIZE_MASK) == MEM_TRACE_DATA_SIZE_32_BITS) ? 'W' :
-                   ((w_buf.flags & MEM_TRACE_DATA_SIZE_MASK) == MEM_TRACE_DATA_SIZE_64_BITS) ? 'D' : 'B',
-
-                   (w_buf.flags & MEM_TRACE_COHERENCY_REQ) ? 'Y' : 'N',
-
-                   ((w_buf.flags & MEM_TRACE_CACHE_LEVEL_MASK) == MEM_TRACE_CACHE_LEVEL_ALL) ? 'A' :
-                   ((w_buf.flags & MEM_TRACE_CACHE_LEVEL_MASK) == MEM_TRACE_CACHE_LEVEL_3) ? '3' :
-                   ((w_buf.flags & MEM_TRACE_CACHE_LEVEL_MASK) == MEM_TRACE_CACHE_LEVEL_2) ? '2' : '1',
-
-                   (w_buf.flags & MEM_TRACE_CACHE_INHIBIT_ON) ? 'Y' : 'N',
-
-                   (w_buf.flags & MEM_TRACE_CACHE_WT_ON) ? 'E' : 'D',
-
-                   (w_buf.flags & MEM_TRACE_EVENT_EXCLUSIVE) ? 'Y' : 'N'
-                );
+            print_record(size, &record);
+            continue;
         }
 
-        else
+        /* Expand the instruction fetch ranges and the string blocks */
+        if(qem_trace_range_add(range, &record) != 0)
         {
-            ((l_buf.flags & MEM_TRACE_EVENT_DCBZ) == MEM_TRACE_EVENT_DCBZ) ? printf("D ") : (
-                ((l_buf.flags & MEM_TRACE_EVENT_PREFETCH) == MEM_TRACE_EVENT_PREFETCH) ? printf("P ") : (
-                    ((l_buf.flags & MEM_TRACE_EVENT_UNLOCK) == MEM_TRACE_EVENT_UNLOCK) ? printf("U ") : (
-                         ((l_buf.flags & MEM_TRACE_EVENT_LOCK) == MEM_TRACE_EVENT_LOCK) ? printf("L ") : (
-                                 ((l_buf.flags & (MEM_TRACE_EVENT_INVALIDATE | MEM_TRACE_EVENT_FLUSH)) == (MEM_TRACE_EVENT_INVALIDATE | MEM_TRACE_EVENT_FLUSH)) ? printf("FL/INV ") : (
-                                     ((l_buf.flags & MEM_TRACE_EVENT_INVALIDATE) == MEM_TRACE_EVENT_INVALIDATE) ? printf("INV ") : (
-                                         ((l_buf.flags & MEM_TRACE_EVENT_FLUSH) == MEM_TRACE_EVENT_FLUSH) ? printf("FL ") : ((l_buf.flags & MEM_TRACE_DATA_TYPE_INST) ? printf("I "): printf("D "))))))));
-
-
-            if(l_buf.flags & MEM_TRACE_ACCESS_TYPE_WRITE)
-            {
-                printf("ST ");
-            }
-            else
-            {
-                printf("LD ");
-            }
-            
-            if(lasttime > l_buf.timestamp)
+            printf("ERROR INVALID RANGE\n");
+            exit(-1);
+        }
+        if(qem_trace_range_complete(range) != 0)
+        {
+            while(qem_trace_range_next(range, &record) != 0)
             {
-                printf("ERROR WRONG TIMESTAMP\n");
-                exit(-1);
+                print_record(size, &record);
             }
-            lasttime = l_buf.timestamp;
-
-            printf("| P 0x%16x | Core %d | Time %llu | RW: %c | ID: %c | PL: %c | E: %c | G: %c | S: %c | CR: %c | CL: %c | CI: %c | WT: %c | EX: %c\n",
-                    l_buf.address, l_buf.flags & 0xFF, l_buf.timestamp,
-                   (l_buf.flags & MEM_TRACE_ACCESS_TYPE_WRITE) ? 'W' : 'R',
-
-                   (l_buf.flags & MEM_TRACE_DATA_TYPE_INST) ? 'I' : 'D',
-
-                   (l_buf.flags & MEM_TRACE_PL_USER) ? 'U' : 'K',
-
-                   ((l_buf.flags & MEM_TRACE_EVENT_DCBZ) == MEM_TRACE_EVENT_DCBZ) ? 'D' : (
-                       ((l_buf.flags & MEM_TRACE_EVENT_PREFETCH) == MEM_TRACE_EVENT_PREFETCH) ? 'P' : (
-                           ((l_buf.flags & MEM_TRACE_EVENT_UNLOCK) == MEM_TRACE_EVENT_UNLOCK) ? 'U' : (
-                                ((l_buf.flags & MEM_TRACE_EVENT_LOCK) == MEM_TRACE_EVENT_LOCK) ? 'L' : (
-                                        ((l_buf.flags & (MEM_TRACE_EVENT_INVALIDATE | MEM_TRACE_EVENT_FLUSH)) == (MEM_TRACE_EVENT_INVALIDATE | MEM_TRACE_EVENT_FLUSH)) ? 'B' : (
-                                            ((l_buf.flags & MEM_TRACE_EVENT_INVALIDATE) == MEM_TRACE_EVENT_INVALIDATE) ? 'I' : (
-                                                ((l_buf.flags & MEM_TRACE_EVENT_FLUSH) == MEM_TRACE_EVENT_FLUSH) ? 'F' : 'A')))))),
-
-                   ((l_buf.flags & MEM_TRACE_GRANULARITY_SET) == MEM_TRACE_GRANULARITY_SET) ? 'S' :
-                   ((l_buf.flags & MEM_TRACE_GRANULARITY_WAY) == MEM_TRACE_GRANULARITY_WAY) ? 'W' :
-                   ((l_buf.flags & MEM_TRACE_GRANULARITY_GLOBAL) == MEM_TRACE_GRANULARITY_GLOBAL) ? 'G' : 'L',
-
-                   ((l_buf.flags & MEM_TRACE_DATA_SIZE_16_BITS) == MEM_TRACE_DATA_SIZE_16_BITS) ? 'H' :
-                   ((l_buf.flags & MEM_TRACE_DATA_SIZE_32_BITS) == MEM_TRACE_DATA_SIZE_32_BITS) ? 'W' :
-                   ((l_buf.flags & MEM_TRACE_DATA_SIZE_64_BITS) == MEM_TRACE_DATA_SIZE_64_BITS) ? 'D' : 'B',
-
-                   (l_buf.flags & MEM_TRACE_COHERENCY_REQ) ? 'Y' : 'N',
-
-                   ((l_buf.flags & MEM_TRACE_CACHE_LEVEL_ALL) == MEM_TRACE_CACHE_LEVEL_ALL) ? 'A' :
-                   ((l_buf.flags & MEM_TRACE_CACHE_LEVEL_3) == MEM_TRACE_CACHE_LEVEL_3) ? '3' :
-                   ((l_buf.flags & MEM_TRACE_CACHE_LEVEL_2) == MEM_TRACE_CACHE_LEVEL_2) ? '2' : '1',
-
-                   (l_buf.flags & MEM_TRACE_CACHE_INHIBIT_ON) ? 'Y' : 'N',
-
-                   (l_buf.flags & MEM_TRACE_CACHE_WT_ON) ? 'E' : 'D',
-
-                   (l_buf.flags & MEM_TRACE_EVENT_EXCLUSIVE) ? 'Y' : 'N'
-               );
+            qem_trace_range_init(range);
         }
     }
     return 0;